@@ -0,0 +1,60 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+
+/**
+ * Example of keeping the last seconds of a stream in memory and dumping them on an event
+ *
+ */
+
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <signal.h>
+
+#include <libsparkproto/sparkproto.h>
+
+using namespace std::chrono_literals;
+using namespace libspark::protocol;
+
+int main() {
+    std::unique_ptr<DeviceEnumeration> deviceEnum = std::make_unique<DeviceEnumeration>();
+    DeviceList deviceList = deviceEnum->discoverDevices();
+
+    if(deviceList.empty()) {
+        std::cout<<"No device was found"<<std::endl;
+        return -1;
+    }
+
+    try {
+        // keep up to 256MB of the stream, a dump holds 5s before and 1s after the event
+        RingRecorderOptions options;
+        options.capacity = 256 << 20;
+        options.preTrigger = 5000;
+        options.postTrigger = 1000;
+        ImageRingRecorder::Ptr blackbox = std::make_shared<ImageRingRecorder>(options);
+
+        // `kill -USR1 <pid>` dumps the ring too
+        ImageRingRecorder::installSignalHandler(SIGUSR1);
+
+        AsyncImageStream::Ptr imgStream = std::make_unique<AsyncImageStream>(deviceList[0]);
+        imgStream->registerEvent(blackbox);
+        imgStream->start();
+
+        std::this_thread::sleep_for(10s);
+        std::cout<<"dumping to "<<blackbox->trigger()<<std::endl;
+        blackbox->waitForDumps();
+
+        imgStream->stop();
+        imgStream->unregisterEvent(blackbox);
+
+        RingRecorderStats stats = blackbox->stats();
+        std::cout<<"ImageSet: "<<stats.recordCount<<", dropped: "<<stats.droppedCount<<", dumps: "<<stats.dumpCount<<std::endl;
+
+    } catch (SparkException &e) {
+        std::cout<<e.toString()<<std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -5,7 +5,7 @@
  * Example of manually controlling gain and exposure using keyboard
  *
  * Press d/e and f/r on the displaying window for adjusting the gain and
- * exposure respectively
+ * exposure respectively, a for toggling the auto exposure of the client
  *
  */
 
@@ -50,19 +50,18 @@ int main() {
     maxGain = 480, minGain = 0,
     exposureStep = 500, gainStep = 10;
 
+    // closed-loop auto exposure on the client, see libspark::protocol::ExposureController
+    ExposureController::Ptr autoExposure;
 
     while (isStreaming) {
         ImageSet imgSet;
         imgStream->recvImageSet(imgSet);
+        if (autoExposure) {
+            autoExposure->onImageEvent(imgSet);
+        }
 
-        cv::Mat image(cv::Size(imgSet.meta().left().width(),
-                               imgSet.meta().left().height()),
-                      CV_8UC3,
-                      (void*)imgSet.getBuffer(ImageSet::BUFFER_LEFT).data(),
-                      cv::Mat::AUTO_STEP);
-
-        cv::Mat bgrImg;
-        cv::cvtColor(image, bgrImg, cv::COLOR_RGB2BGR);
+        cv::Mat bgrImg(imgSet.imageHeight(), imgSet.imageWidth(), CV_8UC3);
+        convertPlane(imgSet, ImageSet::BUFFER_LEFT, PIXEL_BGR8, bgrImg.data, bgrImg.step);
         cv::imshow("left camera", bgrImg);
 
         int k = cv::waitKey(1);
@@ -119,13 +118,28 @@ int main() {
             }
             break;
         
+        case 65: // A
+        case 97: // a
+            if (autoExposure) {
+                ExposureControlStats stats = autoExposure->stats();
+                autoExposure.reset();
+                currExposure = stats.exposure;
+                currGain = stats.gain;
+                std::cout << "Auto exposure off. Exposure: " << currExposure
+                          << " gain: " << currGain << std::endl;
+            } else {
+                autoExposure = std::make_shared<ExposureController>(deviceList[0]);
+                std::cout << "Auto exposure on" << std::endl;
+            }
+            break;
+
         case 27: // ESC
             isStreaming = false;
             break;
 
         default:
             std::cout
-                << "Press d/e for adjusting exposure; f/r for gain; ESC for quit"
+                << "Press d/e for adjusting exposure; f/r for gain; a for auto exposure; ESC for quit"
                 << std::endl;
             break;
         }
@@ -0,0 +1,46 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+
+/**
+ * Example of archiving a stream to a file without receiving the images in user space
+ *
+ */
+
+#include <iostream>
+
+#include <libsparkproto/sparkproto.h>
+
+using namespace libspark::protocol;
+
+int main() {
+    std::unique_ptr<DeviceEnumeration> deviceEnum = std::make_unique<DeviceEnumeration>();
+    DeviceList deviceList = deviceEnum->discoverDevices();
+
+    if(deviceList.empty()) {
+        std::cout<<"No device was found"<<std::endl;
+        return -1;
+    }
+
+    try {
+        ImageStreamArchiver::Ptr archiver = std::make_unique<ImageStreamArchiver>(deviceList[0], "archive.sparkrec");
+        archiver->setStreamType(StreamType::STREAM_LEFT|StreamType::STREAM_RIGHT);
+        archiver->start();
+
+        // archive 1000 ImageSet, only their ImageSetMeta is parsed
+        for(int i = 0; i < 1000; i++) {
+            ImageSetMeta meta;
+            archiver->archiveImageSet(meta);
+        }
+        archiver->stop();
+        archiver->close();
+
+        std::cout<<"archived "<<archiver->recordCount()<<" ImageSet, "<<archiver->writtenBytes()<<" bytes"<<std::endl;
+
+    } catch (SparkException &e) {
+        std::cout<<e.toString()<<std::endl;
+        return 1;
+    }
+
+    return 0;
+}
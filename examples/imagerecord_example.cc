@@ -0,0 +1,61 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+
+/**
+ * Example of recording a stream to a file and playing it back as a virtual device
+ *
+ */
+
+#include <iostream>
+
+#include <libsparkproto/sparkproto.h>
+
+using namespace libspark::protocol;
+
+int main() {
+    std::unique_ptr<DeviceEnumeration> deviceEnum = std::make_unique<DeviceEnumeration>();
+    DeviceList deviceList = deviceEnum->discoverDevices();
+
+    if(deviceList.empty()) {
+        std::cout<<"No device was found"<<std::endl;
+        return -1;
+    }
+
+    try {
+        // record 100 ImageSet of left image and disparity
+        ImageStream::Ptr imgStream = std::make_unique<ImageStream>(deviceList[0]);
+        imgStream->setStreamType(StreamType::STREAM_LEFT|StreamType::STREAM_DISPARITY);
+        imgStream->setImageFormat(ImageFormat::FORMAT_RGB);
+
+        ImageRecorder recorder("capture.sparkrec");
+        imgStream->start();
+        for(int i = 0; i < 100; i++) {
+            ImageSet imgSet;
+            imgStream->recvImageSet(imgSet);
+            recorder.write(imgSet);
+        }
+        imgStream->stop();
+        recorder.close();
+
+        // play back the recording twice as fast as it was recorded, from the 50th ImageSet
+        ImagePlayback::Ptr playback = std::make_shared<ImagePlayback>("capture.sparkrec");
+        playback->setPlaybackRate(2.0);
+        playback->seekToIndex(50);
+
+        ImageStream::Ptr playbackStream = std::make_unique<ImageStream>(playback);
+        playbackStream->start();
+        for(uint64_t i = playback->position(); i < playback->recordCount(); i++) {
+            ImageSet imgSet;
+            playbackStream->recvImageSet(imgSet);
+            std::cout<<"ImageSet "<<i<<", timestamp: "<<imgSet.imageTimestamp()<<std::endl;
+        }
+        playbackStream->stop();
+
+    } catch (SparkException &e) {
+        std::cout<<e.toString()<<std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -38,16 +38,26 @@ int main() {
         return 1;
     }
 
+    cv::Mat bgrImg;
     for(int i = 0; i < 1000; i++) {
         ImageSet imgSet;
-        imgStream->recvImageSet(imgSet);
 
-        cv::Mat image(cv::Size(imgSet.meta().left().width(), imgSet.meta().left().height()),
-                    CV_8UC3, (void*)imgSet.getBuffer(ImageSet::BUFFER_LEFT).data(), cv::Mat::AUTO_STEP
-                    );
+        if(bgrImg.empty()) {
+            // size of images is known after the first ImageSet
+            imgStream->recvImageSet(imgSet);
+            bgrImg.create(imgSet.imageHeight(), imgSet.imageWidth(), CV_8UC3);
+            convertPlane(imgSet, ImageSet::BUFFER_LEFT, PIXEL_BGR8, bgrImg.data, bgrImg.step);
+        } else {
+            // left image is converted to BGR while it is received
+            PlaneOutput output;
+            output.id = ImageSet::BUFFER_LEFT;
+            output.format = PIXEL_BGR8;
+            output.data = bgrImg.data;
+            output.stride = bgrImg.step;
+            output.capacity = bgrImg.step * bgrImg.rows;
+            imgStream->recvImageSet(imgSet, output);
+        }
 
-        cv::Mat bgrImg;
-        cv::cvtColor(image, bgrImg, cv::COLOR_RGB2BGR);
         cv::imshow("left camera", bgrImg);
         cv::waitKey(1);
     }
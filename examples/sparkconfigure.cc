@@ -8,6 +8,7 @@
  */
 
 #include <getopt.h>
+#include <chrono>
 #include <vector>
 #include <map>
 #include <iostream>
@@ -120,6 +121,10 @@ static void configCmdInput(Commandline *cmd) {
     cmd->add("led", "Turn on or off LED (true/false)");
     cmd->add("led_brightness", "Set brightness level of led (0-3)");
     cmd->add("export_calib", "Export calibration data to a file (string)");
+    cmd->add("save_profile", "Save the settings of the device to a profile file (string)");
+    cmd->add("apply_profile", "Write the settings of a profile file which differ on the device (string)");
+    cmd->addBool("all_devices", "Apply the profile, exp_val or gain_val to all discovered devices at once");
+    cmd->add("parallel", "Devices the profile is applied to at a time, default 8 (int)");
 }
 
 struct RequestParameters {
@@ -145,6 +150,11 @@ struct RequestParameters {
     int ledBrightnessLevel;
     // export calibration
     std::string calibOutputPath;
+    // profiles
+    std::string saveProfilePath;
+    std::string applyProfilePath;
+    bool allDevices;
+    int parallelism = 8;
 } request;
 
 int main(int argc, char **argv) {
@@ -186,8 +196,60 @@ int main(int argc, char **argv) {
 
     try {
 
+        if(cmd.get("apply_profile", request.applyProfilePath)){
+            ParameterProfile profile = ParameterProfile::load(request.applyProfilePath);
+            DeviceList devices{dev};
+            if(cmd.get("all_devices", request.allDevices)){
+                devices = deviceList;
+            }
+            cmd.get("parallel", request.parallelism);
+
+            auto start = std::chrono::steady_clock::now();
+            std::vector<ProfileResult> results = DeviceParamConfigure::applyProfile(devices, profile, request.parallelism);
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+            int failed = 0;
+            for(size_t i = 0; i < results.size(); i++){
+                std::cout<<devices[i]->getIpAdress()<<": ";
+                if(results[i].succeeded){
+                    std::cout<<"written "<<results[i].writtenCount<<", unchanged "<<results[i].unchangedCount<<", overridden "<<results[i].overriddenCount<<std::endl;
+                }
+                else{
+                    std::cout<<"failed, "<<results[i].error<<std::endl;
+                    failed++;
+                }
+            }
+            std::cout<<"Applied profile to "<<results.size() - failed<<"/"<<results.size()<<" devices in "<<elapsed.count()<<" ms"<<std::endl;
+            return failed ? 1 : 0;
+        }
+
+        if(cmd.get("all_devices", request.allDevices) && (cmd.get("exp_val", request.manualExpVal) || cmd.get("gain_val", request.manualGainVal))){
+            // same value on all devices at once, e.g. matched exposure of a rig
+            DeviceGroup group(deviceList);
+            GroupWriteResult result = cmd.get("exp_val", request.manualExpVal) ? group.setExposureValue(request.manualExpVal)
+                                                                              : group.setGainValue(request.manualGainVal);
+            for(size_t i = 0; i < result.devices.size(); i++){
+                std::cout<<deviceList[i]->getIpAdress()<<": ";
+                if(result.devices[i].succeeded){
+                    std::cout<<"written in "<<result.devices[i].latency<<" ms"<<std::endl;
+                }
+                else{
+                    std::cout<<"failed, "<<result.devices[i].message<<std::endl;
+                }
+            }
+            std::cout<<"Written to "<<result.devices.size() - result.failedCount<<"/"<<result.devices.size()<<" devices, skew "<<result.skew<<" ms"<<std::endl;
+            return result.succeeded ? 0 : 1;
+        }
+
         DeviceParamConfigure configure(dev);
 
+        if(cmd.get("save_profile", request.saveProfilePath)){
+            ParameterProfile profile = configure.snapshotProfile();
+            profile.save(request.saveProfilePath);
+            std::cout<<"Saved "<<profile.size()<<" settings to: "<<request.saveProfilePath<<std::endl;
+            return 0;
+        }
+
         if(cmd.get("autoexp", request.enableAutoExp)){
             configure.setAutoExposure(request.enableAutoExp);
             std::cout<<"AutoExposure: "<<configure.getAutoExposure()<<std::endl;
@@ -256,16 +318,18 @@ int main(int argc, char **argv) {
         }
 
         if(cmd.get("all", request.requestAllParam)){
-            std::cout<<"AutoExposure: "<<configure.getAutoExposure()<<std::endl;
-            std::cout<<"AutoExposureMode: "<<configure.getAutoExposureMode()<<std::endl;
-            std::cout<<"ExposureValue: "<<configure.getExposureValue()<<std::endl;
-            std::cout<<"AutoWB: "<<configure.getAutoWhiteBalance()<<std::endl;
-            std::cout<<"AutoWBMode: "<<configure.getAutoWhiteBalanceMode()<<std::endl;
-            std::cout<<"WBValue: "<<configure.getWhiteBalanceValue()<<std::endl;
-            std::cout<<"Resolution index: "<<configure.getResolution()<<std::endl;
-            std::cout<<"GainValue: "<<configure.getGainValue()<<std::endl;
-            std::cout<<"LedMode: "<<configure.getLedMode()<<std::endl;
-            std::cout<<"LedBrightnessLevel: "<<configure.getLedBrightnessLevel()<<std::endl;
+            // read in one round trip
+            DeviceSettings settings = configure.readSettings();
+            std::cout<<"AutoExposure: "<<settings.autoExposure<<std::endl;
+            std::cout<<"AutoExposureMode: "<<settings.autoExposureMode<<std::endl;
+            std::cout<<"ExposureValue: "<<settings.exposure<<std::endl;
+            std::cout<<"AutoWB: "<<settings.autoWhiteBalance<<std::endl;
+            std::cout<<"AutoWBMode: "<<settings.autoWhiteBalanceMode<<std::endl;
+            std::cout<<"WBValue: "<<settings.whiteBalance<<std::endl;
+            std::cout<<"Resolution index: "<<settings.resolution<<std::endl;
+            std::cout<<"GainValue: "<<settings.gain<<std::endl;
+            std::cout<<"LedMode: "<<settings.ledMode<<std::endl;
+            std::cout<<"LedBrightnessLevel: "<<settings.ledBrightnessLevel<<std::endl;
         }
 
     } catch (SparkException &e){
@@ -13,6 +13,11 @@ AsyncImageStream::AsyncImageStream(std::shared_ptr<DeviceInfo> pDevice)
 
 }
 
+AsyncImageStream::AsyncImageStream(std::shared_ptr<IImageSource> pSource)
+    :_pImpl(new AsyncImageStreamImpl(pSource)) {
+
+}
+
 AsyncImageStream::~AsyncImageStream() {
 
 }
@@ -25,6 +30,14 @@ void AsyncImageStream::stop() {
     _pImpl->stop();
 }
 
+bool AsyncImageStream::isStreaming() {
+    return _pImpl->isStreaming();
+}
+
+std::string AsyncImageStream::error() {
+    return _pImpl->error();
+}
+
 void AsyncImageStream::setStreamType(int32_t streamType) {
     _pImpl->setStreamType(streamType);
 }
@@ -6,6 +6,7 @@
 #include <memory>
 #include <libsparkproto/common.h>
 #include <libsparkproto/deviceinfo.h>
+#include <libsparkproto/iimagesource.h>
 #include <libsparkproto/image.pb.h>
 
 namespace libspark
@@ -27,6 +28,14 @@ public:
      */
     AsyncImageStream(std::shared_ptr<DeviceInfo> pDevice);
 
+    /**
+     * @brief Construct a new AsyncImageStream object which streams from a source other than a device,
+     * for example a recording played back by libspark::protocol::ImagePlayback
+     * 
+     * @param pSource 
+     */
+    AsyncImageStream(std::shared_ptr<IImageSource> pSource);
+
     /**
      * @brief Destroy the AsyncImageStream object
      * 
@@ -47,6 +56,22 @@ public:
      */
     void stop();
 
+    /**
+     * @brief Whether images are received. The stream stops when the source fails, e.g. the connection is lost or
+     * a recording reached its end, then error() tells why and start() can start it again
+     * 
+     * @return true 
+     * @return false 
+     */
+    bool isStreaming();
+
+    /**
+     * @brief Error of the source which stopped the stream, empty if it was not stopped by a error
+     * 
+     * @return std::string 
+     */
+    std::string error();
+
     /**
      * @brief Set the StreamType. 
      * See list of stream type at libspark::protocol::StreamType.
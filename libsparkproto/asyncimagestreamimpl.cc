@@ -4,21 +4,29 @@
 #include <libsparkproto/asyncimagestreamimpl.h>
 #include <libsparkproto/imagestreamprotocol.h>
 #include <libsparkproto/iimageevent.h>
+#include <libsparkproto/exception.h>
+#include <libsparkproto/log.h>
 
 namespace libspark {
 
 namespace protocol {
 
 AsyncImageStreamImpl::AsyncImageStreamImpl(std::shared_ptr<DeviceInfo> pDevice) 
-    : _pImgStream(new ImageStreamProtocol(pDevice)){
+    : _pImgStream(new ImageStreamProtocol(pDevice)), _isStreaming(false) {
+
+}
+
+AsyncImageStreamImpl::AsyncImageStreamImpl(std::shared_ptr<IImageSource> pSource)
+    : _pImgStream(new ImageStreamProtocol(pSource)), _isStreaming(false) {
 
 }
 
 AsyncImageStreamImpl::~AsyncImageStreamImpl() {
 
-    // call and wait until stream stop if streaming is going
+    // call and wait until stream stop if streaming is going,
+    // a thread which stopped on an error is still joined
     _streamLock.lock();
-    if(_isStreaming) {
+    if(_isStreaming || _streamThreading.joinable()) {
         _streamLock.unlock();
 
         stop();
@@ -29,13 +37,19 @@ AsyncImageStreamImpl::~AsyncImageStreamImpl() {
 }
 
 void AsyncImageStreamImpl::start() {
+    // the thread of a stream which stopped on an error is done, it's joined before a new one starts
+    if(_streamThreading.joinable())
+        _streamThreading.join();
+
     _pImgStream->start();
 
-    _streamThreading = std::thread([&](){
-        _streamLock.lock();
-        _isStreaming = true;
-        _streamLock.unlock();
+    // set before the thread starts, so a stop() right after start() is not missed
+    _streamLock.lock();
+    _isStreaming = true;
+    _error.clear();
+    _streamLock.unlock();
 
+    _streamThreading = std::thread([&](){
         while(1) {
             _streamLock.lock();
             if(!_isStreaming) {
@@ -46,7 +60,17 @@ void AsyncImageStreamImpl::start() {
 
             // receive Image
             ImageSet imgSet;
-            _pImgStream->recvImageSet(imgSet);
+            try {
+                _pImgStream->recvImageSet(imgSet);
+            } catch (SparkException &e) {
+                // source is closed or reached its end, e.g. a recording without looping
+                LOG_ERROR("stream is stopped: %s", e.what());
+                _streamLock.lock();
+                _isStreaming = false;
+                _error = e.what();
+                _streamLock.unlock();
+                break;
+            }
             if(_pImageEvent) {
                 _pImageEvent->onImageEvent(imgSet);
             }
@@ -66,6 +90,16 @@ void AsyncImageStreamImpl::stop() {
     _pImgStream->stop();
 }
 
+bool AsyncImageStreamImpl::isStreaming() {
+    std::lock_guard<std::mutex> lock(_streamLock);
+    return _isStreaming;
+}
+
+std::string AsyncImageStreamImpl::error() {
+    std::lock_guard<std::mutex> lock(_streamLock);
+    return _error;
+}
+
 void AsyncImageStreamImpl::setStreamType(int32_t streamType) {
     _pImgStream->setStreamType(streamType);
 }
@@ -21,6 +21,8 @@ class AsyncImageStreamImpl
 public:
     AsyncImageStreamImpl(std::shared_ptr<DeviceInfo> pDevice);
 
+    AsyncImageStreamImpl(std::shared_ptr<IImageSource> pSource);
+
     virtual ~AsyncImageStreamImpl();
 
     /**
@@ -37,6 +39,21 @@ public:
      */
     void stop();
 
+    /**
+     * @brief Whether images are received, false after stop() or after the source failed
+     * 
+     * @return true 
+     * @return false 
+     */
+    bool isStreaming();
+
+    /**
+     * @brief Error of the source which stopped the stream, empty if it was not stopped by a error
+     * 
+     * @return std::string 
+     */
+    std::string error();
+
     /**
      * @brief Set the StreamType
      * 
@@ -68,6 +85,7 @@ private:
     std::mutex _streamLock;
     std::mutex _streamStopLock;
     bool _isStreaming;
+    std::string _error;
 };
 
 }
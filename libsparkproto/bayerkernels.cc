@@ -0,0 +1,471 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include <libsparkproto/bayerkernels.h>
+
+#if defined(SPARK_CPU_X86)
+    #include <immintrin.h>
+#endif
+
+#if defined(SPARK_CPU_NEON)
+    #include <arm_neon.h>
+#endif
+
+// bodies of kernels are inlined into a wrapper per instruction set, so the compiler vectorizes them for that target
+#define SPARK_KERNEL static inline __attribute__((always_inline))
+
+namespace libspark {
+
+namespace protocol {
+
+namespace bayer {
+
+//
+// unpack
+//
+
+static inline uint16_t scaleSample(uint32_t raw, uint16_t black, uint16_t gain) {
+    uint32_t v = raw > black ? raw - black : 0;
+    return uint16_t((v * gain) >> 10);
+}
+
+static void unpackRowGeneric(Layout layout, const uint8_t *src, uint16_t *dst, uint32_t x, uint32_t width,
+    uint16_t black, uint16_t gainEven, uint16_t gainOdd) {
+
+    // x is a multiple of 4 on packed rows, pixel x starts at byte x * 5 / 4
+    for(; x < width; x += 2) {
+        uint32_t p0, p1;
+        if(layout == LAYOUT_PACKED10) {
+            const uint8_t *group = src + x / 4 * 5;
+            uint32_t i = x % 4;
+            p0 = (group[i] << 2) | ((group[4] >> (2 * i)) & 3);
+            p1 = (group[i + 1] << 2) | ((group[4] >> (2 * i + 2)) & 3);
+        } else {
+            p0 = (src[2 * x] | (src[2 * x + 1] << 8)) & 0x3ff;
+            p1 = (src[2 * x + 2] | (src[2 * x + 3] << 8)) & 0x3ff;
+        }
+        dst[x] = scaleSample(p0, black, gainEven);
+        dst[x + 1] = scaleSample(p1, black, gainOdd);
+    }
+}
+
+#if defined(SPARK_CPU_X86)
+
+// (max(v - black, 0) * gain) >> 10 computed as mulhi((v - black) << 6, gain), v - black fits 10 bits
+__attribute__((target("sse4.1")))
+static inline __m128i scaleSamplesSse41(__m128i v, __m128i black, __m128i gain) {
+    return _mm_mulhi_epu16(_mm_slli_epi16(_mm_subs_epu16(v, black), 6), gain);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i scaleSamplesAvx2(__m256i v, __m256i black, __m256i gain) {
+    return _mm256_mulhi_epu16(_mm256_slli_epi16(_mm256_subs_epu16(v, black), 6), gain);
+}
+
+// 8 pixels of packed RAW10 in the low 10 bytes of a 128-bit lane to 16-bit samples:
+// the high bytes are moved to 16-bit lanes, the byte of low bits is copied to 4 lanes and
+// lane i is multiplied by 4^(3-i) so its 2 bits end up at bit 6
+static const int8_t HI_INDEX[16] = {0, -1, 1, -1, 2, -1, 3, -1, 5, -1, 6, -1, 7, -1, 8, -1};
+static const int8_t LO_INDEX[16] = {4, -1, 4, -1, 4, -1, 4, -1, 9, -1, 9, -1, 9, -1, 9, -1};
+static const int16_t LO_SCALE[8] = {64, 16, 4, 1, 64, 16, 4, 1};
+
+__attribute__((target("sse4.1")))
+static uint32_t unpackRowSse41(Layout layout, const uint8_t *src, uint16_t *dst, uint32_t width,
+    uint16_t black, uint16_t gainEven, uint16_t gainOdd) {
+
+    const __m128i blackVec = _mm_set1_epi16(short(black));
+    const __m128i gainVec = _mm_set1_epi32(int(gainEven | (uint32_t(gainOdd) << 16)));
+    uint32_t x = 0;
+
+    if(layout == LAYOUT_PACKED10) {
+        const __m128i hiIndex = _mm_loadu_si128((const __m128i *)HI_INDEX);
+        const __m128i loIndex = _mm_loadu_si128((const __m128i *)LO_INDEX);
+        const __m128i loScale = _mm_loadu_si128((const __m128i *)LO_SCALE);
+        const __m128i mask3 = _mm_set1_epi16(3);
+        uint32_t rowBytes = width / 4 * 5;
+
+        // a load of 16 bytes for 10 bytes of pixels, it must not read past the row
+        for(; x / 4 * 5 + 16 <= rowBytes; x += 8) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(src + x / 4 * 5));
+            __m128i hi = _mm_slli_epi16(_mm_shuffle_epi8(v, hiIndex), 2);
+            __m128i lo = _mm_and_si128(_mm_srli_epi16(_mm_mullo_epi16(_mm_shuffle_epi8(v, loIndex), loScale), 6), mask3);
+            _mm_storeu_si128((__m128i *)(dst + x), scaleSamplesSse41(_mm_or_si128(hi, lo), blackVec, gainVec));
+        }
+    } else {
+        const __m128i mask10 = _mm_set1_epi16(0x3ff);
+        for(; x + 8 <= width; x += 8) {
+            __m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i *)(src + 2 * x)), mask10);
+            _mm_storeu_si128((__m128i *)(dst + x), scaleSamplesSse41(v, blackVec, gainVec));
+        }
+    }
+    return x;
+}
+
+__attribute__((target("avx2")))
+static uint32_t unpackRowAvx2(Layout layout, const uint8_t *src, uint16_t *dst, uint32_t width,
+    uint16_t black, uint16_t gainEven, uint16_t gainOdd) {
+
+    const __m256i blackVec = _mm256_set1_epi16(short(black));
+    const __m256i gainVec = _mm256_set1_epi32(int(gainEven | (uint32_t(gainOdd) << 16)));
+    uint32_t x = 0;
+
+    if(layout == LAYOUT_PACKED10) {
+        const __m256i hiIndex = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)HI_INDEX));
+        const __m256i loIndex = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)LO_INDEX));
+        const __m256i loScale = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)LO_SCALE));
+        const __m256i mask3 = _mm256_set1_epi16(3);
+        uint32_t rowBytes = width / 4 * 5;
+
+        // 16 pixels in 20 bytes, 10 bytes per 128-bit lane
+        for(; x / 4 * 5 + 26 <= rowBytes; x += 16) {
+            const uint8_t *p = src + x / 4 * 5;
+            __m256i v = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)p)),
+                _mm_loadu_si128((const __m128i *)(p + 10)), 1);
+            __m256i hi = _mm256_slli_epi16(_mm256_shuffle_epi8(v, hiIndex), 2);
+            __m256i lo = _mm256_and_si256(
+                _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_shuffle_epi8(v, loIndex), loScale), 6), mask3);
+            _mm256_storeu_si256((__m256i *)(dst + x), scaleSamplesAvx2(_mm256_or_si256(hi, lo), blackVec, gainVec));
+        }
+    } else {
+        const __m256i mask10 = _mm256_set1_epi16(0x3ff);
+        for(; x + 16 <= width; x += 16) {
+            __m256i v = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(src + 2 * x)), mask10);
+            _mm256_storeu_si256((__m256i *)(dst + x), scaleSamplesAvx2(v, blackVec, gainVec));
+        }
+    }
+    return x;
+}
+
+#endif // SPARK_CPU_X86
+
+#if defined(SPARK_CPU_NEON)
+
+static inline uint16x8_t scaleSamplesNeon(uint16x8_t v, uint16x8_t black, uint16x4_t gain) {
+    v = vqsubq_u16(v, black);
+    uint32x4_t lo = vmull_u16(vget_low_u16(v), gain);
+    uint32x4_t hi = vmull_u16(vget_high_u16(v), gain);
+    return vcombine_u16(vshrn_n_u32(lo, 10), vshrn_n_u32(hi, 10));
+}
+
+static uint32_t unpackRowNeon(Layout layout, const uint8_t *src, uint16_t *dst, uint32_t width,
+    uint16_t black, uint16_t gainEven, uint16_t gainOdd) {
+
+    const uint16x8_t black16 = vdupq_n_u16(black);
+    const uint16_t gains[4] = {gainEven, gainOdd, gainEven, gainOdd};
+    const uint16x4_t gain = vld1_u16(gains);
+    uint32_t x = 0;
+
+    if(layout == LAYOUT_PACKED10) {
+#if defined(__aarch64__)
+        static const uint8_t hiIndex[16] = {0, 255, 1, 255, 2, 255, 3, 255, 5, 255, 6, 255, 7, 255, 8, 255};
+        static const uint8_t loIndex[16] = {4, 255, 4, 255, 4, 255, 4, 255, 9, 255, 9, 255, 9, 255, 9, 255};
+        static const int16_t loShift[8] = {0, -2, -4, -6, 0, -2, -4, -6};
+        const uint8x16_t hiIdx = vld1q_u8(hiIndex);
+        const uint8x16_t loIdx = vld1q_u8(loIndex);
+        const int16x8_t shift = vld1q_s16(loShift);
+        uint32_t rowBytes = width / 4 * 5;
+
+        for(; x / 4 * 5 + 16 <= rowBytes; x += 8) {
+            uint8x16_t v = vld1q_u8(src + x / 4 * 5);
+            uint16x8_t hi = vshlq_n_u16(vreinterpretq_u16_u8(vqtbl1q_u8(v, hiIdx)), 2);
+            uint16x8_t lo = vandq_u16(vshlq_u16(vreinterpretq_u16_u8(vqtbl1q_u8(v, loIdx)), shift), vdupq_n_u16(3));
+            vst1q_u16(dst + x, scaleSamplesNeon(vorrq_u16(hi, lo), black16, gain));
+        }
+#endif
+    } else {
+        const uint16x8_t mask10 = vdupq_n_u16(0x3ff);
+        for(; x + 8 <= width; x += 8) {
+            uint16x8_t v = vandq_u16(vld1q_u16((const uint16_t *)(src + 2 * x)), mask10);
+            vst1q_u16(dst + x, scaleSamplesNeon(v, black16, gain));
+        }
+    }
+    return x;
+}
+
+#endif // SPARK_CPU_NEON
+
+void unpackRow(Layout layout, const uint8_t *src, uint16_t *dst, uint32_t width,
+    uint16_t black, uint16_t gainEven, uint16_t gainOdd, cpu::Level level) {
+
+    uint32_t x = 0;
+    switch (level)
+    {
+#if defined(SPARK_CPU_X86)
+    case cpu::LEVEL_AVX2:
+        x = unpackRowAvx2(layout, src, dst, width, black, gainEven, gainOdd);
+        break;
+    case cpu::LEVEL_SSE41:
+        x = unpackRowSse41(layout, src, dst, width, black, gainEven, gainOdd);
+        break;
+#endif
+#if defined(SPARK_CPU_NEON)
+    case cpu::LEVEL_NEON:
+        x = unpackRowNeon(layout, src, dst, width, black, gainEven, gainOdd);
+        break;
+#endif
+    default:
+        break;
+    }
+    // rest of the row
+    unpackRowGeneric(layout, src, dst, x, width, black, gainEven, gainOdd);
+}
+
+//
+// borders
+//
+
+void mirrorRowBorder(const PaddedPlane &plane, int y) {
+    uint16_t *row = plane.row(y);
+    for(int i = 1; i <= PaddedPlane::PAD; i++) {
+        row[-i] = row[i];
+        row[plane.width - 1 + i] = row[plane.width - 1 - i];
+    }
+}
+
+void mirrorTopBottom(const PaddedPlane &plane) {
+    size_t rowSize = size_t(plane.stride) * sizeof(uint16_t);
+    for(int i = 1; i <= PaddedPlane::PAD; i++) {
+        memcpy(plane.row(-i) - PaddedPlane::PAD, plane.row(i) - PaddedPlane::PAD, rowSize);
+        memcpy(plane.row(plane.height - 1 + i) - PaddedPlane::PAD,
+            plane.row(plane.height - 1 - i) - PaddedPlane::PAD, rowSize);
+    }
+}
+
+//
+// demosaic
+//
+
+// per row scratch of a band, full rows of 32-bit values are simple loops the compiler vectorizes
+struct RowScratch {
+    explicit RowScratch(int width) : r(width), g(width), b(width), h(width), v(width), d(width) {}
+
+    std::vector<int32_t> r, g, b;
+    // horizontal, vertical and diagonal interpolation
+    std::vector<int32_t> h, v, d;
+};
+
+SPARK_KERNEL void storeRow(const RowScratch &s, int width, bool gray, uint8_t *dst) {
+    const int32_t *r = s.r.data();
+    const int32_t *g = s.g.data();
+    const int32_t *b = s.b.data();
+
+    if(gray) {
+        for(int x = 0; x < width; x++) {
+            int32_t y = (77 * std::min(std::max(r[x], 0), 65535) + 150 * std::min(std::max(g[x], 0), 65535)
+                + 29 * std::min(std::max(b[x], 0), 65535)) >> 12;
+            dst[x] = uint8_t(std::min(y, 255));
+        }
+    } else {
+        for(int x = 0; x < width; x++) {
+            dst[3 * x] = uint8_t(std::min(std::max(r[x], 0) >> 4, 255));
+            dst[3 * x + 1] = uint8_t(std::min(std::max(g[x], 0) >> 4, 255));
+            dst[3 * x + 2] = uint8_t(std::min(std::max(b[x], 0) >> 4, 255));
+        }
+    }
+}
+
+// select the colors of a row into r, g, b from the raw row c, the green row and
+// the horizontal, vertical and diagonal color differences to green in h, v, d
+SPARK_KERNEL void selectRow(RowScratch &s, const uint16_t *c, const uint16_t *green, int width, bool redRow, int colorX) {
+    int32_t *r = s.r.data();
+    int32_t *g = s.g.data();
+    int32_t *b = s.b.data();
+    const int32_t *h = s.h.data();
+    const int32_t *v = s.v.data();
+    const int32_t *d = s.d.data();
+
+    // on a red row: red at colorX, green with red left and right, blue above and below
+    int32_t *same = redRow ? r : b;
+    int32_t *other = redRow ? b : r;
+    for(int x = 0; x < width; x++) {
+        bool color = (x & 1) == colorX;
+        same[x] = color ? c[x] : green[x] + h[x];
+        other[x] = green[x] + (color ? d[x] : v[x]);
+        g[x] = green[x];
+    }
+}
+
+SPARK_KERNEL void demosaicBilinearBody(const DemosaicParams &params, int y0, int y1) {
+    const PaddedPlane &raw = params.raw;
+    const int width = raw.width;
+    RowScratch s(width);
+    int32_t *r = s.r.data();
+    int32_t *g = s.g.data();
+    int32_t *b = s.b.data();
+
+    for(int y = y0; y < y1; y++) {
+        const uint16_t *up = raw.row(y - 1);
+        const uint16_t *c = raw.row(y);
+        const uint16_t *dn = raw.row(y + 1);
+
+        bool redRow = (y & 1) == params.redY;
+        int colorX = redRow ? params.redX : 1 - params.redX;
+        // on a red row: red at colorX, green with red left and right, blue above and below
+        int32_t *same = redRow ? r : b;
+        int32_t *other = redRow ? b : r;
+        for(int x = 0; x < width; x++) {
+            bool color = (x & 1) == colorX;
+            int32_t horizontal = c[x - 1] + c[x + 1];
+            int32_t vertical = up[x] + dn[x];
+            int32_t diagonal = up[x - 1] + up[x + 1] + dn[x - 1] + dn[x + 1];
+            same[x] = color ? c[x] : (horizontal + 1) >> 1;
+            other[x] = color ? (diagonal + 2) >> 2 : (vertical + 1) >> 1;
+            g[x] = color ? (horizontal + vertical + 2) >> 2 : c[x];
+        }
+        storeRow(s, width, params.gray, params.dst + size_t(y) * width * (params.gray ? 1 : 3));
+    }
+}
+
+SPARK_KERNEL void interpolateGreenBody(const DemosaicParams &params, const PaddedPlane &green, int y0, int y1) {
+    const PaddedPlane &raw = params.raw;
+    const int width = raw.width;
+
+    for(int y = y0; y < y1; y++) {
+        const uint16_t *c = raw.row(y);
+        const uint16_t *up2 = raw.row(y - 2);
+        const uint16_t *up = raw.row(y - 1);
+        const uint16_t *dn = raw.row(y + 1);
+        const uint16_t *dn2 = raw.row(y + 2);
+        uint16_t *out = green.row(y);
+
+        bool redRow = (y & 1) == params.redY;
+        int colorX = redRow ? params.redX : 1 - params.redX;
+        for(int x = 0; x < width; x++) {
+            int32_t lapH = 2 * c[x] - c[x - 2] - c[x + 2];
+            int32_t lapV = 2 * c[x] - up2[x] - dn2[x];
+            int32_t gradH = abs(c[x - 1] - c[x + 1]) + abs(lapH);
+            int32_t gradV = abs(up[x] - dn[x]) + abs(lapV);
+            // green along an edge, corrected by the laplacian of the color channel
+            int32_t gh = (2 * (c[x - 1] + c[x + 1]) + lapH + 2) >> 2;
+            int32_t gv = (2 * (up[x] + dn[x]) + lapV + 2) >> 2;
+            int32_t g = gradH < gradV ? gh : (gradV < gradH ? gv : (gh + gv + 1) >> 1);
+            g = std::min(std::max(g, 0), 65535);
+            out[x] = (x & 1) == colorX ? uint16_t(g) : c[x];
+        }
+    }
+}
+
+SPARK_KERNEL void interpolateColorBody(const DemosaicParams &params, const PaddedPlane &green, int y0, int y1) {
+    const PaddedPlane &raw = params.raw;
+    const int width = raw.width;
+    RowScratch s(width);
+    int32_t *h = s.h.data();
+    int32_t *v = s.v.data();
+    int32_t *d = s.d.data();
+
+    for(int y = y0; y < y1; y++) {
+        const uint16_t *up = raw.row(y - 1);
+        const uint16_t *c = raw.row(y);
+        const uint16_t *dn = raw.row(y + 1);
+        const uint16_t *gUp = green.row(y - 1);
+        const uint16_t *g = green.row(y);
+        const uint16_t *gDn = green.row(y + 1);
+
+        bool redRow = (y & 1) == params.redY;
+        int colorX = redRow ? params.redX : 1 - params.redX;
+        // averages of color differences to green, where the neighbours are of the right color
+        for(int x = 0; x < width; x++) {
+            h[x] = (c[x - 1] - g[x - 1] + c[x + 1] - g[x + 1]) / 2;
+            v[x] = (up[x] - gUp[x] + dn[x] - gDn[x]) / 2;
+            d[x] = (up[x - 1] - gUp[x - 1] + up[x + 1] - gUp[x + 1]
+                + dn[x - 1] - gDn[x - 1] + dn[x + 1] - gDn[x + 1]) / 4;
+        }
+        selectRow(s, c, g, width, redRow, colorX);
+        storeRow(s, width, params.gray, params.dst + size_t(y) * width * (params.gray ? 1 : 3));
+    }
+}
+
+#if defined(SPARK_CPU_X86)
+
+__attribute__((target("avx2")))
+static void demosaicBilinearAvx2(const DemosaicParams &params, int y0, int y1) {
+    demosaicBilinearBody(params, y0, y1);
+}
+
+__attribute__((target("sse4.1")))
+static void demosaicBilinearSse41(const DemosaicParams &params, int y0, int y1) {
+    demosaicBilinearBody(params, y0, y1);
+}
+
+__attribute__((target("avx2")))
+static void interpolateGreenAvx2(const DemosaicParams &params, const PaddedPlane &green, int y0, int y1) {
+    interpolateGreenBody(params, green, y0, y1);
+}
+
+__attribute__((target("sse4.1")))
+static void interpolateGreenSse41(const DemosaicParams &params, const PaddedPlane &green, int y0, int y1) {
+    interpolateGreenBody(params, green, y0, y1);
+}
+
+__attribute__((target("avx2")))
+static void interpolateColorAvx2(const DemosaicParams &params, const PaddedPlane &green, int y0, int y1) {
+    interpolateColorBody(params, green, y0, y1);
+}
+
+__attribute__((target("sse4.1")))
+static void interpolateColorSse41(const DemosaicParams &params, const PaddedPlane &green, int y0, int y1) {
+    interpolateColorBody(params, green, y0, y1);
+}
+
+#endif // SPARK_CPU_X86
+
+static void demosaicBilinearGeneric(const DemosaicParams &params, int y0, int y1) {
+    demosaicBilinearBody(params, y0, y1);
+}
+
+static void interpolateGreenGeneric(const DemosaicParams &params, const PaddedPlane &green, int y0, int y1) {
+    interpolateGreenBody(params, green, y0, y1);
+}
+
+static void interpolateColorGeneric(const DemosaicParams &params, const PaddedPlane &green, int y0, int y1) {
+    interpolateColorBody(params, green, y0, y1);
+}
+
+void demosaicBilinear(const DemosaicParams &params, int y0, int y1, cpu::Level level) {
+#if defined(SPARK_CPU_X86)
+    if(level == cpu::LEVEL_AVX2) {
+        return demosaicBilinearAvx2(params, y0, y1);
+    }
+    if(level == cpu::LEVEL_SSE41) {
+        return demosaicBilinearSse41(params, y0, y1);
+    }
+#endif
+    (void) level;
+    demosaicBilinearGeneric(params, y0, y1);
+}
+
+void interpolateGreen(const DemosaicParams &params, const PaddedPlane &green, int y0, int y1, cpu::Level level) {
+#if defined(SPARK_CPU_X86)
+    if(level == cpu::LEVEL_AVX2) {
+        return interpolateGreenAvx2(params, green, y0, y1);
+    }
+    if(level == cpu::LEVEL_SSE41) {
+        return interpolateGreenSse41(params, green, y0, y1);
+    }
+#endif
+    (void) level;
+    interpolateGreenGeneric(params, green, y0, y1);
+}
+
+void interpolateColor(const DemosaicParams &params, const PaddedPlane &green, int y0, int y1, cpu::Level level) {
+#if defined(SPARK_CPU_X86)
+    if(level == cpu::LEVEL_AVX2) {
+        return interpolateColorAvx2(params, green, y0, y1);
+    }
+    if(level == cpu::LEVEL_SSE41) {
+        return interpolateColorSse41(params, green, y0, y1);
+    }
+#endif
+    (void) level;
+    interpolateColorGeneric(params, green, y0, y1);
+}
+
+} // namespace bayer
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,118 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <stdint.h>
+
+#include <libsparkproto/cpufeatures.h>
+
+namespace libspark {
+
+namespace protocol {
+
+namespace bayer {
+
+// layouts of a BAYER10 plane, told apart by the size of the plane
+enum Layout {
+    // MIPI RAW10, 4 pixels in 5 bytes: 4 high bytes then a byte with the 2 low bits of each pixel
+    LAYOUT_PACKED10 = 0,
+    // a pixel in the low 10 bits of a little endian 16-bit word
+    LAYOUT_UNPACKED16 = 1
+};
+
+// full scale of a sample after unpack with a gain of 1.0, samples are converted to 8 bits with >> 4
+static constexpr uint32_t SAMPLE_FULL_SCALE = 255 << 4;
+
+// gains are applied in Q10 fixed point
+static constexpr uint32_t GAIN_ONE = 1 << 10;
+
+/**
+ * @brief Unpack a row of 10-bit pixels to 16 bits: out = (max(raw - black, 0) * gain) >> 10,
+ * gainEven is applied to pixels of even columns and gainOdd to odd columns.
+ *
+ * @param layout
+ * @param src
+ * @param dst
+ * @param width even number of pixels
+ * @param black
+ * @param gainEven
+ * @param gainOdd
+ * @param level
+ */
+void unpackRow(Layout layout, const uint8_t *src, uint16_t *dst, uint32_t width,
+    uint16_t black, uint16_t gainEven, uint16_t gainOdd, cpu::Level level);
+
+// a plane of samples with a border of PAD pixels on each side, mirrored around the edges
+struct PaddedPlane {
+    static constexpr int PAD = 2;
+
+    uint16_t *data;
+    // in samples
+    int stride;
+    int width;
+    int height;
+
+    uint16_t* row(int y) const { return data + (y + PAD) * stride + PAD; }
+};
+
+/**
+ * @brief Mirror the left and right border of row y, e.g. column -1 is a copy of column 1 so the Bayer pattern is kept
+ *
+ * @param plane
+ * @param y
+ */
+void mirrorRowBorder(const PaddedPlane &plane, int y);
+
+/**
+ * @brief Mirror the top and bottom border rows, after all rows are filled
+ *
+ * @param plane
+ */
+void mirrorTopBottom(const PaddedPlane &plane);
+
+struct DemosaicParams {
+    PaddedPlane raw;
+    // position of the red pixel in a 2x2 cell
+    int redX;
+    int redY;
+    // output is 3 bytes RGB or 1 byte gray per pixel
+    bool gray;
+    uint8_t *dst;
+};
+
+/**
+ * @brief Bilinear demosaic of rows [y0, y1) to 8-bit RGB or gray
+ *
+ * @param params
+ * @param y0
+ * @param y1
+ * @param level
+ */
+void demosaicBilinear(const DemosaicParams &params, int y0, int y1, cpu::Level level);
+
+/**
+ * @brief First pass of the edge-aware demosaic, interpolate green of rows [y0, y1) along the smaller gradient
+ *
+ * @param params
+ * @param green padded plane of the same size as params.raw
+ * @param y0
+ * @param y1
+ * @param level
+ */
+void interpolateGreen(const DemosaicParams &params, const PaddedPlane &green, int y0, int y1, cpu::Level level);
+
+/**
+ * @brief Second pass of the edge-aware demosaic, interpolate red and blue from color differences to green
+ *
+ * @param params
+ * @param green
+ * @param y0
+ * @param y1
+ * @param level
+ */
+void interpolateColor(const DemosaicParams &params, const PaddedPlane &green, int y0, int y1, cpu::Level level);
+
+} // namespace bayer
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,45 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <libsparkproto/bayerprocessor.h>
+#include <libsparkproto/bayerprocessorimpl.h>
+
+namespace libspark {
+
+namespace protocol {
+
+BayerProcessor::BayerProcessor(const BayerOptions &options)
+    : _pImpl(new BayerProcessorImpl(options)) {
+
+}
+
+BayerProcessor::~BayerProcessor() {
+
+}
+
+void BayerProcessor::setOptions(const BayerOptions &options) {
+    _pImpl->setOptions(options);
+}
+
+BayerOptions BayerProcessor::options() const {
+    return _pImpl->options();
+}
+
+void BayerProcessor::unpack(const void *src, size_t size, uint32_t width, uint32_t height, uint16_t *dst) {
+    _pImpl->unpack(src, size, width, height, dst);
+}
+
+void BayerProcessor::toRgb(const void *src, size_t size, uint32_t width, uint32_t height, uint8_t *dst) {
+    _pImpl->demosaic(src, size, width, height, dst, false);
+}
+
+void BayerProcessor::toGray(const void *src, size_t size, uint32_t width, uint32_t height, uint8_t *dst) {
+    _pImpl->demosaic(src, size, width, height, dst, true);
+}
+
+void BayerProcessor::convert(ImageSet &imgSet, int32_t imgFormat) {
+    _pImpl->convert(imgSet, imgFormat);
+}
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,146 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <libsparkproto/common.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class ImageSet;
+class BayerProcessorImpl;
+
+/**
+ * @brief Color filter arrangement of the sensor, named by the 2x2 cell at the top-left corner of the image
+ *
+ */
+enum BayerPattern {
+    BAYER_RGGB = 0,
+    BAYER_GRBG = 1,
+    BAYER_GBRG = 2,
+    BAYER_BGGR = 3
+};
+
+/**
+ * @brief Options of BayerProcessor
+ *
+ */
+struct SPARK_API BayerOptions {
+    enum Demosaic {
+        // average of the nearest pixels of each color, fastest
+        DEMOSAIC_BILINEAR = 0,
+        // green is interpolated along edges, red and blue from the difference to green. Fewer color fringes on edges
+        DEMOSAIC_EDGE_AWARE = 1
+    };
+
+    BayerPattern pattern = BAYER_RGGB;
+
+    // black level of the sensor in 10-bit units, it is subtracted from every pixel
+    uint16_t blackLevel = 64;
+
+    // white balance gains, applied after black level subtraction. A gain is limited to about 15
+    float gainRed = 1.0f;
+    float gainGreen = 1.0f;
+    float gainBlue = 1.0f;
+
+    Demosaic demosaic = DEMOSAIC_BILINEAR;
+
+    // number of threads an image is split across in bands of rows, 0 for the number of CPU cores, 1 to run in the calling thread
+    uint32_t threads = 0;
+};
+
+/**
+ * @brief BayerProcessor converts images of FORMAT_BAYER10 to RGB or gray on the host,
+ * so a device can stream raw images at less bandwidth than FORMAT_RGB.
+ *
+ * A BAYER10 plane is either MIPI RAW10, 4 pixels packed in 5 bytes, or a pixel per little endian 16-bit word,
+ * the layout is told apart by the size of the plane. Pixels are unpacked to 16 bits with black level and white balance
+ * applied, then demosaiced. The kernels are selected at runtime for the CPU (AVX2, SSE4.1, NEON or generic code),
+ * see libspark::protocol::cpu::dispatchLevel().
+ *
+ * A BayerProcessor keeps its scratch buffers between images, it's not thread-safe. Use one per thread.
+ *
+ */
+class SPARK_API BayerProcessor {
+
+public:
+    /**
+     * @brief Construct a new BayerProcessor object
+     *
+     * @param options
+     */
+    explicit BayerProcessor(const BayerOptions &options = BayerOptions());
+
+    /**
+     * @brief Destroy the BayerProcessor object
+     *
+     */
+    virtual ~BayerProcessor();
+
+    /**
+     * @brief Set options. If options are invalid, a exception is thrown
+     *
+     * @param options
+     */
+    void setOptions(const BayerOptions &options);
+
+    /**
+     * @brief Get options
+     *
+     * @return BayerOptions
+     */
+    BayerOptions options() const;
+
+    /**
+     * @brief Unpack a BAYER10 image to 16-bit samples without demosaic, with black level and white balance applied.
+     * The white level of the sensor maps to 4080, so >> 4 gives 8 bits.
+     * If the size does not match width and height, a exception is thrown
+     *
+     * @param src BAYER10 plane
+     * @param size size of src in bytes
+     * @param width even number of pixels
+     * @param height even number of rows
+     * @param dst width * height samples
+     */
+    void unpack(const void *src, size_t size, uint32_t width, uint32_t height, uint16_t *dst);
+
+    /**
+     * @brief Convert a BAYER10 image to 8-bit RGB
+     *
+     * @param src BAYER10 plane
+     * @param size size of src in bytes
+     * @param width even number of pixels
+     * @param height even number of rows
+     * @param dst width * height * 3 bytes
+     */
+    void toRgb(const void *src, size_t size, uint32_t width, uint32_t height, uint8_t *dst);
+
+    /**
+     * @brief Convert a BAYER10 image to 8-bit gray
+     *
+     * @param src BAYER10 plane
+     * @param size size of src in bytes
+     * @param width even number of pixels
+     * @param height even number of rows
+     * @param dst width * height bytes
+     */
+    void toGray(const void *src, size_t size, uint32_t width, uint32_t height, uint8_t *dst);
+
+    /**
+     * @brief Convert the left and right images of FORMAT_BAYER10 in imgSet to imgFormat in place,
+     * the format and buffsize of their ImageMeta are updated. Other images are not changed
+     *
+     * @param imgSet
+     * @param imgFormat FORMAT_RGB or FORMAT_GRAY, see libspark::protocol::ImageFormat
+     */
+    void convert(ImageSet &imgSet, int32_t imgFormat);
+
+private:
+    std::unique_ptr<BayerProcessorImpl> _pImpl;
+};
+
+} // namespace protocol
+} // namespace libspark
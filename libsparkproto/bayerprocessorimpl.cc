@@ -0,0 +1,213 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <math.h>
+#include <algorithm>
+#include <thread>
+
+#include <libsparkproto/bayerprocessorimpl.h>
+#include <libsparkproto/exception.h>
+#include <libsparkproto/imageset.h>
+#include <libsparkproto/log.h>
+
+namespace libspark {
+
+namespace protocol {
+
+// rows of the smallest band, an even number so every band starts on the same row of the Bayer cell
+static constexpr uint32_t MIN_BAND_ROWS = 16;
+
+enum Channel {
+    CHANNEL_RED = 0,
+    CHANNEL_GREEN = 1,
+    CHANNEL_BLUE = 2
+};
+
+BayerProcessorImpl::BayerProcessorImpl(const BayerOptions &options)
+    : _redX(0), _redY(0), _gains{}, _level(cpu::dispatchLevel()) {
+
+    setOptions(options);
+}
+
+BayerProcessorImpl::~BayerProcessorImpl() {
+
+}
+
+void BayerProcessorImpl::setOptions(const BayerOptions &options) {
+    if(options.pattern < BAYER_RGGB || options.pattern > BAYER_BGGR) {
+        throw SparkError("passed a invalid BayerPattern");
+    }
+    if(options.blackLevel >= 1023) {
+        throw SparkError("black level must be less than the white level 1023");
+    }
+    if(!(options.gainRed >= 0) || !(options.gainGreen >= 0) || !(options.gainBlue >= 0)) {
+        throw SparkError("white balance gains must be positive");
+    }
+
+    // RGGB, GRBG, GBRG, BGGR
+    _redX = options.pattern == BAYER_GRBG || options.pattern == BAYER_BGGR;
+    _redY = options.pattern == BAYER_GBRG || options.pattern == BAYER_BGGR;
+
+    // scale of unpack: white level - black level maps to the full scale of a sample
+    float scale = float(bayer::SAMPLE_FULL_SCALE * bayer::GAIN_ONE) / float(1023 - options.blackLevel);
+    float gains[3] = {options.gainRed, options.gainGreen, options.gainBlue};
+    for(int i = 0; i < 3; i++) {
+        _gains[i] = uint16_t(std::min(lroundf(gains[i] * scale), 65535L));
+    }
+
+    uint32_t threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+    if(threads <= 1) {
+        _pool.reset();
+    } else if(!_pool || _pool->threadCount() != threads) {
+        _pool.reset(new ThreadPool(threads));
+    }
+
+    _options = options;
+}
+
+BayerOptions BayerProcessorImpl::options() const {
+    return _options;
+}
+
+void BayerProcessorImpl::unpack(const void *src, size_t size, uint32_t width, uint32_t height, uint16_t *dst) {
+    bayer::Layout layout = layoutOf(size, width, height);
+
+    runBands(height, [&](int y0, int y1) {
+        unpackRows(layout, (const uint8_t *) src, width, dst, width, y0, y1);
+    });
+}
+
+void BayerProcessorImpl::demosaic(const void *src, size_t size, uint32_t width, uint32_t height, uint8_t *dst, bool gray) {
+    bayer::Layout layout = layoutOf(size, width, height);
+
+    bayer::PaddedPlane raw;
+    raw.stride = width + 2 * bayer::PaddedPlane::PAD;
+    raw.width = width;
+    raw.height = height;
+    _raw.resize(size_t(raw.stride) * (height + 2 * bayer::PaddedPlane::PAD));
+    raw.data = _raw.data();
+
+    runBands(height, [&](int y0, int y1) {
+        unpackRows(layout, (const uint8_t *) src, width, raw.row(0), raw.stride, y0, y1);
+        for(int y = y0; y < y1; y++) {
+            bayer::mirrorRowBorder(raw, y);
+        }
+    });
+    bayer::mirrorTopBottom(raw);
+
+    bayer::DemosaicParams params;
+    params.raw = raw;
+    params.redX = _redX;
+    params.redY = _redY;
+    params.gray = gray;
+    params.dst = dst;
+
+    if(_options.demosaic == BayerOptions::DEMOSAIC_BILINEAR) {
+        runBands(height, [&](int y0, int y1) {
+            bayer::demosaicBilinear(params, y0, y1, _level);
+        });
+        return;
+    }
+
+    // edge-aware: red and blue of a row need green of the rows above and below, so green is finished first
+    bayer::PaddedPlane green = raw;
+    _green.resize(_raw.size());
+    green.data = _green.data();
+
+    runBands(height, [&](int y0, int y1) {
+        bayer::interpolateGreen(params, green, y0, y1, _level);
+        for(int y = y0; y < y1; y++) {
+            bayer::mirrorRowBorder(green, y);
+        }
+    });
+    bayer::mirrorTopBottom(green);
+
+    runBands(height, [&](int y0, int y1) {
+        bayer::interpolateColor(params, green, y0, y1, _level);
+    });
+}
+
+void BayerProcessorImpl::convert(ImageSet &imgSet, int32_t imgFormat) {
+    if(imgFormat != FORMAT_RGB && imgFormat != FORMAT_GRAY) {
+        throw SparkError("BAYER10 images can be converted to FORMAT_RGB or FORMAT_GRAY only");
+    }
+    bool gray = imgFormat == FORMAT_GRAY;
+    uint32_t channels = gray ? 1 : 3;
+
+    std::unique_ptr<ImageSetMeta> meta = std::make_unique<ImageSetMeta>(imgSet.meta());
+    ImageMeta *planes[2] = {
+        meta->has_left() ? meta->mutable_left() : nullptr,
+        meta->has_right() ? meta->mutable_right() : nullptr
+    };
+    ImageSet::BufferID ids[2] = {ImageSet::BUFFER_LEFT, ImageSet::BUFFER_RIGHT};
+
+    bool converted = false;
+    ImageSet::Buffer out;
+    for(int i = 0; i < 2; i++) {
+        if(!planes[i] || planes[i]->format() != FORMAT_BAYER10) {
+            continue;
+        }
+        uint32_t width = planes[i]->width();
+        uint32_t height = planes[i]->height();
+        ImageSet::Buffer &buff = imgSet.getMutableBuffer(ids[i]);
+
+        out.resize(size_t(width) * height * channels);
+        demosaic(buff.data(), buff.size(), width, height, out.data(), gray);
+        buff.swap(out);
+
+        planes[i]->set_format(ImageFormat(imgFormat));
+        planes[i]->set_buffsize(int32_t(buff.size()));
+        converted = true;
+    }
+
+    if(converted) {
+        uint64_t receiveTimestamp = imgSet.receiveTimestamp();
+        imgSet.setAllocatedMeta(std::move(meta));
+        imgSet.setReceiveTimestamp(receiveTimestamp);
+    }
+}
+
+bayer::Layout BayerProcessorImpl::layoutOf(size_t size, uint32_t width, uint32_t height) const {
+    if(width < 4 || height < 4 || width % 2 || height % 2) {
+        throw SparkError("size of a BAYER10 image must be even and at least 4x4, got " +
+            std::to_string(width) + "x" + std::to_string(height));
+    }
+
+    size_t pixels = size_t(width) * height;
+    if(size == pixels * 2) {
+        return bayer::LAYOUT_UNPACKED16;
+    }
+    if(width % 4 == 0 && size == pixels / 4 * 5) {
+        return bayer::LAYOUT_PACKED10;
+    }
+    throw SparkError("size of BAYER10 buffer " + std::to_string(size) + " does not match image " +
+        std::to_string(width) + "x" + std::to_string(height));
+}
+
+void BayerProcessorImpl::unpackRows(bayer::Layout layout, const uint8_t *src, uint32_t width,
+    uint16_t *dst, size_t dstStride, int y0, int y1) {
+
+    size_t rowBytes = layout == bayer::LAYOUT_PACKED10 ? width / 4 * 5 : width * 2;
+    for(int y = y0; y < y1; y++) {
+        // the gains of even and odd columns depend on the row of the cell
+        bool redRow = (y & 1) == _redY;
+        Channel even = redRow ? (_redX ? CHANNEL_GREEN : CHANNEL_RED) : (_redX ? CHANNEL_BLUE : CHANNEL_GREEN);
+        Channel odd = redRow ? (_redX ? CHANNEL_RED : CHANNEL_GREEN) : (_redX ? CHANNEL_GREEN : CHANNEL_BLUE);
+
+        bayer::unpackRow(layout, src + y * rowBytes, dst + y * dstStride, width,
+            _options.blackLevel, _gains[even], _gains[odd], _level);
+    }
+}
+
+void BayerProcessorImpl::runBands(int height, const BandFunc &func) {
+    if(!_pool) {
+        func(0, height);
+        return;
+    }
+    _pool->parallelFor(height, MIN_BAND_ROWS, [&func](uint32_t y0, uint32_t y1) {
+        func(y0, y1);
+    });
+}
+
+} // namespace protocol
+} // namespace libspark
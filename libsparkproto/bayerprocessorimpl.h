@@ -0,0 +1,60 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <libsparkproto/bayerprocessor.h>
+#include <libsparkproto/bayerkernels.h>
+#include <libsparkproto/threadpool.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class BayerProcessorImpl {
+
+public:
+    BayerProcessorImpl(const BayerOptions &options);
+
+    virtual ~BayerProcessorImpl();
+
+    void setOptions(const BayerOptions &options);
+
+    BayerOptions options() const;
+
+    void unpack(const void *src, size_t size, uint32_t width, uint32_t height, uint16_t *dst);
+
+    void demosaic(const void *src, size_t size, uint32_t width, uint32_t height, uint8_t *dst, bool gray);
+
+    void convert(ImageSet &imgSet, int32_t imgFormat);
+
+private:
+    using BandFunc = std::function<void(int y0, int y1)>;
+
+    // check size of the image and find its layout
+    bayer::Layout layoutOf(size_t size, uint32_t width, uint32_t height) const;
+
+    // unpack rows [y0, y1) of src to dst with a stride of dstStride samples
+    void unpackRows(bayer::Layout layout, const uint8_t *src, uint32_t width, uint16_t *dst, size_t dstStride, int y0, int y1);
+
+    // run func over the rows in bands, on the pool when there is one
+    void runBands(int height, const BandFunc &func);
+
+    BayerOptions _options;
+    int _redX;
+    int _redY;
+    // gains of red, green, blue in Q10
+    uint16_t _gains[3];
+    cpu::Level _level;
+    std::unique_ptr<ThreadPool> _pool;
+
+    // scratch planes, kept between images of the same size
+    std::vector<uint16_t> _raw;
+    std::vector<uint16_t> _green;
+};
+
+} // namespace protocol
+} // namespace libspark
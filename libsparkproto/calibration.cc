@@ -0,0 +1,219 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <sstream>
+
+#include <libsparkproto/calibration.h>
+#include <libsparkproto/exception.h>
+
+namespace libspark {
+
+namespace protocol {
+
+// a number, a sequence of numbers or an opencv-matrix of the top level of the calibration
+struct CalibrationEntry {
+    std::vector<double> values;
+    uint32_t rows = 0;
+    uint32_t cols = 0;
+};
+
+using CalibrationEntries = std::map<std::string, CalibrationEntry>;
+
+static std::string trim(const std::string &s) {
+    size_t begin = s.find_first_not_of(" \t\r");
+    if(begin == std::string::npos) {
+        return std::string();
+    }
+    size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(begin, end - begin + 1);
+}
+
+// append the numbers of a part of a flow sequence, return true at its closing bracket
+static bool parseSequence(const std::string &text, std::vector<double> &values) {
+    size_t end = text.find(']');
+    std::string items = text.substr(0, end);
+    for(char &c : items) {
+        if(c == ',' || c == '[') {
+            c = ' ';
+        }
+    }
+
+    const char *p = items.c_str();
+    char *next = nullptr;
+    while(true) {
+        double v = strtod(p, &next);
+        if(next == p) {
+            break;
+        }
+        values.push_back(v);
+        p = next;
+    }
+    return end != std::string::npos;
+}
+
+// top level entries of OpenCV YAML: "key: value", "key: [...]" and "key: !!opencv-matrix" with indented rows, cols and data
+static CalibrationEntries parseEntries(const std::string &data) {
+    CalibrationEntries entries;
+    CalibrationEntry *entry = nullptr;
+    std::vector<double> *sequence = nullptr;
+
+    std::istringstream in(data);
+    std::string line;
+    while(std::getline(in, line)) {
+        if(sequence) {
+            if(parseSequence(line, *sequence)) {
+                sequence = nullptr;
+            }
+            continue;
+        }
+
+        std::string text = trim(line);
+        if(text.empty() || text[0] == '#' || text[0] == '%' || text == "---") {
+            continue;
+        }
+        size_t colon = text.find(':');
+        if(colon == std::string::npos) {
+            continue;
+        }
+        std::string key = trim(text.substr(0, colon));
+        std::string value = trim(text.substr(colon + 1));
+        bool nested = line[0] == ' ' || line[0] == '\t';
+
+        if(!nested) {
+            entry = &entries[key];
+        } else if(!entry) {
+            continue;
+        } else if(key == "rows" || key == "cols") {
+            (key == "rows" ? entry->rows : entry->cols) = uint32_t(atoi(value.c_str()));
+            continue;
+        } else if(key != "data") {
+            continue;
+        }
+
+        if(!value.empty() && value[0] == '[') {
+            if(!parseSequence(value.substr(1), entry->values)) {
+                sequence = &entry->values;
+            }
+        } else if(!value.empty() && value[0] != '!') {
+            char *end = nullptr;
+            double v = strtod(value.c_str(), &end);
+            if(end != value.c_str()) {
+                entry->values.push_back(v);
+            }
+        }
+    }
+    return entries;
+}
+
+static const CalibrationEntry* findEntry(const CalibrationEntries &entries, std::initializer_list<const char*> keys) {
+    for(const char *key : keys) {
+        auto it = entries.find(key);
+        if(it != entries.end() && !it->second.values.empty()) {
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
+
+// copy an entry of size values to dst, return false if there is none
+static bool readMatrix(const CalibrationEntries &entries, std::initializer_list<const char*> keys, double *dst, size_t size) {
+    const CalibrationEntry *entry = findEntry(entries, keys);
+    if(!entry) {
+        return false;
+    }
+    if(entry->values.size() != size || (entry->rows && size_t(entry->rows) * entry->cols != size)) {
+        throw SparkError("calibration entry " + std::string(*keys.begin()) + " has " +
+            std::to_string(entry->values.size()) + " values, expected " + std::to_string(size));
+    }
+    memcpy(dst, entry->values.data(), size * sizeof(double));
+    return true;
+}
+
+static void setIdentity(double *R) {
+    memset(R, 0, 9 * sizeof(double));
+    R[0] = R[4] = R[8] = 1.0;
+}
+
+static void readCamera(const CalibrationEntries &entries, std::initializer_list<const char*> K, const char *D,
+    const char *R, const char *P, CameraCalibration &camera, bool &rectified) {
+
+    if(!readMatrix(entries, K, camera.K, 9)) {
+        throw SparkError("calibration has no camera matrix " + std::string(*K.begin()));
+    }
+
+    camera.distortion.clear();
+    const CalibrationEntry *distortion = findEntry(entries, {D});
+    if(distortion) {
+        size_t n = distortion->values.size();
+        if(n != 4 && n != 5 && n != 8) {
+            throw SparkError("calibration entry " + std::string(D) + " has " + std::to_string(n) +
+                " coefficients, expected 4, 5 or 8");
+        }
+        camera.distortion = distortion->values;
+    }
+
+    bool hasR = readMatrix(entries, {R}, camera.R, 9);
+    bool hasP = readMatrix(entries, {P}, camera.P, 12);
+    if(!hasR || !hasP) {
+        rectified = false;
+        setIdentity(camera.R);
+        memset(camera.P, 0, sizeof(camera.P));
+        for(int row = 0; row < 3; row++) {
+            memcpy(camera.P + 4 * row, camera.K + 3 * row, 3 * sizeof(double));
+        }
+    }
+}
+
+StereoIntrinsics StereoCalibration::intrinsics() const {
+    StereoIntrinsics intrinsics;
+    intrinsics.fx = float(left.P[0]);
+    intrinsics.fy = float(left.P[5]);
+    intrinsics.cx = float(left.P[2]);
+    intrinsics.cy = float(left.P[6]);
+
+    // P2 = [K | K * (Tx, 0, 0)] of the rectified right camera
+    double baseline = rectified && right.P[0] != 0 ? -right.P[3] / right.P[0] : 0.0;
+    if(baseline <= 0) {
+        baseline = sqrt(T[0] * T[0] + T[1] * T[1] + T[2] * T[2]);
+    }
+    intrinsics.baseline = float(baseline);
+    return intrinsics;
+}
+
+StereoCalibration parseCalibration(const std::string &data) {
+    CalibrationEntries entries = parseEntries(data);
+    StereoCalibration calibration;
+
+    calibration.rectified = true;
+    readCamera(entries, {"M1", "K1"}, "D1", "R1", "P1", calibration.left, calibration.rectified);
+    readCamera(entries, {"M2", "K2"}, "D2", "R2", "P2", calibration.right, calibration.rectified);
+    if(!calibration.rectified) {
+        // rectification of one camera only is not used
+        readCamera(entries, {"M1", "K1"}, "D1", "", "", calibration.left, calibration.rectified);
+        readCamera(entries, {"M2", "K2"}, "D2", "", "", calibration.right, calibration.rectified);
+    }
+
+    if(!readMatrix(entries, {"R"}, calibration.R, 9)) {
+        setIdentity(calibration.R);
+    }
+    readMatrix(entries, {"T"}, calibration.T, 3);
+
+    double size[2] = {};
+    if(readMatrix(entries, {"image_size", "imageSize"}, size, 2)) {
+        calibration.width = uint32_t(size[0]);
+        calibration.height = uint32_t(size[1]);
+    } else {
+        const CalibrationEntry *width = findEntry(entries, {"width", "image_width", "imageWidth"});
+        const CalibrationEntry *height = findEntry(entries, {"height", "image_height", "imageHeight"});
+        calibration.width = width ? uint32_t(width->values[0]) : 0;
+        calibration.height = height ? uint32_t(height->values[0]) : 0;
+    }
+    return calibration;
+}
+
+} // namespace protocol
+} // namespace libspark
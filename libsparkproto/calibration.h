@@ -0,0 +1,75 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <libsparkproto/common.h>
+#include <libsparkproto/pointcloud.h>
+
+namespace libspark {
+
+namespace protocol {
+
+/**
+ * @brief Calibration of a camera of a stereo pair. Matrices are row-major
+ *
+ */
+struct SPARK_API CameraCalibration {
+    // camera matrix: fx 0 cx, 0 fy cy, 0 0 1
+    double K[9] = {};
+
+    // k1, k2, p1, p2 and optional k3, k4, k5, k6 of the rational model, empty for no distortion
+    std::vector<double> distortion;
+
+    // rotation from the camera to the rectified camera, identity when the calibration has no rectification
+    double R[9] = {};
+
+    // 3x4 projection matrix of the rectified camera, [K | 0] when the calibration has no rectification
+    double P[12] = {};
+};
+
+/**
+ * @brief Calibration of the stereo cameras of a device, see parseCalibration()
+ *
+ */
+struct SPARK_API StereoCalibration {
+    // size of the calibrated images
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    CameraCalibration left;
+    CameraCalibration right;
+
+    // rotation and translation from the left to the right camera
+    double R[9] = {};
+    double T[3] = {};
+
+    // the calibration has rectification rotations and projections, otherwise maps only undistort
+    bool rectified = false;
+
+    /**
+     * @brief Intrinsics of the rectified left camera for PointCloudGenerator, with the baseline
+     * from the projection of the right camera or T. disparityScale and minDisparity have their defaults
+     *
+     * @return StereoIntrinsics
+     */
+    StereoIntrinsics intrinsics() const;
+};
+
+/**
+ * @brief Parse the calibration of a device, as read from ParameterID::CALIBRATION_DATA.
+ *
+ * The calibration is an OpenCV YAML file of matrices M1/K1, D1, R1, P1 of the left camera,
+ * M2/K2, D2, R2, P2 of the right camera and R, T of the pair, with the image size in
+ * width/height, image_width/image_height or image_size. If a camera matrix is missing or
+ * a matrix has a wrong size, a exception is thrown
+ *
+ * @param data
+ * @return StereoCalibration
+ */
+SPARK_API StereoCalibration parseCalibration(const std::string &data);
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,68 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <libsparkproto/cpufeatures.h>
+#include <libsparkproto/log.h>
+
+namespace libspark {
+
+namespace protocol {
+
+namespace cpu {
+
+static Level detectLevel() {
+#if defined(SPARK_CPU_X86)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        return LEVEL_AVX2;
+    }
+    if(__builtin_cpu_supports("sse4.1")) {
+        return LEVEL_SSE41;
+    }
+    return LEVEL_GENERIC;
+#elif defined(SPARK_CPU_NEON)
+    return LEVEL_NEON;
+#else
+    return LEVEL_GENERIC;
+#endif
+}
+
+static Level selectLevel() {
+    Level level = detectLevel();
+
+    const char *env = getenv("SPARK_CPU_LEVEL");
+    if(env) {
+        for(int i = LEVEL_GENERIC; i <= LEVEL_NEON; i++) {
+            // the CPU level can only be lowered
+            bool supported = i == LEVEL_GENERIC || i == level || (level == LEVEL_AVX2 && i == LEVEL_SSE41);
+            if(strcmp(env, levelName(Level(i))) == 0 && supported) {
+                level = Level(i);
+            }
+        }
+    }
+
+    LOG_INFO("SIMD kernels: %s", levelName(level));
+    return level;
+}
+
+Level dispatchLevel() {
+    static const Level level = selectLevel();
+    return level;
+}
+
+const char* levelName(Level level) {
+    switch (level)
+    {
+    case LEVEL_SSE41: return "sse41";
+    case LEVEL_AVX2: return "avx2";
+    case LEVEL_NEON: return "neon";
+    default: return "generic";
+    }
+}
+
+} // namespace cpu
+} // namespace protocol
+} // namespace libspark
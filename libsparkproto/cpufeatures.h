@@ -0,0 +1,51 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+namespace libspark {
+
+namespace protocol {
+
+namespace cpu {
+
+//
+// Runtime selection of SIMD kernels. x86 kernels are compiled with target attributes,
+// so the library runs on any x86-64 CPU and uses AVX2 when it is available.
+//
+
+#if defined(__x86_64__) || defined(__i386__)
+    #define SPARK_CPU_X86
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define SPARK_CPU_NEON
+#endif
+
+enum Level {
+    LEVEL_GENERIC = 0,
+    LEVEL_SSE41 = 1,
+    LEVEL_AVX2 = 2,
+    LEVEL_NEON = 3
+};
+
+/**
+ * @brief Best level of SIMD kernels supported by the CPU.
+ * It can be lowered with the environment variable SPARK_CPU_LEVEL (generic, sse41, avx2, neon),
+ * e.g. to compare kernels
+ *
+ * @return Level
+ */
+Level dispatchLevel();
+
+/**
+ * @brief Name of a level
+ *
+ * @param level
+ * @return const char*
+ */
+const char* levelName(Level level);
+
+} // namespace cpu
+} // namespace protocol
+} // namespace libspark
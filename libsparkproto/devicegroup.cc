@@ -0,0 +1,55 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <libsparkproto/devicegroup.h>
+#include <libsparkproto/devicegroupimpl.h>
+#include <libsparkproto/parameterids.pb.h>
+
+namespace libspark {
+
+namespace protocol {
+
+DeviceGroup::DeviceGroup(const DeviceList &devices, const ParameterProtocolOptions &options)
+    : _pImpl(new DeviceGroupImpl(devices, options)) {
+
+}
+
+DeviceGroup::DeviceGroup(const std::vector<std::shared_ptr<ParameterProtocol>> &protocols)
+    : _pImpl(new DeviceGroupImpl(protocols)) {
+
+}
+
+DeviceGroup::~DeviceGroup() {
+
+}
+
+size_t DeviceGroup::size() const {
+    return _pImpl->size();
+}
+
+GroupWriteResult DeviceGroup::writeBool(int32_t id, bool value) {
+    return _pImpl->writeBool(id, value);
+}
+
+GroupWriteResult DeviceGroup::writeInt(int32_t id, int32_t value) {
+    return _pImpl->writeInt(id, value);
+}
+
+GroupWriteResult DeviceGroup::writeDouble(int32_t id, double value) {
+    return _pImpl->writeDouble(id, value);
+}
+
+GroupWriteResult DeviceGroup::writeString(int32_t id, const std::string &value) {
+    return _pImpl->writeString(id, value);
+}
+
+GroupWriteResult DeviceGroup::setExposureValue(int32_t value) {
+    return _pImpl->writeInt(ParameterID::MANUAL_EXPOSURE, value);
+}
+
+GroupWriteResult DeviceGroup::setGainValue(int32_t value) {
+    return _pImpl->writeInt(ParameterID::MANUAL_GAIN, value);
+}
+
+} // namespace protocol
+} // namespace libspark
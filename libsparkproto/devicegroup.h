@@ -0,0 +1,171 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <libsparkproto/common.h>
+#include <libsparkproto/deviceinfo.h>
+#include <libsparkproto/parameterprotocol.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class DeviceGroupImpl;
+
+/**
+ * @brief Result of a write of DeviceGroup on one device
+ *
+ */
+struct SPARK_API GroupWriteStatus : public ParameterStatus {
+    // milliseconds from issuing the write to all devices until this device answered
+    double latency = 0.0;
+    // host time when the device answered, in nanoseconds of the monotonic clock of ImageSet::receiveTimestamp().
+    // The first ImageSet of the device received later is the frame boundary where the change is expected, 0 if the
+    // write failed
+    uint64_t appliedTimestamp = 0;
+};
+
+/**
+ * @brief Result of a write of DeviceGroup on all devices
+ *
+ */
+struct SPARK_API GroupWriteResult {
+    // whether every device accepted the write
+    bool succeeded = false;
+    size_t failedCount = 0;
+    // latency of the slowest device, and between the first and the last device which succeeded, in milliseconds
+    double maxLatency = 0.0;
+    double skew = 0.0;
+    // results in the order of the devices of the group
+    std::vector<GroupWriteStatus> devices;
+};
+
+/**
+ * @brief DeviceGroup writes the same parameter to a group of devices, e.g. the cameras of a rig which need matched
+ * exposure and gain. A write is issued to all devices at once over their parameter connections, and returns when
+ * every device has answered, with the latency and error of each. Writes which the registry of parameters rejects
+ * are not sent to any device.
+ *
+ * All functions are thread-safe, and must not be called from a callback of ParameterProtocol.
+ *
+ */
+class SPARK_API DeviceGroup {
+
+public:
+
+    using Ptr = std::unique_ptr<DeviceGroup>;
+
+    /**
+     * @brief Construct a new DeviceGroup object connected to the devices, which are connected concurrently.
+     * If a device can not be accessed, a exception is thrown with the errors of the devices
+     *
+     * @param devices
+     * @param options
+     */
+    DeviceGroup(const DeviceList &devices, const ParameterProtocolOptions &options = ParameterProtocolOptions());
+
+    /**
+     * @brief Construct a new DeviceGroup object writing through protocols, which may be shared with other users
+     *
+     * @param protocols
+     */
+    DeviceGroup(const std::vector<std::shared_ptr<ParameterProtocol>> &protocols);
+
+    /**
+     * @brief Destroy the DeviceGroup object
+     *
+     */
+    virtual ~DeviceGroup();
+
+    /**
+     * @brief Number of devices of the group
+     *
+     * @return size_t
+     */
+    size_t size() const;
+
+    /**
+     * @brief Write a bool parameter to all devices and wait until they answered.
+     * If the write is invalid, a exception is thrown without a request
+     *
+     * @param id
+     * @param value
+     * @return GroupWriteResult
+     */
+    GroupWriteResult writeBool(int32_t id, bool value);
+
+    /**
+     * @brief Write a int parameter to all devices and wait until they answered.
+     * If the write is invalid, a exception is thrown without a request
+     *
+     * @param id
+     * @param value
+     * @return GroupWriteResult
+     */
+    GroupWriteResult writeInt(int32_t id, int32_t value);
+
+    /**
+     * @brief Write a double parameter to all devices and wait until they answered.
+     * If the write is invalid, a exception is thrown without a request
+     *
+     * @param id
+     * @param value
+     * @return GroupWriteResult
+     */
+    GroupWriteResult writeDouble(int32_t id, double value);
+
+    /**
+     * @brief Write a string parameter to all devices and wait until they answered.
+     * If the write is invalid, a exception is thrown without a request
+     *
+     * @param id
+     * @param value
+     * @return GroupWriteResult
+     */
+    GroupWriteResult writeString(int32_t id, const std::string &value);
+
+    /**
+     * @brief Write the parameter Id as the type of its ParameterTraits to all devices, see writeInt()
+     *
+     * @tparam Id
+     * @param value
+     * @return GroupWriteResult
+     */
+    template<ParameterID Id>
+    GroupWriteResult write(const typename ParameterTraits<Id>::Type &value) {
+        static_assert(!ParameterTraits<Id>::descriptor().readOnly, "parameter is read-only");
+        return writeValue(Id, value);
+    }
+
+    /**
+     * @brief Set the exposure value of all devices, see writeInt()
+     *
+     * @param value
+     * @return GroupWriteResult
+     */
+    GroupWriteResult setExposureValue(int32_t value);
+
+    /**
+     * @brief Set the gain value of all devices, see writeInt()
+     *
+     * @param value
+     * @return GroupWriteResult
+     */
+    GroupWriteResult setGainValue(int32_t value);
+
+private:
+    // typed writes dispatched by the type of the value
+    GroupWriteResult writeValue(int32_t id, bool value) { return writeBool(id, value); }
+    GroupWriteResult writeValue(int32_t id, int32_t value) { return writeInt(id, value); }
+    GroupWriteResult writeValue(int32_t id, double value) { return writeDouble(id, value); }
+    GroupWriteResult writeValue(int32_t id, const std::string &value) { return writeString(id, value); }
+
+    std::unique_ptr<DeviceGroupImpl> _pImpl;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,166 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <libsparkproto/devicegroupimpl.h>
+#include <libsparkproto/parameterids.pb.h>
+#include <libsparkproto/parameterregistry.h>
+#include <libsparkproto/constants.h>
+#include <libsparkproto/exception.h>
+
+namespace libspark {
+
+namespace protocol {
+
+// a write is checked once for all devices, so it is sent to all of them or to none
+static void throwIfInvalid(int32_t id, ParameterValueType type, int32_t value = 0) {
+    std::string error = checkParameterWrite(id, type, value);
+    if(!error.empty()) {
+        throw SparkError(error);
+    }
+}
+
+DeviceGroupImpl::DeviceGroupImpl(const DeviceList &devices, const ParameterProtocolOptions &options) {
+    if(devices.empty()) {
+        throw SparkError("passed a empty group of devices");
+    }
+
+    // a connection which is refused or times out does not hold up the others
+    _protocols.resize(devices.size());
+    std::vector<std::string> errors(devices.size());
+    std::vector<std::thread> connects;
+    for(size_t i = 0; i < devices.size(); i++) {
+        connects.emplace_back([&, i]() {
+            try {
+                if(!devices[i]) {
+                    throw SparkError("passed a null device");
+                }
+                if(!devices[i]->isCompatible()) {
+                    throw SparkError("The library is not compatible with Spark firmware, please upgrade new version of libsparkpro");
+                }
+                _protocols[i] = std::make_shared<ParameterProtocol>(devices[i]->getIpAdress(), std::to_string(PARAMETERS_PORT), options);
+            } catch(std::exception &e) {
+                errors[i] = e.what();
+            }
+        });
+    }
+    for(std::thread &connect : connects) {
+        connect.join();
+    }
+
+    std::string message;
+    for(size_t i = 0; i < errors.size(); i++) {
+        if(!errors[i].empty()) {
+            message += " [" + std::to_string(i) + "] " + errors[i] + ";";
+        }
+    }
+    if(!message.empty()) {
+        throw SparkError("failed to connect devices:" + message);
+    }
+}
+
+DeviceGroupImpl::DeviceGroupImpl(const std::vector<std::shared_ptr<ParameterProtocol>> &protocols) : _protocols(protocols) {
+    if(protocols.empty()) {
+        throw SparkError("passed a empty group of devices");
+    }
+    for(const std::shared_ptr<ParameterProtocol> &protocol : protocols) {
+        if(!protocol) {
+            throw SparkError("passed a null parameter protocol");
+        }
+    }
+}
+
+DeviceGroupImpl::~DeviceGroupImpl() {
+}
+
+size_t DeviceGroupImpl::size() const {
+    return _protocols.size();
+}
+
+GroupWriteResult DeviceGroupImpl::writeBool(int32_t id, bool value) {
+    throwIfInvalid(id, VALUE_BOOL, value);
+    return broadcast([id, value](ParameterProtocol &protocol, ParameterWriteCallback callback) {
+        protocol.writeBoolParameterAsync(id, value, std::move(callback));
+    });
+}
+
+GroupWriteResult DeviceGroupImpl::writeInt(int32_t id, int32_t value) {
+    throwIfInvalid(id, VALUE_INT, value);
+    return broadcast([id, value](ParameterProtocol &protocol, ParameterWriteCallback callback) {
+        protocol.writeIntParameterAsync(id, value, std::move(callback));
+    });
+}
+
+GroupWriteResult DeviceGroupImpl::writeDouble(int32_t id, double value) {
+    throwIfInvalid(id, VALUE_DOUBLE);
+    return broadcast([id, value](ParameterProtocol &protocol, ParameterWriteCallback callback) {
+        protocol.writeDoubleParameterAsync(id, value, std::move(callback));
+    });
+}
+
+GroupWriteResult DeviceGroupImpl::writeString(int32_t id, const std::string &value) {
+    throwIfInvalid(id, VALUE_STRING);
+    return broadcast([id, &value](ParameterProtocol &protocol, ParameterWriteCallback callback) {
+        protocol.writeStringParameterAsync(id, value, std::move(callback));
+    });
+}
+
+GroupWriteResult DeviceGroupImpl::broadcast(const Issue &issue) {
+    // shared with the callbacks, which may still run after the barrier is released
+    struct Barrier {
+        std::mutex lock;
+        std::condition_variable cond;
+        size_t remaining;
+        std::vector<GroupWriteStatus> devices;
+    };
+    std::shared_ptr<Barrier> barrier = std::make_shared<Barrier>();
+    barrier->remaining = _protocols.size();
+    barrier->devices.resize(_protocols.size());
+
+    // the writes are issued back to back without waiting, so all devices receive them within a round trip
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < _protocols.size(); i++) {
+        issue(*_protocols[i], [barrier, i, start](const ParameterStatus &status) {
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            std::lock_guard<std::mutex> lock(barrier->lock);
+            GroupWriteStatus &device = barrier->devices[i];
+            static_cast<ParameterStatus&>(device) = status;
+            device.latency = std::chrono::duration<double, std::milli>(now - start).count();
+            device.appliedTimestamp = status.succeeded ?
+                std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count() : 0;
+            if(--barrier->remaining == 0) {
+                barrier->cond.notify_all();
+            }
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(barrier->lock);
+    barrier->cond.wait(lock, [&]() { return barrier->remaining == 0; });
+
+    GroupWriteResult result;
+    result.devices = barrier->devices;
+    double minLatency = 0.0;
+    double maxLatency = 0.0;
+    bool anySucceeded = false;
+    for(const GroupWriteStatus &device : result.devices) {
+        result.maxLatency = std::max(result.maxLatency, device.latency);
+        if(!device.succeeded) {
+            result.failedCount++;
+            continue;
+        }
+        minLatency = anySucceeded ? std::min(minLatency, device.latency) : device.latency;
+        maxLatency = anySucceeded ? std::max(maxLatency, device.latency) : device.latency;
+        anySucceeded = true;
+    }
+    result.skew = maxLatency - minLatency;
+    result.succeeded = result.failedCount == 0;
+    return result;
+}
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,45 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <libsparkproto/devicegroup.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class DeviceGroupImpl {
+
+public:
+    DeviceGroupImpl(const DeviceList &devices, const ParameterProtocolOptions &options);
+
+    DeviceGroupImpl(const std::vector<std::shared_ptr<ParameterProtocol>> &protocols);
+
+    virtual ~DeviceGroupImpl();
+
+    size_t size() const;
+
+    GroupWriteResult writeBool(int32_t id, bool value);
+
+    GroupWriteResult writeInt(int32_t id, int32_t value);
+
+    GroupWriteResult writeDouble(int32_t id, double value);
+
+    GroupWriteResult writeString(int32_t id, const std::string &value);
+
+private:
+    // issues a write to a protocol, completed by the callback
+    using Issue = std::function<void(ParameterProtocol &protocol, ParameterWriteCallback callback)>;
+
+    // issue a write to all devices at once and wait until all of them answered
+    GroupWriteResult broadcast(const Issue &issue);
+
+    std::vector<std::shared_ptr<ParameterProtocol>> _protocols;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -8,8 +8,12 @@
 namespace libspark {
 namespace protocol {
 
-DeviceParamConfigure::DeviceParamConfigure(std::shared_ptr<DeviceInfo> pDevice)
-    : _pImpl(new DeviceParamConfigureImpl(pDevice)) {
+DeviceParamConfigure::DeviceParamConfigure(std::shared_ptr<DeviceInfo> pDevice, const ParameterProtocolOptions &options)
+    : _pImpl(new DeviceParamConfigureImpl(pDevice, options)) {
+}
+
+DeviceParamConfigure::DeviceParamConfigure(std::shared_ptr<ParameterSession> pSession)
+    : _pImpl(new DeviceParamConfigureImpl(pSession)) {
 }
 
 DeviceParamConfigure::~DeviceParamConfigure() {
@@ -95,13 +99,210 @@ int32_t DeviceParamConfigure::getLedBrightnessLevel() {
     return _pImpl->getLedBrightnessLevel();
 }
 
+std::future<void> DeviceParamConfigure::setAutoExposureAsync(bool enable) {
+    return _pImpl->setAutoExposureAsync(enable);
+}
+
+void DeviceParamConfigure::setAutoExposureAsync(bool enable, ParameterWriteCallback callback) {
+    _pImpl->setAutoExposureAsync(enable, std::move(callback));
+}
+
+std::future<bool> DeviceParamConfigure::getAutoExposureAsync() {
+    return _pImpl->getAutoExposureAsync();
+}
+
+void DeviceParamConfigure::getAutoExposureAsync(ParameterReadCallback<bool> callback) {
+    _pImpl->getAutoExposureAsync(std::move(callback));
+}
+
+std::future<void> DeviceParamConfigure::setAutoExposureModeAsync(int32_t mode) {
+    return _pImpl->setAutoExposureModeAsync(mode);
+}
+
+void DeviceParamConfigure::setAutoExposureModeAsync(int32_t mode, ParameterWriteCallback callback) {
+    _pImpl->setAutoExposureModeAsync(mode, std::move(callback));
+}
+
+std::future<int32_t> DeviceParamConfigure::getAutoExposureModeAsync() {
+    return _pImpl->getAutoExposureModeAsync();
+}
+
+void DeviceParamConfigure::getAutoExposureModeAsync(ParameterReadCallback<int32_t> callback) {
+    _pImpl->getAutoExposureModeAsync(std::move(callback));
+}
+
+std::future<void> DeviceParamConfigure::setExposureValueAsync(int32_t value) {
+    return _pImpl->setExposureValueAsync(value);
+}
+
+void DeviceParamConfigure::setExposureValueAsync(int32_t value, ParameterWriteCallback callback) {
+    _pImpl->setExposureValueAsync(value, std::move(callback));
+}
+
+std::future<int32_t> DeviceParamConfigure::getExposureValueAsync() {
+    return _pImpl->getExposureValueAsync();
+}
+
+void DeviceParamConfigure::getExposureValueAsync(ParameterReadCallback<int32_t> callback) {
+    _pImpl->getExposureValueAsync(std::move(callback));
+}
+
+std::future<void> DeviceParamConfigure::setResolutionAsync(int32_t index) {
+    return _pImpl->setResolutionAsync(index);
+}
+
+void DeviceParamConfigure::setResolutionAsync(int32_t index, ParameterWriteCallback callback) {
+    _pImpl->setResolutionAsync(index, std::move(callback));
+}
+
+std::future<int32_t> DeviceParamConfigure::getResolutionAsync() {
+    return _pImpl->getResolutionAsync();
+}
+
+void DeviceParamConfigure::getResolutionAsync(ParameterReadCallback<int32_t> callback) {
+    _pImpl->getResolutionAsync(std::move(callback));
+}
+
+std::future<void> DeviceParamConfigure::setGainValueAsync(int32_t value) {
+    return _pImpl->setGainValueAsync(value);
+}
+
+void DeviceParamConfigure::setGainValueAsync(int32_t value, ParameterWriteCallback callback) {
+    _pImpl->setGainValueAsync(value, std::move(callback));
+}
+
+std::future<int32_t> DeviceParamConfigure::getGainValueAsync() {
+    return _pImpl->getGainValueAsync();
+}
+
+void DeviceParamConfigure::getGainValueAsync(ParameterReadCallback<int32_t> callback) {
+    _pImpl->getGainValueAsync(std::move(callback));
+}
+
+std::future<void> DeviceParamConfigure::setAutoWhiteBalanceAsync(bool enable) {
+    return _pImpl->setAutoWhiteBalanceAsync(enable);
+}
+
+void DeviceParamConfigure::setAutoWhiteBalanceAsync(bool enable, ParameterWriteCallback callback) {
+    _pImpl->setAutoWhiteBalanceAsync(enable, std::move(callback));
+}
+
+std::future<bool> DeviceParamConfigure::getAutoWhiteBalanceAsync() {
+    return _pImpl->getAutoWhiteBalanceAsync();
+}
+
+void DeviceParamConfigure::getAutoWhiteBalanceAsync(ParameterReadCallback<bool> callback) {
+    _pImpl->getAutoWhiteBalanceAsync(std::move(callback));
+}
+
+std::future<void> DeviceParamConfigure::setAutoWhiteBalanceModeAsync(int32_t value) {
+    return _pImpl->setAutoWhiteBalanceModeAsync(value);
+}
+
+void DeviceParamConfigure::setAutoWhiteBalanceModeAsync(int32_t value, ParameterWriteCallback callback) {
+    _pImpl->setAutoWhiteBalanceModeAsync(value, std::move(callback));
+}
+
+std::future<int32_t> DeviceParamConfigure::getAutoWhiteBalanceModeAsync() {
+    return _pImpl->getAutoWhiteBalanceModeAsync();
+}
+
+void DeviceParamConfigure::getAutoWhiteBalanceModeAsync(ParameterReadCallback<int32_t> callback) {
+    _pImpl->getAutoWhiteBalanceModeAsync(std::move(callback));
+}
+
+std::future<void> DeviceParamConfigure::setWhiteBalanceValueAsync(int32_t value) {
+    return _pImpl->setWhiteBalanceValueAsync(value);
+}
+
+void DeviceParamConfigure::setWhiteBalanceValueAsync(int32_t value, ParameterWriteCallback callback) {
+    _pImpl->setWhiteBalanceValueAsync(value, std::move(callback));
+}
+
+std::future<int32_t> DeviceParamConfigure::getWhiteBalanceValueAsync() {
+    return _pImpl->getWhiteBalanceValueAsync();
+}
+
+void DeviceParamConfigure::getWhiteBalanceValueAsync(ParameterReadCallback<int32_t> callback) {
+    _pImpl->getWhiteBalanceValueAsync(std::move(callback));
+}
+
+std::future<void> DeviceParamConfigure::setLedModeAsync(bool enable) {
+    return _pImpl->setLedModeAsync(enable);
+}
+
+void DeviceParamConfigure::setLedModeAsync(bool enable, ParameterWriteCallback callback) {
+    _pImpl->setLedModeAsync(enable, std::move(callback));
+}
+
+std::future<bool> DeviceParamConfigure::getLedModeAsync() {
+    return _pImpl->getLedModeAsync();
+}
+
+void DeviceParamConfigure::getLedModeAsync(ParameterReadCallback<bool> callback) {
+    _pImpl->getLedModeAsync(std::move(callback));
+}
+
+std::future<void> DeviceParamConfigure::setLedBrightnessLevelAsync(int32_t value) {
+    return _pImpl->setLedBrightnessLevelAsync(value);
+}
+
+void DeviceParamConfigure::setLedBrightnessLevelAsync(int32_t value, ParameterWriteCallback callback) {
+    _pImpl->setLedBrightnessLevelAsync(value, std::move(callback));
+}
+
+std::future<int32_t> DeviceParamConfigure::getLedBrightnessLevelAsync() {
+    return _pImpl->getLedBrightnessLevelAsync();
+}
+
+void DeviceParamConfigure::getLedBrightnessLevelAsync(ParameterReadCallback<int32_t> callback) {
+    _pImpl->getLedBrightnessLevelAsync(std::move(callback));
+}
+
 void DeviceParamConfigure::exportCalibrationData(std::string filename) {
     _pImpl->exportCalibrationData(filename);
 }
 
+StereoCalibration DeviceParamConfigure::readCalibration() {
+    return _pImpl->readCalibration();
+}
+
 void DeviceParamConfigure::readDeviceInfoMsg(DeviceInfoMessage &deviceInfoMsg) {
     _pImpl->readDeviceInfoMsg(deviceInfoMsg);
 }
 
+DeviceSettings DeviceParamConfigure::readSettings() {
+    return _pImpl->readSettings();
+}
+
+void DeviceParamConfigure::writeSettings(const DeviceSettings &settings) {
+    _pImpl->writeSettings(settings);
+}
+
+void DeviceParamConfigure::invalidateCache() {
+    _pImpl->invalidateCache();
+}
+
+void DeviceParamConfigure::refreshCache() {
+    _pImpl->refreshCache();
+}
+
+void DeviceParamConfigure::execute(ParameterBatch &batch) {
+    _pImpl->execute(batch);
+}
+
+ParameterProfile DeviceParamConfigure::snapshotProfile() {
+    return _pImpl->snapshotProfile();
+}
+
+ProfileResult DeviceParamConfigure::applyProfile(const ParameterProfile &profile) {
+    return _pImpl->applyProfile(profile);
+}
+
+std::vector<ProfileResult> DeviceParamConfigure::applyProfile(const DeviceList &devices, const ParameterProfile &profile,
+    uint32_t parallelism, const ParameterProtocolOptions &options) {
+    return DeviceParamConfigureImpl::applyProfile(devices, profile, parallelism, options);
+}
+
 } // namespace protocol
 } // namespace libspark
@@ -6,25 +6,65 @@
 #include <memory>
 
 #include <libsparkproto/common.h>
+#include <libsparkproto/calibration.h>
 #include <libsparkproto/deviceinfo.h>
 #include <libsparkproto/device.pb.h>
+#include <libsparkproto/parameterbatch.h>
+#include <libsparkproto/parameterprofile.h>
+#include <libsparkproto/parameterprotocol.h>
+#include <libsparkproto/parametersession.h>
 
 namespace libspark {
 
 namespace protocol {
 
+/**
+ * @brief Settings of a device which DeviceParamConfigure reads and writes in one round trip
+ *
+ */
+struct SPARK_API DeviceSettings {
+    bool autoExposure = false;
+    int32_t autoExposureMode = 0;
+    int32_t exposure = 0;
+    int32_t gain = 0;
+    int32_t resolution = 0;
+    bool autoWhiteBalance = false;
+    int32_t autoWhiteBalanceMode = 0;
+    int32_t whiteBalance = 0;
+    bool ledMode = false;
+    int32_t ledBrightnessLevel = 0;
+};
+
 class DeviceParamConfigureImpl;
+
+/**
+ * @brief DeviceParamConfigure reads and writes parameters of a device. Getters and setters wait for the device,
+ * the *Async ones never do and can be called from stream callbacks and real-time threads, see ParameterProtocol
+ * for how their results are delivered. All functions are thread-safe, requests of concurrent callers are pipelined.
+ *
+ */
 class SPARK_API DeviceParamConfigure
 {
 public:
     using Ptr = std::unique_ptr<DeviceParamConfigure>;
     
     /**
-     * @brief Construct a new Device Parameters object
+     * @brief Construct a new Device Parameters object. options enable e.g. the cache of parameters,
+     * see ParameterProtocolOptions. The connections are shared with the other DeviceParamConfigure objects of the device
+     * with the same options, see ParameterSession::get(). They are opened on first use, so if the device can not be
+     * reached, the exception is thrown by the first call instead
      * 
      * @param pDevice 
+     * @param options 
+     */
+    DeviceParamConfigure(std::shared_ptr<DeviceInfo> pDevice, const ParameterProtocolOptions &options = ParameterProtocolOptions());
+
+    /**
+     * @brief Construct a new Device Parameters object using the connections of a session
+     * 
+     * @param pSession 
      */
-    DeviceParamConfigure(std::shared_ptr<DeviceInfo> pDevice);
+    DeviceParamConfigure(std::shared_ptr<ParameterSession> pSession);
 
     /**
      * @brief Destroy the Device Parameters object
@@ -178,6 +218,306 @@ public:
      */
     int32_t getLedBrightnessLevel();
 
+    /**
+     * @brief Set the Auto Exposure asynchronously, the future completes when the device has accepted it
+     * 
+     * @param enable 
+     * @return std::future<void> 
+     */
+    std::future<void> setAutoExposureAsync(bool enable);
+
+    /**
+     * @brief Set the Auto Exposure asynchronously, callback is called with the result
+     * 
+     * @param enable 
+     * @param callback 
+     */
+    void setAutoExposureAsync(bool enable, ParameterWriteCallback callback);
+
+    /**
+     * @brief Get the Auto Exposure asynchronously
+     * 
+     * @return std::future<bool> 
+     */
+    std::future<bool> getAutoExposureAsync();
+
+    /**
+     * @brief Get the Auto Exposure asynchronously, callback is called with the result
+     * 
+     * @param callback 
+     */
+    void getAutoExposureAsync(ParameterReadCallback<bool> callback);
+
+    /**
+     * @brief Set the Auto Exposure Mode asynchronously, the future completes when the device has accepted it
+     * 
+     * @param mode 
+     * @return std::future<void> 
+     */
+    std::future<void> setAutoExposureModeAsync(int32_t mode);
+
+    /**
+     * @brief Set the Auto Exposure Mode asynchronously, callback is called with the result
+     * 
+     * @param mode 
+     * @param callback 
+     */
+    void setAutoExposureModeAsync(int32_t mode, ParameterWriteCallback callback);
+
+    /**
+     * @brief Get the Auto Exposure Mode asynchronously
+     * 
+     * @return std::future<int32_t> 
+     */
+    std::future<int32_t> getAutoExposureModeAsync();
+
+    /**
+     * @brief Get the Auto Exposure Mode asynchronously, callback is called with the result
+     * 
+     * @param callback 
+     */
+    void getAutoExposureModeAsync(ParameterReadCallback<int32_t> callback);
+
+    /**
+     * @brief Set the Exposure Value asynchronously, the future completes when the device has accepted it
+     * 
+     * @param value 
+     * @return std::future<void> 
+     */
+    std::future<void> setExposureValueAsync(int32_t value);
+
+    /**
+     * @brief Set the Exposure Value asynchronously, callback is called with the result
+     * 
+     * @param value 
+     * @param callback 
+     */
+    void setExposureValueAsync(int32_t value, ParameterWriteCallback callback);
+
+    /**
+     * @brief Get the Exposure Value asynchronously
+     * 
+     * @return std::future<int32_t> 
+     */
+    std::future<int32_t> getExposureValueAsync();
+
+    /**
+     * @brief Get the Exposure Value asynchronously, callback is called with the result
+     * 
+     * @param callback 
+     */
+    void getExposureValueAsync(ParameterReadCallback<int32_t> callback);
+
+    /**
+     * @brief Set the Resolution asynchronously, the future completes when the device has accepted it
+     * 
+     * @param index 
+     * @return std::future<void> 
+     */
+    std::future<void> setResolutionAsync(int32_t index);
+
+    /**
+     * @brief Set the Resolution asynchronously, callback is called with the result
+     * 
+     * @param index 
+     * @param callback 
+     */
+    void setResolutionAsync(int32_t index, ParameterWriteCallback callback);
+
+    /**
+     * @brief Get the Resolution asynchronously
+     * 
+     * @return std::future<int32_t> 
+     */
+    std::future<int32_t> getResolutionAsync();
+
+    /**
+     * @brief Get the Resolution asynchronously, callback is called with the result
+     * 
+     * @param callback 
+     */
+    void getResolutionAsync(ParameterReadCallback<int32_t> callback);
+
+    /**
+     * @brief Set the Gain Value asynchronously, the future completes when the device has accepted it
+     * 
+     * @param value 
+     * @return std::future<void> 
+     */
+    std::future<void> setGainValueAsync(int32_t value);
+
+    /**
+     * @brief Set the Gain Value asynchronously, callback is called with the result
+     * 
+     * @param value 
+     * @param callback 
+     */
+    void setGainValueAsync(int32_t value, ParameterWriteCallback callback);
+
+    /**
+     * @brief Get the Gain Value asynchronously
+     * 
+     * @return std::future<int32_t> 
+     */
+    std::future<int32_t> getGainValueAsync();
+
+    /**
+     * @brief Get the Gain Value asynchronously, callback is called with the result
+     * 
+     * @param callback 
+     */
+    void getGainValueAsync(ParameterReadCallback<int32_t> callback);
+
+    /**
+     * @brief Set the Auto White Balance asynchronously, the future completes when the device has accepted it
+     * 
+     * @param enable 
+     * @return std::future<void> 
+     */
+    std::future<void> setAutoWhiteBalanceAsync(bool enable);
+
+    /**
+     * @brief Set the Auto White Balance asynchronously, callback is called with the result
+     * 
+     * @param enable 
+     * @param callback 
+     */
+    void setAutoWhiteBalanceAsync(bool enable, ParameterWriteCallback callback);
+
+    /**
+     * @brief Get the Auto White Balance asynchronously
+     * 
+     * @return std::future<bool> 
+     */
+    std::future<bool> getAutoWhiteBalanceAsync();
+
+    /**
+     * @brief Get the Auto White Balance asynchronously, callback is called with the result
+     * 
+     * @param callback 
+     */
+    void getAutoWhiteBalanceAsync(ParameterReadCallback<bool> callback);
+
+    /**
+     * @brief Set the Auto White Balance Mode asynchronously, the future completes when the device has accepted it
+     * 
+     * @param value 
+     * @return std::future<void> 
+     */
+    std::future<void> setAutoWhiteBalanceModeAsync(int32_t value);
+
+    /**
+     * @brief Set the Auto White Balance Mode asynchronously, callback is called with the result
+     * 
+     * @param value 
+     * @param callback 
+     */
+    void setAutoWhiteBalanceModeAsync(int32_t value, ParameterWriteCallback callback);
+
+    /**
+     * @brief Get the Auto White Balance Mode asynchronously
+     * 
+     * @return std::future<int32_t> 
+     */
+    std::future<int32_t> getAutoWhiteBalanceModeAsync();
+
+    /**
+     * @brief Get the Auto White Balance Mode asynchronously, callback is called with the result
+     * 
+     * @param callback 
+     */
+    void getAutoWhiteBalanceModeAsync(ParameterReadCallback<int32_t> callback);
+
+    /**
+     * @brief Set the White Balance Value asynchronously, the future completes when the device has accepted it
+     * 
+     * @param value 
+     * @return std::future<void> 
+     */
+    std::future<void> setWhiteBalanceValueAsync(int32_t value);
+
+    /**
+     * @brief Set the White Balance Value asynchronously, callback is called with the result
+     * 
+     * @param value 
+     * @param callback 
+     */
+    void setWhiteBalanceValueAsync(int32_t value, ParameterWriteCallback callback);
+
+    /**
+     * @brief Get the White Balance Value asynchronously
+     * 
+     * @return std::future<int32_t> 
+     */
+    std::future<int32_t> getWhiteBalanceValueAsync();
+
+    /**
+     * @brief Get the White Balance Value asynchronously, callback is called with the result
+     * 
+     * @param callback 
+     */
+    void getWhiteBalanceValueAsync(ParameterReadCallback<int32_t> callback);
+
+    /**
+     * @brief Set the Led Mode asynchronously, the future completes when the device has accepted it
+     * 
+     * @param enable 
+     * @return std::future<void> 
+     */
+    std::future<void> setLedModeAsync(bool enable);
+
+    /**
+     * @brief Set the Led Mode asynchronously, callback is called with the result
+     * 
+     * @param enable 
+     * @param callback 
+     */
+    void setLedModeAsync(bool enable, ParameterWriteCallback callback);
+
+    /**
+     * @brief Get the Led Mode asynchronously
+     * 
+     * @return std::future<bool> 
+     */
+    std::future<bool> getLedModeAsync();
+
+    /**
+     * @brief Get the Led Mode asynchronously, callback is called with the result
+     * 
+     * @param callback 
+     */
+    void getLedModeAsync(ParameterReadCallback<bool> callback);
+
+    /**
+     * @brief Set the Led Brightness Level asynchronously, the future completes when the device has accepted it
+     * 
+     * @param value 
+     * @return std::future<void> 
+     */
+    std::future<void> setLedBrightnessLevelAsync(int32_t value);
+
+    /**
+     * @brief Set the Led Brightness Level asynchronously, callback is called with the result
+     * 
+     * @param value 
+     * @param callback 
+     */
+    void setLedBrightnessLevelAsync(int32_t value, ParameterWriteCallback callback);
+
+    /**
+     * @brief Get the Led Brightness Level asynchronously
+     * 
+     * @return std::future<int32_t> 
+     */
+    std::future<int32_t> getLedBrightnessLevelAsync();
+
+    /**
+     * @brief Get the Led Brightness Level asynchronously, callback is called with the result
+     * 
+     * @param callback 
+     */
+    void getLedBrightnessLevelAsync(ParameterReadCallback<int32_t> callback);
+
     /**
      * @brief export calibration data to file
      * filename could be a path to file, or just filename only.
@@ -187,6 +527,13 @@ public:
      */
     void exportCalibrationData(std::string filename);
 
+    /**
+     * @brief Read the calibration data of the device and parse it, see parseCalibration()
+     *
+     * @return StereoCalibration
+     */
+    StereoCalibration readCalibration();
+
     /**
      * @brief read detail informations of device. The information is defined as a protobuf message, DeviceInfoMessage.
      * 
@@ -194,6 +541,75 @@ public:
      */
     void readDeviceInfoMsg(DeviceInfoMessage &deviceInfoMsg);
 
+    /**
+     * @brief Read all settings of the device in one round trip.
+     * If a setting can not be read, a exception is thrown with the errors of the settings which failed
+     *
+     * @return DeviceSettings
+     */
+    DeviceSettings readSettings();
+
+    /**
+     * @brief Write all settings to the device in one round trip, the resolution first.
+     * If a setting can not be written, a exception is thrown with the errors of the settings which failed,
+     * the others are written
+     *
+     * @param settings
+     */
+    void writeSettings(const DeviceSettings &settings);
+
+    /**
+     * @brief Remove all parameters from the cache, so the next getters read the device
+     *
+     */
+    void invalidateCache();
+
+    /**
+     * @brief Read the parameters in the cache again from the device
+     *
+     */
+    void refreshCache();
+
+    /**
+     * @brief Execute reads and writes of parameters in one round trip, see ParameterBatch
+     *
+     * @param batch
+     */
+    void execute(ParameterBatch &batch);
+
+    /**
+     * @brief Read the settings of the device into a profile in one round trip. Read-only parameters, commands and
+     * parameters which the device can not read are left out. If the connection fails, a exception is thrown
+     *
+     * @return ParameterProfile
+     */
+    ParameterProfile snapshotProfile();
+
+    /**
+     * @brief Apply a profile to the device, writing only the parameters which have another value on the device.
+     * The device is read in one round trip and the differences are written in a second one, modes before the values
+     * they drive. Values which their automatic mode in the profile overrides are not written.
+     * If a parameter can not be written, a exception is thrown with the errors, the others are written
+     *
+     * @param profile
+     * @return ProfileResult
+     */
+    ProfileResult applyProfile(const ParameterProfile &profile);
+
+    /**
+     * @brief Apply a profile to many devices, up to parallelism devices at a time, see applyProfile().
+     * A device which fails does not stop the others, its error is in its result. Results are in the order of devices.
+     * If parallelism is 0, a exception is thrown
+     *
+     * @param devices
+     * @param profile
+     * @param parallelism
+     * @param options options of the connections to the devices
+     * @return std::vector<ProfileResult>
+     */
+    static std::vector<ProfileResult> applyProfile(const DeviceList &devices, const ParameterProfile &profile,
+        uint32_t parallelism = 8, const ParameterProtocolOptions &options = ParameterProtocolOptions());
+
 private:
     std::unique_ptr<DeviceParamConfigureImpl> _pImpl;
 };
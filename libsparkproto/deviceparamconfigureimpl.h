@@ -6,8 +6,11 @@
 #include <memory>
 
 #include <libsparkproto/common.h>
+#include <libsparkproto/calibration.h>
 #include <libsparkproto/deviceinfo.h>
+#include <libsparkproto/deviceparamconfigure.h>
 #include <libsparkproto/parameterprotocol.h>
+#include <libsparkproto/parametersession.h>
 
 namespace libspark
 {
@@ -22,8 +25,16 @@ public:
      * @brief Construct a new DeviceParamConfigureImpl object
      * 
      * @param pDevice 
+     * @param options 
      */
-    DeviceParamConfigureImpl(std::shared_ptr<DeviceInfo> pDevice);
+    DeviceParamConfigureImpl(std::shared_ptr<DeviceInfo> pDevice, const ParameterProtocolOptions &options);
+
+    /**
+     * @brief Construct a new DeviceParamConfigureImpl object using the connections of a session
+     * 
+     * @param pSession 
+     */
+    DeviceParamConfigureImpl(std::shared_ptr<ParameterSession> pSession);
 
     /**
      * @brief Destroy the DeviceParamConfigureImpl object
@@ -175,6 +186,306 @@ public:
      */
     int32_t getLedBrightnessLevel();
 
+    /**
+     * @brief Set the Auto Exposure asynchronously, the future completes when the device has accepted it
+     * 
+     * @param enable 
+     * @return std::future<void> 
+     */
+    std::future<void> setAutoExposureAsync(bool enable);
+
+    /**
+     * @brief Set the Auto Exposure asynchronously, callback is called with the result
+     * 
+     * @param enable 
+     * @param callback 
+     */
+    void setAutoExposureAsync(bool enable, ParameterWriteCallback callback);
+
+    /**
+     * @brief Get the Auto Exposure asynchronously
+     * 
+     * @return std::future<bool> 
+     */
+    std::future<bool> getAutoExposureAsync();
+
+    /**
+     * @brief Get the Auto Exposure asynchronously, callback is called with the result
+     * 
+     * @param callback 
+     */
+    void getAutoExposureAsync(ParameterReadCallback<bool> callback);
+
+    /**
+     * @brief Set the Auto Exposure Mode asynchronously, the future completes when the device has accepted it
+     * 
+     * @param mode 
+     * @return std::future<void> 
+     */
+    std::future<void> setAutoExposureModeAsync(int32_t mode);
+
+    /**
+     * @brief Set the Auto Exposure Mode asynchronously, callback is called with the result
+     * 
+     * @param mode 
+     * @param callback 
+     */
+    void setAutoExposureModeAsync(int32_t mode, ParameterWriteCallback callback);
+
+    /**
+     * @brief Get the Auto Exposure Mode asynchronously
+     * 
+     * @return std::future<int32_t> 
+     */
+    std::future<int32_t> getAutoExposureModeAsync();
+
+    /**
+     * @brief Get the Auto Exposure Mode asynchronously, callback is called with the result
+     * 
+     * @param callback 
+     */
+    void getAutoExposureModeAsync(ParameterReadCallback<int32_t> callback);
+
+    /**
+     * @brief Set the Exposure Value asynchronously, the future completes when the device has accepted it
+     * 
+     * @param value 
+     * @return std::future<void> 
+     */
+    std::future<void> setExposureValueAsync(int32_t value);
+
+    /**
+     * @brief Set the Exposure Value asynchronously, callback is called with the result
+     * 
+     * @param value 
+     * @param callback 
+     */
+    void setExposureValueAsync(int32_t value, ParameterWriteCallback callback);
+
+    /**
+     * @brief Get the Exposure Value asynchronously
+     * 
+     * @return std::future<int32_t> 
+     */
+    std::future<int32_t> getExposureValueAsync();
+
+    /**
+     * @brief Get the Exposure Value asynchronously, callback is called with the result
+     * 
+     * @param callback 
+     */
+    void getExposureValueAsync(ParameterReadCallback<int32_t> callback);
+
+    /**
+     * @brief Set the Resolution asynchronously, the future completes when the device has accepted it
+     * 
+     * @param index 
+     * @return std::future<void> 
+     */
+    std::future<void> setResolutionAsync(int32_t index);
+
+    /**
+     * @brief Set the Resolution asynchronously, callback is called with the result
+     * 
+     * @param index 
+     * @param callback 
+     */
+    void setResolutionAsync(int32_t index, ParameterWriteCallback callback);
+
+    /**
+     * @brief Get the Resolution asynchronously
+     * 
+     * @return std::future<int32_t> 
+     */
+    std::future<int32_t> getResolutionAsync();
+
+    /**
+     * @brief Get the Resolution asynchronously, callback is called with the result
+     * 
+     * @param callback 
+     */
+    void getResolutionAsync(ParameterReadCallback<int32_t> callback);
+
+    /**
+     * @brief Set the Gain Value asynchronously, the future completes when the device has accepted it
+     * 
+     * @param value 
+     * @return std::future<void> 
+     */
+    std::future<void> setGainValueAsync(int32_t value);
+
+    /**
+     * @brief Set the Gain Value asynchronously, callback is called with the result
+     * 
+     * @param value 
+     * @param callback 
+     */
+    void setGainValueAsync(int32_t value, ParameterWriteCallback callback);
+
+    /**
+     * @brief Get the Gain Value asynchronously
+     * 
+     * @return std::future<int32_t> 
+     */
+    std::future<int32_t> getGainValueAsync();
+
+    /**
+     * @brief Get the Gain Value asynchronously, callback is called with the result
+     * 
+     * @param callback 
+     */
+    void getGainValueAsync(ParameterReadCallback<int32_t> callback);
+
+    /**
+     * @brief Set the Auto White Balance asynchronously, the future completes when the device has accepted it
+     * 
+     * @param enable 
+     * @return std::future<void> 
+     */
+    std::future<void> setAutoWhiteBalanceAsync(bool enable);
+
+    /**
+     * @brief Set the Auto White Balance asynchronously, callback is called with the result
+     * 
+     * @param enable 
+     * @param callback 
+     */
+    void setAutoWhiteBalanceAsync(bool enable, ParameterWriteCallback callback);
+
+    /**
+     * @brief Get the Auto White Balance asynchronously
+     * 
+     * @return std::future<bool> 
+     */
+    std::future<bool> getAutoWhiteBalanceAsync();
+
+    /**
+     * @brief Get the Auto White Balance asynchronously, callback is called with the result
+     * 
+     * @param callback 
+     */
+    void getAutoWhiteBalanceAsync(ParameterReadCallback<bool> callback);
+
+    /**
+     * @brief Set the Auto White Balance Mode asynchronously, the future completes when the device has accepted it
+     * 
+     * @param value 
+     * @return std::future<void> 
+     */
+    std::future<void> setAutoWhiteBalanceModeAsync(int32_t value);
+
+    /**
+     * @brief Set the Auto White Balance Mode asynchronously, callback is called with the result
+     * 
+     * @param value 
+     * @param callback 
+     */
+    void setAutoWhiteBalanceModeAsync(int32_t value, ParameterWriteCallback callback);
+
+    /**
+     * @brief Get the Auto White Balance Mode asynchronously
+     * 
+     * @return std::future<int32_t> 
+     */
+    std::future<int32_t> getAutoWhiteBalanceModeAsync();
+
+    /**
+     * @brief Get the Auto White Balance Mode asynchronously, callback is called with the result
+     * 
+     * @param callback 
+     */
+    void getAutoWhiteBalanceModeAsync(ParameterReadCallback<int32_t> callback);
+
+    /**
+     * @brief Set the White Balance Value asynchronously, the future completes when the device has accepted it
+     * 
+     * @param value 
+     * @return std::future<void> 
+     */
+    std::future<void> setWhiteBalanceValueAsync(int32_t value);
+
+    /**
+     * @brief Set the White Balance Value asynchronously, callback is called with the result
+     * 
+     * @param value 
+     * @param callback 
+     */
+    void setWhiteBalanceValueAsync(int32_t value, ParameterWriteCallback callback);
+
+    /**
+     * @brief Get the White Balance Value asynchronously
+     * 
+     * @return std::future<int32_t> 
+     */
+    std::future<int32_t> getWhiteBalanceValueAsync();
+
+    /**
+     * @brief Get the White Balance Value asynchronously, callback is called with the result
+     * 
+     * @param callback 
+     */
+    void getWhiteBalanceValueAsync(ParameterReadCallback<int32_t> callback);
+
+    /**
+     * @brief Set the Led Mode asynchronously, the future completes when the device has accepted it
+     * 
+     * @param enable 
+     * @return std::future<void> 
+     */
+    std::future<void> setLedModeAsync(bool enable);
+
+    /**
+     * @brief Set the Led Mode asynchronously, callback is called with the result
+     * 
+     * @param enable 
+     * @param callback 
+     */
+    void setLedModeAsync(bool enable, ParameterWriteCallback callback);
+
+    /**
+     * @brief Get the Led Mode asynchronously
+     * 
+     * @return std::future<bool> 
+     */
+    std::future<bool> getLedModeAsync();
+
+    /**
+     * @brief Get the Led Mode asynchronously, callback is called with the result
+     * 
+     * @param callback 
+     */
+    void getLedModeAsync(ParameterReadCallback<bool> callback);
+
+    /**
+     * @brief Set the Led Brightness Level asynchronously, the future completes when the device has accepted it
+     * 
+     * @param value 
+     * @return std::future<void> 
+     */
+    std::future<void> setLedBrightnessLevelAsync(int32_t value);
+
+    /**
+     * @brief Set the Led Brightness Level asynchronously, callback is called with the result
+     * 
+     * @param value 
+     * @param callback 
+     */
+    void setLedBrightnessLevelAsync(int32_t value, ParameterWriteCallback callback);
+
+    /**
+     * @brief Get the Led Brightness Level asynchronously
+     * 
+     * @return std::future<int32_t> 
+     */
+    std::future<int32_t> getLedBrightnessLevelAsync();
+
+    /**
+     * @brief Get the Led Brightness Level asynchronously, callback is called with the result
+     * 
+     * @param callback 
+     */
+    void getLedBrightnessLevelAsync(ParameterReadCallback<int32_t> callback);
+
     /**
      * @brief export calibration data to file
      * filename could be a path to file, or just filename only.
@@ -184,15 +495,86 @@ public:
      */
     void exportCalibrationData(std::string filename);
 
+    /**
+     * @brief Read the calibration data of the device and parse it, see parseCalibration()
+     *
+     * @return StereoCalibration
+     */
+    StereoCalibration readCalibration();
+
     /**
      * @brief read detail informations of device. The information is defined as a protobuf message, DeviceInfoMessage.
      * 
      * @param deviceInfoMsg 
      */
     void readDeviceInfoMsg(DeviceInfoMessage &deviceInfoMsg);
+
+    /**
+     * @brief Read all settings of the device in one round trip
+     * 
+     * @return DeviceSettings 
+     */
+    DeviceSettings readSettings();
+
+    /**
+     * @brief Write all settings to the device in one round trip
+     * 
+     * @param settings 
+     */
+    void writeSettings(const DeviceSettings &settings);
+
+    /**
+     * @brief Remove all parameters from the cache
+     * 
+     */
+    void invalidateCache();
+
+    /**
+     * @brief Read the parameters in the cache again from the device
+     * 
+     */
+    void refreshCache();
+
+    /**
+     * @brief Execute reads and writes of parameters in one round trip
+     * 
+     * @param batch 
+     */
+    void execute(ParameterBatch &batch);
+
+    /**
+     * @brief Read the settings of the device into a profile
+     * 
+     * @return ParameterProfile 
+     */
+    ParameterProfile snapshotProfile();
+
+    /**
+     * @brief Write the parameters of a profile which have another value on the device
+     * 
+     * @param profile 
+     * @return ProfileResult 
+     */
+    ProfileResult applyProfile(const ParameterProfile &profile);
+
+    /**
+     * @brief Apply a profile to many devices, up to parallelism devices at a time
+     * 
+     * @param devices 
+     * @param profile 
+     * @param parallelism 
+     * @param options 
+     * @return std::vector<ProfileResult> 
+     */
+    static std::vector<ProfileResult> applyProfile(const DeviceList &devices, const ParameterProfile &profile,
+        uint32_t parallelism, const ParameterProtocolOptions &options);
     
 private:
-    std::unique_ptr<ParameterProtocol> _pProtocol;
+    // write the differences of profile to the device, with the errors of the writes in result.
+    // If the connection fails, a exception is thrown
+    void apply(const ParameterProfile &profile, ProfileResult &result);
+
+    std::shared_ptr<ParameterSession> _pSession;
 };
 
 } // namespace protocol
@@ -2,110 +2,282 @@
 // SPDX-License-Identifier: BSD 3-Clause
 
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <set>
+#include <thread>
 
 #include <libsparkproto/deviceparamconfigureimpl.h>
 #include <libsparkproto/parameterids.pb.h>
+#include <libsparkproto/parameterregistry.h>
 #include <libsparkproto/exception.h>
 #include <libsparkproto/constants.h>
+#include <libsparkproto/log.h>
 
 namespace libspark
 {
 namespace protocol
 {
 
-DeviceParamConfigureImpl::DeviceParamConfigureImpl(std::shared_ptr<DeviceInfo> pDevice) {
-    if(!pDevice->isCompatible())
-        throw SparkError("The library is not compatible with Spark firmware, please upgrade new version of libsparkpro");
-    
-    _pProtocol = std::make_unique<ParameterProtocol>(pDevice->getIpAdress(), std::to_string(PARAMETERS_PORT));
+DeviceParamConfigureImpl::DeviceParamConfigureImpl(std::shared_ptr<DeviceInfo> pDevice, const ParameterProtocolOptions &options) {
+    ParameterSessionOptions sessionOptions;
+    sessionOptions.protocol = options;
+    _pSession = ParameterSession::get(pDevice, sessionOptions);
+}
+
+DeviceParamConfigureImpl::DeviceParamConfigureImpl(std::shared_ptr<ParameterSession> pSession) {
+    if(!pSession) {
+        throw SparkError("passed a null session");
+    }
+    _pSession = pSession;
 }
 
 DeviceParamConfigureImpl::~DeviceParamConfigureImpl() {
 }
 
 void DeviceParamConfigureImpl::setAutoExposure(bool enable) {
-    _pProtocol->writeBoolParameter(ParameterID::AUTO_EXPOSURE, enable);
+    _pSession->acquire()->writeBoolParameter(ParameterID::AUTO_EXPOSURE, enable);
 }
 
 bool DeviceParamConfigureImpl::getAutoExposure() {
-    return _pProtocol->readBoolParameter(ParameterID::AUTO_EXPOSURE);
+    return _pSession->acquire()->readBoolParameter(ParameterID::AUTO_EXPOSURE);
 }
 
 void DeviceParamConfigureImpl::setAutoExposureMode(int32_t mode) {
-    _pProtocol->writeIntParameter(ParameterID::AUTO_EXPOSURE_MODE, mode);
+    _pSession->acquire()->writeIntParameter(ParameterID::AUTO_EXPOSURE_MODE, mode);
 }
 
 int32_t DeviceParamConfigureImpl::getAutoExposureMode() {
-    return _pProtocol->readIntParameter(ParameterID::AUTO_EXPOSURE_MODE);
+    return _pSession->acquire()->readIntParameter(ParameterID::AUTO_EXPOSURE_MODE);
 }
 
 void DeviceParamConfigureImpl::setExposureValue(int32_t value) {
-    _pProtocol->writeIntParameter(ParameterID::MANUAL_EXPOSURE, value);
+    _pSession->acquire()->writeIntParameter(ParameterID::MANUAL_EXPOSURE, value);
 }
 
 int32_t DeviceParamConfigureImpl::getExposureValue() {
-    return _pProtocol->readIntParameter(ParameterID::MANUAL_EXPOSURE);
+    return _pSession->acquire()->readIntParameter(ParameterID::MANUAL_EXPOSURE);
 }
 
 void DeviceParamConfigureImpl::setResolution(int32_t index) {
-    _pProtocol->writeIntParameter(ParameterID::RESOLUTION, index);
+    _pSession->acquire()->writeIntParameter(ParameterID::RESOLUTION, index);
 }
 
 int32_t DeviceParamConfigureImpl::getResolution() {
-    return _pProtocol->readIntParameter(ParameterID::RESOLUTION);
+    return _pSession->acquire()->readIntParameter(ParameterID::RESOLUTION);
 }
 
 void DeviceParamConfigureImpl::setGainValue(int32_t value) {
-    _pProtocol->writeIntParameter(ParameterID::MANUAL_GAIN, value);
+    _pSession->acquire()->writeIntParameter(ParameterID::MANUAL_GAIN, value);
 }
 
 int32_t DeviceParamConfigureImpl::getGainValue() {
-    return _pProtocol->readIntParameter(ParameterID::MANUAL_GAIN);
+    return _pSession->acquire()->readIntParameter(ParameterID::MANUAL_GAIN);
 }
 
 void DeviceParamConfigureImpl::setAutoWhiteBalance(bool enable) {
-    _pProtocol->writeBoolParameter(ParameterID::AUTO_WB, enable);
+    _pSession->acquire()->writeBoolParameter(ParameterID::AUTO_WB, enable);
 }
 
 bool DeviceParamConfigureImpl::getAutoWhiteBalance() {
-    return _pProtocol->readBoolParameter(ParameterID::AUTO_WB);
+    return _pSession->acquire()->readBoolParameter(ParameterID::AUTO_WB);
 }
 
 void DeviceParamConfigureImpl::setAutoWhiteBalanceMode(int32_t value) {
-    _pProtocol->writeIntParameter(ParameterID::AUTO_WB_MODE, value);
+    _pSession->acquire()->writeIntParameter(ParameterID::AUTO_WB_MODE, value);
 }
 
 int32_t DeviceParamConfigureImpl::getAutoWhiteBalanceMode() {
-    return _pProtocol->readIntParameter(ParameterID::AUTO_WB_MODE);
+    return _pSession->acquire()->readIntParameter(ParameterID::AUTO_WB_MODE);
 }
 
 void DeviceParamConfigureImpl::setWhiteBalanceValue(int32_t value) {
-    _pProtocol->writeIntParameter(ParameterID::MANUAL_WB, value);
+    _pSession->acquire()->writeIntParameter(ParameterID::MANUAL_WB, value);
 }
 
 int32_t DeviceParamConfigureImpl::getWhiteBalanceValue() {
-    return _pProtocol->readIntParameter(ParameterID::MANUAL_WB);
+    return _pSession->acquire()->readIntParameter(ParameterID::MANUAL_WB);
 }
 
 void DeviceParamConfigureImpl::setLedMode(bool enable) {
-    _pProtocol->writeBoolParameter(ParameterID::LED_MODE, enable);
+    _pSession->acquire()->writeBoolParameter(ParameterID::LED_MODE, enable);
 }
 
 bool DeviceParamConfigureImpl::getLedMode() {
-    return _pProtocol->readBoolParameter(ParameterID::LED_MODE);
+    return _pSession->acquire()->readBoolParameter(ParameterID::LED_MODE);
 }
 
 void DeviceParamConfigureImpl::setLedBrightnessLevel(int32_t value) {
-    _pProtocol->writeIntParameter(ParameterID::LED_BRIGHTNESS_LEVEL, value);
+    _pSession->acquire()->writeIntParameter(ParameterID::LED_BRIGHTNESS_LEVEL, value);
 }
 
 int32_t DeviceParamConfigureImpl::getLedBrightnessLevel() {
-    return _pProtocol->readIntParameter(ParameterID::LED_BRIGHTNESS_LEVEL);
+    return _pSession->acquire()->readIntParameter(ParameterID::LED_BRIGHTNESS_LEVEL);
+}
+
+std::future<void> DeviceParamConfigureImpl::setAutoExposureAsync(bool enable) {
+    return _pSession->acquire()->writeBoolParameterAsync(ParameterID::AUTO_EXPOSURE, enable);
+}
+
+void DeviceParamConfigureImpl::setAutoExposureAsync(bool enable, ParameterWriteCallback callback) {
+    _pSession->acquire()->writeBoolParameterAsync(ParameterID::AUTO_EXPOSURE, enable, std::move(callback));
+}
+
+std::future<bool> DeviceParamConfigureImpl::getAutoExposureAsync() {
+    return _pSession->acquire()->readBoolParameterAsync(ParameterID::AUTO_EXPOSURE);
+}
+
+void DeviceParamConfigureImpl::getAutoExposureAsync(ParameterReadCallback<bool> callback) {
+    _pSession->acquire()->readBoolParameterAsync(ParameterID::AUTO_EXPOSURE, std::move(callback));
+}
+
+std::future<void> DeviceParamConfigureImpl::setAutoExposureModeAsync(int32_t mode) {
+    return _pSession->acquire()->writeIntParameterAsync(ParameterID::AUTO_EXPOSURE_MODE, mode);
+}
+
+void DeviceParamConfigureImpl::setAutoExposureModeAsync(int32_t mode, ParameterWriteCallback callback) {
+    _pSession->acquire()->writeIntParameterAsync(ParameterID::AUTO_EXPOSURE_MODE, mode, std::move(callback));
+}
+
+std::future<int32_t> DeviceParamConfigureImpl::getAutoExposureModeAsync() {
+    return _pSession->acquire()->readIntParameterAsync(ParameterID::AUTO_EXPOSURE_MODE);
+}
+
+void DeviceParamConfigureImpl::getAutoExposureModeAsync(ParameterReadCallback<int32_t> callback) {
+    _pSession->acquire()->readIntParameterAsync(ParameterID::AUTO_EXPOSURE_MODE, std::move(callback));
+}
+
+std::future<void> DeviceParamConfigureImpl::setExposureValueAsync(int32_t value) {
+    return _pSession->acquire()->writeIntParameterAsync(ParameterID::MANUAL_EXPOSURE, value);
+}
+
+void DeviceParamConfigureImpl::setExposureValueAsync(int32_t value, ParameterWriteCallback callback) {
+    _pSession->acquire()->writeIntParameterAsync(ParameterID::MANUAL_EXPOSURE, value, std::move(callback));
+}
+
+std::future<int32_t> DeviceParamConfigureImpl::getExposureValueAsync() {
+    return _pSession->acquire()->readIntParameterAsync(ParameterID::MANUAL_EXPOSURE);
+}
+
+void DeviceParamConfigureImpl::getExposureValueAsync(ParameterReadCallback<int32_t> callback) {
+    _pSession->acquire()->readIntParameterAsync(ParameterID::MANUAL_EXPOSURE, std::move(callback));
+}
+
+std::future<void> DeviceParamConfigureImpl::setResolutionAsync(int32_t index) {
+    return _pSession->acquire()->writeIntParameterAsync(ParameterID::RESOLUTION, index);
+}
+
+void DeviceParamConfigureImpl::setResolutionAsync(int32_t index, ParameterWriteCallback callback) {
+    _pSession->acquire()->writeIntParameterAsync(ParameterID::RESOLUTION, index, std::move(callback));
+}
+
+std::future<int32_t> DeviceParamConfigureImpl::getResolutionAsync() {
+    return _pSession->acquire()->readIntParameterAsync(ParameterID::RESOLUTION);
+}
+
+void DeviceParamConfigureImpl::getResolutionAsync(ParameterReadCallback<int32_t> callback) {
+    _pSession->acquire()->readIntParameterAsync(ParameterID::RESOLUTION, std::move(callback));
+}
+
+std::future<void> DeviceParamConfigureImpl::setGainValueAsync(int32_t value) {
+    return _pSession->acquire()->writeIntParameterAsync(ParameterID::MANUAL_GAIN, value);
+}
+
+void DeviceParamConfigureImpl::setGainValueAsync(int32_t value, ParameterWriteCallback callback) {
+    _pSession->acquire()->writeIntParameterAsync(ParameterID::MANUAL_GAIN, value, std::move(callback));
+}
+
+std::future<int32_t> DeviceParamConfigureImpl::getGainValueAsync() {
+    return _pSession->acquire()->readIntParameterAsync(ParameterID::MANUAL_GAIN);
+}
+
+void DeviceParamConfigureImpl::getGainValueAsync(ParameterReadCallback<int32_t> callback) {
+    _pSession->acquire()->readIntParameterAsync(ParameterID::MANUAL_GAIN, std::move(callback));
+}
+
+std::future<void> DeviceParamConfigureImpl::setAutoWhiteBalanceAsync(bool enable) {
+    return _pSession->acquire()->writeBoolParameterAsync(ParameterID::AUTO_WB, enable);
+}
+
+void DeviceParamConfigureImpl::setAutoWhiteBalanceAsync(bool enable, ParameterWriteCallback callback) {
+    _pSession->acquire()->writeBoolParameterAsync(ParameterID::AUTO_WB, enable, std::move(callback));
+}
+
+std::future<bool> DeviceParamConfigureImpl::getAutoWhiteBalanceAsync() {
+    return _pSession->acquire()->readBoolParameterAsync(ParameterID::AUTO_WB);
+}
+
+void DeviceParamConfigureImpl::getAutoWhiteBalanceAsync(ParameterReadCallback<bool> callback) {
+    _pSession->acquire()->readBoolParameterAsync(ParameterID::AUTO_WB, std::move(callback));
+}
+
+std::future<void> DeviceParamConfigureImpl::setAutoWhiteBalanceModeAsync(int32_t value) {
+    return _pSession->acquire()->writeIntParameterAsync(ParameterID::AUTO_WB_MODE, value);
+}
+
+void DeviceParamConfigureImpl::setAutoWhiteBalanceModeAsync(int32_t value, ParameterWriteCallback callback) {
+    _pSession->acquire()->writeIntParameterAsync(ParameterID::AUTO_WB_MODE, value, std::move(callback));
+}
+
+std::future<int32_t> DeviceParamConfigureImpl::getAutoWhiteBalanceModeAsync() {
+    return _pSession->acquire()->readIntParameterAsync(ParameterID::AUTO_WB_MODE);
+}
+
+void DeviceParamConfigureImpl::getAutoWhiteBalanceModeAsync(ParameterReadCallback<int32_t> callback) {
+    _pSession->acquire()->readIntParameterAsync(ParameterID::AUTO_WB_MODE, std::move(callback));
+}
+
+std::future<void> DeviceParamConfigureImpl::setWhiteBalanceValueAsync(int32_t value) {
+    return _pSession->acquire()->writeIntParameterAsync(ParameterID::MANUAL_WB, value);
+}
+
+void DeviceParamConfigureImpl::setWhiteBalanceValueAsync(int32_t value, ParameterWriteCallback callback) {
+    _pSession->acquire()->writeIntParameterAsync(ParameterID::MANUAL_WB, value, std::move(callback));
+}
+
+std::future<int32_t> DeviceParamConfigureImpl::getWhiteBalanceValueAsync() {
+    return _pSession->acquire()->readIntParameterAsync(ParameterID::MANUAL_WB);
+}
+
+void DeviceParamConfigureImpl::getWhiteBalanceValueAsync(ParameterReadCallback<int32_t> callback) {
+    _pSession->acquire()->readIntParameterAsync(ParameterID::MANUAL_WB, std::move(callback));
+}
+
+std::future<void> DeviceParamConfigureImpl::setLedModeAsync(bool enable) {
+    return _pSession->acquire()->writeBoolParameterAsync(ParameterID::LED_MODE, enable);
+}
+
+void DeviceParamConfigureImpl::setLedModeAsync(bool enable, ParameterWriteCallback callback) {
+    _pSession->acquire()->writeBoolParameterAsync(ParameterID::LED_MODE, enable, std::move(callback));
+}
+
+std::future<bool> DeviceParamConfigureImpl::getLedModeAsync() {
+    return _pSession->acquire()->readBoolParameterAsync(ParameterID::LED_MODE);
+}
+
+void DeviceParamConfigureImpl::getLedModeAsync(ParameterReadCallback<bool> callback) {
+    _pSession->acquire()->readBoolParameterAsync(ParameterID::LED_MODE, std::move(callback));
+}
+
+std::future<void> DeviceParamConfigureImpl::setLedBrightnessLevelAsync(int32_t value) {
+    return _pSession->acquire()->writeIntParameterAsync(ParameterID::LED_BRIGHTNESS_LEVEL, value);
+}
+
+void DeviceParamConfigureImpl::setLedBrightnessLevelAsync(int32_t value, ParameterWriteCallback callback) {
+    _pSession->acquire()->writeIntParameterAsync(ParameterID::LED_BRIGHTNESS_LEVEL, value, std::move(callback));
+}
+
+std::future<int32_t> DeviceParamConfigureImpl::getLedBrightnessLevelAsync() {
+    return _pSession->acquire()->readIntParameterAsync(ParameterID::LED_BRIGHTNESS_LEVEL);
+}
+
+void DeviceParamConfigureImpl::getLedBrightnessLevelAsync(ParameterReadCallback<int32_t> callback) {
+    _pSession->acquire()->readIntParameterAsync(ParameterID::LED_BRIGHTNESS_LEVEL, std::move(callback));
 }
 
 void DeviceParamConfigureImpl::exportCalibrationData(std::string filename) {
-    std::string buff = _pProtocol->readStringParameter(ParameterID::CALIBRATION_DATA);
+    std::string buff = _pSession->acquire()->readStringParameter(ParameterID::CALIBRATION_DATA);
 
     std::ofstream calFile(filename);
     if(calFile.is_open()) {
@@ -116,8 +288,287 @@ void DeviceParamConfigureImpl::exportCalibrationData(std::string filename) {
     }
 }
 
+StereoCalibration DeviceParamConfigureImpl::readCalibration() {
+    return parseCalibration(_pSession->acquire()->readStringParameter(ParameterID::CALIBRATION_DATA));
+}
+
 void DeviceParamConfigureImpl::readDeviceInfoMsg(DeviceInfoMessage &deviceInfoMsg) {
-    _pProtocol->readDeviceInfoMsg(deviceInfoMsg);
+    _pSession->acquire()->readDeviceInfoMsg(deviceInfoMsg);
+}
+
+// errors of the operations of batch which failed, empty if none did
+static std::string failures(const ParameterBatch &batch, const char *what) {
+    if(!batch.failedCount()) {
+        return std::string();
+    }
+
+    std::string message = std::string("failed to ") + what + " " + std::to_string(batch.failedCount()) + " settings:";
+    for(size_t i = 0; i < batch.size(); i++) {
+        if(!batch.succeeded(i)) {
+            const ParameterDescriptor *parameter = findParameter(batch.id(i));
+            std::string name = parameter ? parameter->name : std::to_string(batch.id(i));
+            message += " " + name + ": " + batch.error(i) + ";";
+        }
+    }
+    return message;
+}
+
+// throw a exception with the errors of the operations of batch which failed
+static void throwIfFailed(const ParameterBatch &batch, const char *what) {
+    std::string message = failures(batch, what);
+    if(!message.empty()) {
+        throw SparkError(message);
+    }
+}
+
+// throw the error of the connection if it broke during batch, its failed operations tell nothing about the device
+static void throwIfDisconnected(ParameterProtocol &protocol, const ParameterBatch &batch) {
+    if(protocol.isConnected()) {
+        return;
+    }
+    for(size_t i = 0; i < batch.size(); i++) {
+        if(!batch.succeeded(i)) {
+            throw SparkError(batch.error(i));
+        }
+    }
+}
+
+// add a read of a parameter as the type of its descriptor to batch
+static size_t addRead(ParameterBatch &batch, const ParameterDescriptor &parameter) {
+    switch(parameter.type) {
+    case VALUE_BOOL:
+        return batch.readBool(parameter.id);
+    case VALUE_INT:
+        return batch.readInt(parameter.id);
+    case VALUE_DOUBLE:
+        return batch.readDouble(parameter.id);
+    default:
+        return batch.readString(parameter.id);
+    }
+}
+
+// add a write of the value of a parameter in profile to batch
+static size_t addWrite(ParameterBatch &batch, const ParameterProfile &profile, const ParameterDescriptor &parameter) {
+    switch(parameter.type) {
+    case VALUE_BOOL:
+        return batch.writeBool(parameter.id, profile.boolValue(parameter.id));
+    case VALUE_INT:
+        return batch.writeInt(parameter.id, profile.intValue(parameter.id));
+    case VALUE_DOUBLE:
+        return batch.writeDouble(parameter.id, profile.doubleValue(parameter.id));
+    default:
+        return batch.writeString(parameter.id, profile.stringValue(parameter.id));
+    }
+}
+
+// whether the value read by the operation i of batch is the value of the parameter in profile
+static bool hasValue(const ParameterBatch &batch, size_t i, const ParameterProfile &profile, const ParameterDescriptor &parameter) {
+    if(!batch.succeeded(i)) {
+        return false;
+    }
+    switch(parameter.type) {
+    case VALUE_BOOL:
+        return batch.boolValue(i) == profile.boolValue(parameter.id);
+    case VALUE_INT:
+        return batch.intValue(i) == profile.intValue(parameter.id);
+    case VALUE_DOUBLE:
+        return batch.doubleValue(i) == profile.doubleValue(parameter.id);
+    default:
+        return batch.stringValue(i) == profile.stringValue(parameter.id);
+    }
+}
+
+// set the value read by the operation i of batch to profile
+static void setValue(ParameterProfile &profile, const ParameterBatch &batch, size_t i, const ParameterDescriptor &parameter) {
+    switch(parameter.type) {
+    case VALUE_BOOL:
+        profile.setBool(parameter.id, batch.boolValue(i));
+        break;
+    case VALUE_INT:
+        profile.setInt(parameter.id, batch.intValue(i));
+        break;
+    case VALUE_DOUBLE:
+        profile.setDouble(parameter.id, batch.doubleValue(i));
+        break;
+    default:
+        profile.setString(parameter.id, batch.stringValue(i));
+        break;
+    }
+}
+
+DeviceSettings DeviceParamConfigureImpl::readSettings() {
+    ParameterBatch batch;
+    size_t autoExposure = batch.readBool(ParameterID::AUTO_EXPOSURE);
+    size_t autoExposureMode = batch.readInt(ParameterID::AUTO_EXPOSURE_MODE);
+    size_t exposure = batch.readInt(ParameterID::MANUAL_EXPOSURE);
+    size_t gain = batch.readInt(ParameterID::MANUAL_GAIN);
+    size_t resolution = batch.readInt(ParameterID::RESOLUTION);
+    size_t autoWhiteBalance = batch.readBool(ParameterID::AUTO_WB);
+    size_t autoWhiteBalanceMode = batch.readInt(ParameterID::AUTO_WB_MODE);
+    size_t whiteBalance = batch.readInt(ParameterID::MANUAL_WB);
+    size_t ledMode = batch.readBool(ParameterID::LED_MODE);
+    size_t ledBrightnessLevel = batch.readInt(ParameterID::LED_BRIGHTNESS_LEVEL);
+
+    _pSession->acquire()->execute(batch);
+    throwIfFailed(batch, "read");
+
+    DeviceSettings settings;
+    settings.autoExposure = batch.boolValue(autoExposure);
+    settings.autoExposureMode = batch.intValue(autoExposureMode);
+    settings.exposure = batch.intValue(exposure);
+    settings.gain = batch.intValue(gain);
+    settings.resolution = batch.intValue(resolution);
+    settings.autoWhiteBalance = batch.boolValue(autoWhiteBalance);
+    settings.autoWhiteBalanceMode = batch.intValue(autoWhiteBalanceMode);
+    settings.whiteBalance = batch.intValue(whiteBalance);
+    settings.ledMode = batch.boolValue(ledMode);
+    settings.ledBrightnessLevel = batch.intValue(ledBrightnessLevel);
+    return settings;
+}
+
+void DeviceParamConfigureImpl::writeSettings(const DeviceSettings &settings) {
+    // manual values are written after the modes which decide whether they are used
+    ParameterBatch batch;
+    batch.writeInt(ParameterID::RESOLUTION, settings.resolution);
+    batch.writeBool(ParameterID::AUTO_EXPOSURE, settings.autoExposure);
+    batch.writeInt(ParameterID::AUTO_EXPOSURE_MODE, settings.autoExposureMode);
+    batch.writeInt(ParameterID::MANUAL_EXPOSURE, settings.exposure);
+    batch.writeInt(ParameterID::MANUAL_GAIN, settings.gain);
+    batch.writeBool(ParameterID::AUTO_WB, settings.autoWhiteBalance);
+    batch.writeInt(ParameterID::AUTO_WB_MODE, settings.autoWhiteBalanceMode);
+    batch.writeInt(ParameterID::MANUAL_WB, settings.whiteBalance);
+    batch.writeBool(ParameterID::LED_MODE, settings.ledMode);
+    batch.writeInt(ParameterID::LED_BRIGHTNESS_LEVEL, settings.ledBrightnessLevel);
+
+    _pSession->acquire()->execute(batch);
+    throwIfFailed(batch, "write");
+}
+
+void DeviceParamConfigureImpl::invalidateCache() {
+    _pSession->invalidateCache();
+}
+
+void DeviceParamConfigureImpl::refreshCache() {
+    _pSession->refreshCache();
+}
+
+void DeviceParamConfigureImpl::execute(ParameterBatch &batch) {
+    _pSession->acquire()->execute(batch);
+}
+
+ParameterProfile DeviceParamConfigureImpl::snapshotProfile() {
+    ParameterBatch batch;
+    std::vector<const ParameterDescriptor*> parameters;
+    for(const ParameterDescriptor &parameter : registeredParameters()) {
+        if(!parameter.readOnly && !parameter.command) {
+            addRead(batch, parameter);
+            parameters.push_back(&parameter);
+        }
+    }
+    std::shared_ptr<ParameterProtocol> protocol = _pSession->acquire();
+    protocol->execute(batch);
+    throwIfDisconnected(*protocol, batch);
+
+    ParameterProfile profile;
+    for(size_t i = 0; i < parameters.size(); i++) {
+        if(!batch.succeeded(i)) {
+            LOG_WARNING("parameter %s is left out of the profile: %s", parameters[i]->name, batch.error(i).c_str());
+            continue;
+        }
+        try {
+            setValue(profile, batch, i, *parameters[i]);
+        } catch(SparkException &e) {
+            LOG_WARNING("parameter %s is left out of the profile: %s", parameters[i]->name, e.what());
+        }
+    }
+    return profile;
+}
+
+ProfileResult DeviceParamConfigureImpl::applyProfile(const ParameterProfile &profile) {
+    ProfileResult result;
+    apply(profile, result);
+    if(!result.succeeded) {
+        throw SparkError(result.error);
+    }
+    return result;
+}
+
+std::vector<ProfileResult> DeviceParamConfigureImpl::applyProfile(const DeviceList &devices, const ParameterProfile &profile,
+    uint32_t parallelism, const ParameterProtocolOptions &options) {
+
+    if(parallelism == 0) {
+        throw SparkError("parallelism of devices must be at least 1");
+    }
+
+    // each worker takes the next device until all are done, so a slow device holds up one worker only
+    std::vector<ProfileResult> results(devices.size());
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        for(size_t i = next++; i < devices.size(); i = next++) {
+            try {
+                if(!devices[i]) {
+                    throw SparkError("passed a null device");
+                }
+                DeviceParamConfigureImpl configure(devices[i], options);
+                configure.apply(profile, results[i]);
+            } catch(std::exception &e) {
+                results[i].succeeded = false;
+                results[i].error = e.what();
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    size_t workerCount = std::min<size_t>(parallelism, devices.size());
+    for(size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back(work);
+    }
+    for(std::thread &worker : workers) {
+        worker.join();
+    }
+    return results;
+}
+
+void DeviceParamConfigureImpl::apply(const ParameterProfile &profile, ProfileResult &result) {
+    std::vector<int32_t> ids = profile.ids();
+    ParameterBatch reads;
+    for(int32_t id : ids) {
+        addRead(reads, *findParameter(id));
+    }
+    std::shared_ptr<ParameterProtocol> protocol = _pSession->acquire();
+    protocol->execute(reads);
+    throwIfDisconnected(*protocol, reads);
+
+    // the ids are in order, so modes are written before the values they drive
+    ParameterBatch writes;
+    std::set<int32_t> written;
+    result.unchangedCount = 0;
+    result.overriddenCount = 0;
+    for(size_t i = 0; i < ids.size(); i++) {
+        const ParameterDescriptor &parameter = *findParameter(ids[i]);
+        ParameterID mode = parameter.drivenBy;
+        bool overridden = mode != ParameterID::PARAMETER_UNKNOWN && profile.contains(mode) && profile.boolValue(mode);
+        // a value is written again when its mode changes, the device may not keep it
+        bool modeWritten = written.count(mode) != 0;
+        if(overridden) {
+            result.overriddenCount++;
+            continue;
+        }
+        if(hasValue(reads, i, profile, parameter) && !modeWritten) {
+            result.unchangedCount++;
+            continue;
+        }
+
+        addWrite(writes, profile, parameter);
+        written.insert(parameter.id);
+    }
+    if(writes.size()) {
+        protocol->execute(writes);
+    }
+
+    result.writtenCount = writes.size() - writes.failedCount();
+    result.error = failures(writes, "write");
+    result.succeeded = result.error.empty();
 }
 
 } // namespace protocol
@@ -0,0 +1,37 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <libsparkproto/disparityfilter.h>
+#include <libsparkproto/disparityfilterimpl.h>
+
+namespace libspark {
+
+namespace protocol {
+
+DisparityFilter::DisparityFilter(const DisparityFilterOptions &options)
+    : _pImpl(new DisparityFilterImpl(options)) {
+
+}
+
+DisparityFilter::~DisparityFilter() {
+
+}
+
+const DisparityFilterOptions& DisparityFilter::options() const {
+    return _pImpl->options();
+}
+
+void DisparityFilter::apply(uint16_t *disparity, uint32_t width, uint32_t height) {
+    _pImpl->apply(disparity, width, height);
+}
+
+void DisparityFilter::apply(ImageSet &imgSet) {
+    _pImpl->apply(imgSet);
+}
+
+void DisparityFilter::reset() {
+    _pImpl->reset();
+}
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,116 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <libsparkproto/common.h>
+#include <libsparkproto/imageset.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class DisparityFilterImpl;
+
+/**
+ * @brief Options of DisparityFilter, in units of the disparity values, e.g. 1/16 pixel for 16-bit disparity
+ *
+ */
+struct SPARK_API DisparityFilterOptions {
+    // connected regions of less pixels are invalidated, 0 to skip
+    uint32_t speckleSize = 100;
+    // largest difference of neighbouring disparities of a region
+    uint16_t speckleRange = 16;
+
+    // passes of the edge-preserving spatial filter, 0 to skip
+    uint32_t spatialIterations = 1;
+    // weight of a pixel against its smoothed neighbour, 0 < alpha <= 1
+    float spatialAlpha = 0.5f;
+    // neighbours of a larger difference are an edge and not smoothed
+    uint16_t spatialDelta = 64;
+
+    // temporal filter across consecutive images
+    bool temporal = true;
+    // weight of the current image against the previous images, 0 < alpha <= 1
+    float temporalAlpha = 0.4f;
+    // disparities of a larger difference to the previous images are a change and not smoothed
+    uint16_t temporalDelta = 64;
+    // an invalid pixel keeps its last disparity if it was valid in at least persistence of the last 8 images, 0 never
+    uint8_t temporalPersistence = 3;
+
+    // gaps of invalid pixels along a row up to this size are filled with the farther disparity of their ends, 0 to skip
+    uint32_t holeSize = 0;
+
+    // number of threads an image is split across in tiles, 0 for the number of CPU cores, 1 to run in the calling thread
+    uint32_t threads = 0;
+};
+
+/**
+ * @brief DisparityFilter cleans up disparity images in place, invalid pixels are 0. The stages are applied in order:
+ *
+ * - speckle removal, small connected regions of similar disparity are invalidated
+ * - edge-preserving spatial filter, recursive smoothing along rows and columns which stops at edges
+ * - temporal filter, exponential smoothing of each pixel across images while it is valid and changes little
+ * - hole filling, short gaps of a row are filled conservatively with the farther disparity
+ *
+ * Stages run in tiles of rows or columns across threads, the spatial and temporal filters with SSE4.1 or AVX2
+ * when the CPU supports them, see libspark::protocol::cpu::dispatchLevel(). The state of the temporal filter and
+ * scratch buffers are kept between images, so images of the same size are filtered without allocations. The temporal
+ * state is reset when the size of the images changes.
+ *
+ * A DisparityFilter filters a single stream of images and is not thread-safe, use one per stream.
+ *
+ */
+class SPARK_API DisparityFilter {
+
+public:
+    /**
+     * @brief Construct a new DisparityFilter object. If the options are invalid, a exception is thrown
+     *
+     * @param options
+     */
+    explicit DisparityFilter(const DisparityFilterOptions &options = DisparityFilterOptions());
+
+    /**
+     * @brief Destroy the DisparityFilter object
+     *
+     */
+    virtual ~DisparityFilter();
+
+    /**
+     * @brief Options of the filter
+     *
+     * @return const DisparityFilterOptions&
+     */
+    const DisparityFilterOptions& options() const;
+
+    /**
+     * @brief Filter a disparity image in place
+     *
+     * @param disparity width * height values
+     * @param width
+     * @param height
+     */
+    void apply(uint16_t *disparity, uint32_t width, uint32_t height);
+
+    /**
+     * @brief Filter the disparity image of imgSet in place, of 16 or 8 bits. If imgSet has no disparity,
+     * a exception is thrown
+     *
+     * @param imgSet
+     */
+    void apply(ImageSet &imgSet);
+
+    /**
+     * @brief Forget the previous images of the temporal filter, e.g. after the camera moved abruptly
+     *
+     */
+    void reset();
+
+private:
+    std::unique_ptr<DisparityFilterImpl> _pImpl;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,278 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <math.h>
+#include <algorithm>
+#include <thread>
+
+#include <libsparkproto/disparityfilterimpl.h>
+#include <libsparkproto/filterkernels.h>
+#include <libsparkproto/exception.h>
+
+namespace libspark {
+
+namespace protocol {
+
+// tiles of rows and of columns run by a thread
+static constexpr uint32_t MIN_BAND_ROWS = 16;
+static constexpr uint32_t MIN_TILE_COLUMNS = 64;
+
+static int16_t alphaOf(float alpha, const char *name) {
+    if(!(alpha > 0.0f && alpha <= 1.0f)) {
+        throw SparkError(std::string(name) + " must be 0 < alpha <= 1, got " + std::to_string(alpha));
+    }
+    return int16_t(std::max(1L, std::min(32767L, lroundf(alpha * 32768.0f))));
+}
+
+static void checkDelta(uint16_t delta, const char *name) {
+    if(!delta || delta > 32767) {
+        throw SparkError(std::string(name) + " must be 1 to 32767, got " + std::to_string(delta));
+    }
+}
+
+// root of a region, halving the path
+static inline uint32_t findRoot(uint32_t *parent, uint32_t p) {
+    while(parent[p] != p) {
+        parent[p] = parent[parent[p]];
+        p = parent[p];
+    }
+    return p;
+}
+
+// root of a region without writes, for threads sharing the parents
+static inline uint32_t peekRoot(const uint32_t *parent, uint32_t p) {
+    while(parent[p] != p) {
+        p = parent[p];
+    }
+    return p;
+}
+
+// the root of the smaller index is kept, so the roots of a band stay in the band
+static inline void unite(uint32_t *parent, uint32_t a, uint32_t b) {
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if(a < b) {
+        parent[b] = a;
+    } else if(b < a) {
+        parent[a] = b;
+    }
+}
+
+static inline bool connected(const uint16_t *disparity, uint32_t a, uint32_t b, uint16_t range) {
+    return disparity[a] && disparity[b] &&
+        std::max(disparity[a], disparity[b]) - std::min(disparity[a], disparity[b]) <= range;
+}
+
+DisparityFilterImpl::DisparityFilterImpl(const DisparityFilterOptions &options)
+    : _options(options), _level(cpu::dispatchLevel()), _stateWidth(0), _stateHeight(0) {
+
+    _spatialAlpha = alphaOf(_options.spatialAlpha, "spatialAlpha");
+    _temporalAlpha = alphaOf(_options.temporalAlpha, "temporalAlpha");
+    checkDelta(_options.spatialDelta, "spatialDelta");
+    checkDelta(_options.temporalDelta, "temporalDelta");
+    if(_options.temporalPersistence > 8) {
+        throw SparkError("temporalPersistence must be 0 to 8, got " + std::to_string(_options.temporalPersistence));
+    }
+
+    uint32_t threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+    if(threads > 1) {
+        _pool.reset(new ThreadPool(threads));
+    }
+}
+
+DisparityFilterImpl::~DisparityFilterImpl() {
+
+}
+
+const DisparityFilterOptions& DisparityFilterImpl::options() const {
+    return _options;
+}
+
+void DisparityFilterImpl::apply(uint16_t *disparity, uint32_t width, uint32_t height) {
+    if(!width || !height) {
+        throw SparkError("size of disparity " + std::to_string(width) + "x" + std::to_string(height) + " is invalid");
+    }
+
+    if(_options.speckleSize) {
+        removeSpeckles(disparity, width, height);
+    }
+    if(_options.spatialIterations) {
+        smoothSpatial(disparity, width, height);
+    }
+    if(_options.temporal) {
+        smoothTemporal(disparity, width, height);
+    }
+    if(_options.holeSize) {
+        fillHoles(disparity, width, height);
+    }
+}
+
+void DisparityFilterImpl::apply(ImageSet &imgSet) {
+    if(!imgSet.hasDisparity()) {
+        throw SparkError("the ImageSet has no disparity image");
+    }
+
+    const ImageMeta &meta = imgSet.meta().disparity();
+    uint32_t width = meta.width();
+    uint32_t height = meta.height();
+    ImageSet::Buffer &buff = imgSet.getMutableBuffer(ImageSet::BUFFER_DISPARITY);
+    size_t pixels = size_t(width) * height;
+
+    if(buff.size() == pixels * 2) {
+        apply((uint16_t *) buff.data(), width, height);
+    } else if(buff.size() == pixels) {
+        // filtered disparities stay between the disparities of the image, they fit 8 bits again
+        _widened.resize(pixels);
+        std::copy(buff.begin(), buff.begin() + pixels, _widened.begin());
+        apply(_widened.data(), width, height);
+        std::copy(_widened.begin(), _widened.end(), buff.begin());
+    } else {
+        throw SparkError("size of disparity buffer " + std::to_string(buff.size()) + " does not match image " +
+            std::to_string(width) + "x" + std::to_string(height));
+    }
+}
+
+void DisparityFilterImpl::reset() {
+    _stateWidth = 0;
+    _stateHeight = 0;
+}
+
+void DisparityFilterImpl::removeSpeckles(uint16_t *disparity, uint32_t width, uint32_t height) {
+    size_t pixels = size_t(width) * height;
+    if(pixels > UINT32_MAX) {
+        throw SparkError("disparity image is too large for speckle removal");
+    }
+    _parent.resize(pixels);
+    _roots.resize(pixels);
+    _bandStarts.assign(height, 0);
+    uint32_t *parent = _parent.data();
+    uint16_t range = _options.speckleRange;
+
+    // regions of each band of rows, with the neighbours left and above in the band
+    runRanges(height, MIN_BAND_ROWS, [&](uint32_t y0, uint32_t y1) {
+        _bandStarts[y0] = 1;
+        for(uint32_t y = y0; y < y1; y++) {
+            uint32_t row = y * width;
+            for(uint32_t x = 0; x < width; x++) {
+                uint32_t p = row + x;
+                parent[p] = p;
+                if(x > 0 && connected(disparity, p, p - 1, range)) {
+                    unite(parent, p, p - 1);
+                }
+                if(y > y0 && connected(disparity, p, p - width, range)) {
+                    unite(parent, p, p - width);
+                }
+            }
+        }
+    });
+
+    // regions across the bands
+    for(uint32_t y = 1; y < height; y++) {
+        if(!_bandStarts[y]) {
+            continue;
+        }
+        for(uint32_t p = y * width; p < (y + 1) * width; p++) {
+            if(connected(disparity, p, p - width, range)) {
+                unite(parent, p, p - width);
+            }
+        }
+    }
+
+    runRanges(height, MIN_BAND_ROWS, [&](uint32_t y0, uint32_t y1) {
+        for(uint32_t p = y0 * width; p < y1 * width; p++) {
+            _roots[p] = peekRoot(parent, p);
+        }
+    });
+
+    // parents are replaced by the size of each region
+    std::fill(_parent.begin(), _parent.end(), 0);
+    for(uint32_t p = 0; p < pixels; p++) {
+        if(disparity[p]) {
+            parent[_roots[p]]++;
+        }
+    }
+
+    uint32_t minSize = _options.speckleSize;
+    runRanges(height, MIN_BAND_ROWS, [&](uint32_t y0, uint32_t y1) {
+        for(uint32_t p = y0 * width; p < y1 * width; p++) {
+            if(parent[_roots[p]] < minSize) {
+                disparity[p] = 0;
+            }
+        }
+    });
+}
+
+void DisparityFilterImpl::smoothSpatial(uint16_t *disparity, uint32_t width, uint32_t height) {
+    uint16_t delta = _options.spatialDelta;
+    for(uint32_t i = 0; i < _options.spatialIterations; i++) {
+        runRanges(height, MIN_BAND_ROWS, [&](uint32_t y0, uint32_t y1) {
+            for(uint32_t y = y0; y < y1; y++) {
+                filter::smoothRow(disparity + size_t(y) * width, width, _spatialAlpha, delta);
+            }
+        });
+
+        // columns down and up, a row of a tile at a time
+        runRanges(width, MIN_TILE_COLUMNS, [&](uint32_t x0, uint32_t x1) {
+            uint16_t *tile = disparity + x0;
+            for(uint32_t y = 1; y < height; y++) {
+                filter::smoothColumns(tile + size_t(y - 1) * width, tile + size_t(y) * width, x1 - x0,
+                    _spatialAlpha, delta, _level);
+            }
+            for(uint32_t y = height - 1; y-- > 0;) {
+                filter::smoothColumns(tile + size_t(y + 1) * width, tile + size_t(y) * width, x1 - x0,
+                    _spatialAlpha, delta, _level);
+            }
+        });
+    }
+}
+
+void DisparityFilterImpl::smoothTemporal(uint16_t *disparity, uint32_t width, uint32_t height) {
+    size_t pixels = size_t(width) * height;
+    if(width != _stateWidth || height != _stateHeight) {
+        _state.assign(pixels, 0);
+        _history.assign(pixels, 0);
+        _stateWidth = width;
+        _stateHeight = height;
+    }
+
+    runRanges(height, MIN_BAND_ROWS, [&](uint32_t y0, uint32_t y1) {
+        size_t begin = size_t(y0) * width;
+        filter::temporalFilter(disparity + begin, _state.data() + begin, _history.data() + begin,
+            size_t(y1 - y0) * width, _temporalAlpha, _options.temporalDelta, _options.temporalPersistence, _level);
+    });
+}
+
+void DisparityFilterImpl::fillHoles(uint16_t *disparity, uint32_t width, uint32_t height) {
+    uint32_t holeSize = _options.holeSize;
+    runRanges(height, MIN_BAND_ROWS, [&](uint32_t y0, uint32_t y1) {
+        for(uint32_t y = y0; y < y1; y++) {
+            uint16_t *row = disparity + size_t(y) * width;
+            uint32_t x = 0;
+            while(x < width) {
+                if(row[x]) {
+                    x++;
+                    continue;
+                }
+                uint32_t start = x;
+                while(x < width && !row[x]) {
+                    x++;
+                }
+                // gaps at the borders have a single end and are left
+                if(start > 0 && x < width && x - start <= holeSize) {
+                    std::fill(row + start, row + x, std::min(row[start - 1], row[x]));
+                }
+            }
+        }
+    });
+}
+
+void DisparityFilterImpl::runRanges(uint32_t count, uint32_t minRange, const RangeFunc &func) {
+    if(_pool) {
+        _pool->parallelFor(count, minRange, func);
+    } else {
+        func(0, count);
+    }
+}
+
+} // namespace protocol
+} // namespace libspark
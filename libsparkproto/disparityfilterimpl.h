@@ -0,0 +1,69 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <libsparkproto/disparityfilter.h>
+#include <libsparkproto/cpufeatures.h>
+#include <libsparkproto/threadpool.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class DisparityFilterImpl {
+
+public:
+    DisparityFilterImpl(const DisparityFilterOptions &options);
+
+    virtual ~DisparityFilterImpl();
+
+    const DisparityFilterOptions& options() const;
+
+    void apply(uint16_t *disparity, uint32_t width, uint32_t height);
+
+    void apply(ImageSet &imgSet);
+
+    void reset();
+
+private:
+    using RangeFunc = std::function<void(uint32_t begin, uint32_t end)>;
+
+    void removeSpeckles(uint16_t *disparity, uint32_t width, uint32_t height);
+
+    void smoothSpatial(uint16_t *disparity, uint32_t width, uint32_t height);
+
+    void smoothTemporal(uint16_t *disparity, uint32_t width, uint32_t height);
+
+    void fillHoles(uint16_t *disparity, uint32_t width, uint32_t height);
+
+    // run func over [0, count) in ranges of at least minRange, on the pool when there is one
+    void runRanges(uint32_t count, uint32_t minRange, const RangeFunc &func);
+
+    DisparityFilterOptions _options;
+    cpu::Level _level;
+    std::unique_ptr<ThreadPool> _pool;
+    // alphas in 1/32768
+    int16_t _spatialAlpha;
+    int16_t _temporalAlpha;
+
+    // union-find of speckle removal, parent and then size of each region, and root of each pixel
+    std::vector<uint32_t> _parent;
+    std::vector<uint32_t> _roots;
+    std::vector<uint8_t> _bandStarts;
+
+    // temporal filter
+    uint32_t _stateWidth;
+    uint32_t _stateHeight;
+    std::vector<uint16_t> _state;
+    std::vector<uint8_t> _history;
+
+    // 8-bit disparity widened
+    std::vector<uint16_t> _widened;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,56 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <libsparkproto/exposurecontrol.h>
+#include <libsparkproto/exposurecontrolimpl.h>
+#include <libsparkproto/constants.h>
+#include <libsparkproto/exception.h>
+
+namespace libspark {
+
+namespace protocol {
+
+ExposureController::ExposureController(std::shared_ptr<DeviceInfo> pDevice, const ExposureControlOptions &options) {
+    if(!pDevice->isCompatible())
+        throw SparkError("The library is not compatible with Spark firmware, please upgrade new version of libsparkpro");
+
+    std::shared_ptr<ParameterProtocol> protocol =
+        std::make_shared<ParameterProtocol>(pDevice->getIpAdress(), std::to_string(PARAMETERS_PORT));
+    _pImpl.reset(new ExposureControllerImpl(protocol, options));
+}
+
+ExposureController::ExposureController(std::shared_ptr<ParameterProtocol> protocol, const ExposureControlOptions &options)
+    : _pImpl(new ExposureControllerImpl(protocol, options)) {
+
+}
+
+ExposureController::~ExposureController() {
+
+}
+
+void ExposureController::onImageEvent(ImageSet &imgSet) {
+    _pImpl->onImageEvent(imgSet);
+}
+
+void ExposureController::update(const ImageStats &stats) {
+    _pImpl->update(stats, nullptr);
+}
+
+void ExposureController::update(const ImageStats &stats, const ImageStats &roiStats) {
+    _pImpl->update(stats, &roiStats);
+}
+
+void ExposureController::setTarget(float target) {
+    _pImpl->setTarget(target);
+}
+
+ExposureControlOptions ExposureController::options() const {
+    return _pImpl->options();
+}
+
+ExposureControlStats ExposureController::stats() const {
+    return _pImpl->stats();
+}
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,196 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <libsparkproto/common.h>
+#include <libsparkproto/deviceinfo.h>
+#include <libsparkproto/iimageevent.h>
+#include <libsparkproto/imagestats.h>
+#include <libsparkproto/parameterprotocol.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class ExposureControllerImpl;
+
+/**
+ * @brief Brightness of an image which ExposureController drives to its target
+ *
+ */
+enum ExposureMetric {
+    // mean of the samples
+    METRIC_MEAN = 0,
+    // value below which ExposureControlOptions::percentile of the samples are, e.g. to keep highlights at the target
+    METRIC_PERCENTILE = 1
+};
+
+/**
+ * @brief Which of exposure and gain ExposureController changes first
+ *
+ */
+enum ExposurePriority {
+    // brighten by exposure until maxExposure, then by gain. Darken by gain first. Least noise
+    PRIORITY_EXPOSURE = 0,
+    // brighten by gain until maxGain, then by exposure. Darken by exposure first. Least motion blur
+    PRIORITY_GAIN = 1
+};
+
+/**
+ * @brief Options of ExposureController
+ *
+ */
+struct SPARK_API ExposureControlOptions {
+    ExposureMetric metric = METRIC_MEAN;
+    // brightness the image is driven to, 0 - 255
+    float target = 110.0f;
+    // fraction of samples below the brightness of METRIC_PERCENTILE
+    float percentile = 0.5f;
+    // brightness within deadband of the target is not corrected
+    float deadband = 6.0f;
+    // fraction of the error corrected per step, in log of exposure times gain. 1 corrects it at once
+    float damping = 0.5f;
+    // largest change of exposure times gain per step
+    float maxStepRatio = 4.0f;
+
+    ExposurePriority priority = PRIORITY_EXPOSURE;
+    // range of the control, within the range of the device, exposure 6 - 36200 and gain 0 - 480
+    int32_t minExposure = 6;
+    int32_t maxExposure = 36200;
+    int32_t minGain = 0;
+    int32_t maxGain = 480;
+
+    // samples are taken every step-th pixel of every step-th row of the image
+    uint32_t step = 4;
+    // region of interest, width or height 0 for none. Its brightness is weighted by roiWeight
+    // against the brightness of the whole image, 1 for the region only
+    uint32_t roiX = 0;
+    uint32_t roiY = 0;
+    uint32_t roiWidth = 0;
+    uint32_t roiHeight = 0;
+    float roiWeight = 0.5f;
+
+    // minimum time between writes to the device in milliseconds
+    uint32_t minWriteInterval = 100;
+    // images skipped after a write has finished, until the new exposure takes effect
+    uint32_t settleFrames = 2;
+
+    // turn off the auto exposure of the device when the controller is created
+    bool disableDeviceAutoExposure = true;
+};
+
+/**
+ * @brief Counters and current state of ExposureController
+ *
+ */
+struct SPARK_API ExposureControlStats {
+    // exposure and gain on the device, updated when the asynchronous write of a command has finished
+    int32_t exposure = 0;
+    int32_t gain = 0;
+    // brightness of the last image
+    float brightness = 0.0f;
+    // images the control ran on
+    uint64_t updateCount = 0;
+    // commands of new exposure and gain
+    uint64_t commandCount = 0;
+    // commands written to the device and failed
+    uint64_t writeCount = 0;
+    uint64_t failedWriteCount = 0;
+};
+
+/**
+ * @brief ExposureController is a closed-loop auto exposure and gain control on the client. It measures the brightness
+ * of each image, the mean or a percentile of the left image optionally weighted to a region of interest,
+ * and steps exposure and gain towards the target within the configured range.
+ *
+ * Statistics attached to the ImageSet are used when the stream computes them, see ImageStreamProtocol::enableStatistics(),
+ * otherwise the image is sampled by the controller. New exposure and gain are written to the device by a thread of
+ * the controller, so the stream thread never waits for the device. Writes are rate limited, and the control holds
+ * until a write is finished and the images taken with it have arrived.
+ *
+ * ExposureController can be registered to AsyncImageStream directly. All functions are thread-safe.
+ *
+ */
+class SPARK_API ExposureController : public IImageEvent {
+
+public:
+
+    using Ptr = std::shared_ptr<ExposureController>;
+
+    /**
+     * @brief Construct a new ExposureController object controlling the device. The current exposure and gain are read,
+     * and the auto exposure of the device is turned off by default. If options are invalid or the device can not be
+     * accessed, a exception is thrown
+     *
+     * @param pDevice
+     * @param options
+     */
+    ExposureController(std::shared_ptr<DeviceInfo> pDevice, const ExposureControlOptions &options = ExposureControlOptions());
+
+    /**
+     * @brief Construct a new ExposureController object writing to a device through protocol, which may be shared
+     * with other users
+     *
+     * @param protocol
+     * @param options
+     */
+    ExposureController(std::shared_ptr<ParameterProtocol> protocol, const ExposureControlOptions &options = ExposureControlOptions());
+
+    /**
+     * @brief Destroy the ExposureController object, a pending write is finished
+     *
+     */
+    virtual ~ExposureController();
+
+    /**
+     * @brief Run a step of the control on the left image of imgSet. Images without a left image of 8-bit pixels are skipped
+     *
+     * @param imgSet
+     */
+    void onImageEvent(ImageSet &imgSet) override;
+
+    /**
+     * @brief Run a step of the control on statistics of an image
+     *
+     * @param stats
+     */
+    void update(const ImageStats &stats);
+
+    /**
+     * @brief Run a step of the control on statistics of an image and of its region of interest,
+     * weighted by ExposureControlOptions::roiWeight
+     *
+     * @param stats
+     * @param roiStats
+     */
+    void update(const ImageStats &stats, const ImageStats &roiStats);
+
+    /**
+     * @brief Set the brightness the image is driven to
+     *
+     * @param target
+     */
+    void setTarget(float target);
+
+    /**
+     * @brief Options of the controller
+     *
+     * @return ExposureControlOptions
+     */
+    ExposureControlOptions options() const;
+
+    /**
+     * @brief Get counters and the current state of the controller
+     *
+     * @return ExposureControlStats
+     */
+    ExposureControlStats stats() const;
+
+private:
+    std::unique_ptr<ExposureControllerImpl> _pImpl;
+};
+
+} // namespace protocol
+} // namespace libspark
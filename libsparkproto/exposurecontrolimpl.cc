@@ -0,0 +1,280 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <math.h>
+#include <algorithm>
+
+#include <libsparkproto/exposurecontrolimpl.h>
+#include <libsparkproto/parameterids.pb.h>
+#include <libsparkproto/parameterregistry.h>
+#include <libsparkproto/pixelconvert.h>
+#include <libsparkproto/exception.h>
+#include <libsparkproto/log.h>
+
+namespace libspark {
+
+namespace protocol {
+
+// range of the device
+static constexpr int32_t DEVICE_MIN_EXPOSURE = ParameterTraits<MANUAL_EXPOSURE>::descriptor().min;
+static constexpr int32_t DEVICE_MAX_EXPOSURE = ParameterTraits<MANUAL_EXPOSURE>::descriptor().max;
+static constexpr int32_t DEVICE_MIN_GAIN = ParameterTraits<MANUAL_GAIN>::descriptor().min;
+static constexpr int32_t DEVICE_MAX_GAIN = ParameterTraits<MANUAL_GAIN>::descriptor().max;
+
+// gain is in steps of 0.1 dB of amplitude
+static double gainFactor(double gain) {
+    return pow(10.0, gain / 200.0);
+}
+
+static double gainOf(double factor) {
+    return 200.0 * log10(factor);
+}
+
+static int32_t clampRound(double value, int32_t low, int32_t high) {
+    return int32_t(lround(std::min(std::max(value, double(low)), double(high))));
+}
+
+static void checkOptions(const ExposureControlOptions &options) {
+    if(options.minExposure < DEVICE_MIN_EXPOSURE || options.maxExposure > DEVICE_MAX_EXPOSURE ||
+        options.minExposure > options.maxExposure) {
+        throw SparkError("exposure range must be within 6 - 36200");
+    }
+    if(options.minGain < DEVICE_MIN_GAIN || options.maxGain > DEVICE_MAX_GAIN || options.minGain > options.maxGain) {
+        throw SparkError("gain range must be within 0 - 480");
+    }
+    if(!(options.target > 0.0f && options.target < 255.0f) || !(options.percentile >= 0.0f && options.percentile <= 1.0f) ||
+        !(options.deadband >= 0.0f)) {
+        throw SparkError("target and percentile of brightness are out of range");
+    }
+    if(!(options.damping > 0.0f && options.damping <= 1.0f) || !(options.maxStepRatio > 1.0f)) {
+        throw SparkError("damping must be in (0, 1] and maxStepRatio above 1");
+    }
+    if(!options.step || !(options.roiWeight >= 0.0f && options.roiWeight <= 1.0f)) {
+        throw SparkError("step of sampling must be at least 1 and roiWeight in [0, 1]");
+    }
+}
+
+ExposureControllerImpl::ExposureControllerImpl(std::shared_ptr<ParameterProtocol> protocol, const ExposureControlOptions &options)
+    : _protocol(protocol), _options(options), _settle(0), _pending(false), _stopWrite(false), _pendingExposure(0), _pendingGain(0),
+    _writtenExposure(0), _writtenGain(0) {
+
+    if(!protocol) {
+        throw SparkError("passed a null parameter protocol");
+    }
+    checkOptions(options);
+
+    if(options.disableDeviceAutoExposure) {
+        _protocol->writeBoolParameter(ParameterID::AUTO_EXPOSURE, false);
+    }
+    _stats.exposure = _protocol->readIntParameter(ParameterID::MANUAL_EXPOSURE);
+    _stats.gain = _protocol->readIntParameter(ParameterID::MANUAL_GAIN);
+    _writtenExposure = _stats.exposure;
+    _writtenGain = _stats.gain;
+
+    StatsOptions statsOptions;
+    statsOptions.step = options.step;
+    statsOptions.threads = 1;
+    _statistics.reset(new ImageStatistics(statsOptions));
+    if(options.roiWidth && options.roiHeight && options.roiWeight > 0.0f) {
+        statsOptions.roiX = options.roiX;
+        statsOptions.roiY = options.roiY;
+        statsOptions.roiWidth = options.roiWidth;
+        statsOptions.roiHeight = options.roiHeight;
+        _roiStatistics.reset(new ImageStatistics(statsOptions));
+    }
+
+    _lastCommand = std::chrono::steady_clock::now() - std::chrono::milliseconds(options.minWriteInterval);
+    _writeThread = std::thread(&ExposureControllerImpl::writeLoop, this);
+}
+
+ExposureControllerImpl::~ExposureControllerImpl() {
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _stopWrite = true;
+    }
+    _writeCond.notify_all();
+
+    if(_writeThread.joinable()) {
+        _writeThread.join();
+    }
+}
+
+void ExposureControllerImpl::onImageEvent(ImageSet &imgSet) {
+    if(!imgSet.hasLeft()) {
+        return;
+    }
+    const ImageMeta &meta = imgSet.meta().left();
+    PixelFormat format = pixelFormatOf(meta.format());
+    const ImageSet::Buffer &buff = imgSet.getBuffer(ImageSet::BUFFER_LEFT);
+    std::shared_ptr<const ImageStats> stats = imgSet.stats(ImageSet::BUFFER_LEFT);
+
+    bool sampled = format != PIXEL_UNKNOWN && buff.size() >= imageSize(format, meta.width(), meta.height());
+    if(!stats && !sampled) {
+        return;
+    }
+
+    // the ImageStatistics are used in the stream thread only, unless events come from several streams
+    std::lock_guard<std::mutex> lock(_sampleLock);
+    if(!stats) {
+        stats = _statistics->compute(imgSet, ImageSet::BUFFER_LEFT);
+    }
+    if(_roiStatistics && sampled) {
+        _roiStatistics->compute(buff.data(), 0, format, meta.width(), meta.height(), _roi);
+        update(*stats, &_roi);
+    } else {
+        update(*stats, nullptr);
+    }
+}
+
+void ExposureControllerImpl::update(const ImageStats &stats, const ImageStats *roiStats) {
+    if(!stats.samples) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_lock);
+    float brightness = brightnessOf(stats);
+    if(roiStats && roiStats->samples) {
+        brightness += _options.roiWeight * (brightnessOf(*roiStats) - brightness);
+    }
+    _stats.brightness = brightness;
+    _stats.updateCount++;
+
+    // images taken before the last command took effect don't tell about it
+    if(_pending) {
+        return;
+    }
+    if(_settle) {
+        _settle--;
+        return;
+    }
+    if(fabsf(_options.target - brightness) <= _options.deadband) {
+        return;
+    }
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if(now - _lastCommand < std::chrono::milliseconds(_options.minWriteInterval)) {
+        return;
+    }
+
+    // brightness is about proportional to exposure times gain, the error is corrected in steps of their log
+    double ratio = pow(_options.target / std::max(brightness, 1.0f), _options.damping);
+    ratio = std::min(std::max(ratio, 1.0 / _options.maxStepRatio), double(_options.maxStepRatio));
+    int32_t exposure;
+    int32_t gain;
+    split(ratio, exposure, gain);
+    if(exposure == _stats.exposure && gain == _stats.gain) {
+        // at the end of the range
+        return;
+    }
+
+    _stats.commandCount++;
+    _pending = true;
+    _pendingExposure = exposure;
+    _pendingGain = gain;
+    _lastCommand = now;
+    _writeCond.notify_all();
+}
+
+void ExposureControllerImpl::setTarget(float target) {
+    if(!(target > 0.0f && target < 255.0f)) {
+        throw SparkError("target of brightness is out of range");
+    }
+    std::lock_guard<std::mutex> lock(_lock);
+    _options.target = target;
+}
+
+ExposureControlOptions ExposureControllerImpl::options() const {
+    std::lock_guard<std::mutex> lock(_lock);
+    return _options;
+}
+
+ExposureControlStats ExposureControllerImpl::stats() const {
+    std::lock_guard<std::mutex> lock(_lock);
+    return _stats;
+}
+
+float ExposureControllerImpl::brightnessOf(const ImageStats &stats) const {
+    // luma weights of red, green and blue
+    static const float weights[3] = {0.299f, 0.587f, 0.114f};
+
+    float brightness = 0.0f;
+    for(uint32_t c = 0; c < stats.channels; c++) {
+        const ChannelStats &channel = stats.channel[c];
+        float value = float(channel.mean);
+        if(_options.metric == METRIC_PERCENTILE) {
+            uint64_t rank = uint64_t(ceil(double(_options.percentile) * stats.samples));
+            uint64_t count = 0;
+            uint32_t v = 0;
+            for(; v < 255; v++) {
+                count += channel.histogram[v];
+                if(count >= rank) {
+                    break;
+                }
+            }
+            value = float(v);
+        }
+
+        if(stats.channels == 1) {
+            return value;
+        }
+        brightness += value * weights[stats.format == PIXEL_BGR8 ? 2 - c : c];
+    }
+    return brightness;
+}
+
+void ExposureControllerImpl::split(double ratio, int32_t &exposure, int32_t &gain) const {
+    double total = _stats.exposure * gainFactor(_stats.gain) * ratio;
+
+    if(_options.priority == PRIORITY_EXPOSURE) {
+        exposure = clampRound(total / gainFactor(_options.minGain), _options.minExposure, _options.maxExposure);
+        gain = clampRound(gainOf(total / exposure), _options.minGain, _options.maxGain);
+    } else {
+        gain = clampRound(gainOf(total / _options.minExposure), _options.minGain, _options.maxGain);
+        exposure = clampRound(total / gainFactor(gain), _options.minExposure, _options.maxExposure);
+    }
+}
+
+void ExposureControllerImpl::writeLoop() {
+    std::unique_lock<std::mutex> lock(_lock);
+
+    while(true) {
+        _writeCond.wait(lock, [&]() { return _pending || _stopWrite; });
+        // a pending write is finished before stopping
+        if(!_pending) {
+            break;
+        }
+        int32_t exposure = _pendingExposure;
+        int32_t gain = _pendingGain;
+        lock.unlock();
+
+        bool written = true;
+        try {
+            if(exposure != _writtenExposure) {
+                _protocol->writeIntParameter(ParameterID::MANUAL_EXPOSURE, exposure);
+                _writtenExposure = exposure;
+            }
+            if(gain != _writtenGain) {
+                _protocol->writeIntParameter(ParameterID::MANUAL_GAIN, gain);
+                _writtenGain = gain;
+            }
+        } catch (std::exception &e) {
+            LOG_ERROR("failed to write exposure %d and gain %d: %s", exposure, gain, e.what());
+            written = false;
+        }
+
+        // the next step starts from the values on the device, also if a write failed
+        lock.lock();
+        _stats.exposure = _writtenExposure;
+        _stats.gain = _writtenGain;
+        if(written) {
+            _stats.writeCount++;
+        } else {
+            _stats.failedWriteCount++;
+        }
+        // the control waits until the images are taken with the new values
+        _pending = false;
+        _settle = _options.settleFrames;
+    }
+}
+
+} // namespace protocol
+} // namespace libspark
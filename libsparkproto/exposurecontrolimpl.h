@@ -0,0 +1,71 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <libsparkproto/exposurecontrol.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class ExposureControllerImpl {
+
+public:
+    ExposureControllerImpl(std::shared_ptr<ParameterProtocol> protocol, const ExposureControlOptions &options);
+
+    virtual ~ExposureControllerImpl();
+
+    void onImageEvent(ImageSet &imgSet);
+
+    void update(const ImageStats &stats, const ImageStats *roiStats);
+
+    void setTarget(float target);
+
+    ExposureControlOptions options() const;
+
+    ExposureControlStats stats() const;
+
+private:
+    // brightness of an image by the metric of the options
+    float brightnessOf(const ImageStats &stats) const;
+
+    // exposure and gain which give the image a brightness of ratio times the current one
+    void split(double ratio, int32_t &exposure, int32_t &gain) const;
+
+    void writeLoop();
+
+    std::shared_ptr<ParameterProtocol> _protocol;
+    ExposureControlOptions _options;
+
+    // sampling of images which have no statistics attached and of the region of interest
+    std::mutex _sampleLock;
+    std::unique_ptr<ImageStatistics> _statistics;
+    std::unique_ptr<ImageStatistics> _roiStatistics;
+    ImageStats _roi;
+
+    // lock of the options, the state and the pending write
+    mutable std::mutex _lock;
+    ExposureControlStats _stats;
+    uint32_t _settle;
+    std::chrono::steady_clock::time_point _lastCommand;
+
+    // exposure and gain to be written, there is no new command until they are written
+    std::condition_variable _writeCond;
+    bool _pending;
+    bool _stopWrite;
+    int32_t _pendingExposure;
+    int32_t _pendingGain;
+    // values on the device, used by the write thread only
+    int32_t _writtenExposure;
+    int32_t _writtenGain;
+    std::thread _writeThread;
+};
+
+} // namespace protocol
+} // namespace libspark
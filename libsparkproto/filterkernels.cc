@@ -0,0 +1,250 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <libsparkproto/filterkernels.h>
+
+#if defined(SPARK_CPU_X86)
+    #include <immintrin.h>
+#endif
+
+namespace libspark {
+
+namespace protocol {
+
+namespace filter {
+
+void smoothRow(uint16_t *row, uint32_t width, int16_t alpha, uint16_t delta) {
+    if(width < 2) {
+        return;
+    }
+    for(uint32_t x = 1; x < width; x++) {
+        row[x] = smooth(row[x], row[x - 1], alpha, delta);
+    }
+    for(uint32_t x = width - 1; x-- > 0;) {
+        row[x] = smooth(row[x], row[x + 1], alpha, delta);
+    }
+}
+
+static void smoothColumnsGeneric(const uint16_t *prev, uint16_t *row, uint32_t x, uint32_t count,
+    int16_t alpha, uint16_t delta) {
+
+    for(; x < count; x++) {
+        row[x] = smooth(row[x], prev[x], alpha, delta);
+    }
+}
+
+static uint8_t popcount8(uint8_t bits) {
+    return uint8_t(__builtin_popcount(bits));
+}
+
+static void temporalGeneric(uint16_t *disparity, uint16_t *state, uint8_t *history, size_t i, size_t count,
+    int16_t alpha, uint16_t delta, uint8_t persistence) {
+
+    for(; i < count; i++) {
+        uint16_t value = disparity[i];
+        uint8_t bits = history[i];
+        if(value) {
+            if(bits & 1) {
+                value = smooth(value, state[i], alpha, delta);
+            }
+            state[i] = value;
+        } else if(persistence && popcount8(bits) >= persistence) {
+            value = state[i];
+        }
+        history[i] = uint8_t((bits << 1) | (disparity[i] != 0));
+        disparity[i] = value;
+    }
+}
+
+// SIMD kernels process the head of the values and return the index reached, the generic kernel finishes them
+struct Kernels {
+    uint32_t (*smoothColumns)(const uint16_t *prev, uint16_t *row, uint32_t count, int16_t alpha, uint16_t delta);
+    size_t (*temporal)(uint16_t *disparity, uint16_t *state, uint8_t *history, size_t count,
+        int16_t alpha, uint16_t delta, uint8_t persistence);
+};
+
+static uint32_t smoothColumnsNone(const uint16_t *, uint16_t *, uint32_t, int16_t, uint16_t) { return 0; }
+
+static size_t temporalNone(uint16_t *, uint16_t *, uint8_t *, size_t, int16_t, uint16_t, uint8_t) { return 0; }
+
+static const Kernels GENERIC_KERNELS = {
+    smoothColumnsNone, temporalNone
+};
+
+#if defined(SPARK_CPU_X86)
+
+//
+// SSE4.1 and AVX2: smooth() of 8 or 16 values, mulhrs rounds (diff * alpha) >> 15 like the generic kernel.
+// Differences are only used below delta, where they fit 16 bits
+//
+
+__attribute__((target("sse4.1")))
+static inline __m128i smoothSse41(__m128i value, __m128i prev, __m128i alpha, __m128i deltaMax) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i diff = _mm_sub_epi16(_mm_max_epu16(value, prev), _mm_min_epu16(value, prev));
+    __m128i close = _mm_cmpeq_epi16(_mm_min_epu16(diff, deltaMax), diff);
+    __m128i invalid = _mm_or_si128(_mm_cmpeq_epi16(value, zero), _mm_cmpeq_epi16(prev, zero));
+    __m128i smoothed = _mm_add_epi16(prev, _mm_mulhrs_epi16(_mm_sub_epi16(value, prev), alpha));
+    return _mm_blendv_epi8(value, smoothed, _mm_andnot_si128(invalid, close));
+}
+
+__attribute__((target("sse4.1")))
+static uint32_t smoothColumnsSse41(const uint16_t *prev, uint16_t *row, uint32_t count, int16_t alpha, uint16_t delta) {
+    __m128i alphaVec = _mm_set1_epi16(alpha);
+    __m128i deltaMax = _mm_set1_epi16(short(delta - 1));
+    uint32_t x = 0;
+    for(; x + 8 <= count; x += 8) {
+        __m128i value = _mm_loadu_si128((const __m128i *)(row + x));
+        __m128i above = _mm_loadu_si128((const __m128i *)(prev + x));
+        _mm_storeu_si128((__m128i *)(row + x), smoothSse41(value, above, alphaVec, deltaMax));
+    }
+    return x;
+}
+
+// bits set in each byte
+__attribute__((target("sse4.1")))
+static inline __m128i popcountBytesSse41(__m128i v) {
+    __m128i nibbles = _mm_set1_epi8(0x0f);
+    __m128i table = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    __m128i low = _mm_shuffle_epi8(table, _mm_and_si128(v, nibbles));
+    __m128i high = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(v, 4), nibbles));
+    return _mm_add_epi8(low, high);
+}
+
+// the temporal filter of 8 values, history widened to 16 bits
+__attribute__((target("sse4.1")))
+static inline __m128i temporalSse41(__m128i value, __m128i &state, __m128i &bits, __m128i alpha, __m128i deltaMax,
+    __m128i persistence) {
+
+    __m128i zero = _mm_setzero_si128();
+    __m128i one = _mm_set1_epi16(1);
+    __m128i valid = _mm_xor_si128(_mm_cmpeq_epi16(value, zero), _mm_set1_epi16(-1));
+    __m128i lastValid = _mm_cmpeq_epi16(_mm_and_si128(bits, one), one);
+    __m128i counts = _mm_cvtepu8_epi16(popcountBytesSse41(_mm_packus_epi16(bits, bits)));
+    __m128i keep = _mm_cmpgt_epi16(counts, persistence);
+
+    __m128i smoothed = _mm_blendv_epi8(value, smoothSse41(value, state, alpha, deltaMax), lastValid);
+    __m128i out = _mm_blendv_epi8(_mm_and_si128(state, keep), smoothed, valid);
+    state = _mm_blendv_epi8(state, out, valid);
+    bits = _mm_and_si128(_mm_or_si128(_mm_add_epi16(bits, bits), _mm_and_si128(valid, one)), _mm_set1_epi16(0xff));
+    return out;
+}
+
+__attribute__((target("sse4.1")))
+static size_t temporalSse41(uint16_t *disparity, uint16_t *state, uint8_t *history, size_t count,
+    int16_t alpha, uint16_t delta, uint8_t persistence) {
+
+    __m128i alphaVec = _mm_set1_epi16(alpha);
+    __m128i deltaMax = _mm_set1_epi16(short(delta - 1));
+    // counts above persistence - 1 keep the last disparity, never for 0
+    __m128i persistenceVec = _mm_set1_epi16(persistence ? short(persistence - 1) : short(8));
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m128i stateVec = _mm_loadu_si128((const __m128i *)(state + i));
+        __m128i bits = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(history + i)));
+        __m128i out = temporalSse41(_mm_loadu_si128((const __m128i *)(disparity + i)), stateVec, bits,
+            alphaVec, deltaMax, persistenceVec);
+        _mm_storeu_si128((__m128i *)(disparity + i), out);
+        _mm_storeu_si128((__m128i *)(state + i), stateVec);
+        _mm_storel_epi64((__m128i *)(history + i), _mm_packus_epi16(bits, bits));
+    }
+    return i;
+}
+
+static const Kernels SSE41_KERNELS = {
+    smoothColumnsSse41, temporalSse41
+};
+
+__attribute__((target("avx2")))
+static inline __m256i smoothAvx2(__m256i value, __m256i prev, __m256i alpha, __m256i deltaMax) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i diff = _mm256_sub_epi16(_mm256_max_epu16(value, prev), _mm256_min_epu16(value, prev));
+    __m256i close = _mm256_cmpeq_epi16(_mm256_min_epu16(diff, deltaMax), diff);
+    __m256i invalid = _mm256_or_si256(_mm256_cmpeq_epi16(value, zero), _mm256_cmpeq_epi16(prev, zero));
+    __m256i smoothed = _mm256_add_epi16(prev, _mm256_mulhrs_epi16(_mm256_sub_epi16(value, prev), alpha));
+    return _mm256_blendv_epi8(value, smoothed, _mm256_andnot_si256(invalid, close));
+}
+
+__attribute__((target("avx2")))
+static uint32_t smoothColumnsAvx2(const uint16_t *prev, uint16_t *row, uint32_t count, int16_t alpha, uint16_t delta) {
+    __m256i alphaVec = _mm256_set1_epi16(alpha);
+    __m256i deltaMax = _mm256_set1_epi16(short(delta - 1));
+    uint32_t x = 0;
+    for(; x + 16 <= count; x += 16) {
+        __m256i value = _mm256_loadu_si256((const __m256i *)(row + x));
+        __m256i above = _mm256_loadu_si256((const __m256i *)(prev + x));
+        _mm256_storeu_si256((__m256i *)(row + x), smoothAvx2(value, above, alphaVec, deltaMax));
+    }
+    return x;
+}
+
+__attribute__((target("avx2")))
+static size_t temporalAvx2(uint16_t *disparity, uint16_t *state, uint8_t *history, size_t count,
+    int16_t alpha, uint16_t delta, uint8_t persistence) {
+
+    __m256i alphaVec = _mm256_set1_epi16(alpha);
+    __m256i deltaMax = _mm256_set1_epi16(short(delta - 1));
+    __m256i persistenceVec = _mm256_set1_epi16(persistence ? short(persistence - 1) : short(8));
+    __m256i zero = _mm256_setzero_si256();
+    __m256i one = _mm256_set1_epi16(1);
+    size_t i = 0;
+
+    for(; i + 16 <= count; i += 16) {
+        __m256i value = _mm256_loadu_si256((const __m256i *)(disparity + i));
+        __m256i stateVec = _mm256_loadu_si256((const __m256i *)(state + i));
+        __m128i packedBits = _mm_loadu_si128((const __m128i *)(history + i));
+        __m256i bits = _mm256_cvtepu8_epi16(packedBits);
+
+        __m256i valid = _mm256_xor_si256(_mm256_cmpeq_epi16(value, zero), _mm256_set1_epi16(-1));
+        __m256i lastValid = _mm256_cmpeq_epi16(_mm256_and_si256(bits, one), one);
+        __m256i counts = _mm256_cvtepu8_epi16(popcountBytesSse41(packedBits));
+        __m256i keep = _mm256_cmpgt_epi16(counts, persistenceVec);
+
+        __m256i smoothed = _mm256_blendv_epi8(value, smoothAvx2(value, stateVec, alphaVec, deltaMax), lastValid);
+        __m256i out = _mm256_blendv_epi8(_mm256_and_si256(stateVec, keep), smoothed, valid);
+        stateVec = _mm256_blendv_epi8(stateVec, out, valid);
+        bits = _mm256_and_si256(_mm256_or_si256(_mm256_add_epi16(bits, bits), _mm256_and_si256(valid, one)),
+            _mm256_set1_epi16(0xff));
+
+        _mm256_storeu_si256((__m256i *)(disparity + i), out);
+        _mm256_storeu_si256((__m256i *)(state + i), stateVec);
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(bits, bits), 0xd8);
+        _mm_storeu_si128((__m128i *)(history + i), _mm256_castsi256_si128(packed));
+    }
+    return i;
+}
+
+static const Kernels AVX2_KERNELS = {
+    smoothColumnsAvx2, temporalAvx2
+};
+
+#endif // SPARK_CPU_X86
+
+static const Kernels& kernelsOf(cpu::Level level) {
+#if defined(SPARK_CPU_X86)
+    if(level == cpu::LEVEL_AVX2) {
+        return AVX2_KERNELS;
+    }
+    if(level == cpu::LEVEL_SSE41) {
+        return SSE41_KERNELS;
+    }
+#endif
+    (void) level;
+    return GENERIC_KERNELS;
+}
+
+void smoothColumns(const uint16_t *prev, uint16_t *row, uint32_t count, int16_t alpha, uint16_t delta, cpu::Level level) {
+    uint32_t x = kernelsOf(level).smoothColumns(prev, row, count, alpha, delta);
+    smoothColumnsGeneric(prev, row, x, count, alpha, delta);
+}
+
+void temporalFilter(uint16_t *disparity, uint16_t *state, uint8_t *history, size_t count,
+    int16_t alpha, uint16_t delta, uint8_t persistence, cpu::Level level) {
+
+    size_t i = kernelsOf(level).temporal(disparity, state, history, count, alpha, delta, persistence);
+    temporalGeneric(disparity, state, history, i, count, alpha, delta, persistence);
+}
+
+} // namespace filter
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,76 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <libsparkproto/cpufeatures.h>
+
+namespace libspark {
+
+namespace protocol {
+
+namespace filter {
+
+/**
+ * @brief Smoothing of a disparity value towards a neighbour: prev + (value - prev) * alpha / 32768, rounded,
+ * if both are valid and differ by less than delta, otherwise value
+ *
+ * @param value
+ * @param prev
+ * @param alpha weight of value, 1 to 32767
+ * @param delta 1 to 32767
+ * @return uint16_t
+ */
+inline uint16_t smooth(uint16_t value, uint16_t prev, int16_t alpha, uint16_t delta) {
+    int32_t diff = int32_t(value) - prev;
+    if(!value || !prev || diff >= delta || -diff >= delta) {
+        return value;
+    }
+    return uint16_t(prev + ((diff * alpha + 0x4000) >> 15));
+}
+
+/**
+ * @brief Smooth a row left to right and right to left
+ *
+ * @param row
+ * @param width
+ * @param alpha
+ * @param delta
+ */
+void smoothRow(uint16_t *row, uint32_t width, int16_t alpha, uint16_t delta);
+
+/**
+ * @brief Smooth each value of a row towards the value of the previous row, see smooth()
+ *
+ * @param prev
+ * @param row
+ * @param count
+ * @param alpha
+ * @param delta
+ * @param level
+ */
+void smoothColumns(const uint16_t *prev, uint16_t *row, uint32_t count, int16_t alpha, uint16_t delta, cpu::Level level);
+
+/**
+ * @brief Temporal filter of disparity against the filtered disparity of the previous frames.
+ * A valid pixel which was valid in the previous frame is smoothed towards it, see smooth(). An invalid pixel
+ * keeps the last valid disparity if it was valid in at least persistence of the last 8 frames, else stays 0
+ *
+ * @param disparity filtered in place
+ * @param state last valid filtered disparity, updated
+ * @param history validity of the last 8 frames, the previous frame in bit 0, updated
+ * @param count
+ * @param alpha weight of the current frame, 1 to 32767
+ * @param delta 1 to 32767
+ * @param persistence 0 to 8, 0 to never keep disparity of previous frames
+ * @param level
+ */
+void temporalFilter(uint16_t *disparity, uint16_t *state, uint8_t *history, size_t count,
+    int16_t alpha, uint16_t delta, uint8_t persistence, cpu::Level level);
+
+} // namespace filter
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,61 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <stdint.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class ImageSet;
+
+/**
+ * @brief Interface of a source of ImageSet used by ImageStreamProtocol and AsyncImageStream.
+ * The network stream of a Spark camera and ImagePlayback are implementations of this interface.
+ *
+ */
+class IImageSource {
+
+public:
+    virtual ~IImageSource() {}
+
+    /**
+     * @brief Start delivering ImageSet
+     *
+     */
+    virtual void start() = 0;
+
+    /**
+     * @brief Stop delivering ImageSet
+     *
+     */
+    virtual void stop() = 0;
+
+    /**
+     * @brief Receive next ImageSet with timeout
+     * when timeout is not set or -1, function will block until ImageSet received
+     *
+     * @param imgSet
+     * @param timeout
+     */
+    virtual void recvImageSet(ImageSet &imgSet, int timeout=-1) = 0;
+
+    /**
+     * @brief Set the StreamType, see libspark::protocol::StreamType
+     *
+     * @param streamType
+     */
+    virtual void setStreamType(int32_t streamType) = 0;
+
+    /**
+     * @brief Set the ImageFormat, see libspark::protocol::ImageFormat
+     *
+     * @param imgFormat
+     */
+    virtual void setImageFormat(int32_t imgFormat) = 0;
+};
+
+} // namespace protocol
+} // namespace libspark
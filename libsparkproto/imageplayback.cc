@@ -0,0 +1,73 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <libsparkproto/imageplayback.h>
+#include <libsparkproto/imageplaybackimpl.h>
+
+namespace libspark {
+
+namespace protocol {
+
+ImagePlayback::ImagePlayback(const std::string &filename)
+    : _pImpl(new ImagePlaybackImpl(filename)) {
+
+}
+
+ImagePlayback::~ImagePlayback() {
+
+}
+
+void ImagePlayback::start() {
+    _pImpl->start();
+}
+
+void ImagePlayback::stop() {
+    _pImpl->stop();
+}
+
+void ImagePlayback::recvImageSet(ImageSet &imgSet, int timeout) {
+    _pImpl->recvImageSet(imgSet, timeout);
+}
+
+void ImagePlayback::setStreamType(int32_t streamType) {
+    _pImpl->setStreamType(streamType);
+}
+
+void ImagePlayback::setImageFormat(int32_t imgFormat) {
+    _pImpl->setImageFormat(imgFormat);
+}
+
+void ImagePlayback::setPlaybackRate(double rate) {
+    _pImpl->setPlaybackRate(rate);
+}
+
+void ImagePlayback::setLoop(bool enable) {
+    _pImpl->setLoop(enable);
+}
+
+bool ImagePlayback::seek(uint64_t timestamp) {
+    return _pImpl->seek(timestamp);
+}
+
+void ImagePlayback::seekToIndex(uint64_t position) {
+    _pImpl->seekToIndex(position);
+}
+
+uint64_t ImagePlayback::position() const {
+    return _pImpl->position();
+}
+
+uint64_t ImagePlayback::recordCount() const {
+    return _pImpl->recordCount();
+}
+
+uint64_t ImagePlayback::beginTimestamp() const {
+    return _pImpl->beginTimestamp();
+}
+
+uint64_t ImagePlayback::endTimestamp() const {
+    return _pImpl->endTimestamp();
+}
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,153 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <libsparkproto/common.h>
+#include <libsparkproto/iimagesource.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class ImagePlaybackImpl;
+
+/**
+ * @brief ImagePlayback is a virtual device which serves ImageSet from a file written by ImageRecorder.
+ * It's passed to ImageStreamProtocol or AsyncImageStream in place of a DeviceInfo, for example:
+ *
+ *     auto playback = std::make_shared<ImagePlayback>("capture.sparkrec");
+ *     ImageStream::Ptr imgStream = std::make_unique<ImageStream>(playback);
+ *
+ * By default ImageSet are served as fast as possible, setPlaybackRate paces them by the
+ * receive time of the recording. The functions of ImagePlayback are thread-safe.
+ *
+ */
+class SPARK_API ImagePlayback : public IImageSource {
+
+public:
+
+    using Ptr = std::shared_ptr<ImagePlayback>;
+
+    /**
+     * @brief Construct a new ImagePlayback object.
+     * If the file is not a recording, a exception is thrown, see more exception libspark::protocol::SparkException
+     *
+     * @param filename
+     */
+    ImagePlayback(const std::string &filename);
+
+    /**
+     * @brief Destroy the ImagePlayback object
+     *
+     */
+    virtual ~ImagePlayback();
+
+    /**
+     * @brief Start playback from the current position
+     *
+     */
+    void start() override;
+
+    /**
+     * @brief Stop playback, the current position is kept
+     *
+     */
+    void stop() override;
+
+    /**
+     * @brief Read next ImageSet of the recording.
+     * At the end of the recording, playback restarts from the beginning when looping is enabled,
+     * otherwise a exception is thrown.
+     * When playback is paced and the next ImageSet is not due within timeout milliseconds, a exception is thrown
+     * after timeout and the ImageSet is returned by a later call.
+     *
+     * @param imgSet
+     * @param timeout is -1 to wait until the next ImageSet is due
+     */
+    void recvImageSet(ImageSet &imgSet, int timeout=-1) override;
+
+    /**
+     * @brief Select planes which are served, planes are skipped when they are not in streamType.
+     * See list of stream type at libspark::protocol::StreamType.
+     *
+     * @param streamType
+     */
+    void setStreamType(int32_t streamType) override;
+
+    /**
+     * @brief ImageFormat is fixed at recording time, the value is just validated
+     *
+     * @param imgFormat
+     */
+    void setImageFormat(int32_t imgFormat) override;
+
+    /**
+     * @brief Set playback rate relative to recording speed, 1.0 is real time, 2.0 is twice as fast.
+     * Rate 0 serves ImageSet as fast as possible, it's the default.
+     *
+     * @param rate
+     */
+    void setPlaybackRate(double rate);
+
+    /**
+     * @brief Restart from the beginning when the end of the recording is reached
+     *
+     * @param enable
+     */
+    void setLoop(bool enable);
+
+    /**
+     * @brief Move to the first ImageSet which has timestamp equal or greater than timestamp,
+     * see ImageSet::imageTimestamp(). Return false if there is no such ImageSet,
+     * the position is moved to the end of recording in that case.
+     *
+     * @param timestamp
+     * @return true
+     * @return false
+     */
+    bool seek(uint64_t timestamp);
+
+    /**
+     * @brief Move to an ImageSet by its index in the recording
+     *
+     * @param position
+     */
+    void seekToIndex(uint64_t position);
+
+    /**
+     * @brief Index of the next ImageSet to be served
+     *
+     * @return uint64_t
+     */
+    uint64_t position() const;
+
+    /**
+     * @brief Number of ImageSet in the recording
+     *
+     * @return uint64_t
+     */
+    uint64_t recordCount() const;
+
+    /**
+     * @brief Timestamp of the first ImageSet in the recording
+     *
+     * @return uint64_t
+     */
+    uint64_t beginTimestamp() const;
+
+    /**
+     * @brief Timestamp of the last ImageSet in the recording
+     *
+     * @return uint64_t
+     */
+    uint64_t endTimestamp() const;
+
+private:
+    std::unique_ptr<ImagePlaybackImpl> _pImpl;
+};
+
+} // namespace protocol
+} // namespace libspark
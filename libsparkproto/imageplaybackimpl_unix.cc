@@ -0,0 +1,341 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
+
+#include <libsparkproto/imageplaybackimpl.h>
+#include <libsparkproto/imageset.h>
+#include <libsparkproto/recordingcodec.h>
+#include <libsparkproto/exception.h>
+#include <libsparkproto/log.h>
+
+namespace libspark {
+
+namespace protocol {
+
+ImagePlaybackImpl::ImagePlaybackImpl(const std::string &filename)
+    : _fd(-1), _filename(filename), _position(0),
+      _streamType(STREAM_LEFT | STREAM_RIGHT | STREAM_DEPTH | STREAM_DISPARITY),
+      _rate(0.0), _loop(false), _started(false), _paceValid(false), _paceRecordTime(0) {
+
+    _fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if(_fd < 0) {
+        throw SparkError("can not open recording file " + filename + ": " + std::string(strerror(errno)));
+    }
+
+    try {
+        struct stat st;
+        if(fstat(_fd, &st) < 0) {
+            throw SparkError("can not stat recording file: " + std::string(strerror(errno)));
+        }
+        uint64_t fileSize = st.st_size;
+
+        recording::FileHeader header;
+        if(fileSize < sizeof(header)) {
+            throw SparkError(filename + " is not a recording");
+        }
+        recording::preadFixed(_fd, &header, sizeof(header), 0);
+        if(!recording::isValidFileHeader(header)) {
+            throw SparkError(filename + " is not a recording or its version is not supported");
+        }
+
+        if(!recording::readIndex(_fd, fileSize, _index)) {
+            LOG_WARNING("recording %s has no index, rebuilding it", filename.c_str());
+            recording::scanIndex(_fd, fileSize, _index);
+        }
+    } catch (SparkException &e) {
+        ::close(_fd);
+        throw;
+    }
+}
+
+ImagePlaybackImpl::~ImagePlaybackImpl() {
+    ::close(_fd);
+}
+
+void ImagePlaybackImpl::start() {
+    std::lock_guard<std::mutex> lock(_playbackLock);
+
+    if(_started) {
+        throw SparkError("playback is started, it need to stop before restarting again");
+    }
+    _started = true;
+    _paceValid = false;
+}
+
+void ImagePlaybackImpl::stop() {
+    std::lock_guard<std::mutex> lock(_playbackLock);
+    _started = false;
+}
+
+void ImagePlaybackImpl::recvImageSet(ImageSet &imgSet, int timeout) {
+
+    Clock::time_point serveTime;
+    {
+        std::unique_lock<std::mutex> lock(_playbackLock);
+
+        if(!_started) {
+            throw SparkError("playback is not started");
+        }
+
+        if(_position >= _index.size()) {
+            if(!_loop || _index.empty()) {
+                throw SparkError("end of recording " + _filename);
+            }
+            _position = 0;
+            _paceValid = false;
+        }
+
+        const recording::IndexEntry &entry = _index[_position];
+        serveTime = paceRecord(entry);
+
+        // the record is kept for the next call if it is not due before the timeout
+        if(timeout >= 0) {
+            Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeout);
+            if(serveTime > deadline) {
+                lock.unlock();
+                std::this_thread::sleep_until(deadline);
+                throw SparkError("no ImageSet is due within " + std::to_string(timeout) + " ms");
+            }
+        }
+
+        readRecord(_position, imgSet);
+        _position++;
+    }
+
+    // wait outside of the lock, so seek is not blocked by pacing
+    std::this_thread::sleep_until(serveTime);
+
+    imgSet.setReceiveTimestamp(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now().time_since_epoch()).count());
+}
+
+void ImagePlaybackImpl::setStreamType(int32_t streamType) {
+    if(streamType < 1)
+        throw SparkError("passed a invalid StreamType, see more libspark::protocol::StreamType");
+
+    std::lock_guard<std::mutex> lock(_playbackLock);
+    _streamType = streamType;
+}
+
+void ImagePlaybackImpl::setImageFormat(int32_t imgFormat) {
+    if(!ImageFormat_IsValid(imgFormat))
+        throw SparkError("passed a invalid ImageFormat, see more libspark::protocol::ImageFormat");
+}
+
+void ImagePlaybackImpl::setPlaybackRate(double rate) {
+    if(rate < 0.0)
+        throw SparkError("playback rate can not be negative");
+
+    std::lock_guard<std::mutex> lock(_playbackLock);
+    _rate = rate;
+    _paceValid = false;
+}
+
+void ImagePlaybackImpl::setLoop(bool enable) {
+    std::lock_guard<std::mutex> lock(_playbackLock);
+    _loop = enable;
+}
+
+bool ImagePlaybackImpl::seek(uint64_t timestamp) {
+    std::lock_guard<std::mutex> lock(_playbackLock);
+
+    // records are ordered by receive time, device timestamps are expected to increase with them
+    auto it = std::lower_bound(_index.begin(), _index.end(), (int64_t)timestamp,
+        [](const recording::IndexEntry &entry, int64_t value) {
+            return entry.timestamp < value;
+        });
+
+    _position = it - _index.begin();
+    _paceValid = false;
+
+    return it != _index.end();
+}
+
+void ImagePlaybackImpl::seekToIndex(uint64_t position) {
+    std::lock_guard<std::mutex> lock(_playbackLock);
+
+    if(position > _index.size())
+        throw SparkError("position is out of recording");
+
+    _position = position;
+    _paceValid = false;
+}
+
+uint64_t ImagePlaybackImpl::position() const {
+    std::lock_guard<std::mutex> lock(_playbackLock);
+    return _position;
+}
+
+uint64_t ImagePlaybackImpl::recordCount() const {
+    return _index.size();
+}
+
+uint64_t ImagePlaybackImpl::beginTimestamp() const {
+    return _index.empty() ? 0 : _index.front().timestamp;
+}
+
+uint64_t ImagePlaybackImpl::endTimestamp() const {
+    return _index.empty() ? 0 : _index.back().timestamp;
+}
+
+void ImagePlaybackImpl::readRecord(uint64_t position, ImageSet &imgSet) {
+
+    recording::RecordHeader header;
+    std::unique_ptr<ImageSetMeta> meta = std::make_unique<ImageSetMeta>();
+    uint64_t offset = readRecordHeader(position, header, *meta);
+
+    for(uint32_t i = 0; i < recording::PLANE_COUNT; i++) {
+        ImageSet::BufferID id = ImageSet::BufferID(i);
+        ImageSet::Buffer &buff = imgSet.getMutableBuffer(id);
+        uint32_t planeSize = header.planeSize[i];
+
+        // plane bits of StreamType are in the order of BufferID
+        if(planeSize == 0 || !(_streamType & (1 << i))) {
+            buff.clear();
+            switch (id)
+            {
+            case ImageSet::BUFFER_LEFT: meta->clear_left(); break;
+            case ImageSet::BUFFER_RIGHT: meta->clear_right(); break;
+            case ImageSet::BUFFER_DEPTH: meta->clear_depth(); break;
+            case ImageSet::BUFFER_DISPARITY: meta->clear_disparity(); break;
+            }
+            offset += planeSize;
+            continue;
+        }
+
+        if(header.codec[i] == recording::CODEC_NONE) {
+            buff.resize(planeSize);
+            recording::preadFixed(_fd, buff.data(), planeSize, offset);
+        }
+        else {
+            const ImageMeta *plane = recording::planeMeta(*meta, id);
+            decodePlane(position, header, offset, i, plane ? plane->buffsize() : 0, buff);
+        }
+        offset += planeSize;
+    }
+
+    imgSet.setAllocatedMeta(std::move(meta));
+}
+
+uint64_t ImagePlaybackImpl::readRecordHeader(uint64_t position, recording::RecordHeader &header, ImageSetMeta &meta) {
+
+    uint64_t offset = _index[position].offset;
+    recording::preadFixed(_fd, &header, sizeof(header), offset);
+    if(header.sync != recording::RECORD_SYNC) {
+        throw SparkError("recording " + _filename + " is corrupted");
+    }
+    offset += sizeof(header);
+
+    _metaBuff.resize(header.metaSize);
+    recording::preadFixed(_fd, &_metaBuff[0], header.metaSize, offset);
+    offset += header.metaSize;
+
+    if(!meta.ParseFromString(_metaBuff)) {
+        throw SparkError("failed parse ImageSetMeta from recording");
+    }
+
+    return offset;
+}
+
+void ImagePlaybackImpl::decodePlane(uint64_t position, const recording::RecordHeader &header, uint64_t offset,
+    uint32_t plane, uint32_t rawSize, ImageSet::Buffer &buff) {
+
+    uint8_t codec = header.codec[plane];
+    recording::PlaneCodec planeCodec = recording::PlaneCodec(codec & recording::CODEC_MASK);
+    uint32_t planeSize = header.planeSize[plane];
+
+    if(!recording::isCodecSupported(planeCodec)) {
+        throw SparkError("recording uses a codec which is not supported by this build");
+    }
+
+    buff.resize(rawSize);
+    if(planeCodec == recording::CODEC_NONE) {
+        if(planeSize != rawSize) {
+            throw SparkError("recording " + _filename + " is corrupted");
+        }
+        recording::preadFixed(_fd, buff.data(), planeSize, offset);
+    }
+    else {
+        _compressedBuff.resize(planeSize);
+        recording::preadFixed(_fd, _compressedBuff.data(), planeSize, offset);
+        recording::decompressPlane(planeCodec, _compressedBuff.data(), planeSize, buff.data(), rawSize);
+    }
+
+    if(codec & recording::CODEC_FLAG_DELTA) {
+        if(position == 0) {
+            throw SparkError("recording " + _filename + " is corrupted");
+        }
+        const ImageSet::Buffer &reference = referencePlane(position - 1, plane);
+        if(reference.size() != rawSize) {
+            throw SparkError("recording " + _filename + " is corrupted");
+        }
+        recording::deltaDecode(buff.data(), reference.data(), rawSize);
+    }
+
+    // the next record may store its difference to this plane
+    _decoded[plane].position = position;
+    _decoded[plane].data.assign(buff.begin(), buff.end());
+}
+
+const ImageSet::Buffer& ImagePlaybackImpl::referencePlane(uint64_t position, uint32_t plane) {
+
+    recording::RecordHeader header;
+    ImageSetMeta meta;
+
+    // walk back to a record which does not depend on the previous one or which is decoded already,
+    // e.g. after a seek or when the plane was not selected
+    uint64_t first = position;
+    while(_decoded[plane].position != first) {
+        readRecordHeader(first, header, meta);
+        if(!(header.codec[plane] & recording::CODEC_FLAG_DELTA)) {
+            break;
+        }
+        if(first == 0) {
+            throw SparkError("recording " + _filename + " is corrupted");
+        }
+        first--;
+    }
+
+    for(uint64_t p = first; p <= position; p++) {
+        if(_decoded[plane].position == p) {
+            continue;
+        }
+
+        uint64_t offset = readRecordHeader(p, header, meta);
+        for(uint32_t i = 0; i < plane; i++) {
+            offset += header.planeSize[i];
+        }
+        const ImageMeta *planeMeta = recording::planeMeta(meta, ImageSet::BufferID(plane));
+        decodePlane(p, header, offset, plane, planeMeta ? planeMeta->buffsize() : 0, _referenceBuff);
+    }
+
+    return _decoded[plane].data;
+}
+
+ImagePlaybackImpl::Clock::time_point ImagePlaybackImpl::paceRecord(const recording::IndexEntry &entry) {
+
+    Clock::time_point now = Clock::now();
+    if(_rate <= 0.0) {
+        return now;
+    }
+
+    if(!_paceValid || entry.receiveTimestamp < _paceRecordTime) {
+        _paceValid = true;
+        _paceRecordTime = entry.receiveTimestamp;
+        _paceStartTime = now;
+        return now;
+    }
+
+    double elapsed = (entry.receiveTimestamp - _paceRecordTime) / _rate;
+    return _paceStartTime + std::chrono::nanoseconds((int64_t)elapsed);
+}
+
+} // namespace protocol
+} // namespace libspark
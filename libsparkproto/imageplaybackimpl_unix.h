@@ -0,0 +1,140 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <libsparkproto/recordingformat.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class ImageSet;
+class ImagePlaybackImpl {
+
+public:
+    /**
+     * @brief Construct a new ImagePlaybackImpl object
+     *
+     * @param filename
+     */
+    ImagePlaybackImpl(const std::string &filename);
+
+    /**
+     * @brief Destroy the ImagePlaybackImpl object
+     *
+     */
+    virtual ~ImagePlaybackImpl();
+
+    void start();
+
+    void stop();
+
+    void recvImageSet(ImageSet &imgSet, int timeout=-1);
+
+    void setStreamType(int32_t streamType);
+
+    void setImageFormat(int32_t imgFormat);
+
+    void setPlaybackRate(double rate);
+
+    void setLoop(bool enable);
+
+    bool seek(uint64_t timestamp);
+
+    void seekToIndex(uint64_t position);
+
+    uint64_t position() const;
+
+    uint64_t recordCount() const;
+
+    uint64_t beginTimestamp() const;
+
+    uint64_t endTimestamp() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Read record at position to imgSet, planes not selected by _streamType are skipped
+     * and compressed planes are decoded only when they are selected
+     *
+     * @param position
+     * @param imgSet
+     */
+    void readRecord(uint64_t position, ImageSet &imgSet);
+
+    /**
+     * @brief Read RecordHeader and ImageSetMeta of a record, return offset of its first plane
+     *
+     * @param position
+     * @param header
+     * @param meta
+     * @return uint64_t
+     */
+    uint64_t readRecordHeader(uint64_t position, recording::RecordHeader &header, ImageSetMeta &meta);
+
+    /**
+     * @brief Read and decode a plane of a record
+     *
+     * @param position
+     * @param header
+     * @param offset offset of the plane in the file
+     * @param plane
+     * @param rawSize size of the decoded plane
+     * @param buff
+     */
+    void decodePlane(uint64_t position, const recording::RecordHeader &header, uint64_t offset,
+        uint32_t plane, uint32_t rawSize, ImageSet::Buffer &buff);
+
+    /**
+     * @brief Get decoded plane of a record, the records since the last one without difference are decoded if needed
+     *
+     * @param position
+     * @param plane
+     * @return const ImageSet::Buffer&
+     */
+    const ImageSet::Buffer& referencePlane(uint64_t position, uint32_t plane);
+
+    /**
+     * @brief Time when the record should be served, pacing is restarted from the record if needed
+     *
+     * @param entry
+     * @return Clock::time_point
+     */
+    Clock::time_point paceRecord(const recording::IndexEntry &entry);
+
+    int _fd;
+    std::string _filename;
+    recording::Index _index;
+    std::string _metaBuff;
+    std::vector<char> _compressedBuff;
+
+    // last decoded compressed plane, reference of the difference stored in the next record
+    struct DecodedPlane {
+        uint64_t position = UINT64_MAX;
+        ImageSet::Buffer data;
+    };
+    DecodedPlane _decoded[recording::PLANE_COUNT];
+    ImageSet::Buffer _referenceBuff;
+
+    uint64_t _position;
+    int32_t _streamType;
+    double _rate;
+    bool _loop;
+    bool _started;
+
+    // pacing reference, receive time of a record and the time it was served
+    bool _paceValid;
+    uint64_t _paceRecordTime;
+    Clock::time_point _paceStartTime;
+
+    mutable std::mutex _playbackLock;
+};
+
+} // namespace protocol
+} // namespace libspark
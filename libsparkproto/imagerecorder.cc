@@ -0,0 +1,37 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <libsparkproto/imagerecorder.h>
+#include <libsparkproto/imagerecorderimpl.h>
+
+namespace libspark {
+
+namespace protocol {
+
+ImageRecorder::ImageRecorder(const std::string &filename, const RecorderOptions &options)
+    : _pImpl(new ImageRecorderImpl(filename, options)) {
+
+}
+
+ImageRecorder::~ImageRecorder() {
+
+}
+
+bool ImageRecorder::write(const ImageSet &imgSet) {
+    return _pImpl->write(imgSet);
+}
+
+void ImageRecorder::close() {
+    _pImpl->close();
+}
+
+uint64_t ImageRecorder::recordCount() const {
+    return _pImpl->recordCount();
+}
+
+RecorderStats ImageRecorder::stats() const {
+    return _pImpl->stats();
+}
+
+} // namespace protocol
+} // namespace libspark
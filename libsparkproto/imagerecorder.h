@@ -0,0 +1,172 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <libsparkproto/common.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class ImageSet;
+class ImageRecorderImpl;
+
+/**
+ * @brief Options of the write path of ImageRecorder.
+ * ImageSet are copied into a pool of chunkCount buffers of chunkSize bytes which are written
+ * to disk by a writer thread. When the pool is exhausted, ImageSet are dropped instead of
+ * blocking the caller, see RecorderStats.
+ *
+ * When a plane is compressed, ImageSet are copied and compressed by a pool of worker threads,
+ * then appended to the recording in the order they were written. ImagePlayback decompresses
+ * only the planes it serves.
+ *
+ */
+struct SPARK_API RecorderOptions {
+
+    enum IoBackend {
+        // chunks are written with pwrite from the writer thread
+        IO_SYNC = 0,
+        // chunks are submitted to io_uring, falls back to IO_SYNC if the kernel does not support it
+        IO_URING = 1
+    };
+
+    // open segments with O_DIRECT, bypass page cache
+    bool directIO = false;
+
+    IoBackend ioBackend = IO_SYNC;
+
+    // size of a buffer of the pool, rounded up to a multiple of 4096 bytes
+    uint32_t chunkSize = 8 << 20;
+
+    // number of buffers in the pool, bounds the memory used for data not yet written
+    uint32_t chunkCount = 16;
+
+    // bytes reserved with fallocate when a segment is created, 0 disables preallocation
+    uint64_t preallocateSize = 0;
+
+    // start a new segment when it would exceed this size, 0 disables rotation by size
+    uint64_t segmentMaxSize = 0;
+
+    // start a new segment after this duration in milliseconds, 0 disables rotation by time
+    uint64_t segmentMaxDuration = 0;
+
+    enum Compression {
+        COMPRESSION_NONE = 0,
+        // fast, requires the library built with ENABLE_LZ4
+        COMPRESSION_LZ4 = 1,
+        // better ratio, requires the library built with ENABLE_ZSTD
+        COMPRESSION_ZSTD = 2
+    };
+
+    // compression of each plane, indexed by ImageSet::BufferID
+    Compression compression[4] = {COMPRESSION_NONE, COMPRESSION_NONE, COMPRESSION_NONE, COMPRESSION_NONE};
+
+    // level of zstd or acceleration of LZ4, 0 for the default of the codec
+    int compressionLevel = 0;
+
+    // store disparity as the difference to the previous ImageSet, before it's compressed
+    bool deltaDisparity = false;
+
+    // with deltaDisparity, one of keyframeInterval ImageSet is stored without difference.
+    // Segments are rotated on these ImageSet, so each segment can be played back alone
+    uint32_t keyframeInterval = 30;
+
+    // threads compressing ImageSet, 0 for the number of CPU cores
+    uint32_t compressionThreads = 0;
+
+    // ImageSet waiting or being compressed, more ImageSet are dropped, 0 for twice compressionThreads
+    uint32_t compressionQueueSize = 0;
+};
+
+/**
+ * @brief Counters of ImageRecorder
+ *
+ */
+struct SPARK_API RecorderStats {
+    // ImageSet accepted by the recorder
+    uint64_t recordCount = 0;
+    // ImageSet dropped since the buffer pool was exhausted
+    uint64_t droppedCount = 0;
+    uint64_t droppedBytes = 0;
+    // bytes written to disk
+    uint64_t writtenBytes = 0;
+    // size of planes of the accepted ImageSet, before and after compression
+    uint64_t rawPlaneBytes = 0;
+    uint64_t storedPlaneBytes = 0;
+    uint64_t segmentCount = 0;
+    // maximum number of buffers of the pool used at the same time
+    uint32_t peakChunksInUse = 0;
+};
+
+/**
+ * @brief ImageRecorder writes a sequence of ImageSet to a recording file.
+ * A recording can be played back with libspark::protocol::ImagePlayback.
+ * The function write is thread-safe, so it can be called from a callback of AsyncImageStream.
+ * It never waits for the disk, ImageSet are handed to a writer thread, see RecorderOptions.
+ *
+ * When rotation of segments is enabled, each segment is a complete recording named
+ * <filename without extension>_<segment number>.sparkrec
+ *
+ */
+class SPARK_API ImageRecorder {
+
+public:
+
+    using Ptr = std::unique_ptr<ImageRecorder>;
+
+    /**
+     * @brief Construct a new ImageRecorder object, the file is created or truncated.
+     * If the file can not be created or a codec is not supported by the build, a exception is thrown, see more exception libspark::protocol::SparkException
+     *
+     * @param filename
+     * @param options
+     */
+    ImageRecorder(const std::string &filename, const RecorderOptions &options = RecorderOptions());
+
+    /**
+     * @brief Destroy the ImageRecorder object, the recording is closed if it is still open
+     *
+     */
+    virtual ~ImageRecorder();
+
+    /**
+     * @brief Append an ImageSet to the recording. Return false if the ImageSet is dropped
+     * since the buffer pool or the compression queue is full. A compressed ImageSet can still be
+     * dropped after it's compressed, see RecorderStats. If the writer thread failed, a exception is thrown.
+     *
+     * @param imgSet
+     * @return true
+     * @return false
+     */
+    bool write(const ImageSet &imgSet);
+
+    /**
+     * @brief Finish the recording, wait until all data is on disk and index of the recording is written to the file
+     *
+     */
+    void close();
+
+    /**
+     * @brief Number of ImageSet accepted by the recording
+     *
+     * @return uint64_t
+     */
+    uint64_t recordCount() const;
+
+    /**
+     * @brief Get counters of the recorder
+     *
+     * @return RecorderStats
+     */
+    RecorderStats stats() const;
+
+private:
+    std::unique_ptr<ImageRecorderImpl> _pImpl;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,10 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#if (defined(_WIN32))
+    #include <libsparkproto/imagerecorderimpl_win32.h>
+#else
+    #include <libsparkproto/imagerecorderimpl_unix.h>
+#endif
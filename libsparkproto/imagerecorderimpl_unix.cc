@@ -0,0 +1,732 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <chrono>
+#include <algorithm>
+
+#include <libsparkproto/imagerecorderimpl.h>
+#include <libsparkproto/imageset.h>
+#include <libsparkproto/iouring.h>
+#include <libsparkproto/recordingcodec.h>
+#include <libsparkproto/threadpool.h>
+#include <libsparkproto/exception.h>
+#include <libsparkproto/log.h>
+
+namespace libspark {
+
+namespace protocol {
+
+// alignment of buffers, offsets and sizes required by O_DIRECT
+static constexpr uint32_t IO_ALIGNMENT = 4096;
+static constexpr uint32_t MIN_CHUNK_COUNT = 2;
+
+static uint64_t rawPlaneBytes(const ImageSetMeta &meta) {
+    uint64_t size = 0;
+    for(uint32_t i = 0; i < recording::PLANE_COUNT; i++) {
+        const ImageMeta *plane = recording::planeMeta(meta, ImageSet::BufferID(i));
+        size += plane ? plane->buffsize() : 0;
+    }
+    return size;
+}
+
+// writes after this go through the page cache, which accepts any offset and size
+static void clearDirectIO(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    if(flags >= 0 && (flags & O_DIRECT)) {
+        fcntl(fd, F_SETFL, flags & ~O_DIRECT);
+    }
+}
+
+static uint64_t steadyTimeMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ImageRecorderImpl::ImageRecorderImpl(const std::string &filename, const RecorderOptions &options)
+    : _filename(filename), _options(options), _closed(false), _segmentId(0), _segmentStartTime(0),
+      _current(nullptr), _stopWriter(false), _lastJob(nullptr), _heldJob(nullptr), _sinceKeyframe(0),
+      _forceKeyframe(false), _chainBroken(false), _inFlight(0) {
+
+    bool compress = _options.deltaDisparity;
+    for(uint32_t i = 0; i < recording::PLANE_COUNT; i++) {
+        recording::PlaneCodec codec = recording::PlaneCodec(_options.compression[i]);
+        if(!recording::isCodecSupported(codec)) {
+            throw SparkError("compression " + std::to_string(codec) + " is not supported by this build of the library");
+        }
+        compress |= codec != recording::CODEC_NONE;
+    }
+
+    _options.chunkSize = std::max<uint32_t>(_options.chunkSize, IO_ALIGNMENT);
+    _options.chunkSize = (_options.chunkSize + IO_ALIGNMENT - 1) / IO_ALIGNMENT * IO_ALIGNMENT;
+    _options.chunkCount = std::max(_options.chunkCount, MIN_CHUNK_COUNT);
+
+    // the first segment is opened here, so a wrong filename is reported to the caller
+    int fd = openSegmentFile(segmentFilename(0));
+
+    try {
+        for(uint32_t i = 0; i < _options.chunkCount; i++) {
+            _chunks.push_back(std::make_unique<Chunk>());
+            void *data = nullptr;
+            if(posix_memalign(&data, IO_ALIGNMENT, _options.chunkSize) != 0) {
+                throw SparkError("can not allocate buffers of recorder");
+            }
+            _chunks.back()->data = (char*)data;
+            _freeChunks.push_back(_chunks.back().get());
+        }
+
+        if(_options.ioBackend == RecorderOptions::IO_URING) {
+            _ring = std::make_unique<IoUring>();
+            if(!_ring->init(_options.chunkCount)) {
+                LOG_WARNING("io_uring is not available, using synchronous writes");
+                _ring.reset();
+            }
+        }
+
+        if(compress) {
+            _pool = std::make_unique<ThreadPool>(_options.compressionThreads);
+            uint32_t queueSize = _options.compressionQueueSize ? _options.compressionQueueSize : 2 * _pool->threadCount();
+            // one more job is held as reference of the next one
+            for(uint32_t i = 0; i < queueSize + 1; i++) {
+                _jobs.push_back(std::make_unique<CompressJob>());
+                _freeJobs.push_back(_jobs.back().get());
+            }
+        }
+
+        openSegment(fd);
+
+        _writerThread = std::thread(&ImageRecorderImpl::writerLoop, this);
+    } catch (...) {
+        // the destructor does not run, the file and the buffers allocated so far are released here
+        _pool.reset();
+        for(auto &chunk : _chunks) {
+            free(chunk->data);
+        }
+        ::close(fd);
+        throw;
+    }
+}
+
+ImageRecorderImpl::~ImageRecorderImpl() {
+    try {
+        close();
+    } catch (SparkException &e) {
+        LOG_ERROR("failed closing recording: %s", e.what());
+    }
+    _pool.reset();
+
+    for(auto &chunk : _chunks) {
+        free(chunk->data);
+    }
+}
+
+bool ImageRecorderImpl::write(const ImageSet &imgSet) {
+
+    std::lock_guard<std::mutex> lock(_writeLock);
+
+    if(_closed) {
+        throw SparkError("recording " + _filename + " is closed");
+    }
+
+    {
+        std::lock_guard<std::mutex> queueLock(_queueLock);
+        if(!_writeError.empty()) {
+            throw SparkError(_writeError);
+        }
+    }
+
+    const ImageSetMeta &meta = imgSet.meta();
+    for(uint32_t i = 0; i < recording::PLANE_COUNT; i++) {
+        const ImageMeta *plane = recording::planeMeta(meta, ImageSet::BufferID(i));
+        if(plane && (plane->buffsize() < 0 || imgSet.getBuffer(ImageSet::BufferID(i)).size() < size_t(plane->buffsize()))) {
+            throw SparkError("size of buffer does not match ImageSetMeta");
+        }
+    }
+
+    if(_pool) {
+        return submitJob(imgSet);
+    }
+
+    if(!meta.SerializeToString(&_metaBuff)) {
+        throw SparkError("failed serializing ImageSetMeta");
+    }
+
+    recording::RecordHeader header = recording::makeRecordHeader(meta, _metaBuff.size(), imgSet.receiveTimestamp());
+    const void *planes[recording::PLANE_COUNT];
+    for(uint32_t i = 0; i < recording::PLANE_COUNT; i++) {
+        planes[i] = imgSet.getBuffer(ImageSet::BufferID(i)).data();
+    }
+
+    return appendRecord(header, _metaBuff, planes, recording::metaTimestamp(meta), rawPlaneBytes(meta), true);
+}
+
+bool ImageRecorderImpl::appendRecord(const recording::RecordHeader &header, const std::string &metaBuff,
+    const void *const *planes, int64_t timestamp, uint64_t rawBytes, bool canRotate) {
+
+    uint64_t size = recording::recordSize(header);
+
+    bool rotate = false;
+    if(!_segment->index.empty() && canRotate) {
+        rotate = (_options.segmentMaxSize > 0 && _segment->size + size > _options.segmentMaxSize) ||
+            (_options.segmentMaxDuration > 0 && steadyTimeMs() - _segmentStartTime >= _options.segmentMaxDuration);
+    }
+
+    // drop the ImageSet rather than waiting for the disk,
+    // a new segment starts in a new chunk and one more chunk may be needed to end the current segment
+    uint64_t required = rotate ? size + sizeof(recording::FileHeader) + (_current ? 0 : _options.chunkSize) : size;
+    uint64_t available = rotate ? freeBytes() : freeBytes() + (_current ? _options.chunkSize - _current->used : 0);
+    if(required > available) {
+        std::lock_guard<std::mutex> queueLock(_queueLock);
+        _stats.droppedCount++;
+        _stats.droppedBytes += size;
+        return false;
+    }
+
+    if(rotate) {
+        if(!_current) {
+            takeChunk();
+        }
+        queueCurrentChunk(true);
+        _segmentId++;
+        openSegment(-1);
+    }
+
+    uint64_t offset = _segment->size;
+    append(&header, sizeof(header));
+    append(metaBuff.data(), metaBuff.size());
+    uint64_t storedBytes = 0;
+    for(uint32_t i = 0; i < recording::PLANE_COUNT; i++) {
+        if(header.planeSize[i] > 0) {
+            append(planes[i], header.planeSize[i]);
+            storedBytes += header.planeSize[i];
+        }
+    }
+    _segment->index.push_back({timestamp, header.receiveTimestamp, offset});
+
+    std::lock_guard<std::mutex> queueLock(_queueLock);
+    _stats.recordCount++;
+    _stats.storedPlaneBytes += storedBytes;
+    _stats.rawPlaneBytes += rawBytes;
+
+    return true;
+}
+
+bool ImageRecorderImpl::submitJob(const ImageSet &imgSet) {
+    CompressJob *job = nullptr;
+    {
+        std::lock_guard<std::mutex> jobLock(_jobLock);
+        if(!_freeJobs.empty()) {
+            job = _freeJobs.back();
+            _freeJobs.pop_back();
+        }
+    }
+
+    if(!job) {
+        // the next ImageSet can not refer to a dropped one
+        _forceKeyframe = true;
+        _lastJob = nullptr;
+
+        std::lock_guard<std::mutex> queueLock(_queueLock);
+        _stats.droppedCount++;
+        _stats.droppedBytes += rawPlaneBytes(imgSet.meta());
+        return false;
+    }
+
+    job->imgSet = imgSet;
+    bool keyframe = !_options.deltaDisparity || _forceKeyframe || !_lastJob || _sinceKeyframe + 1 >= _options.keyframeInterval;
+    job->reference = keyframe ? nullptr : _lastJob;
+    _sinceKeyframe = keyframe ? 0 : _sinceKeyframe + 1;
+    _forceKeyframe = false;
+    _lastJob = job;
+
+    {
+        std::lock_guard<std::mutex> jobLock(_jobLock);
+        job->done = false;
+        _pendingJobs.push_back(job);
+    }
+
+    _pool->submit([this, job]() {
+        try {
+            compressJob(job);
+        } catch (SparkException &e) {
+            setWriteError(e.what());
+        }
+        {
+            std::lock_guard<std::mutex> jobLock(_jobLock);
+            job->done = true;
+        }
+        commitJobs();
+    });
+
+    return true;
+}
+
+void ImageRecorderImpl::compressJob(CompressJob *job) {
+    const ImageSetMeta &meta = job->imgSet.meta();
+    if(!meta.SerializeToString(&job->metaBuff)) {
+        throw SparkError("failed serializing ImageSetMeta");
+    }
+
+    recording::RecordHeader &header = job->header;
+    header = recording::makeRecordHeader(meta, job->metaBuff.size(), job->imgSet.receiveTimestamp());
+
+    for(uint32_t i = 0; i < recording::PLANE_COUNT; i++) {
+        ImageSet::BufferID id = ImageSet::BufferID(i);
+        uint32_t rawSize = header.planeSize[i];
+        const uint8_t *src = job->imgSet.getBuffer(id).data();
+        job->planes[i] = src;
+        if(rawSize == 0) {
+            continue;
+        }
+
+        // disparity changes little between frames, the difference compresses better
+        if(id == ImageSet::BUFFER_DISPARITY && job->reference) {
+            const ImageMeta *refPlane = recording::planeMeta(job->reference->imgSet.meta(), id);
+            if(refPlane && int64_t(refPlane->buffsize()) == int64_t(rawSize)) {
+                job->deltaBuff.resize(rawSize);
+                recording::deltaEncode(src, job->reference->imgSet.getBuffer(id).data(), job->deltaBuff.data(), rawSize);
+                src = job->deltaBuff.data();
+                job->planes[i] = src;
+                header.codec[i] |= recording::CODEC_FLAG_DELTA;
+            }
+        }
+
+        recording::PlaneCodec codec = recording::PlaneCodec(_options.compression[i]);
+        if(codec == recording::CODEC_NONE) {
+            continue;
+        }
+
+        // a plane which does not get smaller is stored as it is
+        std::vector<char> &out = job->planeData[i];
+        out.resize(recording::compressBound(codec, rawSize));
+        size_t size = recording::compressPlane(codec, _options.compressionLevel, src, rawSize, out.data(), out.size());
+        if(size > 0 && size < rawSize) {
+            header.planeSize[i] = size;
+            header.codec[i] |= codec;
+            job->planes[i] = out.data();
+        }
+    }
+}
+
+void ImageRecorderImpl::commitJobs() {
+    std::lock_guard<std::mutex> lock(_writeLock);
+
+    while(true) {
+        CompressJob *job;
+        {
+            std::lock_guard<std::mutex> jobLock(_jobLock);
+            if(_pendingJobs.empty() || !_pendingJobs.front()->done) {
+                break;
+            }
+            job = _pendingJobs.front();
+            _pendingJobs.pop_front();
+        }
+
+        bool failed;
+        {
+            std::lock_guard<std::mutex> queueLock(_queueLock);
+            failed = !_writeError.empty();
+        }
+
+        bool delta = false;
+        for(uint32_t i = 0; i < recording::PLANE_COUNT; i++) {
+            delta |= (job->header.codec[i] & recording::CODEC_FLAG_DELTA) != 0;
+        }
+
+        // records are discarded after a failure of the writer, write reports the error
+        if(!failed && delta && _chainBroken) {
+            std::lock_guard<std::mutex> queueLock(_queueLock);
+            _stats.droppedCount++;
+            _stats.droppedBytes += recording::recordSize(job->header);
+        }
+        else if(!failed) {
+            const ImageSetMeta &meta = job->imgSet.meta();
+            if(appendRecord(job->header, job->metaBuff, job->planes, recording::metaTimestamp(meta), rawPlaneBytes(meta), !delta)) {
+                _chainBroken = false;
+            }
+            else {
+                _chainBroken = true;
+                _forceKeyframe = true;
+            }
+        }
+
+        // the job is kept until the next one is committed, it may be its reference
+        std::lock_guard<std::mutex> jobLock(_jobLock);
+        if(_heldJob) {
+            _freeJobs.push_back(_heldJob);
+        }
+        _heldJob = job;
+    }
+}
+
+void ImageRecorderImpl::close() {
+    {
+        std::lock_guard<std::mutex> lock(_writeLock);
+
+        if(_closed) {
+            return;
+        }
+        _closed = true;
+    }
+
+    // jobs are committed by the workers, they take _writeLock
+    if(_pool) {
+        _pool->wait();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_writeLock);
+
+        bool failed;
+        {
+            // wait for a chunk to mark the end of the segment, unless the writer failed
+            std::unique_lock<std::mutex> queueLock(_queueLock);
+            _queueCond.wait(queueLock, [&]() { return _current || !_freeChunks.empty() || !_writeError.empty(); });
+            failed = !_writeError.empty();
+        }
+
+        if(failed) {
+            // the segment is not finished, its file is closed after the writer stopped
+            if(_current) {
+                releaseChunk(_current);
+                _current = nullptr;
+            }
+        }
+        else {
+            if(!_current) {
+                takeChunk();
+            }
+            queueCurrentChunk(true);
+        }
+
+        std::lock_guard<std::mutex> queueLock(_queueLock);
+        _stopWriter = true;
+        _queueCond.notify_all();
+    }
+
+    if(_writerThread.joinable()) {
+        _writerThread.join();
+    }
+
+    std::lock_guard<std::mutex> queueLock(_queueLock);
+    if(!_writeError.empty()) {
+        if(_segment && _segment->fd >= 0) {
+            ::close(_segment->fd);
+            _segment->fd = -1;
+        }
+        throw SparkError(_writeError);
+    }
+    LOG_INFO("recorded %lu ImageSet to %s, dropped %lu", _stats.recordCount, _filename.c_str(), _stats.droppedCount);
+}
+
+uint64_t ImageRecorderImpl::recordCount() const {
+    std::lock_guard<std::mutex> lock(_queueLock);
+    return _stats.recordCount;
+}
+
+RecorderStats ImageRecorderImpl::stats() const {
+    std::lock_guard<std::mutex> lock(_queueLock);
+    return _stats;
+}
+
+void ImageRecorderImpl::openSegment(int fd) {
+    _segment = std::make_shared<Segment>();
+    _segment->filename = segmentFilename(_segmentId);
+    _segment->fd = fd;
+    _segmentStartTime = steadyTimeMs();
+
+    {
+        std::lock_guard<std::mutex> queueLock(_queueLock);
+        _stats.segmentCount++;
+    }
+
+    recording::FileHeader header = recording::makeFileHeader();
+    append(&header, sizeof(header));
+}
+
+void ImageRecorderImpl::takeChunk() {
+    std::lock_guard<std::mutex> queueLock(_queueLock);
+
+    _current = _freeChunks.back();
+    _freeChunks.pop_back();
+    _current->used = 0;
+    _current->offset = _segment->size;
+    _current->segment = _segment;
+
+    uint32_t inUse = _options.chunkCount - _freeChunks.size();
+    _stats.peakChunksInUse = std::max(_stats.peakChunksInUse, inUse);
+}
+
+void ImageRecorderImpl::queueCurrentChunk(bool lastInSegment) {
+    std::lock_guard<std::mutex> queueLock(_queueLock);
+
+    _current->lastInSegment = lastInSegment;
+    _writeQueue.push_back(_current);
+    _current = nullptr;
+    _queueCond.notify_all();
+}
+
+void ImageRecorderImpl::append(const void *data, uint64_t size) {
+    const char *src = (const char*)data;
+
+    while(size > 0) {
+        if(!_current) {
+            // availability is checked by the caller, so a chunk is free
+            takeChunk();
+        }
+
+        uint64_t n = std::min<uint64_t>(size, _options.chunkSize - _current->used);
+        memcpy(_current->data + _current->used, src, n);
+        _current->used += n;
+        _segment->size += n;
+        src += n;
+        size -= n;
+
+        if(_current->used == _options.chunkSize) {
+            queueCurrentChunk(false);
+        }
+    }
+}
+
+uint64_t ImageRecorderImpl::freeBytes() const {
+    std::lock_guard<std::mutex> queueLock(_queueLock);
+    return (uint64_t)_freeChunks.size() * _options.chunkSize;
+}
+
+std::string ImageRecorderImpl::segmentFilename(uint64_t segmentId) const {
+    if(_options.segmentMaxSize == 0 && _options.segmentMaxDuration == 0) {
+        return _filename;
+    }
+
+    std::string base = _filename;
+    if(base.size() > recording::FILE_EXTENSION.size() &&
+        base.compare(base.size() - recording::FILE_EXTENSION.size(), std::string::npos, recording::FILE_EXTENSION) == 0) {
+        base.resize(base.size() - recording::FILE_EXTENSION.size());
+    }
+
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "_%04lu", segmentId);
+    return base + suffix + recording::FILE_EXTENSION;
+}
+
+int ImageRecorderImpl::openSegmentFile(const std::string &filename) {
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+    int fd = ::open(filename.c_str(), flags | (_options.directIO ? O_DIRECT : 0), 0644);
+    if(fd < 0 && _options.directIO && errno == EINVAL) {
+        // e.g. tmpfs does not support O_DIRECT
+        LOG_WARNING("O_DIRECT is not supported for %s, using page cache", filename.c_str());
+        fd = ::open(filename.c_str(), flags, 0644);
+    }
+    if(fd < 0) {
+        throw SparkError("can not create recording file " + filename + ": " + std::string(strerror(errno)));
+    }
+
+    if(_options.preallocateSize > 0) {
+        if(fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, _options.preallocateSize) < 0) {
+            LOG_WARNING("can not preallocate %s: %s", filename.c_str(), strerror(errno));
+        }
+    }
+
+    return fd;
+}
+
+void ImageRecorderImpl::writerLoop() {
+    while(true) {
+        Chunk *chunk = nullptr;
+        {
+            std::unique_lock<std::mutex> queueLock(_queueLock);
+            _queueCond.wait(queueLock, [&]() {
+                return !_writeQueue.empty() || _stopWriter || _inFlight > 0;
+            });
+
+            if(!_writeQueue.empty()) {
+                chunk = _writeQueue.front();
+                _writeQueue.pop_front();
+            }
+            else if(_inFlight == 0) {
+                break;
+            }
+        }
+
+        if(!chunk) {
+            // nothing queued, wait for submitted writes
+            reapCompletions(1);
+            continue;
+        }
+
+        bool failed;
+        {
+            std::lock_guard<std::mutex> queueLock(_queueLock);
+            failed = !_writeError.empty();
+        }
+
+        try {
+            if(failed) {
+                // keep the pool running, data is discarded after a failure
+                if(chunk->lastInSegment && chunk->segment->fd >= 0) {
+                    ::close(chunk->segment->fd);
+                    chunk->segment->fd = -1;
+                }
+                releaseChunk(chunk);
+                continue;
+            }
+
+            if(chunk->segment->fd < 0) {
+                chunk->segment->fd = openSegmentFile(chunk->segment->filename);
+            }
+
+            if(chunk->lastInSegment) {
+                finalizeSegment(chunk);
+            }
+            else {
+                writeChunk(chunk);
+            }
+        } catch (SparkException &e) {
+            if(chunk->lastInSegment && chunk->segment->fd >= 0) {
+                ::close(chunk->segment->fd);
+                chunk->segment->fd = -1;
+            }
+            setWriteError(e.what());
+            releaseChunk(chunk);
+        }
+    }
+}
+
+void ImageRecorderImpl::writeChunk(Chunk *chunk) {
+    if(!_ring) {
+        recording::pwriteFixed(chunk->segment->fd, chunk->data, chunk->used, chunk->offset);
+        completeChunk(chunk, chunk->used);
+        return;
+    }
+
+    chunk->iov = {chunk->data, chunk->used};
+    while(!_ring->queueWrite(chunk->segment->fd, &chunk->iov, chunk->offset, (uint64_t)chunk)) {
+        reapCompletions(1);
+        if(!_ring) {
+            // the ring failed, the chunk is discarded like the ones queued after the failure
+            releaseChunk(chunk);
+            return;
+        }
+    }
+    _inFlight++;
+    _submitted.push_back(chunk);
+
+    // submit without waiting, completions are collected when the queue is empty or full
+    reapCompletions(0);
+}
+
+void ImageRecorderImpl::reapCompletions(uint32_t minComplete) {
+    IoUring::Completion completions[64];
+
+    uint32_t count;
+    try {
+        count = _ring->submitAndWait(minComplete, completions, 64);
+    } catch (SparkException &e) {
+        // completions of the submitted chunks can not be collected anymore, they go back to the pool
+        // and the ring is dropped, so no late completion releases them twice
+        setWriteError(e.what());
+        _ring.reset();
+        _inFlight = 0;
+        for(Chunk *chunk : _submitted) {
+            releaseChunk(chunk);
+        }
+        _submitted.clear();
+        return;
+    }
+
+    for(uint32_t i = 0; i < count; i++) {
+        Chunk *chunk = (Chunk*)completions[i].userData;
+        _inFlight--;
+        _submitted.erase(std::find(_submitted.begin(), _submitted.end(), chunk));
+        completeChunk(chunk, completions[i].result);
+    }
+}
+
+void ImageRecorderImpl::completeChunk(Chunk *chunk, int32_t result) {
+    try {
+        if(result < 0) {
+            throw SparkError("failed writing recording file: " + std::string(strerror(-result)));
+        }
+
+        // finish a short write synchronously, from the last aligned offset so O_DIRECT is kept,
+        // an unaligned rest is written after O_DIRECT is cleared
+        if((uint32_t)result < chunk->used) {
+            uint32_t start = (uint32_t)result / IO_ALIGNMENT * IO_ALIGNMENT;
+            if((chunk->used - start) % IO_ALIGNMENT != 0) {
+                clearDirectIO(chunk->segment->fd);
+            }
+            recording::pwriteFixed(chunk->segment->fd, chunk->data + start, chunk->used - start, chunk->offset + start);
+        }
+
+        std::lock_guard<std::mutex> queueLock(_queueLock);
+        _stats.writtenBytes += chunk->used;
+    } catch (SparkException &e) {
+        setWriteError(e.what());
+    }
+
+    releaseChunk(chunk);
+}
+
+void ImageRecorderImpl::finalizeSegment(Chunk *chunk) {
+    while(_inFlight > 0) {
+        reapCompletions(1);
+    }
+
+    std::shared_ptr<Segment> segment = chunk->segment;
+    int fd = segment->fd;
+
+    // the tail is not aligned, it's written after O_DIRECT is cleared
+    uint32_t aligned = chunk->used / IO_ALIGNMENT * IO_ALIGNMENT;
+    if(aligned > 0) {
+        recording::pwriteFixed(fd, chunk->data, aligned, chunk->offset);
+    }
+
+    clearDirectIO(fd);
+    if(chunk->used > aligned) {
+        recording::pwriteFixed(fd, chunk->data + aligned, chunk->used - aligned, chunk->offset + aligned);
+    }
+
+    recording::writeIndex(fd, segment->size, segment->index);
+
+    // release blocks preallocated beyond the end of the recording
+    if(_options.preallocateSize > 0) {
+        uint64_t fileSize = segment->size + segment->index.size() * sizeof(recording::IndexEntry) + sizeof(recording::FileTrailer);
+        if(ftruncate(fd, fileSize) < 0) {
+            LOG_WARNING("can not truncate %s: %s", segment->filename.c_str(), strerror(errno));
+        }
+    }
+
+    ::close(fd);
+    segment->fd = -1;
+
+    {
+        std::lock_guard<std::mutex> queueLock(_queueLock);
+        _stats.writtenBytes += chunk->used;
+    }
+    releaseChunk(chunk);
+}
+
+void ImageRecorderImpl::setWriteError(const std::string &error) {
+    std::lock_guard<std::mutex> queueLock(_queueLock);
+    if(_writeError.empty()) {
+        _writeError = error;
+        LOG_ERROR("recorder stopped writing: %s", error.c_str());
+    }
+}
+
+void ImageRecorderImpl::releaseChunk(Chunk *chunk) {
+    std::lock_guard<std::mutex> queueLock(_queueLock);
+
+    chunk->segment.reset();
+    chunk->iov = {nullptr, 0};
+    _freeChunks.push_back(chunk);
+    _queueCond.notify_all();
+}
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,241 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <sys/uio.h>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <libsparkproto/imagerecorder.h>
+#include <libsparkproto/imageset.h>
+#include <libsparkproto/recordingformat.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class IoUring;
+class ThreadPool;
+class ImageRecorderImpl {
+
+public:
+    /**
+     * @brief Construct a new ImageRecorderImpl object
+     *
+     * @param filename
+     * @param options
+     */
+    ImageRecorderImpl(const std::string &filename, const RecorderOptions &options);
+
+    /**
+     * @brief Destroy the ImageRecorderImpl object
+     *
+     */
+    virtual ~ImageRecorderImpl();
+
+    /**
+     * @brief Append an ImageSet to the recording
+     *
+     * @param imgSet
+     * @return true
+     * @return false
+     */
+    bool write(const ImageSet &imgSet);
+
+    /**
+     * @brief Flush all chunks, write index of the recording and close the file
+     *
+     */
+    void close();
+
+    /**
+     * @brief Number of ImageSet accepted by the recording
+     *
+     * @return uint64_t
+     */
+    uint64_t recordCount() const;
+
+    /**
+     * @brief Get counters of the recorder
+     *
+     * @return RecorderStats
+     */
+    RecorderStats stats() const;
+
+private:
+    // a recording file, segments are created when rotation is enabled
+    struct Segment {
+        std::string filename;
+        int fd = -1;
+        // index is filled by the caller of write and read by the writer thread after the last chunk
+        recording::Index index;
+        uint64_t size = 0;
+    };
+
+    // an aligned buffer of the pool, holds a range of bytes of a segment
+    struct Chunk {
+        char *data = nullptr;
+        uint32_t used = 0;
+        uint64_t offset = 0;
+        bool lastInSegment = false;
+        std::shared_ptr<Segment> segment;
+        iovec iov = {nullptr, 0};
+    };
+
+    // an ImageSet copied for the compression workers
+    struct CompressJob {
+        ImageSet imgSet;
+        // previous ImageSet, reference of the difference of disparity, nullptr for a keyframe
+        CompressJob *reference = nullptr;
+        bool done = false;
+        std::string metaBuff;
+        recording::RecordHeader header;
+        // data stored for each plane, points to imgSet or to planeData
+        const void *planes[recording::PLANE_COUNT];
+        std::vector<char> planeData[recording::PLANE_COUNT];
+        std::vector<uint8_t> deltaBuff;
+    };
+
+    /**
+     * @brief Append a serialized record to chunks, rotate the segment if needed.
+     * Return false if the record is dropped since the pool is full
+     *
+     * @param header
+     * @param metaBuff
+     * @param planes
+     * @param timestamp
+     * @param rawBytes size of the planes before compression
+     * @param canRotate false if the record depends on the previous record
+     * @return true
+     * @return false
+     */
+    bool appendRecord(const recording::RecordHeader &header, const std::string &metaBuff,
+        const void *const *planes, int64_t timestamp, uint64_t rawBytes, bool canRotate);
+
+    /**
+     * @brief Copy an ImageSet to a free job and queue it to the compression workers
+     *
+     * @param imgSet
+     * @return true
+     * @return false
+     */
+    bool submitJob(const ImageSet &imgSet);
+
+    /**
+     * @brief Compress planes of a job, run by a worker
+     *
+     * @param job
+     */
+    void compressJob(CompressJob *job);
+
+    /**
+     * @brief Append the compressed jobs to the recording in the order they are submitted
+     *
+     */
+    void commitJobs();
+
+    /**
+     * @brief Create a segment and write its file header to the current chunk
+     *
+     * @param fd opened file of the segment, -1 if it's opened by the writer thread
+     */
+    void openSegment(int fd);
+
+    /**
+     * @brief Take a free chunk as the current chunk, the pool must not be empty
+     *
+     */
+    void takeChunk();
+
+    /**
+     * @brief Queue the current chunk to the writer thread
+     *
+     * @param lastInSegment
+     */
+    void queueCurrentChunk(bool lastInSegment);
+
+    /**
+     * @brief Copy bytes to chunks, queue the chunks which become full
+     *
+     * @param data
+     * @param size
+     */
+    void append(const void *data, uint64_t size);
+
+    /**
+     * @brief Number of bytes in the free chunks of the pool
+     *
+     * @return uint64_t
+     */
+    uint64_t freeBytes() const;
+
+    std::string segmentFilename(uint64_t segmentId) const;
+
+    int openSegmentFile(const std::string &filename);
+
+    void writerLoop();
+
+    void writeChunk(Chunk *chunk);
+
+    void reapCompletions(uint32_t minComplete);
+
+    void completeChunk(Chunk *chunk, int32_t result);
+
+    void finalizeSegment(Chunk *chunk);
+
+    void setWriteError(const std::string &error);
+
+    void releaseChunk(Chunk *chunk);
+
+    std::string _filename;
+    RecorderOptions _options;
+    bool _closed;
+
+    // caller side, protected by _writeLock
+    std::shared_ptr<Segment> _segment;
+    uint64_t _segmentId;
+    uint64_t _segmentStartTime;
+    Chunk *_current;
+    std::string _metaBuff;
+    mutable std::mutex _writeLock;
+
+    // pool of chunks and queue to the writer thread, protected by _queueLock
+    std::vector<std::unique_ptr<Chunk>> _chunks;
+    std::vector<Chunk*> _freeChunks;
+    std::deque<Chunk*> _writeQueue;
+    bool _stopWriter;
+    std::string _writeError;
+    RecorderStats _stats;
+    mutable std::mutex _queueLock;
+    std::condition_variable _queueCond;
+
+    // compression, jobs are submitted and committed with _writeLock,
+    // _pendingJobs and _freeJobs are protected by _jobLock
+    std::unique_ptr<ThreadPool> _pool;
+    std::vector<std::unique_ptr<CompressJob>> _jobs;
+    std::vector<CompressJob*> _freeJobs;
+    std::deque<CompressJob*> _pendingJobs;
+    std::mutex _jobLock;
+    // last submitted and last committed job are kept, they may be the reference of the next job
+    CompressJob *_lastJob;
+    CompressJob *_heldJob;
+    uint32_t _sinceKeyframe;
+    bool _forceKeyframe;
+    // a record was dropped after compression, the next records with difference can not be decoded
+    bool _chainBroken;
+
+    // writer thread side
+    std::unique_ptr<IoUring> _ring;
+    uint32_t _inFlight;
+    // chunks submitted to the ring which did not complete yet
+    std::vector<Chunk*> _submitted;
+    std::thread _writerThread;
+};
+
+} // namespace protocol
+} // namespace libspark
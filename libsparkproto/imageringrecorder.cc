@@ -0,0 +1,53 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <libsparkproto/imageringrecorder.h>
+#include <libsparkproto/imageringrecorderimpl.h>
+
+namespace libspark {
+
+namespace protocol {
+
+ImageRingRecorder::ImageRingRecorder(const RingRecorderOptions &options)
+    : _pImpl(new ImageRingRecorderImpl(options)) {
+
+}
+
+ImageRingRecorder::~ImageRingRecorder() {
+
+}
+
+bool ImageRingRecorder::write(const ImageSet &imgSet, uint8_t streamId) {
+    return _pImpl->write(imgSet, streamId);
+}
+
+void ImageRingRecorder::onImageEvent(ImageSet &imgSet) {
+    _pImpl->write(imgSet, 0);
+}
+
+std::shared_ptr<IImageEvent> ImageRingRecorder::streamEvent(uint8_t streamId) {
+    return _pImpl->streamEvent(streamId);
+}
+
+std::string ImageRingRecorder::trigger(const std::string &filename) {
+    return _pImpl->trigger(filename);
+}
+
+void ImageRingRecorder::waitForDumps() {
+    _pImpl->waitForDumps();
+}
+
+RingRecorderStats ImageRingRecorder::stats() const {
+    return _pImpl->stats();
+}
+
+void ImageRingRecorder::triggerAll() {
+    ImageRingRecorderImpl::triggerAll();
+}
+
+void ImageRingRecorder::installSignalHandler(int signum) {
+    ImageRingRecorderImpl::installSignalHandler(signum);
+}
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,165 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <libsparkproto/common.h>
+#include <libsparkproto/iimageevent.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class ImageSet;
+class ImageRingRecorderImpl;
+
+/**
+ * @brief Options of ImageRingRecorder
+ *
+ */
+struct SPARK_API RingRecorderOptions {
+    // size of the ring in bytes, it's allocated once when the recorder is created
+    uint64_t capacity = 512 << 20;
+
+    // maximum number of ImageSet kept in the ring
+    uint32_t maxRecords = 4096;
+
+    // duration in milliseconds before a trigger which is written to the dump
+    uint64_t preTrigger = 10000;
+
+    // duration in milliseconds after a trigger which is written to the dump
+    uint64_t postTrigger = 2000;
+
+    // map the ring to this file instead of anonymous memory, so the last frames survive a crash of the process
+    std::string backingFile;
+
+    // lock the ring in physical memory with mlock
+    bool lockMemory = false;
+
+    // dumps started without a filename are named <dumpPrefix>_<local time>_<dump number>.sparkrec
+    std::string dumpPrefix = "blackbox";
+};
+
+/**
+ * @brief Counters of ImageRingRecorder
+ *
+ */
+struct SPARK_API RingRecorderStats {
+    // ImageSet stored in the ring
+    uint64_t recordCount = 0;
+    // ImageSet dropped since they are larger than the ring or would overwrite frames being dumped
+    uint64_t droppedCount = 0;
+    // ImageSet currently kept in the ring and their size
+    uint64_t ringRecords = 0;
+    uint64_t ringBytes = 0;
+    // dumps written and failed
+    uint64_t dumpCount = 0;
+    uint64_t failedDumpCount = 0;
+};
+
+/**
+ * @brief ImageRingRecorder is a black box recorder. It keeps the last ImageSet of one or more streams
+ * in a ring allocated once, and writes the window around an event to a recording file on trigger.
+ * A dump can be played back with libspark::protocol::ImagePlayback.
+ *
+ * ImageSet are serialized in the format of the recording file when they are written to the ring,
+ * so the steady state does not allocate memory and a dump is a plain copy of the ring to disk.
+ * Frames of a dump are pinned in the ring until they are on disk, ImageSet which would overwrite
+ * them are dropped.
+ *
+ * ImageRingRecorder can be registered to AsyncImageStream directly, frames of other streams are
+ * tagged with a stream id, see streamEvent(). The stream id is stored in the lower 8 bits of
+ * RecordHeader::flags of the dump. All functions are thread-safe.
+ *
+ */
+class SPARK_API ImageRingRecorder : public IImageEvent {
+
+public:
+
+    using Ptr = std::shared_ptr<ImageRingRecorder>;
+
+    /**
+     * @brief Construct a new ImageRingRecorder object, the ring is allocated and the dump thread is started.
+     * If the ring can not be allocated, a exception is thrown, see more exception libspark::protocol::SparkException
+     *
+     * @param options
+     */
+    ImageRingRecorder(const RingRecorderOptions &options = RingRecorderOptions());
+
+    /**
+     * @brief Destroy the ImageRingRecorder object. Pending dumps are finished without waiting for post trigger frames
+     *
+     */
+    virtual ~ImageRingRecorder();
+
+    /**
+     * @brief Copy an ImageSet to the ring, the oldest ImageSet are overwritten.
+     * Return false if the ImageSet is dropped.
+     *
+     * @param imgSet
+     * @param streamId
+     * @return true
+     * @return false
+     */
+    bool write(const ImageSet &imgSet, uint8_t streamId = 0);
+
+    /**
+     * @brief Write an ImageSet with stream id 0, see IImageEvent
+     *
+     * @param imgSet
+     */
+    void onImageEvent(ImageSet &imgSet) override;
+
+    /**
+     * @brief Get a IImageEvent which writes ImageSet with the given stream id, to be registered to
+     * a AsyncImageStream. The event must be unregistered before the recorder is destroyed.
+     *
+     * @param streamId
+     * @return std::shared_ptr<IImageEvent>
+     */
+    std::shared_ptr<IImageEvent> streamEvent(uint8_t streamId);
+
+    /**
+     * @brief Dump the window around now to a file. The dump is written by a background thread,
+     * it's complete after the post trigger duration. Return the name of the file.
+     *
+     * @param filename name of the dump, empty for a name from RingRecorderOptions::dumpPrefix
+     * @return std::string
+     */
+    std::string trigger(const std::string &filename = "");
+
+    /**
+     * @brief Wait until all triggered dumps are written
+     *
+     */
+    void waitForDumps();
+
+    /**
+     * @brief Get counters of the recorder
+     *
+     * @return RingRecorderStats
+     */
+    RingRecorderStats stats() const;
+
+    /**
+     * @brief Trigger a dump on all ImageRingRecorder of the process.
+     * It's async-signal-safe, so it can be called from a signal handler.
+     *
+     */
+    static void triggerAll();
+
+    /**
+     * @brief Install a handler of signal signum which calls triggerAll, e.g. SIGUSR1
+     *
+     * @param signum
+     */
+    static void installSignalHandler(int signum);
+
+private:
+    std::unique_ptr<ImageRingRecorderImpl> _pImpl;
+};
+
+} // namespace protocol
+} // namespace libspark
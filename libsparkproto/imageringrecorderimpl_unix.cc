@@ -0,0 +1,408 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <chrono>
+#include <algorithm>
+
+#include <libsparkproto/imageringrecorderimpl.h>
+#include <libsparkproto/imageset.h>
+#include <libsparkproto/exception.h>
+#include <libsparkproto/log.h>
+
+namespace libspark {
+
+namespace protocol {
+
+// records start at multiples of this alignment in the ring
+static constexpr uint64_t RECORD_ALIGNMENT = 8;
+static constexpr uint64_t NO_PIN = UINT64_MAX;
+// interval the dump thread checks for triggers from triggerAll
+static constexpr int TRIGGER_POLL_MS = 50;
+
+// written by triggerAll, which may run in a signal handler, so only lock-free atomics are used
+static std::atomic<uint32_t> s_triggerGeneration(0);
+static std::atomic<uint64_t> s_triggerTime(0);
+
+static uint64_t steadyTimeNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// forwards ImageSet of an AsyncImageStream with a stream id
+class RingStreamEvent : public IImageEvent {
+
+public:
+    RingStreamEvent(ImageRingRecorderImpl *recorder, uint8_t streamId)
+        : _recorder(recorder), _streamId(streamId) {
+
+    }
+
+    void onImageEvent(ImageSet &imgSet) override {
+        _recorder->write(imgSet, _streamId);
+    }
+
+private:
+    ImageRingRecorderImpl *_recorder;
+    uint8_t _streamId;
+};
+
+ImageRingRecorderImpl::ImageRingRecorderImpl(const RingRecorderOptions &options)
+    : _options(options), _region(nullptr), _backingFd(-1), _oldestSeq(0), _nextSeq(0), _writePos(0),
+      _ringBytes(0), _pinnedSeq(NO_PIN), _dumping(false), _stopDump(false), _dumpId(0) {
+
+    if(_options.capacity == 0 || _options.maxRecords == 0) {
+        throw SparkError("capacity and maxRecords of ring recorder must not be 0");
+    }
+
+    void *region = MAP_FAILED;
+    if(_options.backingFile.empty()) {
+        region = mmap(nullptr, _options.capacity, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    }
+    else {
+        _backingFd = ::open(_options.backingFile.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if(_backingFd < 0) {
+            throw SparkError("can not create " + _options.backingFile + ": " + std::string(strerror(errno)));
+        }
+        if(ftruncate(_backingFd, _options.capacity) == 0) {
+            region = mmap(nullptr, _options.capacity, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, _backingFd, 0);
+        }
+    }
+
+    if(region == MAP_FAILED) {
+        std::string error = strerror(errno);
+        if(_backingFd >= 0) {
+            ::close(_backingFd);
+        }
+        throw SparkError("can not allocate ring of " + std::to_string(_options.capacity) + " bytes: " + error);
+    }
+    _region = (char*)region;
+
+    if(_options.lockMemory && mlock(_region, _options.capacity) != 0) {
+        LOG_WARNING("can not lock ring in memory: %s", strerror(errno));
+    }
+
+    _slots.resize(_options.maxRecords);
+    _triggerGeneration = s_triggerGeneration.load();
+
+    _dumpThread = std::thread(&ImageRingRecorderImpl::dumpLoop, this);
+}
+
+ImageRingRecorderImpl::~ImageRingRecorderImpl() {
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _stopDump = true;
+        _dumpCond.notify_all();
+        _recordCond.notify_all();
+    }
+
+    if(_dumpThread.joinable()) {
+        _dumpThread.join();
+    }
+
+    munmap(_region, _options.capacity);
+    if(_backingFd >= 0) {
+        ::close(_backingFd);
+    }
+}
+
+bool ImageRingRecorderImpl::write(const ImageSet &imgSet, uint8_t streamId) {
+
+    const ImageSetMeta &meta = imgSet.meta();
+    // the size of a message beyond 2 GB is not a valid int
+    int byteSize = meta.ByteSize();
+    if(byteSize < 0) {
+        throw SparkError("ImageSetMeta is too large for a record");
+    }
+    uint32_t metaSize = uint32_t(byteSize);
+    uint64_t receiveTimestamp = imgSet.receiveTimestamp() ? imgSet.receiveTimestamp() : steadyTimeNs();
+
+    recording::RecordHeader header = recording::makeRecordHeader(meta, metaSize, receiveTimestamp);
+    header.flags = streamId & recording::RECORD_FLAG_STREAM_MASK;
+    uint64_t size = recording::recordSize(header);
+
+    for(uint32_t i = 0; i < recording::PLANE_COUNT; i++) {
+        if(imgSet.getBuffer(ImageSet::BufferID(i)).size() < header.planeSize[i]) {
+            throw SparkError("size of buffer does not match ImageSetMeta");
+        }
+    }
+
+    // reserve the space under the lock, the copy runs unlocked so several streams can write at the same time
+    uint64_t seq;
+    uint64_t offset;
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        if(!reserve(size, offset)) {
+            _stats.droppedCount++;
+            return false;
+        }
+
+        seq = _nextSeq++;
+        Slot &s = slot(seq);
+        s.offset = offset;
+        s.size = size;
+        s.receiveTimestamp = receiveTimestamp;
+        s.timestamp = recording::metaTimestamp(meta);
+        s.committed = false;
+        _ringBytes += size;
+    }
+
+    char *dst = _region + offset;
+    memcpy(dst, &header, sizeof(header));
+    dst += sizeof(header);
+    meta.SerializeToArray(dst, metaSize);
+    dst += metaSize;
+    for(uint32_t i = 0; i < recording::PLANE_COUNT; i++) {
+        if(header.planeSize[i] > 0) {
+            memcpy(dst, imgSet.getBuffer(ImageSet::BufferID(i)).data(), header.planeSize[i]);
+            dst += header.planeSize[i];
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_lock);
+    slot(seq).committed = true;
+    _stats.recordCount++;
+    if(_dumping) {
+        _recordCond.notify_all();
+    }
+    if(s_triggerGeneration.load(std::memory_order_relaxed) != _triggerGeneration) {
+        _dumpCond.notify_all();
+    }
+
+    return true;
+}
+
+std::shared_ptr<IImageEvent> ImageRingRecorderImpl::streamEvent(uint8_t streamId) {
+    return std::make_shared<RingStreamEvent>(this, streamId);
+}
+
+std::string ImageRingRecorderImpl::trigger(const std::string &filename) {
+    std::lock_guard<std::mutex> lock(_lock);
+
+    DumpRequest request;
+    request.filename = filename.empty() ? dumpFilename() : filename;
+    request.time = steadyTimeNs();
+    _dumpQueue.push_back(request);
+    _dumpCond.notify_all();
+
+    return request.filename;
+}
+
+void ImageRingRecorderImpl::waitForDumps() {
+    std::unique_lock<std::mutex> lock(_lock);
+    _dumpCond.wait(lock, [&]() {
+        return (_dumpQueue.empty() && !_dumping &&
+            s_triggerGeneration.load() == _triggerGeneration) || _stopDump;
+    });
+}
+
+RingRecorderStats ImageRingRecorderImpl::stats() const {
+    std::lock_guard<std::mutex> lock(_lock);
+    RingRecorderStats stats = _stats;
+    stats.ringRecords = _nextSeq - _oldestSeq;
+    stats.ringBytes = _ringBytes;
+    return stats;
+}
+
+void ImageRingRecorderImpl::triggerAll() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    s_triggerTime.store((uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec);
+    s_triggerGeneration.fetch_add(1);
+}
+
+static void onTriggerSignal(int signum) {
+    (void) signum;
+    ImageRingRecorderImpl::triggerAll();
+}
+
+void ImageRingRecorderImpl::installSignalHandler(int signum) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onTriggerSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    if(sigaction(signum, &action, nullptr) != 0) {
+        throw SparkError("can not install handler of signal " + std::to_string(signum) + ": " + std::string(strerror(errno)));
+    }
+}
+
+bool ImageRingRecorderImpl::reserve(uint64_t size, uint64_t &offset) {
+    uint64_t alignedSize = (size + RECORD_ALIGNMENT - 1) / RECORD_ALIGNMENT * RECORD_ALIGNMENT;
+    if(alignedSize > _options.capacity) {
+        return false;
+    }
+
+    uint64_t pos = _writePos;
+    uint64_t evictEnd = _oldestSeq;
+
+    // records behind the write position are the oldest, they are evicted when the ring wraps
+    if(pos + alignedSize > _options.capacity) {
+        while(evictEnd < _nextSeq && slot(evictEnd).offset >= pos) {
+            evictEnd++;
+        }
+        pos = 0;
+    }
+    while(evictEnd < _nextSeq && slot(evictEnd).offset >= pos && slot(evictEnd).offset < pos + alignedSize) {
+        evictEnd++;
+    }
+    if(_nextSeq - evictEnd >= _options.maxRecords) {
+        evictEnd = _nextSeq + 1 - _options.maxRecords;
+    }
+
+    if(evictEnd > _pinnedSeq) {
+        return false;
+    }
+    for(uint64_t seq = _oldestSeq; seq < evictEnd; seq++) {
+        if(!slot(seq).committed) {
+            return false;
+        }
+    }
+
+    for(; _oldestSeq < evictEnd; _oldestSeq++) {
+        _ringBytes -= slot(_oldestSeq).size;
+    }
+    offset = pos;
+    _writePos = pos + alignedSize;
+
+    return true;
+}
+
+ImageRingRecorderImpl::Slot& ImageRingRecorderImpl::slot(uint64_t seq) {
+    return _slots[seq % _options.maxRecords];
+}
+
+std::string ImageRingRecorderImpl::dumpFilename() {
+    time_t now = time(nullptr);
+    tm localTime;
+    localtime_r(&now, &localTime);
+    char timeStr[32];
+    strftime(timeStr, sizeof(timeStr), "%Y%m%d_%H%M%S", &localTime);
+
+    return _options.dumpPrefix + "_" + timeStr + "_" + std::to_string(_dumpId++) + recording::FILE_EXTENSION;
+}
+
+void ImageRingRecorderImpl::dumpLoop() {
+    std::unique_lock<std::mutex> lock(_lock);
+
+    while(true) {
+        _dumpCond.wait_for(lock, std::chrono::milliseconds(TRIGGER_POLL_MS), [&]() {
+            return _stopDump || !_dumpQueue.empty() || s_triggerGeneration.load() != _triggerGeneration;
+        });
+
+        uint32_t generation = s_triggerGeneration.load();
+        if(generation != _triggerGeneration) {
+            _triggerGeneration = generation;
+            _dumpQueue.push_back({dumpFilename(), s_triggerTime.load()});
+        }
+
+        if(_dumpQueue.empty()) {
+            if(_stopDump) {
+                break;
+            }
+            continue;
+        }
+
+        DumpRequest request = _dumpQueue.front();
+        _dumpQueue.pop_front();
+        _dumping = true;
+
+        lock.unlock();
+        dump(request);
+        lock.lock();
+
+        _dumping = false;
+        _dumpCond.notify_all();
+    }
+}
+
+void ImageRingRecorderImpl::dump(const DumpRequest &request) {
+    uint64_t windowBegin = request.time - std::min(request.time, _options.preTrigger * 1000000);
+    uint64_t windowEnd = request.time + _options.postTrigger * 1000000;
+    auto deadline = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(windowEnd));
+
+    {
+        // pin the records of the window, from the first one received after the beginning
+        std::lock_guard<std::mutex> lock(_lock);
+        uint64_t seq = _oldestSeq;
+        while(seq < _nextSeq && slot(seq).receiveTimestamp < windowBegin) {
+            seq++;
+        }
+        _pinnedSeq = seq;
+    }
+
+    int fd = ::open(request.filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool success = fd >= 0;
+    if(!success) {
+        LOG_ERROR("can not create dump %s: %s", request.filename.c_str(), strerror(errno));
+    }
+
+    try {
+        recording::Index index;
+        uint64_t offset = 0;
+        if(success) {
+            recording::FileHeader fileHeader = recording::makeFileHeader();
+            recording::pwriteFixed(fd, &fileHeader, sizeof(fileHeader), 0);
+            offset = sizeof(fileHeader);
+        }
+
+        while(success) {
+            Slot record;
+            {
+                // records before the trigger are in the ring already, the later ones are waited until the deadline
+                std::unique_lock<std::mutex> lock(_lock);
+                bool available = _recordCond.wait_until(lock, deadline, [&]() {
+                    return (_pinnedSeq < _nextSeq && slot(_pinnedSeq).committed) || _stopDump;
+                });
+                if(!available || !(_pinnedSeq < _nextSeq && slot(_pinnedSeq).committed)) {
+                    break;
+                }
+                record = slot(_pinnedSeq);
+            }
+
+            if(record.receiveTimestamp > windowEnd) {
+                break;
+            }
+
+            // the record is pinned, so it's read from the ring without the lock
+            recording::pwriteFixed(fd, _region + record.offset, record.size, offset);
+            index.push_back({record.timestamp, record.receiveTimestamp, offset});
+            offset += record.size;
+
+            std::lock_guard<std::mutex> lock(_lock);
+            _pinnedSeq++;
+        }
+
+        if(success) {
+            recording::writeIndex(fd, offset, index);
+            LOG_INFO("dumped %lu ImageSet to %s", index.size(), request.filename.c_str());
+        }
+    } catch (SparkException &e) {
+        LOG_ERROR("failed writing dump %s: %s", request.filename.c_str(), e.what());
+        success = false;
+    }
+
+    if(fd >= 0) {
+        ::close(fd);
+    }
+
+    std::lock_guard<std::mutex> lock(_lock);
+    _pinnedSeq = NO_PIN;
+    if(success) {
+        _stats.dumpCount++;
+    }
+    else {
+        _stats.failedDumpCount++;
+    }
+}
+
+} // namespace protocol
+} // namespace libspark
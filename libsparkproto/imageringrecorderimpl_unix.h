@@ -0,0 +1,145 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <libsparkproto/imageringrecorder.h>
+#include <libsparkproto/recordingformat.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class ImageSet;
+class ImageRingRecorderImpl {
+
+public:
+    /**
+     * @brief Construct a new ImageRingRecorderImpl object
+     *
+     * @param options
+     */
+    ImageRingRecorderImpl(const RingRecorderOptions &options);
+
+    /**
+     * @brief Destroy the ImageRingRecorderImpl object
+     *
+     */
+    virtual ~ImageRingRecorderImpl();
+
+    /**
+     * @brief Copy an ImageSet to the ring
+     *
+     * @param imgSet
+     * @param streamId
+     * @return true
+     * @return false
+     */
+    bool write(const ImageSet &imgSet, uint8_t streamId);
+
+    /**
+     * @brief Get a IImageEvent which writes ImageSet with the given stream id
+     *
+     * @param streamId
+     * @return std::shared_ptr<IImageEvent>
+     */
+    std::shared_ptr<IImageEvent> streamEvent(uint8_t streamId);
+
+    /**
+     * @brief Queue a dump of the window around now
+     *
+     * @param filename
+     * @return std::string
+     */
+    std::string trigger(const std::string &filename);
+
+    /**
+     * @brief Wait until all queued dumps are written
+     *
+     */
+    void waitForDumps();
+
+    /**
+     * @brief Get counters of the recorder
+     *
+     * @return RingRecorderStats
+     */
+    RingRecorderStats stats() const;
+
+    static void triggerAll();
+
+    static void installSignalHandler(int signum);
+
+private:
+    // a record in the ring, slots are indexed by sequence number modulo maxRecords
+    struct Slot {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint64_t receiveTimestamp = 0;
+        int64_t timestamp = 0;
+        // false while the caller of write is copying the record
+        bool committed = false;
+    };
+
+    struct DumpRequest {
+        std::string filename;
+        // steady clock time of the trigger in nanoseconds
+        uint64_t time;
+    };
+
+    /**
+     * @brief Reserve space for a record and evict the oldest records overlapping it.
+     * Return false if a evicted record is pinned or not committed yet.
+     *
+     * @param size
+     * @param offset
+     * @return true
+     * @return false
+     */
+    bool reserve(uint64_t size, uint64_t &offset);
+
+    Slot& slot(uint64_t seq);
+
+    std::string dumpFilename();
+
+    void dumpLoop();
+
+    void dump(const DumpRequest &request);
+
+    RingRecorderOptions _options;
+
+    // the ring, allocated once with mmap
+    char *_region;
+    int _backingFd;
+
+    // protected by _lock
+    std::vector<Slot> _slots;
+    uint64_t _oldestSeq;
+    uint64_t _nextSeq;
+    uint64_t _writePos;
+    uint64_t _ringBytes;
+    // records from _pinnedSeq are being dumped and must not be overwritten
+    uint64_t _pinnedSeq;
+    std::deque<DumpRequest> _dumpQueue;
+    bool _dumping;
+    bool _stopDump;
+    uint64_t _dumpId;
+    RingRecorderStats _stats;
+    mutable std::mutex _lock;
+    std::condition_variable _recordCond;
+    std::condition_variable _dumpCond;
+
+    uint32_t _triggerGeneration;
+    std::thread _dumpThread;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -2,32 +2,67 @@
 // SPDX-License-Identifier: BSD 3-Clause
 
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <libsparkproto/imageset.h>
+#include <libsparkproto/exception.h>
+#include <libsparkproto/pixelconvert.h>
+#include <libsparkproto/pixelkernels.h>
 
 namespace libspark {
 
 namespace protocol {
 
-ImageSet::ImageSet() : _meta(new ImageSetMeta()){
+struct ImageSet::ViewCache {
+    // a view is computed under the lock of its slot, so other views are not blocked meanwhile
+    struct Slot {
+        std::mutex lock;
+        std::shared_ptr<const ImageView> view;
+    };
+
+    std::mutex lock;
+    std::map<uint64_t, std::shared_ptr<Slot>> slots;
+    std::shared_ptr<const ImageStats> stats[ImageSet::BUFFER_ID_MAX + 1];
+};
+
+static uint64_t viewKey(ImageSet::BufferID id, PixelFormat format, uint32_t scale) {
+    return uint64_t(id) | (uint64_t(format) << 8) | (uint64_t(scale) << 16);
+}
+
+// 8-bit format with the channels of format
+static PixelFormat baseFormatOf(PixelFormat format) {
+    switch (format)
+    {
+    case PIXEL_GRAY16:
+    case PIXEL_GRAY32F: return PIXEL_GRAY8;
+    case PIXEL_RGB16:
+    case PIXEL_RGB32F: return PIXEL_RGB8;
+    default: return format;
+    }
+}
+
+ImageSet::ImageSet() : _meta(new ImageSetMeta()), _receiveTimestamp(0), _views(new ViewCache()) {
     _bufferSet.resize((uint32_t)ImageSet::BufferID::BUFFER_ID_MAX + 1);
 }
 
-ImageSet::ImageSet(std::unique_ptr<ImageSetMeta> meta) : _meta(std::move(meta)){
+ImageSet::ImageSet(std::unique_ptr<ImageSetMeta> meta) : _meta(std::move(meta)), _receiveTimestamp(0), _views(new ViewCache()) {
     _bufferSet.resize((uint32_t)ImageSet::BufferID::BUFFER_ID_MAX + 1);
 }
 
-ImageSet::ImageSet(const ImageSet& rhs) {
+ImageSet::ImageSet(const ImageSet& rhs) : _receiveTimestamp(rhs._receiveTimestamp), _views(new ViewCache()) {
     _bufferSet = rhs._bufferSet;
     _meta = std::make_unique<ImageSetMeta>();
     *_meta.get() = *rhs._meta.get();
 }
 
-ImageSet::ImageSet(ImageSet&& rhs) {
+ImageSet::ImageSet(ImageSet&& rhs) : _receiveTimestamp(rhs._receiveTimestamp), _views(new ViewCache()) {
     _bufferSet = std::move(rhs._bufferSet);
     _meta = std::move(rhs._meta);
+    // views move with the buffers
+    _views.swap(rhs._views);
 }
 
-ImageSet::ImageSet(const ImageSet *rhs) {
+ImageSet::ImageSet(const ImageSet *rhs) : _receiveTimestamp(rhs->_receiveTimestamp), _views(new ViewCache()) {
     _bufferSet = rhs->_bufferSet;
     _meta = std::make_unique<ImageSetMeta>();
     *_meta.get() = *rhs->_meta.get();
@@ -35,8 +70,10 @@ ImageSet::ImageSet(const ImageSet *rhs) {
 
 const ImageSet& ImageSet::operator=(const ImageSet& rhs) {
     _bufferSet = rhs._bufferSet;
+    _receiveTimestamp = rhs._receiveTimestamp;
     _meta = std::make_unique<ImageSetMeta>();
     *_meta.get() = *rhs._meta.get();
+    clearViews();
 
     return *this;
 }
@@ -58,6 +95,7 @@ ImageSet::Buffer& ImageSet::getMutableBuffer(BufferID id) {
         return _nullBuffer;
     }
 
+    clearViews();
     return _bufferSet[(uint32_t)id];
 }
 
@@ -66,6 +104,7 @@ ImageSet::Buffer ImageSet::getMovedBuffer(BufferID id) {
         return _nullBuffer;
     }
 
+    clearViews();
     return std::move(_bufferSet[(uint32_t)id]);
 }
 
@@ -111,11 +150,108 @@ uint64_t ImageSet::imageTimestamp() const {
 
 void ImageSet::setAllocatedMeta(std::unique_ptr<ImageSetMeta> meta) {
     _meta.swap(meta);
+    clearViews();
 }
 
 void ImageSet::printDebugString() const {
     _meta->PrintDebugString();
 }
 
+std::shared_ptr<const ImageView> ImageSet::view(BufferID id, PixelFormat format, uint32_t scale) const {
+    if(scale == 0) {
+        throw SparkError("scale of a view must be at least 1");
+    }
+
+    std::shared_ptr<ViewCache::Slot> slot;
+    {
+        std::lock_guard<std::mutex> lock(_views->lock);
+        std::shared_ptr<ViewCache::Slot> &entry = _views->slots[viewKey(id, format, scale)];
+        if(!entry) {
+            entry = std::make_shared<ViewCache::Slot>();
+        }
+        slot = entry;
+    }
+
+    std::lock_guard<std::mutex> lock(slot->lock);
+    if(!slot->view) {
+        // if it throws, the slot stays empty and the next request tries again
+        slot->view = makeView(id, format, scale);
+    }
+    return slot->view;
+}
+
+void ImageSet::clearViews() {
+    if(!_views) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(_views->lock);
+    _views->slots.clear();
+    for(std::shared_ptr<const ImageStats> &stats : _views->stats) {
+        stats.reset();
+    }
+}
+
+std::shared_ptr<const ImageStats> ImageSet::stats(BufferID id) const {
+    if((uint32_t)id > BUFFER_ID_MAX) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(_views->lock);
+    return _views->stats[id];
+}
+
+void ImageSet::setStats(BufferID id, std::shared_ptr<const ImageStats> stats) {
+    if((uint32_t)id > BUFFER_ID_MAX) {
+        throw SparkError("invalid buffer id " + std::to_string(id));
+    }
+    std::lock_guard<std::mutex> lock(_views->lock);
+    _views->stats[id] = std::move(stats);
+}
+
+std::shared_ptr<const ImageView> ImageSet::makeView(BufferID id, PixelFormat format, uint32_t scale) const {
+    if((id != BUFFER_LEFT || !hasLeft()) && (id != BUFFER_RIGHT || !hasRight())) {
+        throw SparkError("a view can be made of the left or right image only, and it must be in the ImageSet");
+    }
+
+    const ImageMeta &meta = id == BUFFER_LEFT ? _meta->left() : _meta->right();
+    PixelFormat srcFormat = pixelFormatOf(meta.format());
+    PixelFormat baseFormat = baseFormatOf(format);
+    if(!isConversionSupported(srcFormat, baseFormat) || (baseFormat != format && !isConversionSupported(baseFormat, format))) {
+        throw SparkError("image of format " + std::to_string(meta.format()) + " has no view of pixel format " + std::to_string(format));
+    }
+    if(meta.width() < int32_t(scale) || meta.height() < int32_t(scale)) {
+        throw SparkError("scale of a view is larger than the image");
+    }
+
+    std::shared_ptr<ImageView> view = std::make_shared<ImageView>();
+    view->id = id;
+    view->format = format;
+    view->scale = scale;
+    view->width = meta.width() / scale;
+    view->height = meta.height() / scale;
+    view->stride = size_t(view->width) * pixelSize(format);
+    view->data.resize(imageSize(format, view->width, view->height));
+
+    // views of other formats are converted from the view of the source format at the same scale,
+    // or of the 8-bit format of the same channels, which are cached too
+    PixelFormat viaFormat = srcFormat != baseFormat && baseFormat != format ? baseFormat : srcFormat;
+    if(format != viaFormat && (scale > 1 || viaFormat != srcFormat)) {
+        std::shared_ptr<const ImageView> via = this->view(id, viaFormat, scale);
+        convertPixels(via->data.data(), via->stride, viaFormat, view->data.data(), view->stride, format, view->width, view->height);
+        return view;
+    }
+
+    const Buffer &buff = getBuffer(id);
+    if(buff.size() < imageSize(srcFormat, meta.width(), meta.height())) {
+        throw SparkError("buffer of the image is smaller than its size in ImageMeta");
+    }
+    if(scale > 1) {
+        pixel::downscale(buff.data(), imageSize(srcFormat, meta.width(), 1), pixelSize(srcFormat), scale,
+            view->data.data(), view->stride, view->width, view->height);
+    } else {
+        convertPixels(buff.data(), 0, srcFormat, view->data.data(), view->stride, format, view->width, view->height);
+    }
+    return view;
+}
+
 } // namespace protocol
 } // namespace libspark
@@ -3,14 +3,19 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 #include <libsparkproto/common.h>
 #include <libsparkproto/image.pb.h>
+#include <libsparkproto/pixelformat.h>
 
 namespace libspark {
 
 namespace protocol {
 
+struct ImageView;
+struct ImageStats;
+
 class SPARK_API ImageSet {
 
 public:
@@ -156,6 +161,21 @@ public:
      */
     uint64_t imageTimestamp() const;
 
+    /**
+     * @brief Get host time when the ImageSet was received, in nanoseconds of a monotonic clock.
+     * It's zero if the ImageSet was not received from a stream.
+     * 
+     * @return uint64_t 
+     */
+    uint64_t receiveTimestamp() const;
+
+    /**
+     * @brief Internal using
+     * 
+     * @param timestamp 
+     */
+    void setReceiveTimestamp(uint64_t timestamp);
+
     /**
      * @brief Metadata of ImageSet. Can get full information of image in meta object. See more ImageSetMeta
      * 
@@ -176,10 +196,68 @@ public:
      */
     void printDebugString() const;
 
+    /**
+     * @brief Get the left or right image converted to format and downscaled by scale, e.g. a half resolution gray image.
+     * A view is computed on its first request and cached with the ImageSet, so consumers of the same ImageSet
+     * share the work. It's thread-safe, a view requested by several threads at once is computed once.
+     * Cached views are released with the ImageSet, or when its buffers or meta are changed.
+     * If the image can not be converted to format, a exception is thrown, see libspark::protocol::isConversionSupported()
+     * 
+     * @param id left or right image
+     * @param format 
+     * @param scale downscale factor, each pixel is the average of scale x scale pixels
+     * @return std::shared_ptr<const ImageView> 
+     */
+    std::shared_ptr<const ImageView> view(BufferID id, PixelFormat format, uint32_t scale = 1) const;
+
+    /**
+     * @brief Release cached views
+     * 
+     */
+    void clearViews();
+
+    /**
+     * @brief Get statistics of the image id attached by ImageStreamProtocol::enableStatistics() or ImageStatistics::compute(),
+     * nullptr if there are none. Statistics are released like views when the buffers or meta are changed
+     * 
+     * @param id 
+     * @return std::shared_ptr<const ImageStats> 
+     */
+    std::shared_ptr<const ImageStats> stats(BufferID id) const;
+
+    /**
+     * @brief Attach statistics of the image id
+     * 
+     * @param id 
+     * @param stats 
+     */
+    void setStats(BufferID id, std::shared_ptr<const ImageStats> stats);
+
 private:
+    struct ViewCache;
+
+    std::shared_ptr<const ImageView> makeView(BufferID id, PixelFormat format, uint32_t scale) const;
+
     std::unique_ptr<ImageSetMeta> _meta;
     std::vector<Buffer> _bufferSet;
     Buffer _nullBuffer;
+    uint64_t _receiveTimestamp;
+    std::unique_ptr<ViewCache> _views;
+};
+
+/**
+ * @brief An image derived from a plane of ImageSet, see ImageSet::view()
+ * 
+ */
+struct SPARK_API ImageView {
+    ImageSet::BufferID id;
+    PixelFormat format;
+    uint32_t scale;
+    uint32_t width;
+    uint32_t height;
+    // bytes between rows, planes of PIXEL_RGB8_PLANAR are height * stride bytes apart
+    size_t stride;
+    std::vector<u_char> data;
 };
 
 inline bool ImageSet::hasLeft() const {
@@ -202,5 +280,13 @@ inline const ImageSetMeta& ImageSet::meta() const {
     return *_meta.get();
 }
 
+inline uint64_t ImageSet::receiveTimestamp() const {
+    return _receiveTimestamp;
+}
+
+inline void ImageSet::setReceiveTimestamp(uint64_t timestamp) {
+    _receiveTimestamp = timestamp;
+}
+
 } // namespace protocol
 } // namespace libspark
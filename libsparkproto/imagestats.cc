@@ -0,0 +1,35 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <libsparkproto/imagestats.h>
+#include <libsparkproto/imagestatsimpl.h>
+
+namespace libspark {
+
+namespace protocol {
+
+ImageStatistics::ImageStatistics(const StatsOptions &options)
+    : _pImpl(new ImageStatisticsImpl(options)) {
+
+}
+
+ImageStatistics::~ImageStatistics() {
+
+}
+
+const StatsOptions& ImageStatistics::options() const {
+    return _pImpl->options();
+}
+
+void ImageStatistics::compute(const uint8_t *src, size_t srcStride, PixelFormat format, uint32_t width, uint32_t height,
+    ImageStats &stats) {
+
+    _pImpl->compute(src, srcStride, format, width, height, stats);
+}
+
+std::shared_ptr<const ImageStats> ImageStatistics::compute(ImageSet &imgSet, ImageSet::BufferID id) {
+    return _pImpl->compute(imgSet, id);
+}
+
+} // namespace protocol
+} // namespace libspark
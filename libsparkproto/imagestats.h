@@ -0,0 +1,134 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <libsparkproto/common.h>
+#include <libsparkproto/imageset.h>
+#include <libsparkproto/pixelformat.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class ImageStatisticsImpl;
+
+/**
+ * @brief Options of ImageStatistics, which pixels are sampled and what counts as clipped
+ *
+ */
+struct SPARK_API StatsOptions {
+    // every step-th pixel of every step-th row is sampled, 1 for all pixels
+    uint32_t step = 1;
+
+    // region of interest, width or height 0 for the whole image. It is clipped to the image
+    uint32_t roiX = 0;
+    uint32_t roiY = 0;
+    uint32_t roiWidth = 0;
+    uint32_t roiHeight = 0;
+
+    // values up to clipLow are clipped dark, from clipHigh up saturated
+    uint8_t clipLow = 0;
+    uint8_t clipHigh = 255;
+
+    // number of threads ImageStatistics::compute() splits an image across in bands of rows,
+    // 0 for the number of CPU cores, 1 to run in the calling thread
+    uint32_t threads = 0;
+};
+
+/**
+ * @brief Statistics of a channel of 8-bit values
+ *
+ */
+struct SPARK_API ChannelStats {
+    // number of samples of each value
+    uint32_t histogram[256];
+    double mean;
+    // variance of the samples, not of the population they are sampled of
+    double variance;
+    uint8_t min;
+    uint8_t max;
+    // fraction of samples up to StatsOptions::clipLow and from StatsOptions::clipHigh up
+    float clippedLow;
+    float clippedHigh;
+};
+
+/**
+ * @brief Statistics of an image, per channel in the order of the pixels, e.g. red, green and blue for PIXEL_RGB8
+ *
+ */
+struct SPARK_API ImageStats {
+    ImageSet::BufferID id;
+    PixelFormat format;
+    // 1 for gray, 3 for color images
+    uint32_t channels;
+    // sampled pixels
+    uint64_t samples;
+    ChannelStats channel[3];
+};
+
+/**
+ * @brief ImageStatistics computes histograms, mean, variance and clipping of the channels of 8-bit images,
+ * e.g. for exposure monitoring. Pixels of a region of interest are sampled, subsampled by a step, and counted to
+ * replicated histograms in bands of rows across threads. Mean, variance and clipping are derived from the histograms
+ * exactly, so each pixel is read once and counted once.
+ *
+ * To compute statistics of images as they are received, without another pass over them,
+ * see ImageStreamProtocol::enableStatistics(). Statistics are attached to the ImageSet, see ImageSet::stats().
+ *
+ * An ImageStatistics keeps scratch histograms between images, it's not thread-safe. Use one per thread.
+ *
+ */
+class SPARK_API ImageStatistics {
+
+public:
+    /**
+     * @brief Construct a new ImageStatistics object. If options are invalid, a exception is thrown
+     *
+     * @param options
+     */
+    explicit ImageStatistics(const StatsOptions &options = StatsOptions());
+
+    /**
+     * @brief Destroy the ImageStatistics object
+     *
+     */
+    virtual ~ImageStatistics();
+
+    /**
+     * @brief Options of the statistics
+     *
+     * @return const StatsOptions&
+     */
+    const StatsOptions& options() const;
+
+    /**
+     * @brief Compute statistics of an image. If the format is not PIXEL_RGB8, PIXEL_BGR8 or PIXEL_GRAY8,
+     * a exception is thrown
+     *
+     * @param src
+     * @param srcStride bytes between rows of src, 0 for no padding
+     * @param format
+     * @param width
+     * @param height
+     * @param stats
+     */
+    void compute(const uint8_t *src, size_t srcStride, PixelFormat format, uint32_t width, uint32_t height, ImageStats &stats);
+
+    /**
+     * @brief Compute statistics of the image id of imgSet and attach them to imgSet, see ImageSet::stats().
+     * If imgSet has no such image of 8-bit pixels, a exception is thrown
+     *
+     * @param imgSet
+     * @param id left or right image
+     * @return std::shared_ptr<const ImageStats>
+     */
+    std::shared_ptr<const ImageStats> compute(ImageSet &imgSet, ImageSet::BufferID id);
+
+private:
+    std::unique_ptr<ImageStatisticsImpl> _pImpl;
+};
+
+} // namespace protocol
+} // namespace libspark
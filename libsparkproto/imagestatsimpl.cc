@@ -0,0 +1,260 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <string.h>
+#include <algorithm>
+#include <thread>
+
+#include <libsparkproto/imagestatsimpl.h>
+#include <libsparkproto/pixelconvert.h>
+#include <libsparkproto/exception.h>
+
+namespace libspark {
+
+namespace protocol {
+
+// consecutive samples are counted to separate copies of the histograms, so increments of the same value
+// don't wait for each other. Counting is bound by these increments, SIMD has no gather-increment to speed it up
+static constexpr uint32_t HISTOGRAM_COPIES = 4;
+static constexpr uint32_t COUNTS_SIZE = HISTOGRAM_COPIES * 3 * 256;
+// sampled rows of the smallest band
+static constexpr uint32_t MIN_BAND_ROWS = 16;
+
+// gray pixels without subsampling, 8 at a time
+static void countGray(const uint8_t *p, uint32_t columns, uint32_t *counts) {
+    uint32_t x = 0;
+    for(; x + 8 <= columns; x += 8) {
+        uint64_t v;
+        memcpy(&v, p + x, 8);
+        counts[0 * 256 + (v & 0xff)]++;
+        counts[1 * 256 + ((v >> 8) & 0xff)]++;
+        counts[2 * 256 + ((v >> 16) & 0xff)]++;
+        counts[3 * 256 + ((v >> 24) & 0xff)]++;
+        counts[0 * 256 + ((v >> 32) & 0xff)]++;
+        counts[1 * 256 + ((v >> 40) & 0xff)]++;
+        counts[2 * 256 + ((v >> 48) & 0xff)]++;
+        counts[3 * 256 + (v >> 56)]++;
+    }
+    for(; x < columns; x++) {
+        counts[p[x]]++;
+    }
+}
+
+template<uint32_t CHANNELS>
+static void countPixels(const uint8_t *p, uint32_t columns, size_t pixelStep, uint32_t *counts) {
+    uint32_t *copies[HISTOGRAM_COPIES];
+    for(uint32_t i = 0; i < HISTOGRAM_COPIES; i++) {
+        copies[i] = counts + i * CHANNELS * 256;
+    }
+    uint32_t x = 0;
+    for(; x + HISTOGRAM_COPIES <= columns; x += HISTOGRAM_COPIES) {
+        for(uint32_t i = 0; i < HISTOGRAM_COPIES; i++) {
+            for(uint32_t c = 0; c < CHANNELS; c++) {
+                copies[i][c * 256 + p[c]]++;
+            }
+            p += pixelStep;
+        }
+    }
+    for(; x < columns; x++) {
+        for(uint32_t c = 0; c < CHANNELS; c++) {
+            copies[0][c * 256 + p[c]]++;
+        }
+        p += pixelStep;
+    }
+}
+
+ImageStatisticsImpl::ImageStatisticsImpl(const StatsOptions &options) : _options(options) {
+    if(!options.step) {
+        throw SparkError("step of sampling must be at least 1");
+    }
+    if(options.clipLow >= options.clipHigh) {
+        throw SparkError("clipLow must be below clipHigh");
+    }
+
+    uint32_t threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+    if(threads > 1) {
+        _pool.reset(new ThreadPool(threads));
+    }
+    _counts.resize(1);
+    _counts[0].resize(COUNTS_SIZE);
+    _region = regionOf(PIXEL_GRAY8, 0, 0);
+}
+
+ImageStatisticsImpl::~ImageStatisticsImpl() {
+
+}
+
+const StatsOptions& ImageStatisticsImpl::options() const {
+    return _options;
+}
+
+void ImageStatisticsImpl::compute(const uint8_t *src, size_t srcStride, PixelFormat format, uint32_t width, uint32_t height,
+    ImageStats &stats) {
+
+    if(format != PIXEL_RGB8 && format != PIXEL_BGR8 && format != PIXEL_GRAY8) {
+        throw SparkError("statistics of pixel format " + std::to_string(format) + " are not supported");
+    }
+    if(!srcStride) {
+        srcStride = size_t(width) * pixelSize(format);
+    }
+
+    Region region = regionOf(format, width, height);
+    uint32_t sampledRows = (region.y1 - region.y0 + _options.step - 1) / _options.step;
+    uint32_t bands = 1;
+    if(_pool) {
+        bands = std::max(1u, std::min(_pool->threadCount(), sampledRows / MIN_BAND_ROWS));
+    }
+    if(_counts.size() < bands) {
+        _counts.resize(bands);
+    }
+
+    auto run = [&](uint32_t begin, uint32_t end) {
+        for(uint32_t i = begin; i < end; i++) {
+            // bands start at sampled rows
+            uint32_t y0 = region.y0 + uint32_t(uint64_t(sampledRows) * i / bands) * _options.step;
+            uint32_t y1 = std::min(region.y1, region.y0 + uint32_t(uint64_t(sampledRows) * (i + 1) / bands) * _options.step);
+            _counts[i].assign(COUNTS_SIZE, 0);
+            countRows(region, src + y0 * srcStride, srcStride, y0, y1, _counts[i].data());
+        }
+    };
+    if(_pool && bands > 1) {
+        _pool->parallelFor(bands, 1, run);
+    } else {
+        run(0, bands);
+    }
+
+    summarize(region, bands, stats);
+}
+
+std::shared_ptr<const ImageStats> ImageStatisticsImpl::compute(ImageSet &imgSet, ImageSet::BufferID id) {
+    if((id != ImageSet::BUFFER_LEFT || !imgSet.hasLeft()) && (id != ImageSet::BUFFER_RIGHT || !imgSet.hasRight())) {
+        throw SparkError("statistics are computed of the left or right image only, and it must be in the ImageSet");
+    }
+
+    const ImageMeta &meta = id == ImageSet::BUFFER_LEFT ? imgSet.meta().left() : imgSet.meta().right();
+    PixelFormat format = pixelFormatOf(meta.format());
+    const ImageSet::Buffer &buff = imgSet.getBuffer(id);
+    if(format == PIXEL_UNKNOWN || buff.size() < imageSize(format, meta.width(), meta.height())) {
+        throw SparkError("image of format " + std::to_string(meta.format()) + " and " + std::to_string(buff.size()) +
+            " bytes has no statistics");
+    }
+
+    std::shared_ptr<ImageStats> stats = std::make_shared<ImageStats>();
+    compute(buff.data(), 0, format, meta.width(), meta.height(), *stats);
+    stats->id = id;
+    imgSet.setStats(id, stats);
+    return stats;
+}
+
+bool ImageStatisticsImpl::begin(PixelFormat format, uint32_t width, uint32_t height) {
+    if(format != PIXEL_RGB8 && format != PIXEL_BGR8 && format != PIXEL_GRAY8) {
+        return false;
+    }
+    _region = regionOf(format, width, height);
+    _counts[0].assign(COUNTS_SIZE, 0);
+    return true;
+}
+
+void ImageStatisticsImpl::addRows(const uint8_t *rows, size_t stride, uint32_t y0, uint32_t count) {
+    countRows(_region, rows, stride, y0, y0 + count, _counts[0].data());
+}
+
+void ImageStatisticsImpl::finish(ImageSet::BufferID id, ImageStats &stats) {
+    summarize(_region, 1, stats);
+    stats.id = id;
+}
+
+ImageStatisticsImpl::Region ImageStatisticsImpl::regionOf(PixelFormat format, uint32_t width, uint32_t height) const {
+    Region region;
+    region.format = format;
+    region.channels = format == PIXEL_GRAY8 ? 1 : 3;
+
+    uint32_t x0 = 0;
+    uint32_t x1 = width;
+    region.y0 = 0;
+    region.y1 = height;
+    if(_options.roiWidth && _options.roiHeight) {
+        x0 = std::min(_options.roiX, width);
+        x1 = x0 + std::min(_options.roiWidth, width - x0);
+        region.y0 = std::min(_options.roiY, height);
+        region.y1 = region.y0 + std::min(_options.roiHeight, height - region.y0);
+    }
+    region.x0 = x0;
+    region.columns = (x1 - x0 + _options.step - 1) / _options.step;
+    return region;
+}
+
+void ImageStatisticsImpl::countRows(const Region &region, const uint8_t *src, size_t stride, uint32_t y0, uint32_t y1,
+    uint32_t *counts) const {
+
+    uint32_t step = _options.step;
+    uint32_t y = std::max(y0, region.y0);
+    // first sampled row
+    y += (step - (y - region.y0) % step) % step;
+    for(; y < std::min(y1, region.y1); y += step) {
+        const uint8_t *p = src + (y - y0) * stride + size_t(region.x0) * region.channels;
+        if(region.channels == 1 && step == 1) {
+            countGray(p, region.columns, counts);
+        } else if(region.channels == 1) {
+            countPixels<1>(p, region.columns, step, counts);
+        } else {
+            countPixels<3>(p, region.columns, size_t(step) * 3, counts);
+        }
+    }
+}
+
+void ImageStatisticsImpl::summarize(const Region &region, uint32_t bands, ImageStats &stats) const {
+    uint32_t channels = region.channels;
+    stats.format = region.format;
+    stats.channels = channels;
+    stats.samples = 0;
+    memset(stats.channel, 0, sizeof(stats.channel));
+
+    for(uint32_t c = 0; c < channels; c++) {
+        ChannelStats &channel = stats.channel[c];
+        for(uint32_t b = 0; b < bands; b++) {
+            const uint32_t *counts = _counts[b].data();
+            for(uint32_t i = 0; i < HISTOGRAM_COPIES; i++) {
+                const uint32_t *histogram = counts + (i * channels + c) * 256;
+                for(uint32_t v = 0; v < 256; v++) {
+                    channel.histogram[v] += histogram[v];
+                }
+            }
+        }
+
+        uint64_t samples = 0;
+        uint64_t sum = 0;
+        uint64_t low = 0;
+        uint64_t high = 0;
+        double sumSquares = 0.0;
+        int min = -1;
+        int max = 0;
+        for(uint32_t v = 0; v < 256; v++) {
+            uint64_t n = channel.histogram[v];
+            if(!n) {
+                continue;
+            }
+            samples += n;
+            sum += n * v;
+            sumSquares += double(n) * v * v;
+            low += v <= _options.clipLow ? n : 0;
+            high += v >= _options.clipHigh ? n : 0;
+            min = min < 0 ? v : min;
+            max = v;
+        }
+        if(!samples) {
+            continue;
+        }
+
+        channel.mean = double(sum) / samples;
+        channel.variance = std::max(0.0, sumSquares / samples - channel.mean * channel.mean);
+        channel.min = uint8_t(min);
+        channel.max = uint8_t(max);
+        channel.clippedLow = float(double(low) / samples);
+        channel.clippedHigh = float(double(high) / samples);
+        stats.samples = samples;
+    }
+}
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,69 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <libsparkproto/imagestats.h>
+#include <libsparkproto/threadpool.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class ImageStatisticsImpl {
+
+public:
+    ImageStatisticsImpl(const StatsOptions &options);
+
+    virtual ~ImageStatisticsImpl();
+
+    const StatsOptions& options() const;
+
+    void compute(const uint8_t *src, size_t srcStride, PixelFormat format, uint32_t width, uint32_t height, ImageStats &stats);
+
+    std::shared_ptr<const ImageStats> compute(ImageSet &imgSet, ImageSet::BufferID id);
+
+    //
+    // statistics of an image of which rows are added in order as they are received, in the calling thread
+    //
+
+    // start an image, false if statistics of its format are not supported
+    bool begin(PixelFormat format, uint32_t width, uint32_t height);
+
+    // add count rows from row y0 of the image, stride bytes apart
+    void addRows(const uint8_t *rows, size_t stride, uint32_t y0, uint32_t count);
+
+    void finish(ImageSet::BufferID id, ImageStats &stats);
+
+private:
+    // sampled pixels of an image
+    struct Region {
+        PixelFormat format;
+        uint32_t channels;
+        uint32_t x0;
+        uint32_t y0;
+        uint32_t y1;
+        // sampled pixels of a row
+        uint32_t columns;
+    };
+
+    Region regionOf(PixelFormat format, uint32_t width, uint32_t height) const;
+
+    // count the sampled pixels of rows [y0, y1) of the image to counts
+    void countRows(const Region &region, const uint8_t *src, size_t stride, uint32_t y0, uint32_t y1, uint32_t *counts) const;
+
+    // sum the counts of bands and derive the statistics
+    void summarize(const Region &region, uint32_t bands, ImageStats &stats) const;
+
+    StatsOptions _options;
+    std::unique_ptr<ThreadPool> _pool;
+
+    // replicated histograms of each band of rows, band 0 for the image being received
+    std::vector<std::vector<uint32_t>> _counts;
+    Region _region;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,57 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <libsparkproto/imagestreamarchiver.h>
+#include <libsparkproto/imagestreamarchiverimpl.h>
+#include <libsparkproto/constants.h>
+#include <libsparkproto/exception.h>
+
+namespace libspark {
+
+namespace protocol {
+
+ImageStreamArchiver::ImageStreamArchiver(std::shared_ptr<DeviceInfo> pDevice, const std::string &filename) {
+    if(!pDevice->isCompatible())
+        throw SparkError("The library is not compatible with Spark firmware, please upgrade new version of libsparkpro");
+
+    _pImpl = std::make_unique<ImageStreamArchiverImpl>(pDevice->getIpAdress(), std::to_string(IMAGEDATA_PORT), filename);
+}
+
+ImageStreamArchiver::~ImageStreamArchiver() {
+
+}
+
+void ImageStreamArchiver::start() {
+    _pImpl->start();
+}
+
+void ImageStreamArchiver::stop() {
+    _pImpl->stop();
+}
+
+void ImageStreamArchiver::archiveImageSet(ImageSetMeta &meta, int timeout) {
+    _pImpl->archiveImageSet(meta, timeout);
+}
+
+void ImageStreamArchiver::setStreamType(int32_t streamType) {
+    _pImpl->setStreamType(streamType);
+}
+
+void ImageStreamArchiver::setImageFormat(int32_t imgFormat) {
+    _pImpl->setImageFormat(imgFormat);
+}
+
+void ImageStreamArchiver::close() {
+    _pImpl->close();
+}
+
+uint64_t ImageStreamArchiver::recordCount() const {
+    return _pImpl->recordCount();
+}
+
+uint64_t ImageStreamArchiver::writtenBytes() const {
+    return _pImpl->writtenBytes();
+}
+
+} // namespace protocol
+} // namespace libspark
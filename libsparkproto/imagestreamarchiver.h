@@ -0,0 +1,110 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <libsparkproto/common.h>
+#include <libsparkproto/deviceinfo.h>
+#include <libsparkproto/image.pb.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class ImageStreamArchiverImpl;
+
+/**
+ * @brief ImageStreamArchiver records a stream of a device to a recording file without receiving
+ * the images in user space. Only the header and ImageSetMeta of each ImageSet are parsed,
+ * the plane payloads are moved from the stream socket to the file by the kernel with splice().
+ * The file has the same format as ImageRecorder and can be played back with ImagePlayback.
+ *
+ * It's meant for pure archival, use ImageRecorder when the application also processes the images.
+ *
+ */
+class SPARK_API ImageStreamArchiver {
+
+public:
+
+    using Ptr = std::unique_ptr<ImageStreamArchiver>;
+
+    /**
+     * @brief Construct a new ImageStreamArchiver object, the file is created or truncated.
+     * If the file can not be created, a exception is thrown, see more exception libspark::protocol::SparkException
+     *
+     * @param device
+     * @param filename
+     */
+    ImageStreamArchiver(std::shared_ptr<DeviceInfo> device, const std::string &filename);
+
+    /**
+     * @brief Destroy the ImageStreamArchiver object, the stream is stopped and the recording is closed
+     *
+     */
+    virtual ~ImageStreamArchiver();
+
+    /**
+     * @brief Start stream ImageSet from spark, see ImageStreamProtocol::start
+     *
+     */
+    void start();
+
+    /**
+     * @brief Stop stream, the recording stays open so the stream can be started again
+     *
+     */
+    void stop();
+
+    /**
+     * @brief Receive the next ImageSet and append it to the recording
+     * when timeout is not set or -1, function will block until ImageSet received.
+     * After a failure the stream is not at the start of a record, so every later call throws a exception.
+     * The records archived before stay in the recording
+     *
+     * @param meta ImageSetMeta of the archived ImageSet
+     * @param timeout
+     */
+    void archiveImageSet(ImageSetMeta &meta, int timeout=-1);
+
+    /**
+     * @brief Set the StreamType, see ImageStreamProtocol::setStreamType
+     *
+     * @param streamType
+     */
+    void setStreamType(int32_t streamType);
+
+    /**
+     * @brief Set the ImageFormat
+     *
+     * @param imgFormat
+     */
+    void setImageFormat(int32_t imgFormat);
+
+    /**
+     * @brief Write index of the recording and close the file
+     *
+     */
+    void close();
+
+    /**
+     * @brief Number of ImageSet in the recording
+     *
+     * @return uint64_t
+     */
+    uint64_t recordCount() const;
+
+    /**
+     * @brief Number of bytes written to the recording
+     *
+     * @return uint64_t
+     */
+    uint64_t writtenBytes() const;
+
+private:
+    std::unique_ptr<ImageStreamArchiverImpl> _pImpl;
+};
+
+} // namespace protocol
+} // namespace libspark
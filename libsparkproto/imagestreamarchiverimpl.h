@@ -0,0 +1,10 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#if (defined(_WIN32))
+    #include <libsparkproto/imagestreamarchiverimpl_win32.h>
+#else
+    #include <libsparkproto/imagestreamarchiverimpl_unix.h>
+#endif
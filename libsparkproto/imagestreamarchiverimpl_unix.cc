@@ -0,0 +1,166 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <chrono>
+
+#include <libsparkproto/imagestreamarchiverimpl.h>
+#include <libsparkproto/imagestreamprotocolimpl.h>
+#include <libsparkproto/imageset.h>
+#include <libsparkproto/exception.h>
+#include <libsparkproto/log.h>
+
+namespace libspark {
+
+namespace protocol {
+
+// a larger pipe moves a plane with fewer splice calls
+static constexpr int PIPE_SIZE = 1 << 20;
+
+ImageStreamArchiverImpl::ImageStreamArchiverImpl(const std::string &address, const std::string &service, const std::string &filename)
+    : _stream(new ImageStreamProtocolImpl(address, service)), _filename(filename), _fd(-1), _offset(0) {
+
+    if(pipe2(_pipeFds, O_CLOEXEC) != 0) {
+        throw SparkError("can not create pipe: " + std::string(strerror(errno)));
+    }
+#ifdef F_SETPIPE_SZ
+    // the default size is used when the limit of the system is lower
+    fcntl(_pipeFds[1], F_SETPIPE_SZ, PIPE_SIZE);
+#endif
+
+    _fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(_fd < 0) {
+        std::string error = strerror(errno);
+        ::close(_pipeFds[0]);
+        ::close(_pipeFds[1]);
+        throw SparkError("can not create recording " + filename + ": " + error);
+    }
+
+    recording::FileHeader header = recording::makeFileHeader();
+    try {
+        recording::pwriteFixed(_fd, &header, sizeof(header), 0);
+    } catch (SparkException &e) {
+        ::close(_fd);
+        ::close(_pipeFds[0]);
+        ::close(_pipeFds[1]);
+        throw;
+    }
+    _offset = sizeof(header);
+}
+
+ImageStreamArchiverImpl::~ImageStreamArchiverImpl() {
+    _stream->stop();
+
+    try {
+        close();
+    } catch (SparkException &e) {
+        LOG_ERROR("failed closing recording: %s", e.what());
+    }
+
+    ::close(_pipeFds[0]);
+    ::close(_pipeFds[1]);
+}
+
+void ImageStreamArchiverImpl::start() {
+    _stream->start();
+}
+
+void ImageStreamArchiverImpl::stop() {
+    _stream->stop();
+}
+
+void ImageStreamArchiverImpl::archiveImageSet(ImageSetMeta &meta, int timeout) {
+
+    (void) timeout;
+
+    if(_fd < 0) {
+        throw SparkError("recording " + _filename + " is closed");
+    }
+    if(!_error.empty()) {
+        throw SparkError("archiving stopped after a failure: " + _error);
+    }
+
+    // a failure leaves the stream in the middle of a record, the next bytes are no meta
+    uint64_t receiveTimestamp;
+    uint64_t offset = _offset;
+    try {
+        _stream->recvImageSetMeta(meta, _metaBuff);
+        receiveTimestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+
+        for(uint32_t i = 0; i < recording::PLANE_COUNT; i++) {
+            const ImageMeta *plane = recording::planeMeta(meta, ImageSet::BufferID(i));
+            if(plane && (plane->buffsize() < 0 || plane->buffsize() > recording::MAX_PLANE_SIZE)) {
+                throw SparkError("invalid buffsize " + std::to_string(plane->buffsize()) + " of a image on the stream");
+            }
+        }
+
+        // the meta is stored as received, so it's not serialized again
+        recording::RecordHeader header = recording::makeRecordHeader(meta, _metaBuff.size(), receiveTimestamp);
+        recording::pwriteFixed(_fd, &header, sizeof(header), offset);
+        offset += sizeof(header);
+        recording::pwriteFixed(_fd, _metaBuff.data(), _metaBuff.size(), offset);
+        offset += _metaBuff.size();
+
+        // planes follow the meta in BufferID order on the stream, the same order as in a record
+        for(uint32_t i = 0; i < recording::PLANE_COUNT; i++) {
+            if(header.planeSize[i] > 0) {
+                network::spliceFixedFrom(_stream->streamSocket(), _pipeFds, _fd, offset, header.planeSize[i]);
+                offset += header.planeSize[i];
+            }
+        }
+    } catch (SparkException &e) {
+        _error = e.what();
+        throw;
+    }
+
+    // a record is added to the index only when it's complete, a partial record is overwritten by the next one
+    _index.push_back({recording::metaTimestamp(meta), receiveTimestamp, _offset});
+    _offset = offset;
+}
+
+void ImageStreamArchiverImpl::setStreamType(int32_t streamType) {
+    _stream->setStreamType(streamType);
+}
+
+void ImageStreamArchiverImpl::setImageFormat(int32_t imgFormat) {
+    _stream->setImageFormat(imgFormat);
+}
+
+void ImageStreamArchiverImpl::close() {
+    if(_fd < 0) {
+        return;
+    }
+
+    int fd = _fd;
+    _fd = -1;
+
+    try {
+        recording::writeIndex(fd, _offset, _index);
+        // drop a partial record after the trailer
+        uint64_t size = _offset + _index.size() * sizeof(recording::IndexEntry) + sizeof(recording::FileTrailer);
+        if(ftruncate(fd, size) != 0) {
+            throw SparkError("can not truncate recording " + _filename + ": " + std::string(strerror(errno)));
+        }
+    } catch (SparkException &e) {
+        ::close(fd);
+        throw;
+    }
+
+    ::close(fd);
+    LOG_INFO("archived %lu ImageSet to %s", _index.size(), _filename.c_str());
+}
+
+uint64_t ImageStreamArchiverImpl::recordCount() const {
+    return _index.size();
+}
+
+uint64_t ImageStreamArchiverImpl::writtenBytes() const {
+    return _offset;
+}
+
+} // namespace protocol
+} // namespace libspark
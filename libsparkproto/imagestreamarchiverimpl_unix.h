@@ -0,0 +1,74 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <libsparkproto/image.pb.h>
+#include <libsparkproto/recordingformat.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class ImageStreamProtocolImpl;
+class ImageStreamArchiverImpl {
+
+public:
+    /**
+     * @brief Construct a new ImageStreamArchiverImpl object
+     *
+     * @param address
+     * @param service
+     * @param filename
+     */
+    ImageStreamArchiverImpl(const std::string &address, const std::string &service, const std::string &filename);
+
+    /**
+     * @brief Destroy the ImageStreamArchiverImpl object
+     *
+     */
+    virtual ~ImageStreamArchiverImpl();
+
+    void start();
+
+    void stop();
+
+    /**
+     * @brief Receive the next ImageSet and splice its planes to the recording
+     *
+     * @param meta
+     * @param timeout
+     */
+    void archiveImageSet(ImageSetMeta &meta, int timeout);
+
+    void setStreamType(int32_t streamType);
+
+    void setImageFormat(int32_t imgFormat);
+
+    void close();
+
+    uint64_t recordCount() const;
+
+    uint64_t writtenBytes() const;
+
+private:
+    std::unique_ptr<ImageStreamProtocolImpl> _stream;
+
+    std::string _filename;
+    int _fd;
+    // pipe between the stream socket and the file for splice
+    int _pipeFds[2];
+
+    recording::Index _index;
+    // end of the last complete record
+    uint64_t _offset;
+    std::vector<char> _metaBuff;
+    // failure which left the stream in the middle of a record, archiving does not continue after it
+    std::string _error;
+};
+
+} // namespace protocol
+} // namespace libspark
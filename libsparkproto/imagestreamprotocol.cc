@@ -5,6 +5,7 @@
 #include <libsparkproto/imagestreamprotocolimpl.h>
 #include <libsparkproto/constants.h>
 #include <libsparkproto/exception.h>
+#include <libsparkproto/imageset.h>
 
 namespace libspark {
 
@@ -14,7 +15,14 @@ ImageStreamProtocol::ImageStreamProtocol(std::shared_ptr<DeviceInfo> pDevice) {
     if(!pDevice->isCompatible())
         throw SparkError("The library is not compatible with Spark firmware, please upgrade new version of libsparkpro");
 
-    _pImpl = std::make_unique<ImageStreamProtocolImpl>(pDevice->getIpAdress(), std::to_string(IMAGEDATA_PORT));
+    _pImpl = std::make_shared<ImageStreamProtocolImpl>(pDevice->getIpAdress(), std::to_string(IMAGEDATA_PORT));
+}
+
+ImageStreamProtocol::ImageStreamProtocol(std::shared_ptr<IImageSource> source) {
+    if(!source)
+        throw SparkError("passed a null image source");
+
+    _pImpl = source;
 }
 
 ImageStreamProtocol::~ImageStreamProtocol() {
@@ -31,6 +39,37 @@ void ImageStreamProtocol::stop() {
 
 void ImageStreamProtocol::recvImageSet(ImageSet &imgSet, int timeout) {
     _pImpl->recvImageSet(imgSet, timeout);
+    computeStatistics(imgSet);
+}
+
+void ImageStreamProtocol::recvImageSet(ImageSet &imgSet, const PlaneOutput &output, int timeout) {
+    std::shared_ptr<ImageStreamProtocolImpl> stream = std::dynamic_pointer_cast<ImageStreamProtocolImpl>(_pImpl);
+    if(stream) {
+        stream->recvImageSet(imgSet, output, timeout);
+        return;
+    }
+
+    // other sources deliver whole ImageSet, the image is converted after it's received
+    _pImpl->recvImageSet(imgSet, timeout);
+    computeStatistics(imgSet);
+
+    const ImageMeta &meta = output.id == ImageSet::BUFFER_LEFT ? imgSet.meta().left() : imgSet.meta().right();
+    if(output.capacity < imageSize(output.format, meta.width(), meta.height(), output.stride)) {
+        throw SparkError("output buffer is too small for the converted image");
+    }
+    convertPlane(imgSet, output.id, output.format, output.data, output.stride);
+
+    // clearing the buffer releases the statistics of all images, they are still valid
+    std::shared_ptr<const ImageStats> stats[ImageSet::BUFFER_ID_MAX + 1];
+    for(int32_t i = 0; i <= ImageSet::BUFFER_ID_MAX; i++) {
+        stats[i] = imgSet.stats(ImageSet::BufferID(i));
+    }
+    imgSet.getMutableBuffer(output.id).clear();
+    for(int32_t i = 0; i <= ImageSet::BUFFER_ID_MAX; i++) {
+        if(stats[i]) {
+            imgSet.setStats(ImageSet::BufferID(i), stats[i]);
+        }
+    }
 }
 
 void ImageStreamProtocol::setStreamType(int32_t streamType) {
@@ -41,5 +80,40 @@ void ImageStreamProtocol::setImageFormat(int32_t imgFormat) {
     _pImpl->setImageFormat(imgFormat);
 }
 
+void ImageStreamProtocol::enableStatistics(const StatsOptions &options) {
+    std::shared_ptr<ImageStreamProtocolImpl> stream = std::dynamic_pointer_cast<ImageStreamProtocolImpl>(_pImpl);
+    if(stream) {
+        stream->enableStatistics(options);
+        return;
+    }
+    _statistics = std::make_shared<ImageStatistics>(options);
+}
+
+void ImageStreamProtocol::disableStatistics() {
+    std::shared_ptr<ImageStreamProtocolImpl> stream = std::dynamic_pointer_cast<ImageStreamProtocolImpl>(_pImpl);
+    if(stream) {
+        stream->disableStatistics();
+    }
+    _statistics.reset();
+}
+
+void ImageStreamProtocol::computeStatistics(ImageSet &imgSet) {
+    if(!_statistics) {
+        return;
+    }
+
+    for(ImageSet::BufferID id : {ImageSet::BUFFER_LEFT, ImageSet::BUFFER_RIGHT}) {
+        bool present = id == ImageSet::BUFFER_LEFT ? imgSet.hasLeft() : imgSet.hasRight();
+        if(!present) {
+            continue;
+        }
+        const ImageMeta &meta = id == ImageSet::BUFFER_LEFT ? imgSet.meta().left() : imgSet.meta().right();
+        PixelFormat format = pixelFormatOf(meta.format());
+        if(format != PIXEL_UNKNOWN && imgSet.getBuffer(id).size() >= imageSize(format, meta.width(), meta.height())) {
+            _statistics->compute(imgSet, id);
+        }
+    }
+}
+
 } // namespace protocol
 } // namespace libspark
@@ -5,12 +5,14 @@
 
 #include <libsparkproto/common.h>
 #include <libsparkproto/deviceinfo.h>
+#include <libsparkproto/iimagesource.h>
+#include <libsparkproto/imagestats.h>
+#include <libsparkproto/pixelconvert.h>
 
 namespace libspark {
 
 namespace protocol {
 
-class ImageStreamProtocolImpl;
 class ImageSet;
 class SPARK_API ImageStreamProtocol {
 
@@ -25,6 +27,14 @@ public:
      */
     ImageStreamProtocol(std::shared_ptr<DeviceInfo> device);
 
+    /**
+     * @brief Construct a new ImageStreamProtocol object which streams from a source other than a device,
+     * for example a recording played back by libspark::protocol::ImagePlayback
+     * 
+     * @param source 
+     */
+    ImageStreamProtocol(std::shared_ptr<IImageSource> source);
+
     /**
      * @brief Destroy the ImageStreamProtocol object
      * 
@@ -55,6 +65,18 @@ public:
      */
     void recvImageSet(ImageSet &imgSet, int timeout=-1);
 
+    /**
+     * @brief Receive ImageSet with the image output.id converted to output.format into the buffer of the caller,
+     * for example BGR for OpenCV. On a stream of a device the image is converted while it is received,
+     * so it is touched once. The buffer of the image in imgSet is left empty, its ImageMeta is not changed.
+     * If the image can not be converted to output, a exception is thrown, see libspark::protocol::PlaneOutput
+     *
+     * @param imgSet
+     * @param output
+     * @param timeout
+     */
+    void recvImageSet(ImageSet &imgSet, const PlaneOutput &output, int timeout=-1);
+
     /**
      * @brief Set the StreamType. 
      * See list of stream type at libspark::protocol::StreamType.
@@ -70,8 +92,28 @@ public:
      */
     void setImageFormat(int32_t imgFormat);
 
+    /**
+     * @brief Compute statistics of the left and right images of 8-bit pixels of each received ImageSet
+     * and attach them to it, see ImageSet::stats(). On a stream of a device the rows are counted while
+     * they are received, so the images are not read again. If options are invalid, a exception is thrown,
+     * see libspark::protocol::ImageStatistics
+     *
+     * @param options
+     */
+    void enableStatistics(const StatsOptions &options = StatsOptions());
+
+    /**
+     * @brief Stop computing statistics of received ImageSet
+     *
+     */
+    void disableStatistics();
+
 private:
-    std::unique_ptr<ImageStreamProtocolImpl> _pImpl;
+    // attach statistics of the images of imgSet, if enabled on a source other than a device
+    void computeStatistics(ImageSet &imgSet);
+
+    std::shared_ptr<IImageSource> _pImpl;
+    std::shared_ptr<ImageStatistics> _statistics;
 };
 
 } // namespace protocol
@@ -1,15 +1,21 @@
 // Copyright 2021 Dynim Oy.
 // SPDX-License-Identifier: BSD 3-Clause
 
+#include <algorithm>
+#include <chrono>
 #include <libsparkproto/imagestreamprotocolimpl.h>
 #include <libsparkproto/exception.h>
 #include <libsparkproto/log.h>
 #include <libsparkproto/imageset.h>
+#include <libsparkproto/pixelkernels.h>
 
 namespace libspark {
 
 namespace protocol {
 
+// size of the chunks of rows an image is received in when it's converted
+static constexpr size_t RECV_CHUNK_SIZE = 64 * 1024;
+
 ImageStreamProtocolImpl::ImageStreamProtocolImpl(const std::string &address, const std::string &service)
     : _sock(-1), _address(address), _service(service) {
 
@@ -56,52 +62,94 @@ void ImageStreamProtocolImpl::recvImageSet(ImageSet &imgSet, int timeout) {
     
     (void) timeout;
     
-    // receive 4 bytes for header, is size of response message
-    int resSize;
-    u_char hBuff[4];
-    network::recvFixedFrom(_sock, hBuff, 4);
-    memcpy(&resSize, hBuff, 4);
-    if(resSize <= 0) {
-        throw SparkError("payload size is zero");
-    }
-
-    // receive ImageSetMeta
-    std::unique_ptr<char[]> pResBuff = std::make_unique<char[]>(resSize);
-    network::recvFixedFrom(_sock, pResBuff.get(), resSize);
-
+    std::vector<char> metaBuff;
     std::unique_ptr<ImageSetMeta> meta = std::make_unique<ImageSetMeta>();
-    int ret = meta->ParseFromArray(pResBuff.get(), resSize);
-    if(!ret) {
-        throw SparkError("failed parse ImageSetMeta from socket");
-    }
-
+    recvImageSetMeta(*meta, metaBuff);
 
     // receive buffers
+    std::shared_ptr<ImageStats> stats[ImageSet::BUFFER_ID_MAX + 1];
     if(meta->has_left()){
-        ImageSet::Buffer &buff = imgSet.getMutableBuffer(ImageSet::BUFFER_LEFT);
-        buff.resize(meta->left().buffsize());
-        network::recvFixedFrom(_sock, buff.data(), buff.size());
+        recvPlane(imgSet, ImageSet::BUFFER_LEFT, meta->left(), nullptr,
+            hasStatistics(ImageSet::BUFFER_LEFT, meta->left()) ? &stats[ImageSet::BUFFER_LEFT] : nullptr);
     }
 
     if(meta->has_right()){
-        ImageSet::Buffer &buff = imgSet.getMutableBuffer(ImageSet::BUFFER_RIGHT);
-        buff.resize(meta->right().buffsize());
-        network::recvFixedFrom(_sock, buff.data(), buff.size());
+        recvPlane(imgSet, ImageSet::BUFFER_RIGHT, meta->right(), nullptr,
+            hasStatistics(ImageSet::BUFFER_RIGHT, meta->right()) ? &stats[ImageSet::BUFFER_RIGHT] : nullptr);
     }
 
     if(meta->has_depth()){
-        ImageSet::Buffer &buff = imgSet.getMutableBuffer(ImageSet::BUFFER_DEPTH);
-        buff.resize(meta->depth().buffsize());
-        network::recvFixedFrom(_sock, buff.data(), buff.size());
+        recvPlane(imgSet, ImageSet::BUFFER_DEPTH, meta->depth(), nullptr, nullptr);
     }
 
     if(meta->has_disparity()){
-        ImageSet::Buffer &buff = imgSet.getMutableBuffer(ImageSet::BUFFER_DISPARITY);
-        buff.resize(meta->disparity().buffsize());
-        network::recvFixedFrom(_sock, buff.data(), buff.size());
+        recvPlane(imgSet, ImageSet::BUFFER_DISPARITY, meta->disparity(), nullptr, nullptr);
     }
     
     imgSet.setAllocatedMeta(std::move(meta));
+    imgSet.setReceiveTimestamp(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+
+    // attached after the meta, which releases what was attached before
+    for(int id = ImageSet::BUFFER_LEFT; id <= ImageSet::BUFFER_ID_MAX; id++) {
+        if(stats[id]) {
+            imgSet.setStats(ImageSet::BufferID(id), stats[id]);
+        }
+    }
+}
+
+void ImageStreamProtocolImpl::recvImageSet(ImageSet &imgSet, const PlaneOutput &output, int timeout) {
+
+    (void) timeout;
+
+    std::vector<char> metaBuff;
+    std::unique_ptr<ImageSetMeta> meta = std::make_unique<ImageSetMeta>();
+    recvImageSetMeta(*meta, metaBuff);
+
+    // a plane which can not be converted is received as usual, so the stream stays in sync
+    std::string error;
+    std::shared_ptr<ImageStats> stats[ImageSet::BUFFER_ID_MAX + 1];
+    const ImageMeta *planes[] = {
+        meta->has_left() ? &meta->left() : nullptr,
+        meta->has_right() ? &meta->right() : nullptr,
+        meta->has_depth() ? &meta->depth() : nullptr,
+        meta->has_disparity() ? &meta->disparity() : nullptr
+    };
+    for(int id = ImageSet::BUFFER_LEFT; id <= ImageSet::BUFFER_ID_MAX; id++) {
+        if(!planes[id]) {
+            continue;
+        }
+        const PlaneOutput *planeOutput = nullptr;
+        if(id == output.id) {
+            const ImageMeta &planeMeta = *planes[id];
+            PixelFormat srcFormat = pixelFormatOf(planeMeta.format());
+            if(!isConversionSupported(srcFormat, output.format)) {
+                error = "image of format " + std::to_string(planeMeta.format()) + " can not be converted to pixel format " +
+                    std::to_string(output.format);
+            } else if(size_t(planeMeta.buffsize()) != imageSize(srcFormat, planeMeta.width(), planeMeta.height())) {
+                error = "buffsize of the image does not match its width and height";
+            } else if(!output.data || output.capacity < imageSize(output.format, planeMeta.width(), planeMeta.height(), output.stride)) {
+                error = "output buffer is too small for the converted image";
+            } else {
+                planeOutput = &output;
+            }
+        }
+        recvPlane(imgSet, ImageSet::BufferID(id), *planes[id], planeOutput,
+            hasStatistics(ImageSet::BufferID(id), *planes[id]) ? &stats[id] : nullptr);
+    }
+
+    imgSet.setAllocatedMeta(std::move(meta));
+    imgSet.setReceiveTimestamp(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    for(int id = ImageSet::BUFFER_LEFT; id <= ImageSet::BUFFER_ID_MAX; id++) {
+        if(stats[id]) {
+            imgSet.setStats(ImageSet::BufferID(id), stats[id]);
+        }
+    }
+
+    if(!error.empty()) {
+        throw SparkError(error);
+    }
 }
 
 void ImageStreamProtocolImpl::setStreamType(int32_t streamType) {
@@ -118,6 +166,112 @@ void ImageStreamProtocolImpl::setImageFormat(int32_t imgFormat) {
     _streamRequest.set_imgformat(ImageFormat(imgFormat));
 }
 
+void ImageStreamProtocolImpl::enableStatistics(const StatsOptions &options) {
+    StatsOptions streamOptions = options;
+    // rows are counted in the receiving thread as they arrive
+    streamOptions.threads = 1;
+    _statistics.reset(new ImageStatisticsImpl(streamOptions));
+}
+
+void ImageStreamProtocolImpl::disableStatistics() {
+    _statistics.reset();
+}
+
+void ImageStreamProtocolImpl::recvImageSetMeta(ImageSetMeta &meta, std::vector<char> &metaBuff) {
+
+    // receive 4 bytes for header, is size of response message
+    int resSize;
+    u_char hBuff[4];
+    network::recvFixedFrom(_sock, hBuff, 4);
+    memcpy(&resSize, hBuff, 4);
+    if(resSize <= 0) {
+        throw SparkError("payload size is zero");
+    }
+
+    // receive ImageSetMeta
+    metaBuff.resize(resSize);
+    network::recvFixedFrom(_sock, metaBuff.data(), resSize);
+
+    int ret = meta.ParseFromArray(metaBuff.data(), resSize);
+    if(!ret) {
+        throw SparkError("failed parse ImageSetMeta from socket");
+    }
+}
+
+SOCKET ImageStreamProtocolImpl::streamSocket() const {
+    return _sock;
+}
+
+void ImageStreamProtocolImpl::recvPlane(ImageSet &imgSet, ImageSet::BufferID id, const ImageMeta &meta, const PlaneOutput *output,
+    std::shared_ptr<ImageStats> *stats) {
+
+    ImageSet::Buffer &buff = imgSet.getMutableBuffer(id);
+
+    if(!output && !stats) {
+        buff.resize(meta.buffsize());
+        network::recvFixedFrom(_sock, buff.data(), buff.size());
+        return;
+    }
+
+    PixelFormat srcFormat = pixelFormatOf(meta.format());
+    uint32_t width = meta.width();
+    uint32_t height = meta.height();
+    size_t srcStride = imageSize(srcFormat, width, 1);
+    uint32_t chunkRows = std::max<size_t>(1, RECV_CHUNK_SIZE / srcStride);
+    if(stats) {
+        *stats = std::make_shared<ImageStats>();
+        _statistics->begin(srcFormat, width, height);
+    }
+
+    // rows are counted while they are still in cache after the copy out of the socket
+    if(!output) {
+        buff.resize(meta.buffsize());
+        for(uint32_t y0 = 0; y0 < height; y0 += chunkRows) {
+            uint32_t rows = std::min(chunkRows, height - y0);
+            uint8_t *chunk = buff.data() + y0 * srcStride;
+            network::recvFixedFrom(_sock, chunk, rows * srcStride);
+            _statistics->addRows(chunk, srcStride, y0, rows);
+        }
+        _statistics->finish(id, **stats);
+        return;
+    }
+    buff.clear();
+
+    size_t dstStride = output->stride ? output->stride : size_t(width) * pixelSize(output->format);
+    size_t planeSize = dstStride * height;
+
+    // rows are converted while they are still in cache after the copy out of the socket
+    _chunk.resize(chunkRows * srcStride);
+
+    cpu::Level level = cpu::dispatchLevel();
+    uint8_t *dst = (uint8_t *) output->data;
+    for(uint32_t y0 = 0; y0 < height; y0 += chunkRows) {
+        uint32_t rows = std::min(chunkRows, height - y0);
+        network::recvFixedFrom(_sock, _chunk.data(), rows * srcStride);
+        if(stats) {
+            _statistics->addRows(_chunk.data(), srcStride, y0, rows);
+        }
+
+        for(uint32_t y = y0; y < y0 + rows; y++) {
+            uint8_t *row = dst + y * dstStride;
+            uint8_t *planes[3] = {row, row + planeSize, row + 2 * planeSize};
+            pixel::convertRow(_chunk.data() + (y - y0) * srcStride, srcFormat, planes, output->format, width, level);
+        }
+    }
+    if(stats) {
+        _statistics->finish(id, **stats);
+    }
+}
+
+bool ImageStreamProtocolImpl::hasStatistics(ImageSet::BufferID id, const ImageMeta &meta) const {
+    if(!_statistics || (id != ImageSet::BUFFER_LEFT && id != ImageSet::BUFFER_RIGHT)) {
+        return false;
+    }
+    PixelFormat format = pixelFormatOf(meta.format());
+    return (format == PIXEL_RGB8 || format == PIXEL_BGR8 || format == PIXEL_GRAY8) &&
+        size_t(meta.buffsize()) == imageSize(format, meta.width(), meta.height());
+}
+
 template<typename TRequest, typename TResponse>
 void ImageStreamProtocolImpl::callStreamRequest(const TRequest& requestMsg, TResponse &responseMsg) {
     // serialize requestMsg to buff to send to socket
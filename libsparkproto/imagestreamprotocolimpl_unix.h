@@ -3,15 +3,20 @@
 
 #pragma once
 
+#include <memory>
+#include <vector>
 #include <libsparkproto/network.h>
 #include <libsparkproto/image.pb.h>
+#include <libsparkproto/iimagesource.h>
+#include <libsparkproto/pixelconvert.h>
+#include <libsparkproto/imagestatsimpl.h>
 
 namespace libspark {
 
 namespace protocol {
 
 class ImageSet;
-class ImageStreamProtocolImpl {
+class ImageStreamProtocolImpl : public IImageSource {
 
 public:
     /**
@@ -33,13 +38,13 @@ public:
      * default ImageFormat is FORMAT_MONO_8_BIT if client don't call setImageFormat function
      * If stream can not start, a exception is thrown, see more exception libspark::protocol::SparkException
      */
-    void start();
+    void start() override;
 
     /**
      * @brief Stop stream
      * 
      */
-    void stop();
+    void stop() override;
 
     /**
      * @brief Receive ImageSet from spark with timeout
@@ -49,23 +54,72 @@ public:
      * @param timeout
      * see more libspark::protocol::ImageSet
      */
-    void recvImageSet(ImageSet &imgSet, int timeout=-1);
+    void recvImageSet(ImageSet &imgSet, int timeout=-1) override;
+
+    /**
+     * @brief Receive ImageSet, the image output.id is converted to output.format while it is received
+     * into output.data, in chunks of rows which stay in cache. The buffer of the image in imgSet is left empty.
+     * If the image can not be converted to output, it is received into imgSet and a exception is thrown
+     *
+     * @param imgSet
+     * @param output
+     * @param timeout
+     */
+    void recvImageSet(ImageSet &imgSet, const PlaneOutput &output, int timeout=-1);
 
     /**
      * @brief Set the StreamType
      * 
      * @param streamType 
      */
-    void setStreamType(int32_t streamType);
+    void setStreamType(int32_t streamType) override;
 
     /**
      * @brief Set the ImageFormat
      * 
      * @param imgFormat 
      */
-    void setImageFormat(int32_t imgFormat);
+    void setImageFormat(int32_t imgFormat) override;
+
+    /**
+     * @brief Compute statistics of the left and right images of 8-bit pixels while they are received,
+     * they are attached to the received ImageSet. options.threads is not used
+     *
+     * @param options
+     */
+    void enableStatistics(const StatsOptions &options);
+
+    /**
+     * @brief Stop computing statistics
+     *
+     */
+    void disableStatistics();
+
+    /**
+     * @brief Receive the header and ImageSetMeta of the next ImageSet, the plane payloads are left in the socket.
+     * The caller must consume buffsize bytes of each plane from streamSocket() in BufferID order.
+     *
+     * @param meta parsed ImageSetMeta
+     * @param metaBuff serialized ImageSetMeta as received, resized to its size
+     */
+    void recvImageSetMeta(ImageSetMeta &meta, std::vector<char> &metaBuff);
+
+    /**
+     * @brief Get socket of the stream, INVALID_SOCKET when stream is stopped
+     *
+     * @return SOCKET
+     */
+    SOCKET streamSocket() const;
 
 private:
+    // receive a plane of size bytes into imgSet, or converted into output when it's given.
+    // Statistics of the plane are computed on the way when stats is given
+    void recvPlane(ImageSet &imgSet, ImageSet::BufferID id, const ImageMeta &meta, const PlaneOutput *output,
+        std::shared_ptr<ImageStats> *stats);
+
+    // whether statistics are computed of a plane
+    bool hasStatistics(ImageSet::BufferID id, const ImageMeta &meta) const;
+
     template<typename TRequest, typename TResponse>
     void callStreamRequest(const TRequest& requestMsg, TResponse &responseMsg);
 
@@ -75,6 +129,11 @@ private:
     std::string _service;
 
     StreamStartRequest _streamRequest;
+
+    // rows of a plane being converted
+    std::vector<uint8_t> _chunk;
+    // statistics of the planes being received, null when disabled
+    std::unique_ptr<ImageStatisticsImpl> _statistics;
 };
 
 } // namespace protocol
@@ -0,0 +1,170 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <string>
+#include <algorithm>
+
+#include <libsparkproto/iouring.h>
+#include <libsparkproto/exception.h>
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+    #include <linux/io_uring.h>
+    #define SPARK_HAVE_IO_URING
+#endif
+
+namespace libspark {
+
+namespace protocol {
+
+IoUring::IoUring()
+    : _ringFd(-1), _sqRing(MAP_FAILED), _sqRingSize(0), _cqRing(MAP_FAILED), _cqRingSize(0),
+      _sqes(MAP_FAILED), _sqesSize(0), _sqEntries(0), _toSubmit(0) {
+
+}
+
+IoUring::~IoUring() {
+    if(_sqes != MAP_FAILED) {
+        munmap(_sqes, _sqesSize);
+    }
+    if(_cqRing != MAP_FAILED && _cqRing != _sqRing) {
+        munmap(_cqRing, _cqRingSize);
+    }
+    if(_sqRing != MAP_FAILED) {
+        munmap(_sqRing, _sqRingSize);
+    }
+    if(_ringFd >= 0) {
+        ::close(_ringFd);
+    }
+}
+
+#ifdef SPARK_HAVE_IO_URING
+
+bool IoUring::init(uint32_t entries) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    _ringFd = syscall(__NR_io_uring_setup, entries, &params);
+    if(_ringFd < 0) {
+        return false;
+    }
+
+    _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if(singleMap) {
+        _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+    }
+
+    _sqRing = mmap(nullptr, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQ_RING);
+    if(_sqRing == MAP_FAILED) {
+        return false;
+    }
+    if(singleMap) {
+        _cqRing = _sqRing;
+    }
+    else {
+        _cqRing = mmap(nullptr, _cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_CQ_RING);
+        if(_cqRing == MAP_FAILED) {
+            return false;
+        }
+    }
+
+    _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    _sqes = mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQES);
+    if(_sqes == MAP_FAILED) {
+        return false;
+    }
+
+    char *sq = (char*)_sqRing;
+    _sqHead = (uint32_t*)(sq + params.sq_off.head);
+    _sqTail = (uint32_t*)(sq + params.sq_off.tail);
+    _sqMask = (uint32_t*)(sq + params.sq_off.ring_mask);
+    _sqArray = (uint32_t*)(sq + params.sq_off.array);
+    _sqEntries = params.sq_entries;
+
+    char *cq = (char*)_cqRing;
+    _cqHead = (uint32_t*)(cq + params.cq_off.head);
+    _cqTail = (uint32_t*)(cq + params.cq_off.tail);
+    _cqMask = (uint32_t*)(cq + params.cq_off.ring_mask);
+    _cqes = cq + params.cq_off.cqes;
+
+    return true;
+}
+
+bool IoUring::queueWrite(int fd, const iovec *iov, uint64_t offset, uint64_t userData) {
+    uint32_t tail = *_sqTail;
+    uint32_t head = __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE);
+    if(tail - head >= _sqEntries) {
+        return false;
+    }
+
+    uint32_t index = tail & *_sqMask;
+    io_uring_sqe *sqe = (io_uring_sqe*)_sqes + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)iov;
+    sqe->len = 1;
+    sqe->off = offset;
+    sqe->user_data = userData;
+
+    _sqArray[index] = index;
+    __atomic_store_n(_sqTail, tail + 1, __ATOMIC_RELEASE);
+    _toSubmit++;
+
+    return true;
+}
+
+uint32_t IoUring::submitAndWait(uint32_t minComplete, Completion *completions, uint32_t maxCompletions) {
+    if(_toSubmit > 0 || minComplete > 0) {
+        int ret;
+        do {
+            ret = syscall(__NR_io_uring_enter, _ringFd, _toSubmit, minComplete,
+                minComplete > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+        } while(ret < 0 && errno == EINTR);
+
+        if(ret < 0) {
+            throw SparkError("io_uring_enter failed: " + std::string(strerror(errno)));
+        }
+        _toSubmit -= ret;
+    }
+
+    uint32_t count = 0;
+    uint32_t head = *_cqHead;
+    uint32_t tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+    while(head != tail && count < maxCompletions) {
+        io_uring_cqe *cqe = (io_uring_cqe*)_cqes + (head & *_cqMask);
+        completions[count++] = {cqe->user_data, cqe->res};
+        head++;
+    }
+    __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+
+    return count;
+}
+
+#else
+
+bool IoUring::init(uint32_t entries) {
+    (void) entries;
+    return false;
+}
+
+bool IoUring::queueWrite(int fd, const iovec *iov, uint64_t offset, uint64_t userData) {
+    (void) fd; (void) iov; (void) offset; (void) userData;
+    return false;
+}
+
+uint32_t IoUring::submitAndWait(uint32_t minComplete, Completion *completions, uint32_t maxCompletions) {
+    (void) minComplete; (void) completions; (void) maxCompletions;
+    return 0;
+}
+
+#endif
+
+} // namespace protocol
+} // namespace libspark
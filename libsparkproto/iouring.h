@@ -0,0 +1,89 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/uio.h>
+
+namespace libspark {
+
+namespace protocol {
+
+/**
+ * @brief Minimal io_uring submission of vectored writes, implemented directly on the system calls
+ * so the library does not depend on liburing.
+ *
+ */
+class IoUring {
+
+public:
+    struct Completion {
+        uint64_t userData;
+        int32_t result;
+    };
+
+    IoUring();
+
+    virtual ~IoUring();
+
+    /**
+     * @brief Set up a ring with at least entries submission slots. Return false if the kernel
+     * does not support io_uring or it's not permitted.
+     *
+     * @param entries
+     * @return true
+     * @return false
+     */
+    bool init(uint32_t entries);
+
+    /**
+     * @brief Queue a write, iov must stay valid until the write completes.
+     * Return false if the submission queue is full.
+     *
+     * @param fd
+     * @param iov
+     * @param offset
+     * @param userData
+     * @return true
+     * @return false
+     */
+    bool queueWrite(int fd, const iovec *iov, uint64_t offset, uint64_t userData);
+
+    /**
+     * @brief Submit queued writes and wait until at least minComplete writes are completed.
+     * Return number of completions stored to completions, at most maxCompletions.
+     * A exception is thrown on failure of the system call.
+     *
+     * @param minComplete
+     * @param completions
+     * @param maxCompletions
+     * @return uint32_t
+     */
+    uint32_t submitAndWait(uint32_t minComplete, Completion *completions, uint32_t maxCompletions);
+
+private:
+    int _ringFd;
+
+    void *_sqRing;
+    size_t _sqRingSize;
+    void *_cqRing;
+    size_t _cqRingSize;
+    void *_sqes;
+    size_t _sqesSize;
+
+    uint32_t *_sqHead;
+    uint32_t *_sqTail;
+    uint32_t *_sqMask;
+    uint32_t *_sqArray;
+    uint32_t _sqEntries;
+    uint32_t _toSubmit;
+
+    uint32_t *_cqHead;
+    uint32_t *_cqTail;
+    uint32_t *_cqMask;
+    void *_cqes;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,105 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+namespace libspark {
+
+namespace protocol {
+
+/**
+ * @brief Interface of a source of parameter values which answers the operations of a ParameterBatch
+ * the device failed, see ParameterBatch::setFallback(). ParameterSimulator is a implementation of this interface.
+ *
+ */
+class IParameterSource {
+
+public:
+    virtual ~IParameterSource() {}
+
+    /**
+     * @brief Read a bool parameter, return false if the source has no bool value of id
+     *
+     * @param id
+     * @param value
+     * @return true
+     * @return false
+     */
+    virtual bool readBool(int32_t id, bool &value) = 0;
+
+    /**
+     * @brief Write a bool parameter, return false if the source does not accept it
+     *
+     * @param id
+     * @param value
+     * @return true
+     * @return false
+     */
+    virtual bool writeBool(int32_t id, bool value) = 0;
+
+    /**
+     * @brief Read a int parameter, return false if the source has no int value of id
+     *
+     * @param id
+     * @param value
+     * @return true
+     * @return false
+     */
+    virtual bool readInt(int32_t id, int32_t &value) = 0;
+
+    /**
+     * @brief Write a int parameter, return false if the source does not accept it
+     *
+     * @param id
+     * @param value
+     * @return true
+     * @return false
+     */
+    virtual bool writeInt(int32_t id, int32_t value) = 0;
+
+    /**
+     * @brief Read a double parameter, return false if the source has no double value of id
+     *
+     * @param id
+     * @param value
+     * @return true
+     * @return false
+     */
+    virtual bool readDouble(int32_t id, double &value) = 0;
+
+    /**
+     * @brief Write a double parameter, return false if the source does not accept it
+     *
+     * @param id
+     * @param value
+     * @return true
+     * @return false
+     */
+    virtual bool writeDouble(int32_t id, double value) = 0;
+
+    /**
+     * @brief Read a string parameter, return false if the source has no string value of id
+     *
+     * @param id
+     * @param value
+     * @return true
+     * @return false
+     */
+    virtual bool readString(int32_t id, std::string &value) = 0;
+
+    /**
+     * @brief Write a string parameter, return false if the source does not accept it
+     *
+     * @param id
+     * @param value
+     * @return true
+     * @return false
+     */
+    virtual bool writeString(int32_t id, const std::string &value) = 0;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -14,6 +14,7 @@
 #include <signal.h>
 #include <ifaddrs.h>
 #include <poll.h>
+#include <fcntl.h>
 #include <string.h>
 #include <memory>
 
@@ -77,6 +78,28 @@ void closeConnection(SOCKET &socket) {
     }
 }
 
+void shutdownConnection(SOCKET socket) {
+    if(socket > 0) {
+        ::shutdown(socket, SHUT_RDWR);
+    }
+}
+
+void setNoDelay(SOCKET socket) {
+    int enable = 1;
+    if(setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable)) < 0) {
+        throw SparkError("error setting TCP_NODELAY: " + std::string(strerror(errno)));
+    }
+}
+
+bool isPeerClosed(SOCKET socket) {
+    char byte;
+    ssize_t size = ::recv(socket, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    if(size < 0) {
+        return errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR;
+    }
+    return size == 0;
+}
+
 void sendFixedTo(SOCKET socket, void *buff, uint32_t fixedSize) {
 
     ssize_t sentSize = ::send(socket, buff, fixedSize, MSG_NOSIGNAL);
@@ -105,6 +128,68 @@ void recvFixedFrom(SOCKET socket, void *buff, uint32_t fixedSize) {
     }
 }
 
+static void copyFixedFrom(SOCKET socket, int fd, uint64_t offset, uint64_t fixedSize) {
+    char buffer[64 * 1024];
+
+    while(fixedSize > 0) {
+        uint32_t size = fixedSize < sizeof(buffer) ? fixedSize : sizeof(buffer);
+        recvFixedFrom(socket, buffer, size);
+        for(uint32_t written = 0; written < size;) {
+            ssize_t ret = ::pwrite(fd, buffer + written, size - written, offset + written);
+            if(ret < 0 && errno == EINTR) {
+                continue;
+            }
+            if(ret <= 0) {
+                throw SparkError("error writing to file: " + std::string(strerror(errno)));
+            }
+            written += ret;
+        }
+        offset += size;
+        fixedSize -= size;
+    }
+}
+
+void spliceFixedFrom(SOCKET socket, int pipeFds[2], int fd, uint64_t offset, uint64_t fixedSize) {
+
+#ifdef SPLICE_F_MOVE
+    loff_t fileOffset = offset;
+    uint64_t moved = 0;
+
+    while(moved < fixedSize) {
+        // socket to pipe, at most the capacity of the pipe
+        ssize_t inPipe = ::splice(socket, nullptr, pipeFds[1], nullptr, fixedSize - moved, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if(inPipe < 0 && errno == EINTR) {
+            continue;
+        }
+        if(inPipe < 0 && moved == 0 && (errno == EINVAL || errno == ENOSYS)) {
+            copyFixedFrom(socket, fd, offset, fixedSize);
+            return;
+        }
+        if(inPipe <= 0) {
+            char errorBuff[1024];
+            sprintf(errorBuff, "just received %lu bytes of buffer, require minimum of %lu bytes, error: %s", moved, fixedSize, strerror(errno));
+            throw SparkError(std::string(errorBuff));
+        }
+
+        // pipe to file, the pipe must be drained before the next splice from the socket
+        while(inPipe > 0) {
+            ssize_t outPipe = ::splice(pipeFds[0], nullptr, fd, &fileOffset, inPipe, SPLICE_F_MOVE | SPLICE_F_MORE);
+            if(outPipe < 0 && errno == EINTR) {
+                continue;
+            }
+            if(outPipe <= 0) {
+                throw SparkError("error splicing to file: " + std::string(strerror(errno)));
+            }
+            inPipe -= outPipe;
+            moved += outPipe;
+        }
+    }
+#else
+    (void) pipeFds;
+    copyFixedFrom(socket, fd, offset, fixedSize);
+#endif
+}
+
 } // namespace network
 } // namespace protocol
 } // namespace libspark
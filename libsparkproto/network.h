@@ -18,6 +18,31 @@ int connectTcpSocket(const std::string &address, const std::string &service);
 
 void closeConnection(SOCKET &socket);
 
+/**
+ * @brief shut down both directions of a connection, so a thread blocked in receive returns.
+ * The socket is still to be closed with closeConnection
+ * 
+ * @param socket 
+ */
+void shutdownConnection(SOCKET socket);
+
+/**
+ * @brief send small messages without waiting for the acknowledgement of the previous ones (TCP_NODELAY)
+ * 
+ * @param socket 
+ */
+void setNoDelay(SOCKET socket);
+
+/**
+ * @brief check without blocking whether the peer closed or reset the connection.
+ * Data waiting to be received is left in the socket
+ * 
+ * @param socket 
+ * @return true 
+ * @return false 
+ */
+bool isPeerClosed(SOCKET socket);
+
 /**
  * @brief send fixedSize bytes to socket,
  * if the sent buffer size is not equal fixedSized, a exception will be thrown
@@ -38,6 +63,19 @@ void sendFixedTo(SOCKET socket, void *buff, uint32_t fixedSize);
  */
 void recvFixedFrom(SOCKET socket, void *buff, uint32_t fixedSize);
 
+/**
+ * @brief move fixedSize bytes from socket to file fd at offset without copying them to user space,
+ * with splice through pipeFds. Falls back to recv and pwrite when splice is not supported.
+ * if the moved size is not equal fixedSize, a exception will be thrown
+ *
+ * @param socket
+ * @param pipeFds pipe created by the caller, it's empty when the function returns
+ * @param fd
+ * @param offset
+ * @param fixedSize
+ */
+void spliceFixedFrom(SOCKET socket, int pipeFds[2], int fd, uint64_t offset, uint64_t fixedSize);
+
 
 } // namespace network
 } // namespace sparkprot
@@ -0,0 +1,169 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <libsparkproto/parameterbatch.h>
+#include <libsparkproto/parameters.pb.h>
+#include <libsparkproto/exception.h>
+
+namespace libspark {
+
+namespace protocol {
+
+size_t ParameterBatch::readBool(int32_t id) {
+    return add(ParameterType::PARAMETER_READ_BOOLEAN, id);
+}
+
+size_t ParameterBatch::writeBool(int32_t id, bool value) {
+    size_t i = add(ParameterType::PARAMETER_WRITE_BOOLEAN, id);
+    _operations[i].boolValue = value;
+    return i;
+}
+
+size_t ParameterBatch::readInt(int32_t id) {
+    return add(ParameterType::PARAMETER_READ_INT, id);
+}
+
+size_t ParameterBatch::writeInt(int32_t id, int32_t value) {
+    size_t i = add(ParameterType::PARAMETER_WRITE_INT, id);
+    _operations[i].intValue = value;
+    return i;
+}
+
+size_t ParameterBatch::readDouble(int32_t id) {
+    return add(ParameterType::PARAMETER_READ_DOUBLE, id);
+}
+
+size_t ParameterBatch::writeDouble(int32_t id, double value) {
+    size_t i = add(ParameterType::PARAMETER_WRITE_DOUBLE, id);
+    _operations[i].doubleValue = value;
+    return i;
+}
+
+size_t ParameterBatch::readString(int32_t id) {
+    return add(ParameterType::PARAMETER_READ_STRING, id);
+}
+
+size_t ParameterBatch::writeString(int32_t id, const std::string &value) {
+    size_t i = add(ParameterType::PARAMETER_WRITE_STRING, id);
+    _operations[i].stringValue = value;
+    return i;
+}
+
+size_t ParameterBatch::size() const {
+    return _operations.size();
+}
+
+void ParameterBatch::clear() {
+    _operations.clear();
+}
+
+int32_t ParameterBatch::id(size_t i) const {
+    return _operations.at(i).id;
+}
+
+bool ParameterBatch::succeeded(size_t i) const {
+    const Operation &operation = _operations.at(i);
+    return operation.executed && operation.error.empty();
+}
+
+const std::string& ParameterBatch::error(size_t i) const {
+    return _operations.at(i).error;
+}
+
+bool ParameterBatch::fromFallback(size_t i) const {
+    return _operations.at(i).fallback;
+}
+
+void ParameterBatch::setFallback(std::shared_ptr<IParameterSource> source) {
+    _fallback = source;
+}
+
+size_t ParameterBatch::failedCount() const {
+    size_t count = 0;
+    for(const Operation &operation : _operations) {
+        count += operation.error.empty() ? 0 : 1;
+    }
+    return count;
+}
+
+bool ParameterBatch::boolValue(size_t i) const {
+    return succeededOperation(i).boolValue;
+}
+
+int32_t ParameterBatch::intValue(size_t i) const {
+    return succeededOperation(i).intValue;
+}
+
+double ParameterBatch::doubleValue(size_t i) const {
+    return succeededOperation(i).doubleValue;
+}
+
+const std::string& ParameterBatch::stringValue(size_t i) const {
+    return succeededOperation(i).stringValue;
+}
+
+size_t ParameterBatch::add(int32_t type, int32_t id) {
+    Operation operation;
+    operation.type = type;
+    operation.id = id;
+    operation.boolValue = false;
+    operation.intValue = 0;
+    operation.doubleValue = 0.0;
+    operation.executed = false;
+    operation.fallback = false;
+    _operations.push_back(std::move(operation));
+    return _operations.size() - 1;
+}
+
+void ParameterBatch::fallBack(Operation &operation) {
+    if(!_fallback) {
+        return;
+    }
+
+    bool answered;
+    switch(operation.type) {
+    case ParameterType::PARAMETER_READ_BOOLEAN:
+        answered = _fallback->readBool(operation.id, operation.boolValue);
+        break;
+    case ParameterType::PARAMETER_WRITE_BOOLEAN:
+        answered = _fallback->writeBool(operation.id, operation.boolValue);
+        break;
+    case ParameterType::PARAMETER_READ_INT:
+        answered = _fallback->readInt(operation.id, operation.intValue);
+        break;
+    case ParameterType::PARAMETER_WRITE_INT:
+        answered = _fallback->writeInt(operation.id, operation.intValue);
+        break;
+    case ParameterType::PARAMETER_READ_DOUBLE:
+        answered = _fallback->readDouble(operation.id, operation.doubleValue);
+        break;
+    case ParameterType::PARAMETER_WRITE_DOUBLE:
+        answered = _fallback->writeDouble(operation.id, operation.doubleValue);
+        break;
+    case ParameterType::PARAMETER_READ_STRING:
+        answered = _fallback->readString(operation.id, operation.stringValue);
+        break;
+    default:
+        answered = _fallback->writeString(operation.id, operation.stringValue);
+        break;
+    }
+
+    if(answered) {
+        operation.fallback = true;
+        operation.error.clear();
+    }
+}
+
+const ParameterBatch::Operation& ParameterBatch::succeededOperation(size_t i) const {
+    const Operation &operation = _operations.at(i);
+    if(!operation.executed) {
+        throw SparkError("parameter " + std::to_string(operation.id) + " of the batch is not executed");
+    }
+    if(!operation.error.empty()) {
+        throw SparkError(operation.error);
+    }
+    return operation;
+}
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,278 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <libsparkproto/common.h>
+#include <libsparkproto/iparametersource.h>
+#include <libsparkproto/parameterregistry.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class ParameterProtocolImpl;
+
+/**
+ * @brief ParameterBatch is a list of parameter reads and writes which ParameterProtocol::execute() sends to the device
+ * in one round trip. Each operation succeeds or fails on its own, a failed operation keeps the error of the device
+ * and the rest of the batch is still executed.
+ *
+ * Operations are added in order and referred to by the index returned when they are added. A batch can be executed
+ * again, e.g. to poll the same parameters.
+ *
+ * The operations the device fails can fall back to a IParameterSource, e.g. a ParameterSimulator with the last known
+ * settings of the device, see setFallback().
+ *
+ */
+class SPARK_API ParameterBatch {
+
+public:
+    /**
+     * @brief Add a read of a bool parameter, return its index
+     *
+     * @param id
+     * @return size_t
+     */
+    size_t readBool(int32_t id);
+
+    /**
+     * @brief Add a write of a bool parameter, return its index
+     *
+     * @param id
+     * @param value
+     * @return size_t
+     */
+    size_t writeBool(int32_t id, bool value);
+
+    /**
+     * @brief Add a read of a int parameter, return its index
+     *
+     * @param id
+     * @return size_t
+     */
+    size_t readInt(int32_t id);
+
+    /**
+     * @brief Add a write of a int parameter, return its index
+     *
+     * @param id
+     * @param value
+     * @return size_t
+     */
+    size_t writeInt(int32_t id, int32_t value);
+
+    /**
+     * @brief Add a read of a double parameter, return its index
+     *
+     * @param id
+     * @return size_t
+     */
+    size_t readDouble(int32_t id);
+
+    /**
+     * @brief Add a write of a double parameter, return its index
+     *
+     * @param id
+     * @param value
+     * @return size_t
+     */
+    size_t writeDouble(int32_t id, double value);
+
+    /**
+     * @brief Add a read of a string parameter, return its index
+     *
+     * @param id
+     * @return size_t
+     */
+    size_t readString(int32_t id);
+
+    /**
+     * @brief Add a write of a string parameter, return its index
+     *
+     * @param id
+     * @param value
+     * @return size_t
+     */
+    size_t writeString(int32_t id, const std::string &value);
+
+    /**
+     * @brief Number of operations
+     *
+     * @return size_t
+     */
+    size_t size() const;
+
+    /**
+     * @brief Remove all operations
+     *
+     */
+    void clear();
+
+    /**
+     * @brief Id of the parameter of the operation i
+     *
+     * @param i
+     * @return int32_t
+     */
+    int32_t id(size_t i) const;
+
+    /**
+     * @brief Whether the operation i was executed without error
+     *
+     * @param i
+     * @return true
+     * @return false
+     */
+    bool succeeded(size_t i) const;
+
+    /**
+     * @brief Error of the operation i, empty if it succeeded
+     *
+     * @param i
+     * @return const std::string&
+     */
+    const std::string& error(size_t i) const;
+
+    /**
+     * @brief Whether the operation i was answered by the fallback after the device failed it
+     *
+     * @param i
+     * @return true
+     * @return false
+     */
+    bool fromFallback(size_t i) const;
+
+    /**
+     * @brief Set the source which answers the operations the device fails, null to remove it. Operations which are
+     * invalid by the registry of parameters or fail because the connection is broken do not fall back
+     *
+     * @param source
+     */
+    void setFallback(std::shared_ptr<IParameterSource> source);
+
+    /**
+     * @brief Number of operations which failed in the last execution
+     *
+     * @return size_t
+     */
+    size_t failedCount() const;
+
+    /**
+     * @brief Value read by the operation i. If it failed, a exception is thrown with its error
+     *
+     * @param i
+     * @return true
+     * @return false
+     */
+    bool boolValue(size_t i) const;
+
+    /**
+     * @brief Value read by the operation i. If it failed, a exception is thrown with its error
+     *
+     * @param i
+     * @return int32_t
+     */
+    int32_t intValue(size_t i) const;
+
+    /**
+     * @brief Value read by the operation i. If it failed, a exception is thrown with its error
+     *
+     * @param i
+     * @return double
+     */
+    double doubleValue(size_t i) const;
+
+    /**
+     * @brief Value read by the operation i. If it failed, a exception is thrown with its error
+     *
+     * @param i
+     * @return const std::string&
+     */
+    const std::string& stringValue(size_t i) const;
+
+    /**
+     * @brief Add a read of the parameter Id as the type of its ParameterTraits, return its index
+     *
+     * @tparam Id
+     * @return size_t
+     */
+    template<ParameterID Id>
+    size_t read() {
+        static_assert(ParameterTraits<Id>::descriptor().type != VALUE_DEVICEINFO, "device information is not read by a batch");
+        return addRead(Id, static_cast<typename ParameterTraits<Id>::Type*>(nullptr));
+    }
+
+    /**
+     * @brief Add a write of the parameter Id as the type of its ParameterTraits, return its index.
+     * The value is checked against the range of the parameter when the batch is executed
+     *
+     * @tparam Id
+     * @param value
+     * @return size_t
+     */
+    template<ParameterID Id>
+    size_t write(const typename ParameterTraits<Id>::Type &value) {
+        static_assert(!ParameterTraits<Id>::descriptor().readOnly, "parameter is read-only");
+        return addWrite(Id, value);
+    }
+
+    /**
+     * @brief Value of the parameter Id read by the operation i. If it failed, a exception is thrown with its error
+     *
+     * @tparam Id
+     * @param i
+     * @return ParameterTraits<Id>::Type
+     */
+    template<ParameterID Id>
+    typename ParameterTraits<Id>::Type value(size_t i) const {
+        static_assert(ParameterTraits<Id>::descriptor().type != VALUE_DEVICEINFO, "device information is not read by a batch");
+        return valueOf(i, static_cast<typename ParameterTraits<Id>::Type*>(nullptr));
+    }
+
+private:
+    friend class ParameterProtocolImpl;
+
+    // typed operations dispatched by the type of the value
+    size_t addRead(int32_t id, bool*) { return readBool(id); }
+    size_t addRead(int32_t id, int32_t*) { return readInt(id); }
+    size_t addRead(int32_t id, double*) { return readDouble(id); }
+    size_t addRead(int32_t id, std::string*) { return readString(id); }
+    size_t addWrite(int32_t id, bool value) { return writeBool(id, value); }
+    size_t addWrite(int32_t id, int32_t value) { return writeInt(id, value); }
+    size_t addWrite(int32_t id, double value) { return writeDouble(id, value); }
+    size_t addWrite(int32_t id, const std::string &value) { return writeString(id, value); }
+    bool valueOf(size_t i, bool*) const { return boolValue(i); }
+    int32_t valueOf(size_t i, int32_t*) const { return intValue(i); }
+    double valueOf(size_t i, double*) const { return doubleValue(i); }
+    const std::string& valueOf(size_t i, std::string*) const { return stringValue(i); }
+
+    struct Operation {
+        // ParameterType of the request
+        int32_t type;
+        int32_t id;
+        bool boolValue;
+        int32_t intValue;
+        double doubleValue;
+        std::string stringValue;
+        bool executed;
+        bool fallback;
+        std::string error;
+    };
+
+    size_t add(int32_t type, int32_t id);
+
+    // answer a operation the device failed by the fallback, the error is kept if it does not answer
+    void fallBack(Operation &operation);
+
+    const Operation& succeededOperation(size_t i) const;
+
+    std::vector<Operation> _operations;
+    std::shared_ptr<IParameterSource> _fallback;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,112 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <libsparkproto/parametercache.h>
+#include <libsparkproto/parameterregistry.h>
+#include <libsparkproto/parameters.pb.h>
+
+namespace libspark {
+
+namespace protocol {
+
+ParameterCache::ParameterCache(uint32_t ttl) : _ttl(ttl) {
+}
+
+bool ParameterCache::tracks(int32_t type) {
+    return type >= ParameterType::PARAMETER_READ_BOOLEAN && type <= ParameterType::PARAMETER_READ_DEVICEINFO;
+}
+
+bool ParameterCache::find(int32_t type, int32_t id, std::string &paramInfo) {
+    std::lock_guard<std::mutex> lock(_lock);
+    std::map<int32_t, Entry>::const_iterator it = _entries.find(id);
+    if(it == _entries.end() || it->second.type != type) {
+        return false;
+    }
+    if(it->second.expires < std::chrono::steady_clock::now()) {
+        _entries.erase(it);
+        return false;
+    }
+    if(isVolatile(id)) {
+        return false;
+    }
+
+    paramInfo = it->second.paramInfo;
+    return true;
+}
+
+void ParameterCache::update(int32_t type, int32_t id, const std::string &paramInfo, const ParameterResponse *responseMsg) {
+    std::lock_guard<std::mutex> lock(_lock);
+    bool write = type != ParameterType::PARAMETER_READ_DEVICEINFO && type % 2 == 0;
+
+    // a reset changes every parameter, and a mode changes the parameters it drives
+    if(write && id == ParameterID::CAMERA_RESET) {
+        _entries.clear();
+        return;
+    }
+    if(write) {
+        for(const ParameterDescriptor &parameter : registeredParameters()) {
+            if(parameter.drivenBy == id) {
+                _entries.erase(parameter.id);
+            }
+        }
+    }
+
+    std::map<int32_t, int32_t>::const_iterator ttl = _ttls.find(id);
+    int32_t ttlOfId = ttl == _ttls.end() ? int32_t(_ttl) : ttl->second;
+    if(!responseMsg || responseMsg->code() != ParameterResponse::RESPONSE_OK || ttlOfId < 0) {
+        // the value on the device is unknown
+        _entries.erase(id);
+        return;
+    }
+
+    Entry &entry = _entries[id];
+    entry.type = write ? type - 1 : type;
+    entry.paramInfo = write ? paramInfo : responseMsg->paraminfo();
+    entry.expires = ttlOfId ? std::chrono::steady_clock::now() + std::chrono::milliseconds(ttlOfId)
+                            : std::chrono::steady_clock::time_point::max();
+}
+
+void ParameterCache::setTtl(int32_t id, int32_t ttl) {
+    std::lock_guard<std::mutex> lock(_lock);
+    _ttls[id] = ttl;
+    // the value is cached again by the next read with the new time to live
+    _entries.erase(id);
+}
+
+void ParameterCache::invalidate(int32_t id) {
+    std::lock_guard<std::mutex> lock(_lock);
+    _entries.erase(id);
+}
+
+void ParameterCache::invalidateAll() {
+    std::lock_guard<std::mutex> lock(_lock);
+    _entries.clear();
+}
+
+void ParameterCache::cached(std::vector<int32_t> &ids, std::vector<int32_t> &types) {
+    std::lock_guard<std::mutex> lock(_lock);
+    ids.clear();
+    types.clear();
+    for(const std::pair<const int32_t, Entry> &item : _entries) {
+        ids.push_back(item.first);
+        types.push_back(item.second.type);
+    }
+}
+
+bool ParameterCache::isVolatile(int32_t id) {
+    // the parameters the device changes while their automatic mode is on
+    const ParameterDescriptor *parameter = findParameter(id);
+    if(!parameter || parameter->drivenBy == ParameterID::PARAMETER_UNKNOWN) {
+        return false;
+    }
+
+    std::map<int32_t, Entry>::const_iterator mode = _entries.find(parameter->drivenBy);
+    if(mode == _entries.end() || mode->second.expires < std::chrono::steady_clock::now()) {
+        return true;
+    }
+    ParameterInfoBool modeInfo;
+    return !modeInfo.ParseFromString(mode->second.paramInfo) || modeInfo.value();
+}
+
+} // namespace protocol
+} // namespace libspark
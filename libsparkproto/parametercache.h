@@ -0,0 +1,114 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace libspark {
+
+namespace protocol {
+
+class ParameterResponse; // defined at libsparkproto/parameters.pb.h
+
+/**
+ * @brief Values of parameters cached by ParameterProtocol, as the serialized parameter info of their last successful
+ * read or write. It is updated in the order the device answers the requests, so a cached value is never older than
+ * a request which was answered before it.
+ *
+ */
+class ParameterCache {
+
+public:
+
+    /**
+     * @brief Construct a new ParameterCache object, values expire after ttl milliseconds, 0 for never
+     *
+     * @param ttl
+     */
+    ParameterCache(uint32_t ttl);
+
+    /**
+     * @brief Whether requests of type go through the cache
+     *
+     * @param type ParameterType of a request
+     * @return true
+     * @return false
+     */
+    static bool tracks(int32_t type);
+
+    /**
+     * @brief Find the cached parameter info of id for a read of type, false if it is not cached, expired,
+     * of another type or volatile
+     *
+     * @param type ParameterType of the read
+     * @param id
+     * @param paramInfo
+     * @return true
+     * @return false
+     */
+    bool find(int32_t type, int32_t id, std::string &paramInfo);
+
+    /**
+     * @brief Update the cache with a request which is answered. paramInfo is the parameter info of a write,
+     * responseMsg is null if no response was received
+     *
+     * @param type ParameterType of the request
+     * @param id
+     * @param paramInfo
+     * @param responseMsg
+     */
+    void update(int32_t type, int32_t id, const std::string &paramInfo, const ParameterResponse *responseMsg);
+
+    /**
+     * @brief Set the time to live of id in milliseconds, 0 for never expiring, negative for not cached
+     *
+     * @param id
+     * @param ttl
+     */
+    void setTtl(int32_t id, int32_t ttl);
+
+    /**
+     * @brief Remove the value of id
+     *
+     * @param id
+     */
+    void invalidate(int32_t id);
+
+    /**
+     * @brief Remove all values
+     *
+     */
+    void invalidateAll();
+
+    /**
+     * @brief Ids and read types of the values in the cache
+     *
+     * @param ids
+     * @param types
+     */
+    void cached(std::vector<int32_t> &ids, std::vector<int32_t> &types);
+
+private:
+    struct Entry {
+        // ParameterType of the read which returns the value
+        int32_t type;
+        std::string paramInfo;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    // whether the value of id is changed by the device, i.e. its automatic mode is on or unknown. With _lock held
+    bool isVolatile(int32_t id);
+
+    std::mutex _lock;
+    std::map<int32_t, Entry> _entries;
+    std::map<int32_t, int32_t> _ttls;
+    uint32_t _ttl;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,263 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fstream>
+#include <sstream>
+
+#include <libsparkproto/parameterprofile.h>
+#include <libsparkproto/exception.h>
+
+namespace libspark {
+
+namespace protocol {
+
+// error of a value of type for id in a profile, empty if it's valid
+static std::string checkSetting(int32_t id, ParameterValueType type, int32_t value = 0) {
+    std::string error = checkParameterWrite(id, type, value);
+    if(error.empty() && findParameter(id)->command) {
+        error = std::string("parameter ") + findParameter(id)->name + " is a command, not a setting";
+    }
+    return error;
+}
+
+static const ParameterDescriptor* findParameterByName(const std::string &name) {
+    for(const ParameterDescriptor &parameter : registeredParameters()) {
+        if(name == parameter.name) {
+            return &parameter;
+        }
+    }
+    return nullptr;
+}
+
+static std::string trim(const std::string &text) {
+    size_t begin = text.find_first_not_of(" \t\r");
+    if(begin == std::string::npos) {
+        return std::string();
+    }
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+void ParameterProfile::setBool(int32_t id, bool value) {
+    std::string error = checkSetting(id, VALUE_BOOL, value);
+    if(!error.empty()) {
+        throw SparkError(error);
+    }
+
+    Value setting = {VALUE_BOOL, value, 0, 0.0, std::string()};
+    set(id, setting);
+}
+
+void ParameterProfile::setInt(int32_t id, int32_t value) {
+    std::string error = checkSetting(id, VALUE_INT, value);
+    if(!error.empty()) {
+        throw SparkError(error);
+    }
+
+    Value setting = {VALUE_INT, false, value, 0.0, std::string()};
+    set(id, setting);
+}
+
+void ParameterProfile::setDouble(int32_t id, double value) {
+    std::string error = checkSetting(id, VALUE_DOUBLE);
+    if(!error.empty()) {
+        throw SparkError(error);
+    }
+
+    Value setting = {VALUE_DOUBLE, false, 0, value, std::string()};
+    set(id, setting);
+}
+
+void ParameterProfile::setString(int32_t id, const std::string &value) {
+    std::string error = checkSetting(id, VALUE_STRING);
+    if(!error.empty()) {
+        throw SparkError(error);
+    }
+    // a value is one line of the serialized profile
+    if(value.find_first_of("\r\n") != std::string::npos) {
+        throw SparkError(std::string("value of ") + findParameter(id)->name + " can not have a line break");
+    }
+
+    Value setting = {VALUE_STRING, false, 0, 0.0, value};
+    set(id, setting);
+}
+
+bool ParameterProfile::contains(int32_t id) const {
+    return _values.find(id) != _values.end();
+}
+
+void ParameterProfile::remove(int32_t id) {
+    _values.erase(id);
+}
+
+size_t ParameterProfile::size() const {
+    return _values.size();
+}
+
+std::vector<int32_t> ParameterProfile::ids() const {
+    std::vector<int32_t> ids;
+    for(const std::pair<const int32_t, Value> &item : _values) {
+        ids.push_back(item.first);
+    }
+    return ids;
+}
+
+bool ParameterProfile::boolValue(int32_t id) const {
+    return valueOf(id, VALUE_BOOL).boolValue;
+}
+
+int32_t ParameterProfile::intValue(int32_t id) const {
+    return valueOf(id, VALUE_INT).intValue;
+}
+
+double ParameterProfile::doubleValue(int32_t id) const {
+    return valueOf(id, VALUE_DOUBLE).doubleValue;
+}
+
+const std::string& ParameterProfile::stringValue(int32_t id) const {
+    return valueOf(id, VALUE_STRING).stringValue;
+}
+
+std::string ParameterProfile::serialize() const {
+    std::ostringstream text;
+    text << "# parameter profile of libsparkproto" << std::endl;
+    for(const std::pair<const int32_t, Value> &item : _values) {
+        const Value &value = item.second;
+        text << findParameter(item.first)->name << "=";
+        switch(value.type) {
+        case VALUE_BOOL:
+            text << (value.boolValue ? "true" : "false");
+            break;
+        case VALUE_INT:
+            text << value.intValue;
+            break;
+        case VALUE_DOUBLE: {
+            // enough digits to read the same double back
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "%.17g", value.doubleValue);
+            text << buffer;
+            break;
+        }
+        default:
+            text << value.stringValue;
+            break;
+        }
+        text << std::endl;
+    }
+    return text.str();
+}
+
+ParameterProfile ParameterProfile::parse(const std::string &text) {
+    ParameterProfile profile;
+    std::istringstream lines(text);
+    std::string line;
+    for(int32_t number = 1; std::getline(lines, line); number++) {
+        std::string prefix = "line " + std::to_string(number) + " of profile: ";
+        line = trim(line);
+        if(line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        size_t separator = line.find('=');
+        if(separator == std::string::npos) {
+            throw SparkError(prefix + "expected NAME=value");
+        }
+        std::string name = trim(line.substr(0, separator));
+        std::string value = trim(line.substr(separator + 1));
+        const ParameterDescriptor *parameter = findParameterByName(name);
+        if(!parameter) {
+            throw SparkError(prefix + "unknown parameter " + name);
+        }
+
+        // the value is checked before it is set, so errors have the number of the line
+        char *end = nullptr;
+        errno = 0;
+        std::string error;
+        switch(parameter->type) {
+        case VALUE_BOOL:
+            if(value != "true" && value != "false" && value != "1" && value != "0") {
+                throw SparkError(prefix + "value of " + name + " is not a bool");
+            }
+            error = checkSetting(parameter->id, VALUE_BOOL);
+            if(error.empty()) {
+                profile.setBool(parameter->id, value == "true" || value == "1");
+            }
+            break;
+        case VALUE_INT: {
+            long number = strtol(value.c_str(), &end, 10);
+            if(value.empty() || *end || errno == ERANGE || number < PARAMETER_INT_MIN || number > PARAMETER_INT_MAX) {
+                throw SparkError(prefix + "value of " + name + " is not a int");
+            }
+            error = checkSetting(parameter->id, VALUE_INT, int32_t(number));
+            if(error.empty()) {
+                profile.setInt(parameter->id, int32_t(number));
+            }
+            break;
+        }
+        case VALUE_DOUBLE: {
+            double number = strtod(value.c_str(), &end);
+            if(value.empty() || *end || errno == ERANGE) {
+                throw SparkError(prefix + "value of " + name + " is not a double");
+            }
+            error = checkSetting(parameter->id, VALUE_DOUBLE);
+            if(error.empty()) {
+                profile.setDouble(parameter->id, number);
+            }
+            break;
+        }
+        default:
+            error = checkSetting(parameter->id, parameter->type);
+            if(error.empty()) {
+                profile.setString(parameter->id, value);
+            }
+            break;
+        }
+        if(!error.empty()) {
+            throw SparkError(prefix + error);
+        }
+    }
+    return profile;
+}
+
+void ParameterProfile::save(const std::string &filename) const {
+    std::ofstream file(filename);
+    if(!file.is_open()) {
+        throw SparkError("can not open file " + filename);
+    }
+    file << serialize();
+    if(!file.good()) {
+        throw SparkError("can not write file " + filename);
+    }
+}
+
+ParameterProfile ParameterProfile::load(const std::string &filename) {
+    std::ifstream file(filename);
+    if(!file.is_open()) {
+        throw SparkError("can not open file " + filename);
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    return parse(text.str());
+}
+
+void ParameterProfile::set(int32_t id, Value &value) {
+    _values[id] = std::move(value);
+}
+
+const ParameterProfile::Value& ParameterProfile::valueOf(int32_t id, ParameterValueType type) const {
+    std::map<int32_t, Value>::const_iterator it = _values.find(id);
+    if(it == _values.end()) {
+        throw SparkError("parameter " + std::to_string(id) + " is not in the profile");
+    }
+    std::string error = checkParameterRead(id, type);
+    if(!error.empty()) {
+        throw SparkError(error);
+    }
+    return it->second;
+}
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,213 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <libsparkproto/common.h>
+#include <libsparkproto/parameterregistry.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class DeviceParamConfigureImpl;
+
+/**
+ * @brief Result of applying a ParameterProfile to a device
+ *
+ */
+struct SPARK_API ProfileResult {
+    // whether every parameter of the profile which differed from the device was written
+    bool succeeded = false;
+    // parameters written, because the device had another value
+    size_t writtenCount = 0;
+    // parameters which the device already had
+    size_t unchangedCount = 0;
+    // parameters not written because the profile turns on the automatic mode which drives them
+    size_t overriddenCount = 0;
+    // errors of the device or of the connection, empty if succeeded
+    std::string error;
+};
+
+/**
+ * @brief ParameterProfile is a set of values of the settings of a device, e.g. a known-good configuration taken by
+ * DeviceParamConfigure::snapshotProfile() and pushed to devices by DeviceParamConfigure::applyProfile().
+ * Values are checked against the registry of parameters when they are set, see parameterregistry.h.
+ *
+ * A profile is serialized as text, one NAME=value line per parameter with the names of the registry. Lines starting
+ * with # are comments.
+ *
+ */
+class SPARK_API ParameterProfile {
+
+public:
+    /**
+     * @brief Set the value of a bool parameter. If the parameter is not a bool setting, a exception is thrown
+     *
+     * @param id
+     * @param value
+     */
+    void setBool(int32_t id, bool value);
+
+    /**
+     * @brief Set the value of a int parameter. If the parameter is not a int setting or value is out of its range,
+     * a exception is thrown
+     *
+     * @param id
+     * @param value
+     */
+    void setInt(int32_t id, int32_t value);
+
+    /**
+     * @brief Set the value of a double parameter. If the parameter is not a double setting, a exception is thrown
+     *
+     * @param id
+     * @param value
+     */
+    void setDouble(int32_t id, double value);
+
+    /**
+     * @brief Set the value of a string parameter. If the parameter is not a string setting or value has a line break,
+     * a exception is thrown
+     *
+     * @param id
+     * @param value
+     */
+    void setString(int32_t id, const std::string &value);
+
+    /**
+     * @brief Set the value of the parameter Id as the type of its ParameterTraits
+     *
+     * @tparam Id
+     * @param value
+     */
+    template<ParameterID Id>
+    void set(const typename ParameterTraits<Id>::Type &value) {
+        static_assert(!ParameterTraits<Id>::descriptor().readOnly, "parameter is read-only");
+        static_assert(!ParameterTraits<Id>::descriptor().command, "parameter is a command, not a setting");
+        setValue(Id, value);
+    }
+
+    /**
+     * @brief Whether the profile has a value of id
+     *
+     * @param id
+     * @return true
+     * @return false
+     */
+    bool contains(int32_t id) const;
+
+    /**
+     * @brief Remove the value of id
+     *
+     * @param id
+     */
+    void remove(int32_t id);
+
+    /**
+     * @brief Number of parameters of the profile
+     *
+     * @return size_t
+     */
+    size_t size() const;
+
+    /**
+     * @brief Ids of the parameters of the profile, in the order they are written
+     *
+     * @return std::vector<int32_t>
+     */
+    std::vector<int32_t> ids() const;
+
+    /**
+     * @brief Value of a bool parameter. If the profile has no bool value of id, a exception is thrown
+     *
+     * @param id
+     * @return true
+     * @return false
+     */
+    bool boolValue(int32_t id) const;
+
+    /**
+     * @brief Value of a int parameter. If the profile has no int value of id, a exception is thrown
+     *
+     * @param id
+     * @return int32_t
+     */
+    int32_t intValue(int32_t id) const;
+
+    /**
+     * @brief Value of a double parameter. If the profile has no double value of id, a exception is thrown
+     *
+     * @param id
+     * @return double
+     */
+    double doubleValue(int32_t id) const;
+
+    /**
+     * @brief Value of a string parameter. If the profile has no string value of id, a exception is thrown
+     *
+     * @param id
+     * @return const std::string&
+     */
+    const std::string& stringValue(int32_t id) const;
+
+    /**
+     * @brief Serialize the profile as text
+     *
+     * @return std::string
+     */
+    std::string serialize() const;
+
+    /**
+     * @brief Parse a profile serialized by serialize(). If a line is invalid, a exception is thrown with its number
+     *
+     * @param text
+     * @return ParameterProfile
+     */
+    static ParameterProfile parse(const std::string &text);
+
+    /**
+     * @brief Save the profile to a file. If the file can not be written, a exception is thrown
+     *
+     * @param filename
+     */
+    void save(const std::string &filename) const;
+
+    /**
+     * @brief Load a profile from a file saved by save(). If the file can not be read or is invalid,
+     * a exception is thrown
+     *
+     * @param filename
+     * @return ParameterProfile
+     */
+    static ParameterProfile load(const std::string &filename);
+
+private:
+    friend class DeviceParamConfigureImpl;
+
+    struct Value {
+        ParameterValueType type;
+        bool boolValue;
+        int32_t intValue;
+        double doubleValue;
+        std::string stringValue;
+    };
+
+    // typed values dispatched by the type of the value
+    void setValue(int32_t id, bool value) { setBool(id, value); }
+    void setValue(int32_t id, int32_t value) { setInt(id, value); }
+    void setValue(int32_t id, double value) { setDouble(id, value); }
+    void setValue(int32_t id, const std::string &value) { setString(id, value); }
+
+    void set(int32_t id, Value &value);
+    const Value& valueOf(int32_t id, ParameterValueType type) const;
+
+    // in the order of ids, which writes the modes before the values they drive
+    std::map<int32_t, Value> _values;
+};
+
+} // namespace protocol
+} // namespace libspark
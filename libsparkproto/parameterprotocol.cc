@@ -8,8 +8,8 @@ namespace libspark {
 
 namespace protocol {
 
-ParameterProtocol::ParameterProtocol(const std::string &address, const std::string &service) 
-    : _pImpl(new ParameterProtocolImpl(address, service)){
+ParameterProtocol::ParameterProtocol(const std::string &address, const std::string &service,
+    const ParameterProtocolOptions &options) : _pImpl(new ParameterProtocolImpl(address, service, options)){
 
 }
 
@@ -49,9 +49,105 @@ void ParameterProtocol::writeStringParameter(int32_t id, const std::string &valu
     _pImpl->writeStringParameter(id, value);
 }
 
+std::future<bool> ParameterProtocol::readBoolParameterAsync(int32_t id) {
+    return _pImpl->readBoolParameterAsync(id);
+}
+
+void ParameterProtocol::readBoolParameterAsync(int32_t id, ParameterReadCallback<bool> callback) {
+    _pImpl->readBoolParameterAsync(id, std::move(callback));
+}
+
+std::future<void> ParameterProtocol::writeBoolParameterAsync(int32_t id, bool value) {
+    return _pImpl->writeBoolParameterAsync(id, value);
+}
+
+void ParameterProtocol::writeBoolParameterAsync(int32_t id, bool value, ParameterWriteCallback callback) {
+    _pImpl->writeBoolParameterAsync(id, value, std::move(callback));
+}
+
+std::future<int32_t> ParameterProtocol::readIntParameterAsync(int32_t id) {
+    return _pImpl->readIntParameterAsync(id);
+}
+
+void ParameterProtocol::readIntParameterAsync(int32_t id, ParameterReadCallback<int32_t> callback) {
+    _pImpl->readIntParameterAsync(id, std::move(callback));
+}
+
+std::future<void> ParameterProtocol::writeIntParameterAsync(int32_t id, int32_t value) {
+    return _pImpl->writeIntParameterAsync(id, value);
+}
+
+void ParameterProtocol::writeIntParameterAsync(int32_t id, int32_t value, ParameterWriteCallback callback) {
+    _pImpl->writeIntParameterAsync(id, value, std::move(callback));
+}
+
+std::future<double> ParameterProtocol::readDoubleParameterAsync(int32_t id) {
+    return _pImpl->readDoubleParameterAsync(id);
+}
+
+void ParameterProtocol::readDoubleParameterAsync(int32_t id, ParameterReadCallback<double> callback) {
+    _pImpl->readDoubleParameterAsync(id, std::move(callback));
+}
+
+std::future<void> ParameterProtocol::writeDoubleParameterAsync(int32_t id, double value) {
+    return _pImpl->writeDoubleParameterAsync(id, value);
+}
+
+void ParameterProtocol::writeDoubleParameterAsync(int32_t id, double value, ParameterWriteCallback callback) {
+    _pImpl->writeDoubleParameterAsync(id, value, std::move(callback));
+}
+
+std::future<std::string> ParameterProtocol::readStringParameterAsync(int32_t id) {
+    return _pImpl->readStringParameterAsync(id);
+}
+
+void ParameterProtocol::readStringParameterAsync(int32_t id, ParameterReadCallback<std::string> callback) {
+    _pImpl->readStringParameterAsync(id, std::move(callback));
+}
+
+std::future<void> ParameterProtocol::writeStringParameterAsync(int32_t id, const std::string &value) {
+    return _pImpl->writeStringParameterAsync(id, value);
+}
+
+void ParameterProtocol::writeStringParameterAsync(int32_t id, const std::string &value, ParameterWriteCallback callback) {
+    _pImpl->writeStringParameterAsync(id, value, std::move(callback));
+}
+
+void ParameterProtocol::setCacheTtl(int32_t id, int32_t ttl) {
+    _pImpl->setCacheTtl(id, ttl);
+}
+
+void ParameterProtocol::invalidateCache(int32_t id) {
+    _pImpl->invalidateCache(id);
+}
+
+void ParameterProtocol::invalidateCache() {
+    _pImpl->invalidateCache();
+}
+
+void ParameterProtocol::refreshCache() {
+    _pImpl->refreshCache();
+}
+
 void ParameterProtocol::readDeviceInfoMsg(DeviceInfoMessage &deviceInfoMsg) {
     _pImpl->readDeviceInfoMsg(deviceInfoMsg);
 }
 
+void ParameterProtocol::execute(ParameterBatch &batch) {
+    _pImpl->execute(batch);
+}
+
+bool ParameterProtocol::isConnected() {
+    return _pImpl->isConnected();
+}
+
+bool ParameterProtocol::ping(uint32_t timeout) {
+    return _pImpl->ping(timeout);
+}
+
+size_t ParameterProtocol::pendingCount() {
+    return _pImpl->pendingCount();
+}
+
 }
 }
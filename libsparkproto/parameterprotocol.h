@@ -3,7 +3,12 @@
 
 #pragma once
 
+#include <functional>
+#include <future>
 #include <memory>
+#include <string>
+#include <libsparkproto/common.h>
+#include <libsparkproto/parameterbatch.h>
 
 namespace libspark {
 
@@ -11,15 +16,79 @@ namespace protocol {
 
 class DeviceInfoMessage; // defined at libsparkproto/device.pb.h
 class ParameterProtocolImpl;
+
+/**
+ * @brief Options of ParameterProtocol
+ *
+ */
+struct SPARK_API ParameterProtocolOptions {
+    // requests sent on the connection before their responses arrive. Requests of concurrent callers and of a batch
+    // are pipelined up to the window, so throughput scales with it instead of one request per round trip
+    uint32_t window = 16;
+
+    // cache the values of parameters read and written successfully, so reads of unchanged parameters are answered
+    // without a request. Exposure, gain and white balance are not cached while their automatic mode is on or unknown
+    bool enableCache = false;
+    // time to live of cached values in milliseconds, 0 for never expiring. It can be set per parameter by
+    // ParameterProtocol::setCacheTtl()
+    uint32_t cacheTtl = 1000;
+};
+
+/**
+ * @brief Result of a asynchronous parameter write, passed to its callback
+ *
+ */
+struct SPARK_API ParameterStatus {
+    // whether the device accepted the request
+    bool succeeded = false;
+    // ParameterResponse code of the device, 0 if no response was received, e.g. the connection is broken
+    int32_t code = 0;
+    // error of the device or of the connection, empty if succeeded
+    std::string message;
+};
+
+/**
+ * @brief Result of a asynchronous parameter read, passed to its callback
+ *
+ */
+template<typename T>
+struct ParameterResult : public ParameterStatus {
+    // value read, valid if succeeded
+    T value = T();
+};
+
+template<typename T>
+using ParameterReadCallback = std::function<void(const ParameterResult<T> &result)>;
+using ParameterWriteCallback = std::function<void(const ParameterStatus &status)>;
+
+/**
+ * @brief ParameterProtocol reads and writes parameters of a device on a TCP connection. Requests of concurrent callers
+ * are pipelined on the connection, and a thread of the protocol matches the responses to them in order.
+ * All functions are thread-safe. If the connection breaks, the requests in flight and all further requests fail
+ * with a exception.
+ *
+ * The *Async functions never wait for the device. The future version completes the future with the value, or with
+ * a exception of the error of the device. The callback version passes the result with ParameterResponse code and
+ * message to the callback, which is called on a I/O thread of the protocol, or on the calling thread if the
+ * connection is already broken. Callbacks must not block, nor make synchronous requests on the same protocol.
+ * Requests which are not answered when the protocol is destroyed fail.
+ *
+ * Requests are checked against the registry of parameters before they are sent, see parameterregistry.h. A read or
+ * write of a parameter as another type, a write of a read-only parameter or of a int value out of range throws a
+ * exception without a request, and fails its operation in a batch. read() and write() check the type at compile time.
+ *
+ */
 class ParameterProtocol {
 
 public:
 
     /**
-     * @brief Construct a new ParameterProtocol object
+     * @brief Construct a new ParameterProtocol object connected to the device.
+     * If the connection can not be made or options are invalid, a exception is thrown
      * 
      */
-    ParameterProtocol(const std::string &address, const std::string &service);
+    ParameterProtocol(const std::string &address, const std::string &service,
+        const ParameterProtocolOptions &options = ParameterProtocolOptions());
 
     /**
      * @brief Destroy the ParameterProtocol object
@@ -93,6 +162,180 @@ public:
      */
     void writeStringParameter(int32_t id, const std::string &value);
 
+    /**
+     * @brief read a bool value from device by id asynchronously.
+     * If id is invalid, a exception is thrown
+     * 
+     * @param id 
+     * @return std::future<bool> 
+     */
+    std::future<bool> readBoolParameterAsync(int32_t id);
+
+    /**
+     * @brief read a bool value from device by id asynchronously, callback is called with the result
+     * 
+     * @param id 
+     * @param callback 
+     */
+    void readBoolParameterAsync(int32_t id, ParameterReadCallback<bool> callback);
+
+    /**
+     * @brief write a bool value by id to device asynchronously.
+     * If id is invalid, a exception is thrown
+     * 
+     * @param id 
+     * @param value 
+     * @return std::future<void> 
+     */
+    std::future<void> writeBoolParameterAsync(int32_t id, bool value);
+
+    /**
+     * @brief write a bool value by id to device asynchronously, callback is called with the result
+     * 
+     * @param id 
+     * @param value 
+     * @param callback 
+     */
+    void writeBoolParameterAsync(int32_t id, bool value, ParameterWriteCallback callback);
+
+    /**
+     * @brief read a int value from device by id asynchronously.
+     * If id is invalid, a exception is thrown
+     * 
+     * @param id 
+     * @return std::future<int32_t> 
+     */
+    std::future<int32_t> readIntParameterAsync(int32_t id);
+
+    /**
+     * @brief read a int value from device by id asynchronously, callback is called with the result
+     * 
+     * @param id 
+     * @param callback 
+     */
+    void readIntParameterAsync(int32_t id, ParameterReadCallback<int32_t> callback);
+
+    /**
+     * @brief write a int value by id to device asynchronously.
+     * If id is invalid, a exception is thrown
+     * 
+     * @param id 
+     * @param value 
+     * @return std::future<void> 
+     */
+    std::future<void> writeIntParameterAsync(int32_t id, int32_t value);
+
+    /**
+     * @brief write a int value by id to device asynchronously, callback is called with the result
+     * 
+     * @param id 
+     * @param value 
+     * @param callback 
+     */
+    void writeIntParameterAsync(int32_t id, int32_t value, ParameterWriteCallback callback);
+
+    /**
+     * @brief read a double value from device by id asynchronously.
+     * If id is invalid, a exception is thrown
+     * 
+     * @param id 
+     * @return std::future<double> 
+     */
+    std::future<double> readDoubleParameterAsync(int32_t id);
+
+    /**
+     * @brief read a double value from device by id asynchronously, callback is called with the result
+     * 
+     * @param id 
+     * @param callback 
+     */
+    void readDoubleParameterAsync(int32_t id, ParameterReadCallback<double> callback);
+
+    /**
+     * @brief write a double value by id to device asynchronously.
+     * If id is invalid, a exception is thrown
+     * 
+     * @param id 
+     * @param value 
+     * @return std::future<void> 
+     */
+    std::future<void> writeDoubleParameterAsync(int32_t id, double value);
+
+    /**
+     * @brief write a double value by id to device asynchronously, callback is called with the result
+     * 
+     * @param id 
+     * @param value 
+     * @param callback 
+     */
+    void writeDoubleParameterAsync(int32_t id, double value, ParameterWriteCallback callback);
+
+    /**
+     * @brief read a string value from device by id asynchronously.
+     * If id is invalid, a exception is thrown
+     * 
+     * @param id 
+     * @return std::future<std::string> 
+     */
+    std::future<std::string> readStringParameterAsync(int32_t id);
+
+    /**
+     * @brief read a string value from device by id asynchronously, callback is called with the result
+     * 
+     * @param id 
+     * @param callback 
+     */
+    void readStringParameterAsync(int32_t id, ParameterReadCallback<std::string> callback);
+
+    /**
+     * @brief write a string value by id to device asynchronously.
+     * If id is invalid, a exception is thrown
+     * 
+     * @param id 
+     * @param value 
+     * @return std::future<void> 
+     */
+    std::future<void> writeStringParameterAsync(int32_t id, const std::string &value);
+
+    /**
+     * @brief write a string value by id to device asynchronously, callback is called with the result
+     * 
+     * @param id 
+     * @param value 
+     * @param callback 
+     */
+    void writeStringParameterAsync(int32_t id, const std::string &value, ParameterWriteCallback callback);
+
+    /**
+     * @brief Set the time to live of a cached parameter in milliseconds, 0 for never expiring, negative for not cached.
+     * It has no effect unless the cache is enabled, see ParameterProtocolOptions.
+     * If id is invalid, a exception is thrown
+     * 
+     * @param id 
+     * @param ttl 
+     */
+    void setCacheTtl(int32_t id, int32_t ttl);
+
+    /**
+     * @brief Remove a parameter from the cache, e.g. after it was changed by another client
+     * 
+     * @param id 
+     */
+    void invalidateCache(int32_t id);
+
+    /**
+     * @brief Remove all parameters from the cache
+     * 
+     */
+    void invalidateCache();
+
+    /**
+     * @brief Read the parameters in the cache again from the device, back to back.
+     * A parameter which can not be read is removed from the cache. If the connection fails, a exception is thrown
+     * 
+     */
+    void refreshCache();
+
     /**
      * @brief read detail informations of device. The information is defined as a protobuf message, DeviceInfoMessage.
      * 
@@ -100,7 +343,82 @@ public:
      */
     void readDeviceInfoMsg(DeviceInfoMessage &deviceInfoMsg);
 
+    /**
+     * @brief execute the reads and writes of a batch in one round trip. Requests are sent back to back and
+     * their responses are read in order, a failed operation does not stop the rest of the batch, see ParameterBatch.
+     * Operations the device fails are answered by the fallback of the batch, if it has one.
+     * If the connection fails, the operations which got no response fail with its error
+     * 
+     * @param batch 
+     */
+    void execute(ParameterBatch &batch);
+
+    /**
+     * @brief whether the connection is open. Once it is broken, all requests fail and a new protocol
+     * has to be connected
+     * 
+     * @return true 
+     * @return false 
+     */
+    bool isConnected();
+
+    /**
+     * @brief check the connection with a request which bypasses the cache. Return false if the connection is broken
+     * or the device does not answer within timeout milliseconds. On a timeout the connection is closed, the requests
+     * waiting on it fail and isConnected() returns false
+     * 
+     * @param timeout 
+     * @return true 
+     * @return false 
+     */
+    bool ping(uint32_t timeout = 1000);
+
+    /**
+     * @brief number of requests waiting to be sent or for their response, of all callers
+     * 
+     * @return size_t 
+     */
+    size_t pendingCount();
+
+    /**
+     * @brief read the parameter Id as the type of its ParameterTraits, e.g. read<MANUAL_GAIN>() returns a int32_t.
+     * Reads of a parameter which is not registered don't compile
+     * 
+     * @tparam Id 
+     * @return ParameterTraits<Id>::Type 
+     */
+    template<ParameterID Id>
+    typename ParameterTraits<Id>::Type read() {
+        typename ParameterTraits<Id>::Type value;
+        readValue(Id, value);
+        return value;
+    }
+
+    /**
+     * @brief write the parameter Id as the type of its ParameterTraits. Writes of a read-only parameter don't compile,
+     * if value is out of the range of the parameter, a exception is thrown without a request
+     * 
+     * @tparam Id 
+     * @param value 
+     */
+    template<ParameterID Id>
+    void write(const typename ParameterTraits<Id>::Type &value) {
+        static_assert(!ParameterTraits<Id>::descriptor().readOnly, "parameter is read-only");
+        writeValue(Id, value);
+    }
+
 private:
+    // typed reads and writes dispatched by the type of the value
+    void readValue(int32_t id, bool &value) { value = readBoolParameter(id); }
+    void readValue(int32_t id, int32_t &value) { value = readIntParameter(id); }
+    void readValue(int32_t id, double &value) { value = readDoubleParameter(id); }
+    void readValue(int32_t id, std::string &value) { value = readStringParameter(id); }
+    void readValue(int32_t, DeviceInfoMessage &value) { readDeviceInfoMsg(value); }
+    void writeValue(int32_t id, bool value) { writeBoolParameter(id, value); }
+    void writeValue(int32_t id, int32_t value) { writeIntParameter(id, value); }
+    void writeValue(int32_t id, double value) { writeDoubleParameter(id, value); }
+    void writeValue(int32_t id, const std::string &value) { writeStringParameter(id, value); }
+
     std::unique_ptr<ParameterProtocolImpl> _pImpl;
 
 };
@@ -2,27 +2,74 @@
 // SPDX-License-Identifier: BSD 3-Clause
 
 
+#include <algorithm>
+
 #include <libsparkproto/parameterprotocolimpl_unix.h>
+#include <libsparkproto/parametercache.h>
 #include <libsparkproto/parameterids.pb.h>
 #include <libsparkproto/parameters.pb.h>
 #include <libsparkproto/exception.h>
 #include <libsparkproto/network.h>
+#include <libsparkproto/log.h>
 
 namespace libspark {
 
 namespace protocol {
 
-ParameterProtocolImpl::ParameterProtocolImpl(const std::string &address, const std::string &service) {
+ParameterProtocolImpl::ParameterProtocolImpl(const std::string &address, const std::string &service,
+    const ParameterProtocolOptions &options) : _options(options), _stop(false) {
+
+    if(!options.window) {
+        throw SparkError("window of requests in flight must be at least 1");
+    }
+    if(options.enableCache) {
+        _cache.reset(new ParameterCache(options.cacheTtl));
+    }
     _socket = network::connectTcpSocket(address, service);
+    try {
+        // pipelined requests are sent without waiting for the acknowledgement of the previous ones
+        network::setNoDelay(_socket);
+
+        _sendThread = std::thread(&ParameterProtocolImpl::sendLoop, this);
+        _recvThread = std::thread(&ParameterProtocolImpl::recvLoop, this);
+    } catch (...) {
+        // the destructor does not run, the thread started and the socket are released here
+        {
+            std::lock_guard<std::mutex> lock(_queueLock);
+            _stop = true;
+        }
+        _queueCond.notify_all();
+        network::shutdownConnection(_socket);
+        if(_sendThread.joinable()) {
+            _sendThread.join();
+        }
+        network::closeConnection(_socket);
+        throw;
+    }
 }
 
 ParameterProtocolImpl::~ParameterProtocolImpl() {
+    {
+        std::lock_guard<std::mutex> lock(_queueLock);
+        _stop = true;
+    }
+    _queueCond.notify_all();
+
+    // requests still in flight fail as the receive returns
+    network::shutdownConnection(_socket);
+    if(_sendThread.joinable()) {
+        _sendThread.join();
+    }
+    if(_recvThread.joinable()) {
+        _recvThread.join();
+    }
+    fail("parameter protocol is closed");
     network::closeConnection(_socket);
 }
 
 bool ParameterProtocolImpl::readBoolParameter(int32_t id) {
 
-    throwErrorIfInvalid(id);
+    throwErrorIfInvalidRead(id, VALUE_BOOL);
 
     ParameterInfoBool paramInfo;
     paramInfo.set_id(ParameterID(id));
@@ -32,7 +79,7 @@ bool ParameterProtocolImpl::readBoolParameter(int32_t id) {
 
 void ParameterProtocolImpl::writeBoolParameter(int32_t id, bool value) {
    
-    throwErrorIfInvalid(id);
+    throwErrorIfInvalidWrite(id, VALUE_BOOL, value);
 
     ParameterInfoBool paramInfo;
     paramInfo.set_id(ParameterID(id));
@@ -43,7 +90,7 @@ void ParameterProtocolImpl::writeBoolParameter(int32_t id, bool value) {
 
 int32_t ParameterProtocolImpl::readIntParameter(int32_t id) {
 
-    throwErrorIfInvalid(id);
+    throwErrorIfInvalidRead(id, VALUE_INT);
 
     ParameterInfoInt paramInfo;
     paramInfo.set_id(ParameterID(id));
@@ -53,7 +100,7 @@ int32_t ParameterProtocolImpl::readIntParameter(int32_t id) {
 
 void ParameterProtocolImpl::writeIntParameter(int32_t id, int32_t value) {
     
-    throwErrorIfInvalid(id);
+    throwErrorIfInvalidWrite(id, VALUE_INT, value);
 
     ParameterInfoInt paramInfo;
     paramInfo.set_id(ParameterID(id));
@@ -64,7 +111,7 @@ void ParameterProtocolImpl::writeIntParameter(int32_t id, int32_t value) {
 
 double ParameterProtocolImpl::readDoubleParameter(int32_t id) {
     
-    throwErrorIfInvalid(id);
+    throwErrorIfInvalidRead(id, VALUE_DOUBLE);
 
     ParameterInfoDouble paramInfo;
     paramInfo.set_id(ParameterID(id));
@@ -74,7 +121,7 @@ double ParameterProtocolImpl::readDoubleParameter(int32_t id) {
 
 void ParameterProtocolImpl::writeDoubleParameter(int32_t id, double value) {
 
-    throwErrorIfInvalid(id);
+    throwErrorIfInvalidWrite(id, VALUE_DOUBLE, 0);
 
     ParameterInfoDouble paramInfo;
     paramInfo.set_id(ParameterID(id));
@@ -85,7 +132,7 @@ void ParameterProtocolImpl::writeDoubleParameter(int32_t id, double value) {
 
 std::string ParameterProtocolImpl::readStringParameter(int32_t id) {
 
-    throwErrorIfInvalid(id);
+    throwErrorIfInvalidRead(id, VALUE_STRING);
 
     ParameterInfoString paramInfo;
     paramInfo.set_id(ParameterID(id));
@@ -95,7 +142,7 @@ std::string ParameterProtocolImpl::readStringParameter(int32_t id) {
 
 void ParameterProtocolImpl::writeStringParameter(int32_t id, const std::string& value) {
 
-    throwErrorIfInvalid(id);
+    throwErrorIfInvalidWrite(id, VALUE_STRING, 0);
 
     ParameterInfoString paramInfo;
     paramInfo.set_id(ParameterID(id));
@@ -110,21 +157,262 @@ void ParameterProtocolImpl::throwErrorIfInvalid(int32_t id) {
         throw SparkError("passed a invalid ParameterID");
 }
 
-void ParameterProtocolImpl::callParameterRequest(const ParameterRequest &requestMsg, ParameterResponse &responseMsg) {
-    
-    // just one request is called at the same time
-    std::lock_guard<std::mutex> lock(_requestLock);
+void ParameterProtocolImpl::throwErrorIfInvalidRead(int32_t id, ParameterValueType type) {
+    // a read of the wrong type would be rejected by the device after a round trip
+    std::string error = checkParameterRead(id, type);
+    if(!error.empty())
+        throw SparkError(error);
+}
 
-    // serialize request message to buffer to send to socket
+void ParameterProtocolImpl::throwErrorIfInvalidWrite(int32_t id, ParameterValueType type, int32_t value) {
+    std::string error = checkParameterWrite(id, type, value);
+    if(!error.empty())
+        throw SparkError(error);
+}
+
+// append a request with its size header to buffer
+static void appendRequest(const ParameterRequest &requestMsg, std::string &buffer) {
     int requestSize = requestMsg.ByteSize();
-    int fullRequestSize = requestSize + 4;
-    std::unique_ptr<char[]> pRqBuff = std::make_unique<char[]>(fullRequestSize);
-    memcpy(pRqBuff.get(), &requestSize, 4);
-    requestMsg.SerializeToArray(pRqBuff.get() + 4, requestSize);
+    size_t offset = buffer.size();
+    buffer.resize(offset + 4 + requestSize);
+    memcpy(&buffer[offset], &requestSize, 4);
+    requestMsg.SerializeToArray(&buffer[offset + 4], requestSize);
+}
+
+template<typename TInfo>
+static void setRequest(ParameterType paramType, const TInfo &paramInfo, ParameterRequest &requestMsg) {
+    requestMsg.set_paramtype(paramType);
+    requestMsg.set_paramid(paramInfo.id());
+    requestMsg.set_paramsize(paramInfo.ByteSize());
+    requestMsg.set_paraminfo(paramInfo.SerializeAsString());
+}
+
+template<typename TInfo, typename TValue>
+static void setBatchRequest(ParameterType paramType, int32_t id, const TValue *value, ParameterRequest &requestMsg) {
+    TInfo paramInfo;
+    paramInfo.set_id(ParameterID(id));
+    if(value) {
+        paramInfo.set_value(*value);
+    }
+    setRequest(paramType, paramInfo, requestMsg);
+}
+
+// value of a read from its response, false if the response can not be parsed
+template<typename TInfo, typename TValue>
+static bool parseValue(const ParameterResponse &responseMsg, TValue &value) {
+    TInfo infoMsg;
+    if(!infoMsg.ParseFromString(responseMsg.paraminfo())) {
+        return false;
+    }
+    value = infoMsg.value();
+    return true;
+}
+
+// exception of a request which can not be completed. It's thrown in place, as SparkException must not be copied
+static std::exception_ptr requestError(const std::string &error) {
+    try {
+        throw SparkError(error);
+    } catch (...) {
+        return std::current_exception();
+    }
+}
+
+// callback completing a future with the result of a asynchronous request
+template<typename TRet>
+static ParameterReadCallback<TRet> resolve(std::shared_ptr<std::promise<TRet>> promise) {
+    return [promise](const ParameterResult<TRet> &result) {
+        if(result.succeeded) {
+            promise->set_value(result.value);
+        } else {
+            promise->set_exception(requestError(result.message));
+        }
+    };
+}
+
+static ParameterWriteCallback resolve(std::shared_ptr<std::promise<void>> promise) {
+    return [promise](const ParameterStatus &status) {
+        if(status.succeeded) {
+            promise->set_value();
+        } else {
+            promise->set_exception(requestError(status.message));
+        }
+    };
+}
+
+// status of a request from its response, or from the error if no response was received
+static void setStatus(const ParameterResponse *responseMsg, const std::string &error, ParameterStatus &status) {
+    if(!responseMsg) {
+        status.message = error;
+        return;
+    }
+    status.code = responseMsg->code();
+    status.succeeded = responseMsg->code() == ParameterResponse::RESPONSE_OK;
+    if(!status.succeeded) {
+        status.message = responseMsg->message().empty() ? "parameter request failed" : responseMsg->message();
+    }
+}
+
+// a exception of the callback must not stop the I/O thread
+template<typename TCallback, typename TResult>
+static void invokeCallback(const TCallback &callback, const TResult &result) {
+    try {
+        callback(result);
+    } catch (std::exception &e) {
+        LOG_ERROR("callback of parameter request threw: %s", e.what());
+    }
+}
+
+void ParameterProtocolImpl::callParameterRequest(const ParameterRequest &requestMsg, ParameterResponse &responseMsg) {
+    throwErrorIfIoThread();
 
-    // send request via socket
-    network::sendFixedTo(_socket, pRqBuff.get(), fullRequestSize);
+    // other callers' requests are in flight at the same time
+    ParameterRequest queuedMsg(requestMsg);
+    responseMsg = submitRequest(queuedMsg).get();
+}
+
+void ParameterProtocolImpl::submit(ParameterRequest &requestMsg, Completion completion) {
+    if(_cache && ParameterCache::tracks(requestMsg.paramtype())) {
+        // the cache is updated by the receive thread, in the order the device answers
+        int32_t type = requestMsg.paramtype();
+        int32_t id = requestMsg.paramid();
+        std::string paramInfo = type % 2 == 0 ? requestMsg.paraminfo() : std::string();
+        completion = [this, type, id, paramInfo, completion](const ParameterResponse *responseMsg, const std::string &error) {
+            _cache->update(type, id, paramInfo, responseMsg);
+            completion(responseMsg, error);
+        };
+    }
+
+    std::unique_lock<std::mutex> lock(_queueLock);
+    if(!_error.empty()) {
+        std::string error = _error;
+        lock.unlock();
+        completion(nullptr, error);
+        return;
+    }
+
+    _queued.emplace_back();
+    _queued.back().first.Swap(&requestMsg);
+    _queued.back().second = std::move(completion);
+    lock.unlock();
+    _queueCond.notify_all();
+}
 
+std::future<ParameterResponse> ParameterProtocolImpl::submitRequest(ParameterRequest &requestMsg) {
+    std::shared_ptr<std::promise<ParameterResponse>> promise = std::make_shared<std::promise<ParameterResponse>>();
+    std::future<ParameterResponse> response = promise->get_future();
+
+    submit(requestMsg, [promise](const ParameterResponse *responseMsg, const std::string &error) {
+        if(responseMsg) {
+            promise->set_value(*responseMsg);
+        } else {
+            promise->set_exception(requestError(error));
+        }
+    });
+    return response;
+}
+
+void ParameterProtocolImpl::throwErrorIfIoThread() {
+    std::thread::id id = std::this_thread::get_id();
+    if(id == _sendThread.get_id() || id == _recvThread.get_id()) {
+        throw SparkError("a synchronous parameter request can not be made from a callback of a asynchronous one");
+    }
+}
+
+void ParameterProtocolImpl::sendLoop() {
+    std::vector<ParameterRequest> requests;
+    std::string buffer;
+    std::unique_lock<std::mutex> lock(_queueLock);
+
+    while(true) {
+        _queueCond.wait(lock, [&]() {
+            return _stop || !_error.empty() || (!_queued.empty() && _inFlight.size() < _options.window);
+        });
+        if(_stop || !_error.empty()) {
+            break;
+        }
+
+        // the requests are in flight in the order they are sent
+        size_t count = std::min(_queued.size(), size_t(_options.window) - _inFlight.size());
+        requests.resize(count);
+        for(size_t i = 0; i < count; i++) {
+            requests[i].Swap(&_queued.front().first);
+            _inFlight.push_back(std::move(_queued.front().second));
+            _queued.pop_front();
+        }
+        lock.unlock();
+        _queueCond.notify_all();
+
+        // one send for the requests of the window
+        buffer.clear();
+        for(const ParameterRequest &requestMsg : requests) {
+            appendRequest(requestMsg, buffer);
+        }
+        try {
+            network::sendFixedTo(_socket, &buffer[0], buffer.size());
+        } catch (std::exception &e) {
+            fail(std::string("parameter connection is broken: ") + e.what());
+            return;
+        }
+        lock.lock();
+    }
+}
+
+void ParameterProtocolImpl::recvLoop() {
+    std::unique_lock<std::mutex> lock(_queueLock);
+
+    while(true) {
+        _queueCond.wait(lock, [&]() { return !_inFlight.empty() || _stop || !_error.empty(); });
+        if(_inFlight.empty()) {
+            break;
+        }
+        lock.unlock();
+
+        // responses come in the order of the requests
+        ParameterResponse responseMsg;
+        try {
+            recvResponse(responseMsg);
+        } catch (std::exception &e) {
+            fail(std::string("parameter connection is broken: ") + e.what());
+            return;
+        }
+
+        lock.lock();
+        if(_inFlight.empty()) {
+            // the connection was given up while the response arrived
+            break;
+        }
+        Completion completion = std::move(_inFlight.front());
+        _inFlight.pop_front();
+        lock.unlock();
+        _queueCond.notify_all();
+
+        completion(&responseMsg, std::string());
+        lock.lock();
+    }
+}
+
+void ParameterProtocolImpl::fail(const std::string &error) {
+    std::deque<Completion> failed;
+    std::unique_lock<std::mutex> lock(_queueLock);
+    if(_error.empty()) {
+        _error = error;
+        network::shutdownConnection(_socket);
+    }
+    failed.swap(_inFlight);
+    for(std::pair<ParameterRequest, Completion> &queued : _queued) {
+        failed.push_back(std::move(queued.second));
+    }
+    _queued.clear();
+    std::string reason = _error;
+    lock.unlock();
+    _queueCond.notify_all();
+
+    for(Completion &completion : failed) {
+        completion(nullptr, reason);
+    }
+}
+
+void ParameterProtocolImpl::recvResponse(ParameterResponse &responseMsg) {
     // receive 4 bytes for header, is size of response message
     int resSize;
     u_char hBuff[4];
@@ -142,16 +430,140 @@ void ParameterProtocolImpl::callParameterRequest(const ParameterRequest &request
     responseMsg.ParseFromArray(pResBuff.get(), resSize);
 }
 
+// error of a operation of a batch by the registry of parameters, empty if it's valid
+static std::string checkOperation(int32_t type, int32_t id, bool boolValue, int32_t intValue) {
+    switch(type) {
+    case ParameterType::PARAMETER_READ_BOOLEAN:
+        return checkParameterRead(id, VALUE_BOOL);
+    case ParameterType::PARAMETER_WRITE_BOOLEAN:
+        return checkParameterWrite(id, VALUE_BOOL, boolValue);
+    case ParameterType::PARAMETER_READ_INT:
+        return checkParameterRead(id, VALUE_INT);
+    case ParameterType::PARAMETER_WRITE_INT:
+        return checkParameterWrite(id, VALUE_INT, intValue);
+    case ParameterType::PARAMETER_READ_DOUBLE:
+        return checkParameterRead(id, VALUE_DOUBLE);
+    case ParameterType::PARAMETER_WRITE_DOUBLE:
+        return checkParameterWrite(id, VALUE_DOUBLE);
+    case ParameterType::PARAMETER_READ_STRING:
+        return checkParameterRead(id, VALUE_STRING);
+    default:
+        return checkParameterWrite(id, VALUE_STRING);
+    }
+}
+
+void ParameterProtocolImpl::execute(ParameterBatch &batch) {
+    std::vector<ParameterBatch::Operation> &operations = batch._operations;
+
+    std::vector<ParameterRequest> requests;
+    std::vector<size_t> sent;
+    requests.reserve(operations.size());
+    for(size_t i = 0; i < operations.size(); i++) {
+        ParameterBatch::Operation &operation = operations[i];
+        operation.executed = false;
+        operation.fallback = false;
+        operation.error.clear();
+        // operations which the device would reject fail locally
+        std::string error = checkOperation(operation.type, operation.id, operation.boolValue, operation.intValue);
+        if(!error.empty()) {
+            operation.executed = true;
+            operation.error = error;
+            continue;
+        }
+
+        requests.emplace_back();
+        ParameterRequest &requestMsg = requests.back();
+        switch(operation.type) {
+        case ParameterType::PARAMETER_READ_BOOLEAN:
+            setBatchRequest<ParameterInfoBool, bool>(ParameterType(operation.type), operation.id, nullptr, requestMsg);
+            break;
+        case ParameterType::PARAMETER_WRITE_BOOLEAN:
+            setBatchRequest<ParameterInfoBool>(ParameterType(operation.type), operation.id, &operation.boolValue, requestMsg);
+            break;
+        case ParameterType::PARAMETER_READ_INT:
+            setBatchRequest<ParameterInfoInt, int32_t>(ParameterType(operation.type), operation.id, nullptr, requestMsg);
+            break;
+        case ParameterType::PARAMETER_WRITE_INT:
+            setBatchRequest<ParameterInfoInt>(ParameterType(operation.type), operation.id, &operation.intValue, requestMsg);
+            break;
+        case ParameterType::PARAMETER_READ_DOUBLE:
+            setBatchRequest<ParameterInfoDouble, double>(ParameterType(operation.type), operation.id, nullptr, requestMsg);
+            break;
+        case ParameterType::PARAMETER_WRITE_DOUBLE:
+            setBatchRequest<ParameterInfoDouble>(ParameterType(operation.type), operation.id, &operation.doubleValue, requestMsg);
+            break;
+        case ParameterType::PARAMETER_READ_STRING:
+            setBatchRequest<ParameterInfoString, std::string>(ParameterType(operation.type), operation.id, nullptr, requestMsg);
+            break;
+        default:
+            setBatchRequest<ParameterInfoString>(ParameterType(operation.type), operation.id, &operation.stringValue, requestMsg);
+            break;
+        }
+        sent.push_back(i);
+    }
+
+    // the requests are sent back to back in windows, the responses are collected in order
+    throwErrorIfIoThread();
+    std::vector<std::future<ParameterResponse>> responses;
+    responses.reserve(requests.size());
+    for(ParameterRequest &requestMsg : requests) {
+        responses.push_back(submitRequest(requestMsg));
+    }
+
+    // if the connection breaks, the operations without a response fail with its error
+    for(size_t r = 0; r < sent.size(); r++) {
+        ParameterBatch::Operation &operation = operations[sent[r]];
+        operation.executed = true;
+        ParameterResponse responseMsg;
+        try {
+            responseMsg = responses[r].get();
+        } catch (SparkException &e) {
+            operation.error = e.what();
+            continue;
+        }
+
+        if(responseMsg.code() != ParameterResponse::RESPONSE_OK) {
+            operation.error = responseMsg.message().empty() ? "parameter request failed" : responseMsg.message();
+            batch.fallBack(operation);
+            continue;
+        }
+
+        bool parsed = true;
+        switch(operation.type) {
+        case ParameterType::PARAMETER_READ_BOOLEAN:
+            parsed = parseValue<ParameterInfoBool>(responseMsg, operation.boolValue);
+            break;
+        case ParameterType::PARAMETER_READ_INT:
+            parsed = parseValue<ParameterInfoInt>(responseMsg, operation.intValue);
+            break;
+        case ParameterType::PARAMETER_READ_DOUBLE:
+            parsed = parseValue<ParameterInfoDouble>(responseMsg, operation.doubleValue);
+            break;
+        case ParameterType::PARAMETER_READ_STRING:
+            parsed = parseValue<ParameterInfoString>(responseMsg, operation.stringValue);
+            break;
+        default:
+            break;
+        }
+        if(!parsed) {
+            operation.error = "response message format is wrong, please check if protocol version is match to device";
+            batch.fallBack(operation);
+        }
+    }
+}
+
 template<typename TRet, typename TInfo>
 TRet ParameterProtocolImpl::readParameter(ParameterType paramType, TInfo paramInfo) {
+
+    std::string cachedInfo;
+    if(_cache && _cache->find(paramType, paramInfo.id(), cachedInfo) && paramInfo.ParseFromString(cachedInfo)) {
+        return paramInfo.value();
+    }
     
     // make ParameterRequest object
     ParameterRequest requestMsg;
     ParameterResponse responseMsg;
-    requestMsg.set_paramtype(paramType);
-    requestMsg.set_paramid(paramInfo.id());
-    requestMsg.set_paramsize(paramInfo.ByteSize());
-    requestMsg.set_paraminfo(paramInfo.SerializeAsString());
+    setRequest(paramType, paramInfo, requestMsg);
 
     // communicate to network
     callParameterRequest(requestMsg, responseMsg);
@@ -174,10 +586,7 @@ void ParameterProtocolImpl::writeParameter(ParameterType paramType, TInfo paramI
     // make ParameterRequest object
     ParameterRequest requestMsg;
     ParameterResponse responseMsg;
-    requestMsg.set_paramtype(paramType);
-    requestMsg.set_paramid(paramInfo.id());
-    requestMsg.set_paramsize(paramInfo.ByteSize());
-    requestMsg.set_paraminfo(paramInfo.SerializeAsString());
+    setRequest(paramType, paramInfo, requestMsg);
 
     callParameterRequest(requestMsg, responseMsg);
 
@@ -186,7 +595,294 @@ void ParameterProtocolImpl::writeParameter(ParameterType paramType, TInfo paramI
     }
 }
 
+template<typename TRet, typename TInfo>
+void ParameterProtocolImpl::readParameterAsync(ParameterType paramType, const TInfo &paramInfo, ParameterReadCallback<TRet> callback) {
+    // a cached value completes on the calling thread
+    std::string cachedInfo;
+    TInfo infoMsg;
+    if(_cache && _cache->find(paramType, paramInfo.id(), cachedInfo) && infoMsg.ParseFromString(cachedInfo)) {
+        ParameterResult<TRet> result;
+        result.succeeded = true;
+        result.code = ParameterResponse::RESPONSE_OK;
+        result.value = infoMsg.value();
+        invokeCallback(callback, result);
+        return;
+    }
+
+    ParameterRequest requestMsg;
+    setRequest(paramType, paramInfo, requestMsg);
+
+    submit(requestMsg, [callback](const ParameterResponse *responseMsg, const std::string &error) {
+        ParameterResult<TRet> result;
+        setStatus(responseMsg, error, result);
+        if(result.succeeded && !parseValue<TInfo>(*responseMsg, result.value)) {
+            result.succeeded = false;
+            result.message = "response message format is wrong, please check if protocol version is match to device";
+        }
+        invokeCallback(callback, result);
+    });
+}
+
+template<typename TInfo>
+void ParameterProtocolImpl::writeParameterAsync(ParameterType paramType, const TInfo &paramInfo, ParameterWriteCallback callback) {
+    ParameterRequest requestMsg;
+    setRequest(paramType, paramInfo, requestMsg);
+
+    submit(requestMsg, [callback](const ParameterResponse *responseMsg, const std::string &error) {
+        ParameterStatus status;
+        setStatus(responseMsg, error, status);
+        invokeCallback(callback, status);
+    });
+}
+
+std::future<bool> ParameterProtocolImpl::readBoolParameterAsync(int32_t id) {
+    std::shared_ptr<std::promise<bool>> promise = std::make_shared<std::promise<bool>>();
+    std::future<bool> value = promise->get_future();
+    readBoolParameterAsync(id, resolve(promise));
+    return value;
+}
+
+void ParameterProtocolImpl::readBoolParameterAsync(int32_t id, ParameterReadCallback<bool> callback) {
+
+    throwErrorIfInvalidRead(id, VALUE_BOOL);
+
+    ParameterInfoBool paramInfo;
+    paramInfo.set_id(ParameterID(id));
+
+    readParameterAsync<bool>(ParameterType::PARAMETER_READ_BOOLEAN, paramInfo, std::move(callback));
+}
+
+std::future<void> ParameterProtocolImpl::writeBoolParameterAsync(int32_t id, bool value) {
+    std::shared_ptr<std::promise<void>> promise = std::make_shared<std::promise<void>>();
+    std::future<void> done = promise->get_future();
+    writeBoolParameterAsync(id, value, resolve(promise));
+    return done;
+}
+
+void ParameterProtocolImpl::writeBoolParameterAsync(int32_t id, bool value, ParameterWriteCallback callback) {
+
+    throwErrorIfInvalidWrite(id, VALUE_BOOL, value);
+
+    ParameterInfoBool paramInfo;
+    paramInfo.set_id(ParameterID(id));
+    paramInfo.set_value(value);
+
+    writeParameterAsync(ParameterType::PARAMETER_WRITE_BOOLEAN, paramInfo, std::move(callback));
+}
+
+std::future<int32_t> ParameterProtocolImpl::readIntParameterAsync(int32_t id) {
+    std::shared_ptr<std::promise<int32_t>> promise = std::make_shared<std::promise<int32_t>>();
+    std::future<int32_t> value = promise->get_future();
+    readIntParameterAsync(id, resolve(promise));
+    return value;
+}
+
+void ParameterProtocolImpl::readIntParameterAsync(int32_t id, ParameterReadCallback<int32_t> callback) {
+
+    throwErrorIfInvalidRead(id, VALUE_INT);
+
+    ParameterInfoInt paramInfo;
+    paramInfo.set_id(ParameterID(id));
+
+    readParameterAsync<int32_t>(ParameterType::PARAMETER_READ_INT, paramInfo, std::move(callback));
+}
+
+std::future<void> ParameterProtocolImpl::writeIntParameterAsync(int32_t id, int32_t value) {
+    std::shared_ptr<std::promise<void>> promise = std::make_shared<std::promise<void>>();
+    std::future<void> done = promise->get_future();
+    writeIntParameterAsync(id, value, resolve(promise));
+    return done;
+}
+
+void ParameterProtocolImpl::writeIntParameterAsync(int32_t id, int32_t value, ParameterWriteCallback callback) {
+
+    throwErrorIfInvalidWrite(id, VALUE_INT, value);
+
+    ParameterInfoInt paramInfo;
+    paramInfo.set_id(ParameterID(id));
+    paramInfo.set_value(value);
+
+    writeParameterAsync(ParameterType::PARAMETER_WRITE_INT, paramInfo, std::move(callback));
+}
+
+std::future<double> ParameterProtocolImpl::readDoubleParameterAsync(int32_t id) {
+    std::shared_ptr<std::promise<double>> promise = std::make_shared<std::promise<double>>();
+    std::future<double> value = promise->get_future();
+    readDoubleParameterAsync(id, resolve(promise));
+    return value;
+}
+
+void ParameterProtocolImpl::readDoubleParameterAsync(int32_t id, ParameterReadCallback<double> callback) {
+
+    throwErrorIfInvalidRead(id, VALUE_DOUBLE);
+
+    ParameterInfoDouble paramInfo;
+    paramInfo.set_id(ParameterID(id));
+
+    readParameterAsync<double>(ParameterType::PARAMETER_READ_DOUBLE, paramInfo, std::move(callback));
+}
+
+std::future<void> ParameterProtocolImpl::writeDoubleParameterAsync(int32_t id, double value) {
+    std::shared_ptr<std::promise<void>> promise = std::make_shared<std::promise<void>>();
+    std::future<void> done = promise->get_future();
+    writeDoubleParameterAsync(id, value, resolve(promise));
+    return done;
+}
+
+void ParameterProtocolImpl::writeDoubleParameterAsync(int32_t id, double value, ParameterWriteCallback callback) {
+
+    throwErrorIfInvalidWrite(id, VALUE_DOUBLE, 0);
+
+    ParameterInfoDouble paramInfo;
+    paramInfo.set_id(ParameterID(id));
+    paramInfo.set_value(value);
+
+    writeParameterAsync(ParameterType::PARAMETER_WRITE_DOUBLE, paramInfo, std::move(callback));
+}
+
+std::future<std::string> ParameterProtocolImpl::readStringParameterAsync(int32_t id) {
+    std::shared_ptr<std::promise<std::string>> promise = std::make_shared<std::promise<std::string>>();
+    std::future<std::string> value = promise->get_future();
+    readStringParameterAsync(id, resolve(promise));
+    return value;
+}
+
+void ParameterProtocolImpl::readStringParameterAsync(int32_t id, ParameterReadCallback<std::string> callback) {
+
+    throwErrorIfInvalidRead(id, VALUE_STRING);
+
+    ParameterInfoString paramInfo;
+    paramInfo.set_id(ParameterID(id));
+
+    readParameterAsync<std::string>(ParameterType::PARAMETER_READ_STRING, paramInfo, std::move(callback));
+}
+
+std::future<void> ParameterProtocolImpl::writeStringParameterAsync(int32_t id, const std::string &value) {
+    std::shared_ptr<std::promise<void>> promise = std::make_shared<std::promise<void>>();
+    std::future<void> done = promise->get_future();
+    writeStringParameterAsync(id, value, resolve(promise));
+    return done;
+}
+
+void ParameterProtocolImpl::writeStringParameterAsync(int32_t id, const std::string &value, ParameterWriteCallback callback) {
+
+    throwErrorIfInvalidWrite(id, VALUE_STRING, 0);
+
+    ParameterInfoString paramInfo;
+    paramInfo.set_id(ParameterID(id));
+    paramInfo.set_value(value);
+
+    writeParameterAsync(ParameterType::PARAMETER_WRITE_STRING, paramInfo, std::move(callback));
+}
+
+void ParameterProtocolImpl::setCacheTtl(int32_t id, int32_t ttl) {
+    throwErrorIfInvalid(id);
+    if(_cache) {
+        _cache->setTtl(id, ttl);
+    }
+}
+
+void ParameterProtocolImpl::invalidateCache(int32_t id) {
+    if(_cache) {
+        _cache->invalidate(id);
+    }
+}
+
+void ParameterProtocolImpl::invalidateCache() {
+    if(_cache) {
+        _cache->invalidateAll();
+    }
+}
+
+bool ParameterProtocolImpl::isConnected() {
+    {
+        std::lock_guard<std::mutex> lock(_queueLock);
+        if(!_error.empty() || _stop) {
+            return false;
+        }
+    }
+    // the receive thread only notices a closed connection when it waits for a response
+    return !network::isPeerClosed(_socket);
+}
+
+bool ParameterProtocolImpl::ping(uint32_t timeout) {
+    throwErrorIfIoThread();
+
+    // any response, also a failure of the device, proves the connection is alive
+    ParameterInfoInt paramInfo;
+    paramInfo.set_id(ParameterID::RESOLUTION);
+    ParameterRequest requestMsg;
+    setRequest(ParameterType::PARAMETER_READ_INT, paramInfo, requestMsg);
+    std::future<ParameterResponse> response = submitRequest(requestMsg);
+    if(response.wait_for(std::chrono::milliseconds(timeout)) != std::future_status::ready) {
+        // responses are matched in order, so the request can't leave the window alone: the connection is given up,
+        // which releases every request waiting on it
+        fail("device did not answer within " + std::to_string(timeout) + " ms");
+        return false;
+    }
+    try {
+        response.get();
+        return true;
+    } catch(SparkException &) {
+        return false;
+    }
+}
+
+size_t ParameterProtocolImpl::pendingCount() {
+    std::lock_guard<std::mutex> lock(_queueLock);
+    return _queued.size() + _inFlight.size();
+}
+
+void ParameterProtocolImpl::refreshCache() {
+    if(!_cache) {
+        return;
+    }
+    throwErrorIfIoThread();
+
+    std::vector<int32_t> ids;
+    std::vector<int32_t> types;
+    _cache->cached(ids, types);
+    _cache->invalidateAll();
+
+    // the parameters are read again back to back, the responses update the cache
+    std::vector<std::future<ParameterResponse>> responses;
+    responses.reserve(ids.size());
+    for(size_t i = 0; i < ids.size(); i++) {
+        ParameterRequest requestMsg;
+        switch(types[i]) {
+        case ParameterType::PARAMETER_READ_BOOLEAN:
+            setBatchRequest<ParameterInfoBool, bool>(ParameterType(types[i]), ids[i], nullptr, requestMsg);
+            break;
+        case ParameterType::PARAMETER_READ_INT:
+            setBatchRequest<ParameterInfoInt, int32_t>(ParameterType(types[i]), ids[i], nullptr, requestMsg);
+            break;
+        case ParameterType::PARAMETER_READ_DOUBLE:
+            setBatchRequest<ParameterInfoDouble, double>(ParameterType(types[i]), ids[i], nullptr, requestMsg);
+            break;
+        case ParameterType::PARAMETER_READ_STRING:
+            setBatchRequest<ParameterInfoString, std::string>(ParameterType(types[i]), ids[i], nullptr, requestMsg);
+            break;
+        default:
+            requestMsg.set_paramtype(ParameterType::PARAMETER_READ_DEVICEINFO);
+            requestMsg.set_paramid(ParameterID::DEVICE_INFORMATION);
+            break;
+        }
+        responses.push_back(submitRequest(requestMsg));
+    }
+
+    // a parameter which fails to be read stays out of the cache
+    for(std::future<ParameterResponse> &response : responses) {
+        response.get();
+    }
+}
+
 void ParameterProtocolImpl::readDeviceInfoMsg(DeviceInfoMessage &deviceInfoMsg) {
+    std::string cachedInfo;
+    if(_cache && _cache->find(ParameterType::PARAMETER_READ_DEVICEINFO, ParameterID::DEVICE_INFORMATION, cachedInfo) &&
+        deviceInfoMsg.ParseFromString(cachedInfo)) {
+        return;
+    }
+
     // make ParameterRequest object
     ParameterRequest requestMsg;
     ParameterResponse responseMsg;
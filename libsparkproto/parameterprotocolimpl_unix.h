@@ -4,9 +4,18 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
 #include <memory>
 #include <mutex>
+#include <thread>
 #include <libsparkproto/network.h>
+#include <libsparkproto/parameterbatch.h>
+#include <libsparkproto/parametercache.h>
+#include <libsparkproto/parameterprotocol.h>
+#include <libsparkproto/parameterregistry.h>
 #include <libsparkproto/parameters.pb.h>
 #include <libsparkproto/device.pb.h>
 
@@ -22,7 +31,7 @@ public:
      * @brief Construct a new ParameterProtocol object
      * 
      */
-    ParameterProtocolImpl(const std::string &address, const std::string &service);
+    ParameterProtocolImpl(const std::string &address, const std::string &service, const ParameterProtocolOptions &options);
 
     /**
      * @brief Destroy the ParameterProtocol object
@@ -95,6 +104,177 @@ public:
      */
     void writeStringParameter(int32_t id, const std::string &value);
 
+    /**
+     * @brief read a bool value from device by id asynchronously.
+     * If id is invalid, a exception is thrown
+     * 
+     * @param id 
+     * @return std::future<bool> 
+     */
+    std::future<bool> readBoolParameterAsync(int32_t id);
+
+    /**
+     * @brief read a bool value from device by id asynchronously, callback is called with the result
+     * 
+     * @param id 
+     * @param callback 
+     */
+    void readBoolParameterAsync(int32_t id, ParameterReadCallback<bool> callback);
+
+    /**
+     * @brief write a bool value by id to device asynchronously.
+     * If id is invalid, a exception is thrown
+     * 
+     * @param id 
+     * @param value 
+     * @return std::future<void> 
+     */
+    std::future<void> writeBoolParameterAsync(int32_t id, bool value);
+
+    /**
+     * @brief write a bool value by id to device asynchronously, callback is called with the result
+     * 
+     * @param id 
+     * @param value 
+     * @param callback 
+     */
+    void writeBoolParameterAsync(int32_t id, bool value, ParameterWriteCallback callback);
+
+    /**
+     * @brief read a int value from device by id asynchronously.
+     * If id is invalid, a exception is thrown
+     * 
+     * @param id 
+     * @return std::future<int32_t> 
+     */
+    std::future<int32_t> readIntParameterAsync(int32_t id);
+
+    /**
+     * @brief read a int value from device by id asynchronously, callback is called with the result
+     * 
+     * @param id 
+     * @param callback 
+     */
+    void readIntParameterAsync(int32_t id, ParameterReadCallback<int32_t> callback);
+
+    /**
+     * @brief write a int value by id to device asynchronously.
+     * If id is invalid, a exception is thrown
+     * 
+     * @param id 
+     * @param value 
+     * @return std::future<void> 
+     */
+    std::future<void> writeIntParameterAsync(int32_t id, int32_t value);
+
+    /**
+     * @brief write a int value by id to device asynchronously, callback is called with the result
+     * 
+     * @param id 
+     * @param value 
+     * @param callback 
+     */
+    void writeIntParameterAsync(int32_t id, int32_t value, ParameterWriteCallback callback);
+
+    /**
+     * @brief read a double value from device by id asynchronously.
+     * If id is invalid, a exception is thrown
+     * 
+     * @param id 
+     * @return std::future<double> 
+     */
+    std::future<double> readDoubleParameterAsync(int32_t id);
+
+    /**
+     * @brief read a double value from device by id asynchronously, callback is called with the result
+     * 
+     * @param id 
+     * @param callback 
+     */
+    void readDoubleParameterAsync(int32_t id, ParameterReadCallback<double> callback);
+
+    /**
+     * @brief write a double value by id to device asynchronously.
+     * If id is invalid, a exception is thrown
+     * 
+     * @param id 
+     * @param value 
+     * @return std::future<void> 
+     */
+    std::future<void> writeDoubleParameterAsync(int32_t id, double value);
+
+    /**
+     * @brief write a double value by id to device asynchronously, callback is called with the result
+     * 
+     * @param id 
+     * @param value 
+     * @param callback 
+     */
+    void writeDoubleParameterAsync(int32_t id, double value, ParameterWriteCallback callback);
+
+    /**
+     * @brief read a string value from device by id asynchronously.
+     * If id is invalid, a exception is thrown
+     * 
+     * @param id 
+     * @return std::future<std::string> 
+     */
+    std::future<std::string> readStringParameterAsync(int32_t id);
+
+    /**
+     * @brief read a string value from device by id asynchronously, callback is called with the result
+     * 
+     * @param id 
+     * @param callback 
+     */
+    void readStringParameterAsync(int32_t id, ParameterReadCallback<std::string> callback);
+
+    /**
+     * @brief write a string value by id to device asynchronously.
+     * If id is invalid, a exception is thrown
+     * 
+     * @param id 
+     * @param value 
+     * @return std::future<void> 
+     */
+    std::future<void> writeStringParameterAsync(int32_t id, const std::string &value);
+
+    /**
+     * @brief write a string value by id to device asynchronously, callback is called with the result
+     * 
+     * @param id 
+     * @param value 
+     * @param callback 
+     */
+    void writeStringParameterAsync(int32_t id, const std::string &value, ParameterWriteCallback callback);
+
+    /**
+     * @brief Set the time to live of a cached parameter in milliseconds, 0 for never expiring, negative for not cached
+     * 
+     * @param id 
+     * @param ttl 
+     */
+    void setCacheTtl(int32_t id, int32_t ttl);
+
+    /**
+     * @brief Remove a parameter from the cache
+     * 
+     * @param id 
+     */
+    void invalidateCache(int32_t id);
+
+    /**
+     * @brief Remove all parameters from the cache
+     * 
+     */
+    void invalidateCache();
+
+    /**
+     * @brief Read the parameters in the cache again from the device
+     * 
+     */
+    void refreshCache();
+
     /**
      * @brief read detail informations of device. The information is defined as a protobuf message, DeviceInfoMessage.
      * 
@@ -102,21 +282,100 @@ public:
      */
     void readDeviceInfoMsg(DeviceInfoMessage &deviceInfoMsg);
 
+    /**
+     * @brief send the requests of a batch back to back and read their responses in order
+     * 
+     * @param batch 
+     */
+    void execute(ParameterBatch &batch);
+
+    /**
+     * @brief whether the connection is not broken
+     * 
+     * @return true 
+     * @return false 
+     */
+    bool isConnected();
+
+    /**
+     * @brief send a read which bypasses the cache and wait for its response up to timeout milliseconds
+     * 
+     * @param timeout 
+     * @return true 
+     * @return false 
+     */
+    bool ping(uint32_t timeout);
+
+    /**
+     * @brief number of requests queued or in flight
+     * 
+     * @return size_t 
+     */
+    size_t pendingCount();
+
 private:
     void throwErrorIfInvalid(int32_t id);
 
+    // check a read or write against the ParameterTraits of id
+    void throwErrorIfInvalidRead(int32_t id, ParameterValueType type);
+
+    void throwErrorIfInvalidWrite(int32_t id, ParameterValueType type, int32_t value);
+
+    // completes a request with its response, or with the error if no response was received
+    using Completion = std::function<void(const ParameterResponse *responseMsg, const std::string &error)>;
+
     void callParameterRequest(const ParameterRequest &requestMsg, ParameterResponse &responseMsg);
 
+    // queue a request to be sent, requestMsg is moved into the queue
+    void submit(ParameterRequest &requestMsg, Completion completion);
+
+    // queue a request, the future completes with its response
+    std::future<ParameterResponse> submitRequest(ParameterRequest &requestMsg);
+
+    // synchronous requests from a thread of the protocol would wait for the thread itself
+    void throwErrorIfIoThread();
+
+    // send the queued requests back to back in windows of requests in flight
+    void sendLoop();
+
+    // receive the responses of the requests in flight
+    void recvLoop();
+
+    // receive a response of a request which is sent
+    void recvResponse(ParameterResponse &responseMsg);
+
+    // fail the requests queued and in flight and all further requests
+    void fail(const std::string &error);
+
     template<typename TRet, typename TInfo>
     TRet readParameter(ParameterType paramType, TInfo paramInfo);
 
     template<typename TInfo>
     void writeParameter(ParameterType paramType, TInfo paramInfo);
 
+    template<typename TRet, typename TInfo>
+    void readParameterAsync(ParameterType paramType, const TInfo &paramInfo, ParameterReadCallback<TRet> callback);
+
+    template<typename TInfo>
+    void writeParameterAsync(ParameterType paramType, const TInfo &paramInfo, ParameterWriteCallback callback);
+
     SOCKET _socket;
+    ParameterProtocolOptions _options;
+    // null unless the cache is enabled
+    std::unique_ptr<ParameterCache> _cache;
+
+    // requests queued to be sent, and requests in flight whose front one is answered next.
+    // Error of the connection once it's broken
+    std::mutex _queueLock;
+    std::condition_variable _queueCond;
+    std::deque<std::pair<ParameterRequest, Completion>> _queued;
+    std::deque<Completion> _inFlight;
+    std::string _error;
+    bool _stop;
 
-    // mutex allow a request is called at the same time
-    std::mutex _requestLock;
+    // I/O threads, the send thread is the only writer and the receive thread the only reader of the connection
+    std::thread _sendThread;
+    std::thread _recvThread;
 };
 
 } // namespace protocol
@@ -0,0 +1,101 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <iterator>
+
+#include <libsparkproto/parameterregistry.h>
+
+namespace libspark {
+
+namespace protocol {
+
+static constexpr ParameterDescriptor PARAMETERS[] = {
+    ParameterTraits<RESOLUTION>::descriptor(),
+    ParameterTraits<AUTO_EXPOSURE>::descriptor(),
+    ParameterTraits<AUTO_EXPOSURE_MODE>::descriptor(),
+    ParameterTraits<MANUAL_EXPOSURE>::descriptor(),
+    ParameterTraits<MANUAL_GAIN>::descriptor(),
+    ParameterTraits<AUTO_WB>::descriptor(),
+    ParameterTraits<AUTO_WB_MODE>::descriptor(),
+    ParameterTraits<MANUAL_WB>::descriptor(),
+    ParameterTraits<LED_MODE>::descriptor(),
+    ParameterTraits<LED_BRIGHTNESS_LEVEL>::descriptor(),
+    ParameterTraits<CALIBRATION_DATA>::descriptor(),
+    ParameterTraits<CAMERA_RESET>::descriptor(),
+    ParameterTraits<DEVICE_INFORMATION>::descriptor(),
+};
+
+static constexpr bool inOrderOfIds() {
+    for(size_t i = 0; i < sizeof(PARAMETERS) / sizeof(PARAMETERS[0]); i++) {
+        if(PARAMETERS[i].id != int32_t(i + 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// a parameter added to ParameterID needs its ParameterTraits
+static_assert(sizeof(PARAMETERS) / sizeof(PARAMETERS[0]) == ParameterID_MAX, "every ParameterID must be registered");
+static_assert(inOrderOfIds(), "parameters must be registered in the order of their ids");
+
+static const char* typeName(ParameterValueType type) {
+    switch(type) {
+    case VALUE_BOOL:
+        return "bool";
+    case VALUE_INT:
+        return "int";
+    case VALUE_DOUBLE:
+        return "double";
+    case VALUE_STRING:
+        return "string";
+    default:
+        return "device information";
+    }
+}
+
+// error of a access to id as a value of type, empty if the type matches
+static std::string checkType(const ParameterDescriptor *descriptor, int32_t id, ParameterValueType type) {
+    if(!descriptor) {
+        return "passed a invalid ParameterID " + std::to_string(id);
+    }
+    if(descriptor->type != type) {
+        return std::string("parameter ") + descriptor->name + " is a " + typeName(descriptor->type) + ", not a " + typeName(type);
+    }
+    return std::string();
+}
+
+const std::vector<ParameterDescriptor>& registeredParameters() {
+    static const std::vector<ParameterDescriptor> parameters(std::begin(PARAMETERS), std::end(PARAMETERS));
+    return parameters;
+}
+
+const ParameterDescriptor* findParameter(int32_t id) {
+    // the parameters are in the order of their ids, starting at 1
+    if(id < 1 || id > ParameterID_MAX) {
+        return nullptr;
+    }
+    return &PARAMETERS[id - 1];
+}
+
+std::string checkParameterRead(int32_t id, ParameterValueType type) {
+    return checkType(findParameter(id), id, type);
+}
+
+std::string checkParameterWrite(int32_t id, ParameterValueType type, int32_t value) {
+    const ParameterDescriptor *descriptor = findParameter(id);
+    std::string error = checkType(descriptor, id, type);
+    if(!error.empty()) {
+        return error;
+    }
+    if(descriptor->readOnly) {
+        return std::string("parameter ") + descriptor->name + " is read-only";
+    }
+    if(!descriptor->inRange(value)) {
+        return "value " + std::to_string(value) + " of " + descriptor->name + " is out of range " +
+            std::to_string(descriptor->min) + " - " + std::to_string(descriptor->max);
+    }
+    return std::string();
+}
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,217 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <limits>
+#include <string>
+#include <vector>
+#include <libsparkproto/common.h>
+#include <libsparkproto/image.pb.h>
+#include <libsparkproto/parameterids.pb.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class DeviceInfoMessage; // defined at libsparkproto/device.pb.h
+
+/**
+ * @brief Type of the value of a parameter
+ *
+ */
+enum ParameterValueType {
+    VALUE_BOOL = 0,
+    VALUE_INT = 1,
+    VALUE_DOUBLE = 2,
+    VALUE_STRING = 3,
+    // DeviceInfoMessage, read by ParameterProtocol::readDeviceInfoMsg()
+    VALUE_DEVICEINFO = 4
+};
+
+/**
+ * @brief Description of a parameter of the device
+ *
+ */
+struct SPARK_API ParameterDescriptor {
+    ParameterID id;
+    const char *name;
+    ParameterValueType type;
+    // range of a int value
+    int32_t min;
+    int32_t max;
+    // the parameter can only be read, PARAMETER_READONLY of ParameterFlag
+    bool readOnly;
+    // writing the parameter triggers a command of the device, it is not a setting, e.g. CAMERA_RESET
+    bool command;
+    // automatic mode which changes the value while it is on, PARAMETER_UNKNOWN if none
+    ParameterID drivenBy;
+
+    /**
+     * @brief Whether value is in the range of the parameter, values which are not int always are
+     *
+     * @param value
+     * @return true
+     * @return false
+     */
+    constexpr bool inRange(int32_t value) const {
+        return type != VALUE_INT || (value >= min && value <= max);
+    }
+};
+
+static constexpr int32_t PARAMETER_INT_MIN = std::numeric_limits<int32_t>::min();
+static constexpr int32_t PARAMETER_INT_MAX = std::numeric_limits<int32_t>::max();
+
+/**
+ * @brief Type and descriptor of a parameter at compile time, e.g. ParameterTraits<MANUAL_GAIN>::Type is int32_t.
+ * It is defined for every parameter of the device, so typed reads and writes of a parameter which is not known
+ * or of the wrong type don't compile, see ParameterProtocol::read()
+ *
+ */
+template<ParameterID Id>
+struct ParameterTraits;
+
+template<>
+struct ParameterTraits<RESOLUTION> {
+    using Type = int32_t;
+    static constexpr ParameterDescriptor descriptor() {
+        return {RESOLUTION, "RESOLUTION", VALUE_INT, RESOLUTION_UNKNOWN + 1, SupportedResolution_MAX, false, false, PARAMETER_UNKNOWN};
+    }
+};
+
+template<>
+struct ParameterTraits<AUTO_EXPOSURE> {
+    using Type = bool;
+    static constexpr ParameterDescriptor descriptor() {
+        return {AUTO_EXPOSURE, "AUTO_EXPOSURE", VALUE_BOOL, 0, 1, false, false, PARAMETER_UNKNOWN};
+    }
+};
+
+template<>
+struct ParameterTraits<AUTO_EXPOSURE_MODE> {
+    using Type = int32_t;
+    static constexpr ParameterDescriptor descriptor() {
+        return {AUTO_EXPOSURE_MODE, "AUTO_EXPOSURE_MODE", VALUE_INT, PARAMETER_INT_MIN, PARAMETER_INT_MAX, false, false, PARAMETER_UNKNOWN};
+    }
+};
+
+// exposure in steps of 10 us, 0.06 ms - 362 ms
+template<>
+struct ParameterTraits<MANUAL_EXPOSURE> {
+    using Type = int32_t;
+    static constexpr ParameterDescriptor descriptor() {
+        return {MANUAL_EXPOSURE, "MANUAL_EXPOSURE", VALUE_INT, 6, 36200, false, false, AUTO_EXPOSURE};
+    }
+};
+
+// gain in steps of 0.1 dB, 0 - 48 dB
+template<>
+struct ParameterTraits<MANUAL_GAIN> {
+    using Type = int32_t;
+    static constexpr ParameterDescriptor descriptor() {
+        return {MANUAL_GAIN, "MANUAL_GAIN", VALUE_INT, 0, 480, false, false, AUTO_EXPOSURE};
+    }
+};
+
+template<>
+struct ParameterTraits<AUTO_WB> {
+    using Type = bool;
+    static constexpr ParameterDescriptor descriptor() {
+        return {AUTO_WB, "AUTO_WB", VALUE_BOOL, 0, 1, false, false, PARAMETER_UNKNOWN};
+    }
+};
+
+template<>
+struct ParameterTraits<AUTO_WB_MODE> {
+    using Type = int32_t;
+    static constexpr ParameterDescriptor descriptor() {
+        return {AUTO_WB_MODE, "AUTO_WB_MODE", VALUE_INT, PARAMETER_INT_MIN, PARAMETER_INT_MAX, false, false, PARAMETER_UNKNOWN};
+    }
+};
+
+template<>
+struct ParameterTraits<MANUAL_WB> {
+    using Type = int32_t;
+    static constexpr ParameterDescriptor descriptor() {
+        return {MANUAL_WB, "MANUAL_WB", VALUE_INT, PARAMETER_INT_MIN, PARAMETER_INT_MAX, false, false, AUTO_WB};
+    }
+};
+
+template<>
+struct ParameterTraits<LED_MODE> {
+    using Type = bool;
+    static constexpr ParameterDescriptor descriptor() {
+        return {LED_MODE, "LED_MODE", VALUE_BOOL, 0, 1, false, false, PARAMETER_UNKNOWN};
+    }
+};
+
+template<>
+struct ParameterTraits<LED_BRIGHTNESS_LEVEL> {
+    using Type = int32_t;
+    static constexpr ParameterDescriptor descriptor() {
+        return {LED_BRIGHTNESS_LEVEL, "LED_BRIGHTNESS_LEVEL", VALUE_INT, PARAMETER_INT_MIN, PARAMETER_INT_MAX, false, false, PARAMETER_UNKNOWN};
+    }
+};
+
+template<>
+struct ParameterTraits<CALIBRATION_DATA> {
+    using Type = std::string;
+    static constexpr ParameterDescriptor descriptor() {
+        return {CALIBRATION_DATA, "CALIBRATION_DATA", VALUE_STRING, 0, 0, true, false, PARAMETER_UNKNOWN};
+    }
+};
+
+// written true to reset the camera
+template<>
+struct ParameterTraits<CAMERA_RESET> {
+    using Type = bool;
+    static constexpr ParameterDescriptor descriptor() {
+        return {CAMERA_RESET, "CAMERA_RESET", VALUE_BOOL, 0, 1, false, true, PARAMETER_UNKNOWN};
+    }
+};
+
+template<>
+struct ParameterTraits<DEVICE_INFORMATION> {
+    using Type = DeviceInfoMessage;
+    static constexpr ParameterDescriptor descriptor() {
+        return {DEVICE_INFORMATION, "DEVICE_INFORMATION", VALUE_DEVICEINFO, 0, 0, true, false, PARAMETER_UNKNOWN};
+    }
+};
+
+/**
+ * @brief Descriptors of all parameters of the device, in the order of ParameterID
+ *
+ * @return const std::vector<ParameterDescriptor>&
+ */
+SPARK_API const std::vector<ParameterDescriptor>& registeredParameters();
+
+/**
+ * @brief Find the descriptor of a parameter, null if id is not a parameter
+ *
+ * @param id
+ * @return const ParameterDescriptor*
+ */
+SPARK_API const ParameterDescriptor* findParameter(int32_t id);
+
+/**
+ * @brief Check a read of a parameter as a value of type before it is sent, return the error or empty if it's valid
+ *
+ * @param id
+ * @param type
+ * @return std::string
+ */
+SPARK_API std::string checkParameterRead(int32_t id, ParameterValueType type);
+
+/**
+ * @brief Check a write of a value of type to a parameter before it is sent, return the error or empty if it's valid.
+ * value is checked against the range of int parameters
+ *
+ * @param id
+ * @param type
+ * @param value
+ * @return std::string
+ */
+SPARK_API std::string checkParameterWrite(int32_t id, ParameterValueType type, int32_t value = 0);
+
+} // namespace protocol
+} // namespace libspark
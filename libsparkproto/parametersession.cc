@@ -0,0 +1,73 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <map>
+#include <mutex>
+
+#include <libsparkproto/parametersession.h>
+#include <libsparkproto/parametersessionimpl.h>
+#include <libsparkproto/constants.h>
+#include <libsparkproto/exception.h>
+
+namespace libspark {
+
+namespace protocol {
+
+// sessions are shared by the users of a device with the same options
+static std::string sessionKey(const std::string &address, const ParameterSessionOptions &options) {
+    return address + "/" + std::to_string(options.poolSize) + "/" + std::to_string(options.healthCheckInterval) + "/" +
+        std::to_string(options.healthCheckTimeout) + "/" + std::to_string(options.protocol.window) + "/" +
+        std::to_string(options.protocol.enableCache) + "/" + std::to_string(options.protocol.cacheTtl);
+}
+
+ParameterSession::Ptr ParameterSession::get(std::shared_ptr<DeviceInfo> pDevice, const ParameterSessionOptions &options) {
+    static std::mutex lock;
+    static std::map<std::string, std::weak_ptr<ParameterSession>> sessions;
+
+    if(!pDevice) {
+        throw SparkError("passed a null device");
+    }
+    if(!pDevice->isCompatible())
+        throw SparkError("The library is not compatible with Spark firmware, please upgrade new version of libsparkpro");
+
+    std::lock_guard<std::mutex> guard(lock);
+    for(std::map<std::string, std::weak_ptr<ParameterSession>>::iterator it = sessions.begin(); it != sessions.end();) {
+        it = it->second.expired() ? sessions.erase(it) : std::next(it);
+    }
+
+    std::weak_ptr<ParameterSession> &entry = sessions[sessionKey(pDevice->getIpAdress(), options)];
+    Ptr session = entry.lock();
+    if(!session) {
+        session = std::make_shared<ParameterSession>(pDevice->getIpAdress(), std::to_string(PARAMETERS_PORT), options);
+        entry = session;
+    }
+    return session;
+}
+
+ParameterSession::ParameterSession(const std::string &address, const std::string &service, const ParameterSessionOptions &options)
+    : _pImpl(new ParameterSessionImpl(address, service, options)) {
+
+}
+
+ParameterSession::~ParameterSession() {
+
+}
+
+std::shared_ptr<ParameterProtocol> ParameterSession::acquire() {
+    return _pImpl->acquire();
+}
+
+void ParameterSession::invalidateCache() {
+    _pImpl->invalidateCache();
+}
+
+void ParameterSession::refreshCache() {
+    _pImpl->refreshCache();
+}
+
+ParameterSessionStats ParameterSession::stats() const {
+    return _pImpl->stats();
+}
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,122 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <libsparkproto/common.h>
+#include <libsparkproto/deviceinfo.h>
+#include <libsparkproto/parameterprotocol.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class ParameterSessionImpl;
+
+/**
+ * @brief Options of ParameterSession
+ *
+ */
+struct SPARK_API ParameterSessionOptions {
+    // parameter connections open at most. A connection is opened when all open ones are busy, so concurrent callers
+    // don't wait behind each other's requests. With the cache enabled, one connection is used, so it stays coherent
+    uint32_t poolSize = 4;
+    // milliseconds a connection can be idle before it is checked by a request when it is used again, 0 for never
+    uint32_t healthCheckInterval = 5000;
+    // milliseconds to wait for the answer of a health check before the connection is replaced
+    uint32_t healthCheckTimeout = 1000;
+    // options of the connections
+    ParameterProtocolOptions protocol;
+};
+
+/**
+ * @brief Counters of ParameterSession
+ *
+ */
+struct SPARK_API ParameterSessionStats {
+    // connections opened, and those of them which were replaced because they broke or failed a health check
+    uint64_t connectCount = 0;
+    uint64_t reconnectCount = 0;
+    uint64_t healthCheckCount = 0;
+    // connections open now
+    uint32_t openCount = 0;
+};
+
+/**
+ * @brief ParameterSession is a small pool of parameter connections to one device, shared by all its users,
+ * e.g. every DeviceParamConfigure of the device. Connections are opened lazily on first use. A broken connection or
+ * one which fails a health check is dropped and replaced by a new one when a connection is acquired next,
+ * so a broken socket only fails the requests in flight on it.
+ *
+ * All functions are thread-safe.
+ *
+ */
+class SPARK_API ParameterSession {
+
+public:
+
+    using Ptr = std::shared_ptr<ParameterSession>;
+
+    /**
+     * @brief Get the session of a device, shared with the users of the device with the same options.
+     * The session is closed when its last user releases it. If the device is not compatible, a exception is thrown
+     *
+     * @param pDevice
+     * @param options
+     * @return Ptr
+     */
+    static Ptr get(std::shared_ptr<DeviceInfo> pDevice, const ParameterSessionOptions &options = ParameterSessionOptions());
+
+    /**
+     * @brief Construct a new ParameterSession object for the parameter service of a device, which is not shared.
+     * No connection is opened yet
+     *
+     * @param address
+     * @param service
+     * @param options
+     */
+    ParameterSession(const std::string &address, const std::string &service,
+        const ParameterSessionOptions &options = ParameterSessionOptions());
+
+    /**
+     * @brief Destroy the ParameterSession object
+     *
+     */
+    virtual ~ParameterSession();
+
+    /**
+     * @brief Acquire the least busy connection, opening one if all are busy and the pool is not full. A connection is
+     * busy while it's leased or has requests pending, the lease ends when the returned pointer is released.
+     * If the connection is broken, it's replaced. If no connection can be opened, a exception is thrown
+     *
+     * @return std::shared_ptr<ParameterProtocol>
+     */
+    std::shared_ptr<ParameterProtocol> acquire();
+
+    /**
+     * @brief Remove all parameters from the caches of the open connections
+     *
+     */
+    void invalidateCache();
+
+    /**
+     * @brief Read the parameters in the caches of the open connections again from the device
+     *
+     */
+    void refreshCache();
+
+    /**
+     * @brief Get counters of the session
+     *
+     * @return ParameterSessionStats
+     */
+    ParameterSessionStats stats() const;
+
+private:
+    std::unique_ptr<ParameterSessionImpl> _pImpl;
+};
+
+} // namespace protocol
+} // namespace libspark
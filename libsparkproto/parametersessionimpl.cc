@@ -0,0 +1,157 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <algorithm>
+
+#include <libsparkproto/parametersessionimpl.h>
+#include <libsparkproto/exception.h>
+
+namespace libspark {
+
+namespace protocol {
+
+static int64_t steadyNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ParameterSessionImpl::ParameterSessionImpl(const std::string &address, const std::string &service, const ParameterSessionOptions &options)
+    : _address(address), _service(service), _options(options), _opening(0) {
+
+    if(options.poolSize < 1) {
+        throw SparkError("pool of parameter connections must have at least 1 connection");
+    }
+    if(options.protocol.window < 1) {
+        throw SparkError("window of requests in flight must be at least 1");
+    }
+}
+
+ParameterSessionImpl::~ParameterSessionImpl() {
+    // connections which are in use are closed when they are released
+}
+
+std::shared_ptr<ParameterProtocol> ParameterSessionImpl::acquire() {
+    std::unique_lock<std::mutex> lock(_lock);
+    while(true) {
+        std::shared_ptr<Connection> connection = leastLoaded();
+
+        // a connection is opened if none is open, or if all are busy and the pool is not full
+        bool poolFull = _connections.size() + _opening >= poolSize();
+        if(!poolFull && (!connection || load(*connection) > 0)) {
+            _opening++;
+            lock.unlock();
+            std::shared_ptr<ParameterProtocol> protocol;
+            std::exception_ptr failure;
+            try {
+                protocol = std::make_shared<ParameterProtocol>(_address, _service, _options.protocol);
+            } catch(...) {
+                failure = std::current_exception();
+            }
+            lock.lock();
+            _opening--;
+            _cond.notify_all();
+
+            if(protocol) {
+                connection = std::make_shared<Connection>();
+                connection->protocol = protocol;
+                connection->users = 0;
+                connection->lastUsed = steadyNow();
+                _connections.push_back(connection);
+                _stats.connectCount++;
+            } else {
+                // a busy connection is still better than none
+                connection = leastLoaded();
+                if(!connection) {
+                    std::rethrow_exception(failure);
+                }
+            }
+        } else if(!connection) {
+            // the pool is full of connections being opened by other callers
+            _cond.wait(lock);
+            continue;
+        }
+
+        // a connection which was idle for long may be gone without notice, e.g. the device was restarted
+        int64_t idle = steadyNow() - connection->lastUsed;
+        bool healthCheck = _options.healthCheckInterval && load(*connection) == 0 &&
+            idle > int64_t(_options.healthCheckInterval) * 1000000;
+
+        // only the connection handed out is checked, without the lock, so callers don't wait for each other
+        connection->users++;
+        lock.unlock();
+        bool alive = false;
+        try {
+            alive = connection->protocol->isConnected() &&
+                (!healthCheck || connection->protocol->ping(_options.healthCheckTimeout));
+        } catch(...) {
+            connection->users--;
+            throw;
+        }
+        lock.lock();
+        if(healthCheck) {
+            connection->lastUsed = steadyNow();
+            _stats.healthCheckCount++;
+        }
+        if(!alive) {
+            connection->users--;
+            _connections.erase(std::remove(_connections.begin(), _connections.end(), connection), _connections.end());
+            _stats.reconnectCount++;
+            continue;
+        }
+
+        // the connection is leased until the last copy of the pointer is released
+        return std::shared_ptr<ParameterProtocol>(connection->protocol.get(), [connection](ParameterProtocol*) {
+            connection->lastUsed = steadyNow();
+            connection->users--;
+        });
+    }
+}
+
+void ParameterSessionImpl::invalidateCache() {
+    for(std::shared_ptr<Connection> &connection : connections()) {
+        connection->protocol->invalidateCache();
+    }
+}
+
+void ParameterSessionImpl::refreshCache() {
+    for(std::shared_ptr<Connection> &connection : connections()) {
+        connection->protocol->refreshCache();
+    }
+}
+
+ParameterSessionStats ParameterSessionImpl::stats() const {
+    std::lock_guard<std::mutex> lock(_lock);
+    ParameterSessionStats stats = _stats;
+    stats.openCount = uint32_t(_connections.size());
+    return stats;
+}
+
+size_t ParameterSessionImpl::load(Connection &connection) {
+    // asynchronous requests release their lease when they are queued, they are counted until they complete
+    return connection.users + connection.protocol->pendingCount();
+}
+
+std::shared_ptr<ParameterSessionImpl::Connection> ParameterSessionImpl::leastLoaded() {
+    std::shared_ptr<Connection> least;
+    size_t leastLoad = 0;
+    for(std::shared_ptr<Connection> &connection : _connections) {
+        size_t connectionLoad = load(*connection);
+        if(!least || connectionLoad < leastLoad) {
+            least = connection;
+            leastLoad = connectionLoad;
+        }
+    }
+    return least;
+}
+
+uint32_t ParameterSessionImpl::poolSize() const {
+    // every connection has its own cache, which only sees the writes made on it
+    return _options.protocol.enableCache ? 1 : _options.poolSize;
+}
+
+std::vector<std::shared_ptr<ParameterSessionImpl::Connection>> ParameterSessionImpl::connections() {
+    std::lock_guard<std::mutex> lock(_lock);
+    return _connections;
+}
+
+} // namespace protocol
+} // namespace libspark
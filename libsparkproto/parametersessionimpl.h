@@ -0,0 +1,67 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <libsparkproto/parametersession.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class ParameterSessionImpl {
+
+public:
+    ParameterSessionImpl(const std::string &address, const std::string &service, const ParameterSessionOptions &options);
+
+    virtual ~ParameterSessionImpl();
+
+    std::shared_ptr<ParameterProtocol> acquire();
+
+    void invalidateCache();
+
+    void refreshCache();
+
+    ParameterSessionStats stats() const;
+
+private:
+    struct Connection {
+        std::shared_ptr<ParameterProtocol> protocol;
+        // leases of the connection, and when the last one was released in nanoseconds of the steady clock.
+        // They are updated without the lock of the session, a lease may be released after the session is gone
+        std::atomic<uint32_t> users;
+        std::atomic<int64_t> lastUsed;
+    };
+
+    // leases and requests pending on a connection
+    static size_t load(Connection &connection);
+
+    // the connection with the least load, null if none is open. With _lock held
+    std::shared_ptr<Connection> leastLoaded();
+
+    // connections open at most
+    uint32_t poolSize() const;
+
+    // open connections, used by the caches of the open connections
+    std::vector<std::shared_ptr<Connection>> connections();
+
+    std::string _address;
+    std::string _service;
+    ParameterSessionOptions _options;
+
+    mutable std::mutex _lock;
+    std::condition_variable _cond;
+    std::vector<std::shared_ptr<Connection>> _connections;
+    // connections being opened without the lock
+    uint32_t _opening;
+    ParameterSessionStats _stats;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,102 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <libsparkproto/parametersimulator.h>
+#include <libsparkproto/exception.h>
+
+namespace libspark {
+
+namespace protocol {
+
+ParameterSimulator::ParameterSimulator(const ParameterProfile &profile) : _profile(profile) {
+
+}
+
+ParameterProfile ParameterSimulator::profile() const {
+    std::lock_guard<std::mutex> lock(_lock);
+    return _profile;
+}
+
+// the typed getters and setters of the profile throw if id has no value of the type or the value is not valid
+bool ParameterSimulator::readBool(int32_t id, bool &value) {
+    std::lock_guard<std::mutex> lock(_lock);
+    try {
+        value = _profile.boolValue(id);
+        return true;
+    } catch (SparkException &) {
+        return false;
+    }
+}
+
+bool ParameterSimulator::writeBool(int32_t id, bool value) {
+    std::lock_guard<std::mutex> lock(_lock);
+    try {
+        _profile.setBool(id, value);
+        return true;
+    } catch (SparkException &) {
+        return false;
+    }
+}
+
+bool ParameterSimulator::readInt(int32_t id, int32_t &value) {
+    std::lock_guard<std::mutex> lock(_lock);
+    try {
+        value = _profile.intValue(id);
+        return true;
+    } catch (SparkException &) {
+        return false;
+    }
+}
+
+bool ParameterSimulator::writeInt(int32_t id, int32_t value) {
+    std::lock_guard<std::mutex> lock(_lock);
+    try {
+        _profile.setInt(id, value);
+        return true;
+    } catch (SparkException &) {
+        return false;
+    }
+}
+
+bool ParameterSimulator::readDouble(int32_t id, double &value) {
+    std::lock_guard<std::mutex> lock(_lock);
+    try {
+        value = _profile.doubleValue(id);
+        return true;
+    } catch (SparkException &) {
+        return false;
+    }
+}
+
+bool ParameterSimulator::writeDouble(int32_t id, double value) {
+    std::lock_guard<std::mutex> lock(_lock);
+    try {
+        _profile.setDouble(id, value);
+        return true;
+    } catch (SparkException &) {
+        return false;
+    }
+}
+
+bool ParameterSimulator::readString(int32_t id, std::string &value) {
+    std::lock_guard<std::mutex> lock(_lock);
+    try {
+        value = _profile.stringValue(id);
+        return true;
+    } catch (SparkException &) {
+        return false;
+    }
+}
+
+bool ParameterSimulator::writeString(int32_t id, const std::string &value) {
+    std::lock_guard<std::mutex> lock(_lock);
+    try {
+        _profile.setString(id, value);
+        return true;
+    } catch (SparkException &) {
+        return false;
+    }
+}
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,129 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <libsparkproto/common.h>
+#include <libsparkproto/iparametersource.h>
+#include <libsparkproto/parameterprofile.h>
+
+namespace libspark {
+
+namespace protocol {
+
+/**
+ * @brief ParameterSimulator simulates the settings of a device with the values of a ParameterProfile, e.g. the
+ * last snapshot of the device. Reads answer the values of the profile and writes change them, values are checked
+ * against the registry of parameters like ParameterProfile does. It is used as the fallback of a ParameterBatch
+ * for the operations the device fails, see ParameterBatch::setFallback()
+ *
+ */
+class SPARK_API ParameterSimulator : public IParameterSource {
+
+public:
+
+    using Ptr = std::shared_ptr<ParameterSimulator>;
+
+    /**
+     * @brief Construct a new ParameterSimulator object with the settings of profile
+     *
+     * @param profile
+     */
+    ParameterSimulator(const ParameterProfile &profile = ParameterProfile());
+
+    /**
+     * @brief Copy of the current settings of the simulator
+     *
+     * @return ParameterProfile
+     */
+    ParameterProfile profile() const;
+
+    /**
+     * @brief Value of a bool parameter of the profile, return false if the profile has no bool value of id
+     *
+     * @param id
+     * @param value
+     * @return true
+     * @return false
+     */
+    bool readBool(int32_t id, bool &value) override;
+
+    /**
+     * @brief Set a bool parameter of the profile, return false if it's not a valid bool setting
+     *
+     * @param id
+     * @param value
+     * @return true
+     * @return false
+     */
+    bool writeBool(int32_t id, bool value) override;
+
+    /**
+     * @brief Value of a int parameter of the profile, return false if the profile has no int value of id
+     *
+     * @param id
+     * @param value
+     * @return true
+     * @return false
+     */
+    bool readInt(int32_t id, int32_t &value) override;
+
+    /**
+     * @brief Set a int parameter of the profile, return false if it's not a valid int setting
+     *
+     * @param id
+     * @param value
+     * @return true
+     * @return false
+     */
+    bool writeInt(int32_t id, int32_t value) override;
+
+    /**
+     * @brief Value of a double parameter of the profile, return false if the profile has no double value of id
+     *
+     * @param id
+     * @param value
+     * @return true
+     * @return false
+     */
+    bool readDouble(int32_t id, double &value) override;
+
+    /**
+     * @brief Set a double parameter of the profile, return false if it's not a valid double setting
+     *
+     * @param id
+     * @param value
+     * @return true
+     * @return false
+     */
+    bool writeDouble(int32_t id, double value) override;
+
+    /**
+     * @brief Value of a string parameter of the profile, return false if the profile has no string value of id
+     *
+     * @param id
+     * @param value
+     * @return true
+     * @return false
+     */
+    bool readString(int32_t id, std::string &value) override;
+
+    /**
+     * @brief Set a string parameter of the profile, return false if it's not a valid string setting
+     *
+     * @param id
+     * @param value
+     * @return true
+     * @return false
+     */
+    bool writeString(int32_t id, const std::string &value) override;
+
+private:
+    mutable std::mutex _lock;
+    ParameterProfile _profile;
+};
+
+} // namespace protocol
+} // namespace libspark
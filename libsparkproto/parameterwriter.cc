@@ -0,0 +1,60 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <libsparkproto/parameterwriter.h>
+#include <libsparkproto/parameterwriterimpl.h>
+#include <libsparkproto/constants.h>
+#include <libsparkproto/exception.h>
+
+namespace libspark {
+
+namespace protocol {
+
+ParameterWriter::ParameterWriter(std::shared_ptr<DeviceInfo> pDevice, const ParameterWriterOptions &options) {
+    if(!pDevice->isCompatible())
+        throw SparkError("The library is not compatible with Spark firmware, please upgrade new version of libsparkpro");
+
+    std::shared_ptr<ParameterProtocol> protocol =
+        std::make_shared<ParameterProtocol>(pDevice->getIpAdress(), std::to_string(PARAMETERS_PORT));
+    _pImpl.reset(new ParameterWriterImpl(protocol, options));
+}
+
+ParameterWriter::ParameterWriter(std::shared_ptr<ParameterProtocol> protocol, const ParameterWriterOptions &options)
+    : _pImpl(new ParameterWriterImpl(protocol, options)) {
+
+}
+
+ParameterWriter::~ParameterWriter() {
+
+}
+
+void ParameterWriter::writeBool(int32_t id, bool value) {
+    _pImpl->writeBool(id, value);
+}
+
+void ParameterWriter::writeInt(int32_t id, int32_t value) {
+    _pImpl->writeInt(id, value);
+}
+
+void ParameterWriter::writeDouble(int32_t id, double value) {
+    _pImpl->writeDouble(id, value);
+}
+
+void ParameterWriter::writeString(int32_t id, const std::string &value) {
+    _pImpl->writeString(id, value);
+}
+
+void ParameterWriter::setMaxRate(int32_t id, float maxRate) {
+    _pImpl->setMaxRate(id, maxRate);
+}
+
+void ParameterWriter::flush() {
+    _pImpl->flush();
+}
+
+ParameterWriterStats ParameterWriter::stats() const {
+    return _pImpl->stats();
+}
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,164 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <libsparkproto/common.h>
+#include <libsparkproto/deviceinfo.h>
+#include <libsparkproto/parameterprotocol.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class ParameterWriterImpl;
+
+/**
+ * @brief Options of ParameterWriter
+ *
+ */
+struct SPARK_API ParameterWriterOptions {
+    // writes per second of a parameter at most, 0 for no limit. It can be changed per parameter by setMaxRate()
+    float maxRate = 0.0f;
+};
+
+/**
+ * @brief Counters of ParameterWriter
+ *
+ */
+struct SPARK_API ParameterWriterStats {
+    // values passed to the writer
+    uint64_t writeCount = 0;
+    // values sent to the device, and those of them which failed
+    uint64_t sentCount = 0;
+    uint64_t failedCount = 0;
+    // values replaced by a newer value of the same parameter before they were sent
+    uint64_t coalescedCount = 0;
+    // parameter and error of the last write which failed, empty if none did
+    int32_t lastFailedId = 0;
+    std::string lastError;
+};
+
+/**
+ * @brief ParameterWriter writes parameters which are updated at a high rate, e.g. exposure and gain by a controller.
+ * The latest value of a parameter wins: a parameter has at most one write in flight, and values written meanwhile
+ * replace each other, so the device follows the newest value instead of a backlog of old ones.
+ *
+ * Writes never wait for the device, they are sent asynchronously on the ParameterProtocol and rate limited per
+ * parameter. A failed write is logged and counted in the stats, which keep the error of the last one. All functions are thread-safe.
+ *
+ */
+class SPARK_API ParameterWriter {
+
+public:
+
+    using Ptr = std::shared_ptr<ParameterWriter>;
+
+    /**
+     * @brief Construct a new ParameterWriter object writing to the device.
+     * If the device can not be accessed, a exception is thrown
+     *
+     * @param pDevice
+     * @param options
+     */
+    ParameterWriter(std::shared_ptr<DeviceInfo> pDevice, const ParameterWriterOptions &options = ParameterWriterOptions());
+
+    /**
+     * @brief Construct a new ParameterWriter object writing to a device through protocol, which may be shared
+     * with other users
+     *
+     * @param protocol
+     * @param options
+     */
+    ParameterWriter(std::shared_ptr<ParameterProtocol> protocol, const ParameterWriterOptions &options = ParameterWriterOptions());
+
+    /**
+     * @brief Destroy the ParameterWriter object, pending values are written first
+     *
+     */
+    virtual ~ParameterWriter();
+
+    /**
+     * @brief Write a bool parameter, replacing a value of it which is not sent yet.
+     * If id is invalid, the parameter is not a bool, a exception is thrown
+     *
+     * @param id
+     * @param value
+     */
+    void writeBool(int32_t id, bool value);
+
+    /**
+     * @brief Write a int parameter, replacing a value of it which is not sent yet.
+     * If id is invalid, the parameter is not a int or value is out of its range, a exception is thrown
+     *
+     * @param id
+     * @param value
+     */
+    void writeInt(int32_t id, int32_t value);
+
+    /**
+     * @brief Write a double parameter, replacing a value of it which is not sent yet.
+     * If id is invalid, the parameter is not a double, a exception is thrown
+     *
+     * @param id
+     * @param value
+     */
+    void writeDouble(int32_t id, double value);
+
+    /**
+     * @brief Write a string parameter, replacing a value of it which is not sent yet.
+     * If id is invalid, the parameter is not a string, a exception is thrown
+     *
+     * @param id
+     * @param value
+     */
+    void writeString(int32_t id, const std::string &value);
+
+    /**
+     * @brief Write the parameter Id as the type of its ParameterTraits, see writeBool()
+     *
+     * @tparam Id
+     * @param value
+     */
+    template<ParameterID Id>
+    void write(const typename ParameterTraits<Id>::Type &value) {
+        static_assert(!ParameterTraits<Id>::descriptor().readOnly, "parameter is read-only");
+        writeValue(Id, value);
+    }
+
+    /**
+     * @brief Set the writes per second of a parameter at most, 0 for no limit
+     *
+     * @param id
+     * @param maxRate
+     */
+    void setMaxRate(int32_t id, float maxRate);
+
+    /**
+     * @brief Send the values written before the call without waiting for the rate limit, and wait until the device
+     * has answered them. It must not be called from a callback of ParameterProtocol
+     *
+     */
+    void flush();
+
+    /**
+     * @brief Get counters of the writer
+     *
+     * @return ParameterWriterStats
+     */
+    ParameterWriterStats stats() const;
+
+private:
+    // typed writes dispatched by the type of the value
+    void writeValue(int32_t id, bool value) { writeBool(id, value); }
+    void writeValue(int32_t id, int32_t value) { writeInt(id, value); }
+    void writeValue(int32_t id, double value) { writeDouble(id, value); }
+    void writeValue(int32_t id, const std::string &value) { writeString(id, value); }
+
+    std::unique_ptr<ParameterWriterImpl> _pImpl;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,270 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <libsparkproto/parameterwriterimpl.h>
+#include <libsparkproto/parameterids.pb.h>
+#include <libsparkproto/parameterregistry.h>
+#include <libsparkproto/parameters.pb.h>
+#include <libsparkproto/exception.h>
+#include <libsparkproto/log.h>
+
+namespace libspark {
+
+namespace protocol {
+
+ParameterWriterImpl::ParameterWriterImpl(std::shared_ptr<ParameterProtocol> protocol, const ParameterWriterOptions &options)
+    : _protocol(protocol), _options(options), _sequence(0), _flushSequence(0), _stop(false) {
+
+    if(!protocol) {
+        throw SparkError("passed a null parameter protocol");
+    }
+    if(!(options.maxRate >= 0.0f)) {
+        throw SparkError("maxRate of writes must not be negative");
+    }
+
+    _timerThread = std::thread(&ParameterWriterImpl::timerLoop, this);
+}
+
+ParameterWriterImpl::~ParameterWriterImpl() {
+    flush();
+
+    std::unique_lock<std::mutex> lock(_lock);
+    _stop = true;
+    _cond.notify_all();
+    lock.unlock();
+    if(_timerThread.joinable()) {
+        _timerThread.join();
+    }
+
+    // callbacks of the writes refer to the writer
+    lock.lock();
+    _cond.wait(lock, [&]() {
+        for(const std::pair<const int32_t, Entry> &item : _entries) {
+            if(item.second.inFlight) {
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+void ParameterWriterImpl::writeBool(int32_t id, bool value) {
+    Value update;
+    update.type = ParameterType::PARAMETER_WRITE_BOOLEAN;
+    update.boolValue = value;
+    write(id, update);
+}
+
+void ParameterWriterImpl::writeInt(int32_t id, int32_t value) {
+    Value update;
+    update.type = ParameterType::PARAMETER_WRITE_INT;
+    update.intValue = value;
+    write(id, update);
+}
+
+void ParameterWriterImpl::writeDouble(int32_t id, double value) {
+    Value update;
+    update.type = ParameterType::PARAMETER_WRITE_DOUBLE;
+    update.doubleValue = value;
+    write(id, update);
+}
+
+void ParameterWriterImpl::writeString(int32_t id, const std::string &value) {
+    Value update;
+    update.type = ParameterType::PARAMETER_WRITE_STRING;
+    update.stringValue = value;
+    write(id, update);
+}
+
+void ParameterWriterImpl::setMaxRate(int32_t id, float maxRate) {
+    if(!ParameterID_IsValid(id)) {
+        throw SparkError("passed a invalid ParameterID");
+    }
+    if(!(maxRate >= 0.0f)) {
+        throw SparkError("maxRate of writes must not be negative");
+    }
+
+    std::lock_guard<std::mutex> lock(_lock);
+    _entries[id].maxRate = maxRate;
+    _cond.notify_all();
+}
+
+void ParameterWriterImpl::flush() {
+    std::vector<Send> sends;
+    std::unique_lock<std::mutex> lock(_lock);
+    uint64_t sequence = _sequence;
+    _flushSequence = std::max(_flushSequence, sequence);
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for(std::pair<const int32_t, Entry> &item : _entries) {
+        take(item.first, item.second, now, sends);
+    }
+    lock.unlock();
+    send(sends);
+    lock.lock();
+
+    // values behind a write in flight are sent when it completes
+    _cond.wait(lock, [&]() {
+        for(const std::pair<const int32_t, Entry> &item : _entries) {
+            const Entry &entry = item.second;
+            if((entry.hasPending && entry.pendingSequence <= sequence) || (entry.inFlight && entry.inFlightSequence <= sequence)) {
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+ParameterWriterStats ParameterWriterImpl::stats() const {
+    std::lock_guard<std::mutex> lock(_lock);
+    return _stats;
+}
+
+void ParameterWriterImpl::write(int32_t id, Value &value) {
+    // a write which the device would reject is not coalesced with the valid ones
+    std::string error;
+    switch(value.type) {
+    case ParameterType::PARAMETER_WRITE_BOOLEAN:
+        error = checkParameterWrite(id, VALUE_BOOL, value.boolValue);
+        break;
+    case ParameterType::PARAMETER_WRITE_INT:
+        error = checkParameterWrite(id, VALUE_INT, value.intValue);
+        break;
+    case ParameterType::PARAMETER_WRITE_DOUBLE:
+        error = checkParameterWrite(id, VALUE_DOUBLE);
+        break;
+    default:
+        error = checkParameterWrite(id, VALUE_STRING);
+        break;
+    }
+    if(!error.empty()) {
+        throw SparkError(error);
+    }
+
+    std::vector<Send> sends;
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        Entry &entry = _entries[id];
+        _stats.writeCount++;
+        if(entry.hasPending) {
+            _stats.coalescedCount++;
+        }
+        entry.hasPending = true;
+        entry.pending = std::move(value);
+        entry.pendingSequence = ++_sequence;
+
+        if(!take(id, entry, std::chrono::steady_clock::now(), sends) && !entry.inFlight) {
+            // held by the rate limit
+            _cond.notify_all();
+        }
+    }
+    send(sends);
+}
+
+bool ParameterWriterImpl::take(int32_t id, Entry &entry, std::chrono::steady_clock::time_point now, std::vector<Send> &sends) {
+    if(!entry.hasPending || entry.inFlight) {
+        return false;
+    }
+    if(entry.pendingSequence > _flushSequence && now < nextSend(entry)) {
+        return false;
+    }
+
+    Send send;
+    send.id = id;
+    send.value = std::move(entry.pending);
+    sends.push_back(std::move(send));
+
+    entry.hasPending = false;
+    entry.inFlight = true;
+    entry.inFlightSequence = entry.pendingSequence;
+    entry.lastSent = now;
+    _stats.sentCount++;
+    return true;
+}
+
+std::chrono::steady_clock::time_point ParameterWriterImpl::nextSend(const Entry &entry) const {
+    float maxRate = entry.maxRate >= 0.0f ? entry.maxRate : _options.maxRate;
+    if(maxRate <= 0.0f) {
+        return entry.lastSent;
+    }
+    return entry.lastSent + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / maxRate));
+}
+
+void ParameterWriterImpl::send(std::vector<Send> &sends) {
+    for(Send &send : sends) {
+        int32_t id = send.id;
+        ParameterWriteCallback callback = [this, id](const ParameterStatus &status) {
+            complete(id, status.succeeded, status.message);
+        };
+
+        switch(send.value.type) {
+        case ParameterType::PARAMETER_WRITE_BOOLEAN:
+            _protocol->writeBoolParameterAsync(id, send.value.boolValue, callback);
+            break;
+        case ParameterType::PARAMETER_WRITE_INT:
+            _protocol->writeIntParameterAsync(id, send.value.intValue, callback);
+            break;
+        case ParameterType::PARAMETER_WRITE_DOUBLE:
+            _protocol->writeDoubleParameterAsync(id, send.value.doubleValue, callback);
+            break;
+        default:
+            _protocol->writeStringParameterAsync(id, send.value.stringValue, callback);
+            break;
+        }
+    }
+    sends.clear();
+}
+
+void ParameterWriterImpl::complete(int32_t id, bool succeeded, const std::string &error) {
+    if(!succeeded) {
+        LOG_ERROR("failed to write parameter %d: %s", id, error.c_str());
+    }
+
+    std::vector<Send> sends;
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        Entry &entry = _entries[id];
+        entry.inFlight = false;
+        if(!succeeded) {
+            _stats.failedCount++;
+            _stats.lastFailedId = id;
+            _stats.lastError = error;
+        }
+        // the value written meanwhile is sent now, or by the timer if the rate limit holds it
+        take(id, entry, std::chrono::steady_clock::now(), sends);
+        _cond.notify_all();
+    }
+    send(sends);
+}
+
+void ParameterWriterImpl::timerLoop() {
+    std::vector<Send> sends;
+    std::unique_lock<std::mutex> lock(_lock);
+
+    while(!_stop) {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point next = std::chrono::steady_clock::time_point::max();
+        for(std::pair<const int32_t, Entry> &item : _entries) {
+            Entry &entry = item.second;
+            if(!take(item.first, entry, now, sends) && entry.hasPending && !entry.inFlight) {
+                next = std::min(next, nextSend(entry));
+            }
+        }
+
+        if(!sends.empty()) {
+            lock.unlock();
+            send(sends);
+            lock.lock();
+            continue;
+        }
+        if(next == std::chrono::steady_clock::time_point::max()) {
+            _cond.wait(lock);
+        } else {
+            _cond.wait_until(lock, next);
+        }
+    }
+}
+
+} // namespace protocol
+} // namespace libspark
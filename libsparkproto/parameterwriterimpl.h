@@ -0,0 +1,102 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <libsparkproto/parameterwriter.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class ParameterWriterImpl {
+
+public:
+    ParameterWriterImpl(std::shared_ptr<ParameterProtocol> protocol, const ParameterWriterOptions &options);
+
+    virtual ~ParameterWriterImpl();
+
+    void writeBool(int32_t id, bool value);
+
+    void writeInt(int32_t id, int32_t value);
+
+    void writeDouble(int32_t id, double value);
+
+    void writeString(int32_t id, const std::string &value);
+
+    void setMaxRate(int32_t id, float maxRate);
+
+    void flush();
+
+    ParameterWriterStats stats() const;
+
+private:
+    struct Value {
+        // ParameterType of the write
+        int32_t type = 0;
+        bool boolValue = false;
+        int32_t intValue = 0;
+        double doubleValue = 0.0;
+        std::string stringValue;
+    };
+
+    struct Entry {
+        // latest value which is not sent yet, and its sequence number of writes
+        bool hasPending = false;
+        Value pending;
+        uint64_t pendingSequence = 0;
+        // sequence number of the value in flight, a parameter has one value in flight at most
+        bool inFlight = false;
+        uint64_t inFlightSequence = 0;
+        std::chrono::steady_clock::time_point lastSent;
+        // negative for the rate of the options
+        float maxRate = -1.0f;
+    };
+
+    // a value taken to be sent
+    struct Send {
+        int32_t id;
+        Value value;
+    };
+
+    // store value as the pending one of id, and send it if the rate allows
+    void write(int32_t id, Value &value);
+
+    // take the pending value of entry to be sent if it can be sent now. With _lock held
+    bool take(int32_t id, Entry &entry, std::chrono::steady_clock::time_point now, std::vector<Send> &sends);
+
+    // time the pending value of entry can be sent at
+    std::chrono::steady_clock::time_point nextSend(const Entry &entry) const;
+
+    // send values taken, without _lock held as the protocol may complete them inline
+    void send(std::vector<Send> &sends);
+
+    void complete(int32_t id, bool succeeded, const std::string &error);
+
+    // sends values which were held by the rate limit
+    void timerLoop();
+
+    std::shared_ptr<ParameterProtocol> _protocol;
+    ParameterWriterOptions _options;
+
+    // lock of the entries and the stats
+    mutable std::mutex _lock;
+    std::condition_variable _cond;
+    std::map<int32_t, Entry> _entries;
+    ParameterWriterStats _stats;
+    uint64_t _sequence;
+    // values written up to this sequence number are sent without waiting for the rate limit
+    uint64_t _flushSequence;
+    bool _stop;
+    std::thread _timerThread;
+};
+
+} // namespace protocol
+} // namespace libspark
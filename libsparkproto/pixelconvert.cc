@@ -0,0 +1,104 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <libsparkproto/pixelconvert.h>
+#include <libsparkproto/pixelkernels.h>
+#include <libsparkproto/exception.h>
+
+namespace libspark {
+
+namespace protocol {
+
+PixelFormat pixelFormatOf(int32_t imgFormat) {
+    switch (imgFormat)
+    {
+    case FORMAT_RGB: return PIXEL_RGB8;
+    case FORMAT_GRAY: return PIXEL_GRAY8;
+    default: return PIXEL_UNKNOWN;
+    }
+}
+
+uint32_t pixelSize(PixelFormat format) {
+    switch (format)
+    {
+    case PIXEL_RGB8:
+    case PIXEL_BGR8: return 3;
+    case PIXEL_GRAY8:
+    case PIXEL_RGB8_PLANAR: return 1;
+    case PIXEL_GRAY16: return 2;
+    case PIXEL_RGB16: return 6;
+    case PIXEL_GRAY32F: return 4;
+    case PIXEL_RGB32F: return 12;
+    default: return 0;
+    }
+}
+
+size_t imageSize(PixelFormat format, uint32_t width, uint32_t height, size_t stride) {
+    size_t rowSize = stride ? stride : size_t(width) * pixelSize(format);
+    return rowSize * height * (format == PIXEL_RGB8_PLANAR ? 3 : 1);
+}
+
+bool isConversionSupported(PixelFormat srcFormat, PixelFormat dstFormat) {
+    if(srcFormat != PIXEL_RGB8 && srcFormat != PIXEL_BGR8 && srcFormat != PIXEL_GRAY8) {
+        return false;
+    }
+    switch (dstFormat)
+    {
+    case PIXEL_RGB8:
+    case PIXEL_BGR8:
+    case PIXEL_GRAY8: return true;
+    case PIXEL_RGB8_PLANAR: return srcFormat != PIXEL_GRAY8;
+    case PIXEL_GRAY16:
+    case PIXEL_GRAY32F: return srcFormat == PIXEL_GRAY8;
+    case PIXEL_RGB16:
+    case PIXEL_RGB32F: return srcFormat == PIXEL_RGB8;
+    default: return false;
+    }
+}
+
+void convertPixels(const void *src, size_t srcStride, PixelFormat srcFormat,
+    void *dst, size_t dstStride, PixelFormat dstFormat, uint32_t width, uint32_t height) {
+
+    if(!isConversionSupported(srcFormat, dstFormat)) {
+        throw SparkError("conversion of pixels from format " + std::to_string(srcFormat) +
+            " to format " + std::to_string(dstFormat) + " is not supported");
+    }
+    if(!srcStride) {
+        srcStride = size_t(width) * pixelSize(srcFormat);
+    }
+    if(!dstStride) {
+        dstStride = size_t(width) * pixelSize(dstFormat);
+    }
+
+    cpu::Level level = cpu::dispatchLevel();
+    size_t planeSize = dstStride * height;
+    const uint8_t *srcRow = (const uint8_t *) src;
+    uint8_t *dstRow = (uint8_t *) dst;
+    for(uint32_t y = 0; y < height; y++) {
+        uint8_t *planes[3] = {dstRow, dstRow + planeSize, dstRow + 2 * planeSize};
+        pixel::convertRow(srcRow, srcFormat, planes, dstFormat, width, level);
+        srcRow += srcStride;
+        dstRow += dstStride;
+    }
+}
+
+void convertPlane(const ImageSet &imgSet, ImageSet::BufferID id, PixelFormat dstFormat, void *dst, size_t dstStride) {
+    if(id != ImageSet::BUFFER_LEFT && id != ImageSet::BUFFER_RIGHT) {
+        throw SparkError("only left and right images can be converted");
+    }
+    if((id == ImageSet::BUFFER_LEFT && !imgSet.hasLeft()) || (id == ImageSet::BUFFER_RIGHT && !imgSet.hasRight())) {
+        throw SparkError("the image to convert is not in the ImageSet");
+    }
+
+    const ImageMeta &meta = id == ImageSet::BUFFER_LEFT ? imgSet.meta().left() : imgSet.meta().right();
+    PixelFormat srcFormat = pixelFormatOf(meta.format());
+    const ImageSet::Buffer &buff = imgSet.getBuffer(id);
+    if(buff.size() < imageSize(srcFormat, meta.width(), meta.height())) {
+        throw SparkError("buffer of the image is smaller than its size in ImageMeta");
+    }
+
+    convertPixels(buff.data(), 0, srcFormat, dst, dstStride, dstFormat, meta.width(), meta.height());
+}
+
+} // namespace protocol
+} // namespace libspark
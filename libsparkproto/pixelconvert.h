@@ -0,0 +1,105 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <libsparkproto/common.h>
+#include <libsparkproto/imageset.h>
+#include <libsparkproto/pixelformat.h>
+
+namespace libspark {
+
+namespace protocol {
+
+//
+// Conversion of the pixels of ImageSet planes to the layouts consumers need, e.g. BGR for OpenCV.
+// Kernels are selected at runtime for the CPU, see libspark::protocol::cpu::dispatchLevel().
+//
+
+/**
+ * @brief Where recvImageSet() of ImageStreamProtocol writes a converted plane.
+ * stride is the distance between rows in bytes, 0 for rows without padding.
+ * Planes of PIXEL_RGB8_PLANAR are height * stride bytes apart
+ *
+ */
+struct SPARK_API PlaneOutput {
+    ImageSet::BufferID id = ImageSet::BUFFER_LEFT;
+    PixelFormat format = PIXEL_BGR8;
+    void *data = nullptr;
+    size_t stride = 0;
+    // size of data in bytes
+    size_t capacity = 0;
+};
+
+/**
+ * @brief PixelFormat of an image streamed in imgFormat, PIXEL_UNKNOWN for BAYER10
+ *
+ * @param imgFormat see libspark::protocol::ImageFormat
+ * @return PixelFormat
+ */
+SPARK_API PixelFormat pixelFormatOf(int32_t imgFormat);
+
+/**
+ * @brief Size of a pixel of a plane in bytes, a plane of PIXEL_RGB8_PLANAR has 1 byte per pixel
+ *
+ * @param format
+ * @return uint32_t
+ */
+SPARK_API uint32_t pixelSize(PixelFormat format);
+
+/**
+ * @brief Size in bytes of an image of width x height pixels in format, with a row stride or 0 for no padding
+ *
+ * @param format
+ * @param width
+ * @param height
+ * @param stride
+ * @return size_t
+ */
+SPARK_API size_t imageSize(PixelFormat format, uint32_t width, uint32_t height, size_t stride = 0);
+
+/**
+ * @brief Check if pixels of srcFormat can be converted to dstFormat
+ * Supported sources are PIXEL_RGB8, PIXEL_BGR8 and PIXEL_GRAY8.
+ * A 16-bit or float format can be made from the 8-bit format of the same channels only
+ *
+ * @param srcFormat
+ * @param dstFormat
+ * @return true
+ * @return false
+ */
+SPARK_API bool isConversionSupported(PixelFormat srcFormat, PixelFormat dstFormat);
+
+/**
+ * @brief Convert an image, src and dst must not overlap except when converting
+ * between PIXEL_RGB8 and PIXEL_BGR8 in place with the same stride.
+ * If the conversion is not supported, a exception is thrown
+ *
+ * @param src
+ * @param srcStride bytes between rows of src, 0 for no padding
+ * @param srcFormat
+ * @param dst
+ * @param dstStride bytes between rows of dst, 0 for no padding
+ * @param dstFormat
+ * @param width
+ * @param height
+ */
+SPARK_API void convertPixels(const void *src, size_t srcStride, PixelFormat srcFormat,
+    void *dst, size_t dstStride, PixelFormat dstFormat, uint32_t width, uint32_t height);
+
+/**
+ * @brief Convert an image of imgSet to dstFormat into a buffer of the caller, in a single pass over the plane.
+ * dst must hold imageSize(dstFormat, width, height, dstStride) bytes
+ *
+ * @param imgSet
+ * @param id left or right image
+ * @param dstFormat
+ * @param dst
+ * @param dstStride bytes between rows of dst, 0 for no padding
+ */
+SPARK_API void convertPlane(const ImageSet &imgSet, ImageSet::BufferID id, PixelFormat dstFormat, void *dst, size_t dstStride = 0);
+
+} // namespace protocol
+} // namespace libspark
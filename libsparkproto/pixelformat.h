@@ -0,0 +1,31 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+namespace libspark {
+
+namespace protocol {
+
+/**
+ * @brief Layout of pixels in memory
+ *
+ */
+enum PixelFormat {
+    PIXEL_UNKNOWN = 0,
+    // 3 bytes per pixel, interleaved
+    PIXEL_RGB8 = 1,
+    PIXEL_BGR8 = 2,
+    PIXEL_GRAY8 = 3,
+    // a plane of 1 byte per pixel for each of red, green and blue, one after another
+    PIXEL_RGB8_PLANAR = 4,
+    // 8-bit values v expanded to v * 257, so 255 maps to 65535
+    PIXEL_GRAY16 = 5,
+    PIXEL_RGB16 = 6,
+    // 32-bit float, 8-bit values normalized to [0, 1]
+    PIXEL_GRAY32F = 7,
+    PIXEL_RGB32F = 8
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,390 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include <libsparkproto/pixelkernels.h>
+
+#if defined(SPARK_CPU_X86)
+    #include <immintrin.h>
+#endif
+
+namespace libspark {
+
+namespace protocol {
+
+namespace pixel {
+
+// gray = (77 R + 150 G + 29 B + 128) >> 8, the weights of BT.601 in 8 bits
+static void rgbToGrayGeneric(const uint8_t *src, uint8_t *dst, uint32_t x, uint32_t width, bool bgr) {
+    const int wr = bgr ? 29 : 77;
+    const int wb = bgr ? 77 : 29;
+    for(; x < width; x++) {
+        dst[x] = uint8_t((wr * src[3 * x] + 150 * src[3 * x + 1] + wb * src[3 * x + 2] + 128) >> 8);
+    }
+}
+
+static void rgbToPlanarGeneric(const uint8_t *src, uint8_t *r, uint8_t *g, uint8_t *b, uint32_t x, uint32_t width) {
+    for(; x < width; x++) {
+        r[x] = src[3 * x];
+        g[x] = src[3 * x + 1];
+        b[x] = src[3 * x + 2];
+    }
+}
+
+static void grayToRgbGeneric(const uint8_t *src, uint8_t *dst, uint32_t x, uint32_t width) {
+    for(; x < width; x++) {
+        dst[3 * x] = src[x];
+        dst[3 * x + 1] = src[x];
+        dst[3 * x + 2] = src[x];
+    }
+}
+
+// v * 257 has v in both bytes, so the 16-bit value is the same on any byte order
+static void expand16Generic(const uint8_t *src, uint8_t *dst, uint32_t i, uint32_t count) {
+    for(; i < count; i++) {
+        dst[2 * i] = src[i];
+        dst[2 * i + 1] = src[i];
+    }
+}
+
+// dst of a caller may not be aligned for float, memcpy compiles to a plain store
+static void normalizeGeneric(const uint8_t *src, uint8_t *dst, uint32_t count) {
+    for(uint32_t i = 0; i < count; i++) {
+        float v = src[i] * (1.0f / 255.0f);
+        memcpy(dst + i * sizeof(float), &v, sizeof(float));
+    }
+}
+
+// safe in place, a pixel is read before it's written
+static void swapRedBlueGeneric(const uint8_t *src, uint8_t *dst, uint32_t x, uint32_t width) {
+    for(; x < width; x++) {
+        uint8_t r = src[3 * x];
+        uint8_t b = src[3 * x + 2];
+        dst[3 * x] = b;
+        dst[3 * x + 1] = src[3 * x + 1];
+        dst[3 * x + 2] = r;
+    }
+}
+
+// SIMD kernels process the head of a row and return the number of pixels done, the generic kernel finishes the row
+struct Kernels {
+    uint32_t (*swapRedBlue)(const uint8_t *src, uint8_t *dst, uint32_t width);
+    uint32_t (*rgbToGray)(const uint8_t *src, uint8_t *dst, uint32_t width, bool bgr);
+    uint32_t (*rgbToPlanar)(const uint8_t *src, uint8_t *r, uint8_t *g, uint8_t *b, uint32_t width);
+    uint32_t (*grayToRgb)(const uint8_t *src, uint8_t *dst, uint32_t width);
+    uint32_t (*expand16)(const uint8_t *src, uint8_t *dst, uint32_t count);
+};
+
+static uint32_t swapRedBlueNone(const uint8_t *, uint8_t *, uint32_t) { return 0; }
+static uint32_t rgbToGrayNone(const uint8_t *, uint8_t *, uint32_t, bool) { return 0; }
+static uint32_t rgbToPlanarNone(const uint8_t *, uint8_t *, uint8_t *, uint8_t *, uint32_t) { return 0; }
+static uint32_t grayToRgbNone(const uint8_t *, uint8_t *, uint32_t) { return 0; }
+static uint32_t expand16None(const uint8_t *, uint8_t *, uint32_t) { return 0; }
+
+static const Kernels GENERIC_KERNELS = {
+    swapRedBlueNone, rgbToGrayNone, rgbToPlanarNone, grayToRgbNone, expand16None
+};
+
+#if defined(SPARK_CPU_X86)
+
+// 5 pixels in the first 15 bytes of a 16-byte block are swapped, byte 15 is stored unchanged
+// so blocks can overlap by a byte, also in place
+static const int8_t SWAP_INDEX[16] = {2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15};
+
+// 16 interleaved pixels in 3 blocks a, b, c to a block per channel: each channel takes 5 or 6 bytes of a block
+static const int8_t DEINTERLEAVE_INDEX[3][3][16] = {
+    // red
+    {{0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1},
+     {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13}},
+    // green
+    {{1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1},
+     {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14}},
+    // blue
+    {{2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1},
+     {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15}}
+};
+
+// 16 gray pixels to 3 blocks of 48 bytes of RGB
+static const int8_t REPLICATE_INDEX[3][16] = {
+    {0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5},
+    {5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10},
+    {10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15}
+};
+
+__attribute__((target("sse4.1")))
+static inline __m128i deinterleaveSse41(__m128i a, __m128i b, __m128i c, int channel) {
+    return _mm_or_si128(_mm_or_si128(
+        _mm_shuffle_epi8(a, _mm_loadu_si128((const __m128i *)DEINTERLEAVE_INDEX[channel][0])),
+        _mm_shuffle_epi8(b, _mm_loadu_si128((const __m128i *)DEINTERLEAVE_INDEX[channel][1]))),
+        _mm_shuffle_epi8(c, _mm_loadu_si128((const __m128i *)DEINTERLEAVE_INDEX[channel][2])));
+}
+
+// 77 r + 150 g + 29 b + 128 is at most 65408, it fits unsigned 16-bit lanes
+__attribute__((target("sse4.1")))
+static inline __m128i weightedSumSse41(__m128i r, __m128i g, __m128i b, __m128i wr, __m128i wg, __m128i wb) {
+    const __m128i round = _mm_set1_epi16(128);
+    __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, wr), _mm_mullo_epi16(g, wg)), _mm_mullo_epi16(b, wb));
+    return _mm_srli_epi16(_mm_add_epi16(sum, round), 8);
+}
+
+__attribute__((target("sse4.1")))
+static uint32_t swapRedBlueSse41(const uint8_t *src, uint8_t *dst, uint32_t width) {
+    const __m128i index = _mm_loadu_si128((const __m128i *)SWAP_INDEX);
+    uint32_t x = 0;
+    for(; 3 * x + 16 <= 3 * width; x += 5) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + 3 * x));
+        _mm_storeu_si128((__m128i *)(dst + 3 * x), _mm_shuffle_epi8(v, index));
+    }
+    return x;
+}
+
+__attribute__((target("sse4.1")))
+static uint32_t rgbToGraySse41(const uint8_t *src, uint8_t *dst, uint32_t width, bool bgr) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i wr = _mm_set1_epi16(bgr ? 29 : 77);
+    const __m128i wg = _mm_set1_epi16(150);
+    const __m128i wb = _mm_set1_epi16(bgr ? 77 : 29);
+    uint32_t x = 0;
+    for(; x + 16 <= width; x += 16) {
+        const __m128i *p = (const __m128i *)(src + 3 * x);
+        __m128i a = _mm_loadu_si128(p);
+        __m128i b = _mm_loadu_si128(p + 1);
+        __m128i c = _mm_loadu_si128(p + 2);
+        __m128i r = deinterleaveSse41(a, b, c, 0);
+        __m128i g = deinterleaveSse41(a, b, c, 1);
+        __m128i bl = deinterleaveSse41(a, b, c, 2);
+        __m128i lo = weightedSumSse41(_mm_unpacklo_epi8(r, zero), _mm_unpacklo_epi8(g, zero), _mm_unpacklo_epi8(bl, zero), wr, wg, wb);
+        __m128i hi = weightedSumSse41(_mm_unpackhi_epi8(r, zero), _mm_unpackhi_epi8(g, zero), _mm_unpackhi_epi8(bl, zero), wr, wg, wb);
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(lo, hi));
+    }
+    return x;
+}
+
+__attribute__((target("sse4.1")))
+static uint32_t rgbToPlanarSse41(const uint8_t *src, uint8_t *r, uint8_t *g, uint8_t *b, uint32_t width) {
+    uint32_t x = 0;
+    for(; x + 16 <= width; x += 16) {
+        const __m128i *p = (const __m128i *)(src + 3 * x);
+        __m128i va = _mm_loadu_si128(p);
+        __m128i vb = _mm_loadu_si128(p + 1);
+        __m128i vc = _mm_loadu_si128(p + 2);
+        _mm_storeu_si128((__m128i *)(r + x), deinterleaveSse41(va, vb, vc, 0));
+        _mm_storeu_si128((__m128i *)(g + x), deinterleaveSse41(va, vb, vc, 1));
+        _mm_storeu_si128((__m128i *)(b + x), deinterleaveSse41(va, vb, vc, 2));
+    }
+    return x;
+}
+
+__attribute__((target("sse4.1")))
+static uint32_t grayToRgbSse41(const uint8_t *src, uint8_t *dst, uint32_t width) {
+    const __m128i index0 = _mm_loadu_si128((const __m128i *)REPLICATE_INDEX[0]);
+    const __m128i index1 = _mm_loadu_si128((const __m128i *)REPLICATE_INDEX[1]);
+    const __m128i index2 = _mm_loadu_si128((const __m128i *)REPLICATE_INDEX[2]);
+    uint32_t x = 0;
+    for(; x + 16 <= width; x += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + x));
+        __m128i *p = (__m128i *)(dst + 3 * x);
+        _mm_storeu_si128(p, _mm_shuffle_epi8(v, index0));
+        _mm_storeu_si128(p + 1, _mm_shuffle_epi8(v, index1));
+        _mm_storeu_si128(p + 2, _mm_shuffle_epi8(v, index2));
+    }
+    return x;
+}
+
+__attribute__((target("sse4.1")))
+static uint32_t expand16Sse41(const uint8_t *src, uint8_t *dst, uint32_t count) {
+    uint32_t i = 0;
+    for(; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + 2 * i), _mm_unpacklo_epi8(v, v));
+        _mm_storeu_si128((__m128i *)(dst + 2 * i + 16), _mm_unpackhi_epi8(v, v));
+    }
+    return i;
+}
+
+// AVX2 shuffles stay within 128-bit lanes, so a 256-bit block holds 16 pixels of a row in each lane
+__attribute__((target("avx2")))
+static inline __m256i loadLanesAvx2(const uint8_t *lo, const uint8_t *hi) {
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)lo)),
+        _mm_loadu_si128((const __m128i *)hi), 1);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i deinterleaveAvx2(__m256i a, __m256i b, __m256i c, int channel) {
+    return _mm256_or_si256(_mm256_or_si256(
+        _mm256_shuffle_epi8(a, _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)DEINTERLEAVE_INDEX[channel][0]))),
+        _mm256_shuffle_epi8(b, _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)DEINTERLEAVE_INDEX[channel][1])))),
+        _mm256_shuffle_epi8(c, _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)DEINTERLEAVE_INDEX[channel][2]))));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i weightedSumAvx2(__m256i r, __m256i g, __m256i b, __m256i wr, __m256i wg, __m256i wb) {
+    const __m256i round = _mm256_set1_epi16(128);
+    __m256i sum = _mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(r, wr), _mm256_mullo_epi16(g, wg)),
+        _mm256_mullo_epi16(b, wb));
+    return _mm256_srli_epi16(_mm256_add_epi16(sum, round), 8);
+}
+
+__attribute__((target("avx2")))
+static uint32_t swapRedBlueAvx2(const uint8_t *src, uint8_t *dst, uint32_t width) {
+    const __m256i index = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)SWAP_INDEX));
+    uint32_t x = 0;
+    // 10 pixels, 15 bytes per 128-bit lane. Both halves are loaded before the overlapping stores
+    for(; 3 * x + 31 <= 3 * width; x += 10) {
+        const uint8_t *p = src + 3 * x;
+        __m256i v = _mm256_shuffle_epi8(loadLanesAvx2(p, p + 15), index);
+        _mm_storeu_si128((__m128i *)(dst + 3 * x), _mm256_castsi256_si128(v));
+        _mm_storeu_si128((__m128i *)(dst + 3 * x + 15), _mm256_extracti128_si256(v, 1));
+    }
+    return x;
+}
+
+__attribute__((target("avx2")))
+static uint32_t rgbToGrayAvx2(const uint8_t *src, uint8_t *dst, uint32_t width, bool bgr) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i wr = _mm256_set1_epi16(bgr ? 29 : 77);
+    const __m256i wg = _mm256_set1_epi16(150);
+    const __m256i wb = _mm256_set1_epi16(bgr ? 77 : 29);
+    uint32_t x = 0;
+    for(; x + 32 <= width; x += 32) {
+        const uint8_t *p = src + 3 * x;
+        __m256i a = loadLanesAvx2(p, p + 48);
+        __m256i b = loadLanesAvx2(p + 16, p + 64);
+        __m256i c = loadLanesAvx2(p + 32, p + 80);
+        __m256i r = deinterleaveAvx2(a, b, c, 0);
+        __m256i g = deinterleaveAvx2(a, b, c, 1);
+        __m256i bl = deinterleaveAvx2(a, b, c, 2);
+        __m256i lo = weightedSumAvx2(_mm256_unpacklo_epi8(r, zero), _mm256_unpacklo_epi8(g, zero),
+            _mm256_unpacklo_epi8(bl, zero), wr, wg, wb);
+        __m256i hi = weightedSumAvx2(_mm256_unpackhi_epi8(r, zero), _mm256_unpackhi_epi8(g, zero),
+            _mm256_unpackhi_epi8(bl, zero), wr, wg, wb);
+        // unpack and pack work per lane, so the lanes stay in pixel order
+        _mm256_storeu_si256((__m256i *)(dst + x), _mm256_packus_epi16(lo, hi));
+    }
+    return x;
+}
+
+__attribute__((target("avx2")))
+static uint32_t rgbToPlanarAvx2(const uint8_t *src, uint8_t *r, uint8_t *g, uint8_t *b, uint32_t width) {
+    uint32_t x = 0;
+    for(; x + 32 <= width; x += 32) {
+        const uint8_t *p = src + 3 * x;
+        __m256i va = loadLanesAvx2(p, p + 48);
+        __m256i vb = loadLanesAvx2(p + 16, p + 64);
+        __m256i vc = loadLanesAvx2(p + 32, p + 80);
+        _mm256_storeu_si256((__m256i *)(r + x), deinterleaveAvx2(va, vb, vc, 0));
+        _mm256_storeu_si256((__m256i *)(g + x), deinterleaveAvx2(va, vb, vc, 1));
+        _mm256_storeu_si256((__m256i *)(b + x), deinterleaveAvx2(va, vb, vc, 2));
+    }
+    return x;
+}
+
+static const Kernels SSE41_KERNELS = {
+    swapRedBlueSse41, rgbToGraySse41, rgbToPlanarSse41, grayToRgbSse41, expand16Sse41
+};
+
+// stores of replicated and expanded pixels are the bound, AVX2 uses the SSE4.1 kernels for them
+static const Kernels AVX2_KERNELS = {
+    swapRedBlueAvx2, rgbToGrayAvx2, rgbToPlanarAvx2, grayToRgbSse41, expand16Sse41
+};
+
+#endif // SPARK_CPU_X86
+
+static const Kernels& kernelsOf(cpu::Level level) {
+#if defined(SPARK_CPU_X86)
+    if(level == cpu::LEVEL_AVX2) {
+        return AVX2_KERNELS;
+    }
+    if(level == cpu::LEVEL_SSE41) {
+        return SSE41_KERNELS;
+    }
+#endif
+    // NEON is part of the baseline of aarch64, the compiler vectorizes the generic kernels for it
+    (void) level;
+    return GENERIC_KERNELS;
+}
+
+void convertRow(const uint8_t *src, PixelFormat srcFormat, uint8_t *const dst[3], PixelFormat dstFormat,
+    uint32_t width, cpu::Level level) {
+
+    const Kernels &kernels = kernelsOf(level);
+    bool bgr = srcFormat == PIXEL_BGR8;
+
+    switch (dstFormat)
+    {
+    case PIXEL_RGB8:
+    case PIXEL_BGR8:
+        if(srcFormat == PIXEL_GRAY8) {
+            grayToRgbGeneric(src, dst[0], kernels.grayToRgb(src, dst[0], width), width);
+        } else if(srcFormat == dstFormat) {
+            if(src != dst[0]) {
+                memcpy(dst[0], src, size_t(width) * 3);
+            }
+        } else {
+            swapRedBlueGeneric(src, dst[0], kernels.swapRedBlue(src, dst[0], width), width);
+        }
+        break;
+    case PIXEL_GRAY8:
+        if(srcFormat == PIXEL_GRAY8) {
+            memcpy(dst[0], src, width);
+        } else {
+            rgbToGrayGeneric(src, dst[0], kernels.rgbToGray(src, dst[0], width, bgr), width, bgr);
+        }
+        break;
+    case PIXEL_RGB8_PLANAR: {
+        uint8_t *r = bgr ? dst[2] : dst[0];
+        uint8_t *b = bgr ? dst[0] : dst[2];
+        rgbToPlanarGeneric(src, r, dst[1], b, kernels.rgbToPlanar(src, r, dst[1], b, width), width);
+        break;
+    }
+    case PIXEL_GRAY16:
+        expand16Generic(src, dst[0], kernels.expand16(src, dst[0], width), width);
+        break;
+    case PIXEL_RGB16:
+        expand16Generic(src, dst[0], kernels.expand16(src, dst[0], width * 3), width * 3);
+        break;
+    case PIXEL_GRAY32F:
+        normalizeGeneric(src, dst[0], width);
+        break;
+    case PIXEL_RGB32F:
+        normalizeGeneric(src, dst[0], width * 3);
+        break;
+    default:
+        break;
+    }
+}
+
+void downscale(const uint8_t *src, size_t srcStride, uint32_t channels, uint32_t scale,
+    uint8_t *dst, size_t dstStride, uint32_t dstWidth, uint32_t dstHeight) {
+
+    std::vector<uint32_t> sums(size_t(dstWidth) * channels);
+    uint32_t area = scale * scale;
+    for(uint32_t y = 0; y < dstHeight; y++) {
+        std::fill(sums.begin(), sums.end(), 0);
+        // sum the rows of the box, then its columns
+        for(uint32_t i = 0; i < scale; i++) {
+            const uint8_t *row = src + (size_t(y) * scale + i) * srcStride;
+            for(uint32_t x = 0; x < dstWidth; x++) {
+                for(uint32_t j = 0; j < scale; j++) {
+                    for(uint32_t c = 0; c < channels; c++) {
+                        sums[x * channels + c] += row[(x * scale + j) * channels + c];
+                    }
+                }
+            }
+        }
+        uint8_t *out = dst + y * dstStride;
+        for(size_t i = 0; i < sums.size(); i++) {
+            out[i] = uint8_t((sums[i] + area / 2) / area);
+        }
+    }
+}
+
+} // namespace pixel
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,50 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <libsparkproto/cpufeatures.h>
+#include <libsparkproto/pixelconvert.h>
+
+namespace libspark {
+
+namespace protocol {
+
+namespace pixel {
+
+/**
+ * @brief Convert a row of width pixels. dst holds a pointer per plane, only dst[0] is used by interleaved formats.
+ * The conversion must be supported, see isConversionSupported()
+ *
+ * @param src
+ * @param srcFormat
+ * @param dst
+ * @param dstFormat
+ * @param width
+ * @param level
+ */
+void convertRow(const uint8_t *src, PixelFormat srcFormat, uint8_t *const dst[3], PixelFormat dstFormat,
+    uint32_t width, cpu::Level level);
+
+/**
+ * @brief Downscale an 8-bit image by an integer factor, each pixel of dst is the rounded average of a box of scale x scale pixels.
+ * Pixels right and below the last full box are dropped
+ *
+ * @param src
+ * @param srcStride
+ * @param channels bytes per pixel
+ * @param scale
+ * @param dst
+ * @param dstStride
+ * @param dstWidth width of src / scale
+ * @param dstHeight height of src / scale
+ */
+void downscale(const uint8_t *src, size_t srcStride, uint32_t channels, uint32_t scale,
+    uint8_t *dst, size_t dstStride, uint32_t dstWidth, uint32_t dstHeight);
+
+} // namespace pixel
+} // namespace protocol
+} // namespace libspark
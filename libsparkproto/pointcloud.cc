@@ -0,0 +1,49 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <libsparkproto/pointcloud.h>
+#include <libsparkproto/pointcloudimpl.h>
+
+namespace libspark {
+
+namespace protocol {
+
+PointCloudGenerator::PointCloudGenerator(const StereoIntrinsics &intrinsics, uint32_t threads)
+    : _pImpl(new PointCloudGeneratorImpl(intrinsics, threads)) {
+
+}
+
+PointCloudGenerator::~PointCloudGenerator() {
+
+}
+
+void PointCloudGenerator::setIntrinsics(const StereoIntrinsics &intrinsics) {
+    _pImpl->setIntrinsics(intrinsics);
+}
+
+StereoIntrinsics PointCloudGenerator::intrinsics() const {
+    return _pImpl->intrinsics();
+}
+
+void PointCloudGenerator::disparityToDepth(const uint16_t *disparity, uint32_t width, uint32_t height, float *depth) {
+    _pImpl->disparityToDepth(disparity, width, height, depth);
+}
+
+void PointCloudGenerator::generate(const uint16_t *disparity, uint32_t width, uint32_t height,
+    const uint8_t *rgb, PointCloud &cloud) {
+
+    _pImpl->generate(disparity, width, height, rgb, width * 3, cloud);
+}
+
+void PointCloudGenerator::generateFromDepth(const float *depth, uint32_t width, uint32_t height,
+    const uint8_t *rgb, PointCloud &cloud) {
+
+    _pImpl->generateFromDepth(depth, width, height, rgb, width * 3, cloud);
+}
+
+void PointCloudGenerator::generate(const ImageSet &imgSet, PointCloud &cloud, bool color) {
+    _pImpl->generate(imgSet, cloud, color);
+}
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,166 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <libsparkproto/common.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class ImageSet;
+class PointCloudGeneratorImpl;
+
+/**
+ * @brief Rectified stereo geometry of a disparity image.
+ * The focal lengths and principal point are in pixels of the disparity image
+ *
+ */
+struct SPARK_API StereoIntrinsics {
+    float fx = 0.0f;
+    float fy = 0.0f;
+    float cx = 0.0f;
+    float cy = 0.0f;
+
+    // distance between the optical centers of the cameras, see DeviceInfoMessage::baseline().
+    // Depth and points are in the unit of the baseline
+    float baseline = 0.0f;
+
+    // disparity in pixels of a disparity value of 1, e.g. 1/16 for values with 4 fractional bits
+    float disparityScale = 1.0f;
+
+    // smaller disparity values are invalid, 0 marks a pixel without a match
+    uint16_t minDisparity = 1;
+};
+
+/**
+ * @brief Points of the valid pixels of a disparity or depth image, in the order of the pixels.
+ * Vectors are resized to the points of the last image, their capacity is kept between images
+ *
+ */
+struct SPARK_API PointCloud {
+    enum Layout {
+        // x, y and z in separate vectors
+        LAYOUT_SOA = 0,
+        // x, y, z of each point interleaved in xyz
+        LAYOUT_AOS = 1
+    };
+
+    // layout the generator writes, set by the caller
+    Layout layout = LAYOUT_SOA;
+
+    // number of points
+    size_t size = 0;
+
+    // LAYOUT_AOS: 3 * size floats
+    std::vector<float> xyz;
+
+    // LAYOUT_SOA: size floats each
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+
+    // 3 * size bytes of r, g, b, empty without colors
+    std::vector<uint8_t> rgb;
+
+    // index of the pixel of each point, v * width + u
+    std::vector<uint32_t> pixels;
+};
+
+/**
+ * @brief PointCloudGenerator converts disparity to metric depth and projects depth to 3D points,
+ * with optional colors of the left image. Pixels of invalid disparity or depth are left out of the point cloud.
+ *
+ * Depth is fx * baseline / (disparity * disparityScale), a point of pixel (u, v) and depth z is
+ * ((u - cx) * z / fx, (v - cy) * z / fy, z). Rows are counted first, so every band of rows writes its points
+ * at their final offset in parallel. The kernels use AVX2 or SSE4.1 when the CPU supports them,
+ * see libspark::protocol::cpu::dispatchLevel(), and give the same points as the generic code.
+ *
+ * A PointCloudGenerator keeps scratch buffers between images, it's not thread-safe. Use one per thread.
+ *
+ */
+class SPARK_API PointCloudGenerator {
+
+public:
+    /**
+     * @brief Construct a new PointCloudGenerator object. If intrinsics are invalid, a exception is thrown
+     *
+     * @param intrinsics
+     * @param threads number of threads an image is split across in bands of rows,
+     * 0 for the number of CPU cores, 1 to run in the calling thread
+     */
+    explicit PointCloudGenerator(const StereoIntrinsics &intrinsics, uint32_t threads = 0);
+
+    /**
+     * @brief Destroy the PointCloudGenerator object
+     *
+     */
+    virtual ~PointCloudGenerator();
+
+    /**
+     * @brief Set intrinsics. If intrinsics are invalid, a exception is thrown
+     *
+     * @param intrinsics
+     */
+    void setIntrinsics(const StereoIntrinsics &intrinsics);
+
+    /**
+     * @brief Get intrinsics
+     *
+     * @return StereoIntrinsics
+     */
+    StereoIntrinsics intrinsics() const;
+
+    /**
+     * @brief Convert a disparity image to depth, invalid pixels to 0
+     *
+     * @param disparity width * height values
+     * @param width
+     * @param height
+     * @param depth width * height floats
+     */
+    void disparityToDepth(const uint16_t *disparity, uint32_t width, uint32_t height, float *depth);
+
+    /**
+     * @brief Generate the point cloud of a disparity image
+     *
+     * @param disparity width * height values
+     * @param width
+     * @param height
+     * @param rgb colors of the pixels, width * height * 3 bytes, or nullptr for no colors
+     * @param cloud
+     */
+    void generate(const uint16_t *disparity, uint32_t width, uint32_t height, const uint8_t *rgb, PointCloud &cloud);
+
+    /**
+     * @brief Generate the point cloud of a depth image, pixels of depth 0, negative or not finite are invalid
+     *
+     * @param depth width * height floats
+     * @param width
+     * @param height
+     * @param rgb colors of the pixels, width * height * 3 bytes, or nullptr for no colors
+     * @param cloud
+     */
+    void generateFromDepth(const float *depth, uint32_t width, uint32_t height, const uint8_t *rgb, PointCloud &cloud);
+
+    /**
+     * @brief Generate the point cloud of the disparity image of imgSet, of 8 or 16 bits per pixel.
+     * Colors are taken from the left image, downscaled when it is an integer multiple of the size of the disparity image,
+     * see ImageSet::view(). If the ImageSet has no disparity image, or color is requested and it has no left image
+     * of a matching size, a exception is thrown
+     *
+     * @param imgSet
+     * @param cloud
+     * @param color
+     */
+    void generate(const ImageSet &imgSet, PointCloud &cloud, bool color = true);
+
+private:
+    std::unique_ptr<PointCloudGeneratorImpl> _pImpl;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,232 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <string.h>
+#include <thread>
+
+#include <libsparkproto/pointcloudimpl.h>
+#include <libsparkproto/exception.h>
+#include <libsparkproto/imageset.h>
+
+namespace libspark {
+
+namespace protocol {
+
+// rows of the smallest band, points of a row are a few kB
+static constexpr uint32_t MIN_BAND_ROWS = 8;
+
+void checkIntrinsics(const StereoIntrinsics &intrinsics) {
+    if(!(intrinsics.fx > 0) || !(intrinsics.fy > 0)) {
+        throw SparkError("focal lengths must be positive");
+    }
+    if(!(intrinsics.baseline > 0)) {
+        throw SparkError("baseline must be positive");
+    }
+    if(!(intrinsics.disparityScale > 0)) {
+        throw SparkError("disparity scale must be positive");
+    }
+    if(intrinsics.minDisparity < 1) {
+        throw SparkError("minimum disparity must be at least 1");
+    }
+}
+
+PointCloudGeneratorImpl::PointCloudGeneratorImpl(const StereoIntrinsics &intrinsics, uint32_t threads)
+    : _focalBaseline(0.0f), _level(cpu::dispatchLevel()), _columnScaleWidth(0) {
+
+    setIntrinsics(intrinsics);
+
+    if(!threads) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if(threads > 1) {
+        _pool.reset(new ThreadPool(threads));
+    }
+}
+
+PointCloudGeneratorImpl::~PointCloudGeneratorImpl() {
+
+}
+
+void PointCloudGeneratorImpl::setIntrinsics(const StereoIntrinsics &intrinsics) {
+    checkIntrinsics(intrinsics);
+
+    _intrinsics = intrinsics;
+    _focalBaseline = intrinsics.fx * intrinsics.baseline / intrinsics.disparityScale;
+    _columnScaleWidth = 0;
+}
+
+StereoIntrinsics PointCloudGeneratorImpl::intrinsics() const {
+    return _intrinsics;
+}
+
+void PointCloudGeneratorImpl::disparityToDepth(const uint16_t *disparity, uint32_t width, uint32_t height, float *depth) {
+    runBands(height, [&](uint32_t y0, uint32_t y1) {
+        for(uint32_t y = y0; y < y1; y++) {
+            size_t row = size_t(y) * width;
+            cloud::disparityToDepthRow(disparity + row, depth + row, width, _focalBaseline, _intrinsics.minDisparity, _level);
+        }
+    });
+}
+
+void PointCloudGeneratorImpl::generate(const uint16_t *disparity, uint32_t width, uint32_t height,
+    const uint8_t *rgb, size_t rgbStride, PointCloud &cloud) {
+
+    uint16_t minDisparity = _intrinsics.minDisparity;
+    build(width, height, [&](uint32_t y) {
+        return cloud::countValidDisparity(disparity + size_t(y) * width, width, minDisparity, _level);
+    }, [&](uint32_t y, const cloud::RowParams &params, const cloud::RowPoints &points) {
+        return cloud::projectDisparityRow(disparity + size_t(y) * width, width, params, points, _level);
+    }, rgb, rgbStride, cloud);
+}
+
+void PointCloudGeneratorImpl::generateFromDepth(const float *depth, uint32_t width, uint32_t height,
+    const uint8_t *rgb, size_t rgbStride, PointCloud &cloud) {
+
+    build(width, height, [&](uint32_t y) {
+        return cloud::countValidDepth(depth + size_t(y) * width, width, _level);
+    }, [&](uint32_t y, const cloud::RowParams &params, const cloud::RowPoints &points) {
+        return cloud::projectDepthRow(depth + size_t(y) * width, width, params, points, _level);
+    }, rgb, rgbStride, cloud);
+}
+
+void PointCloudGeneratorImpl::generate(const ImageSet &imgSet, PointCloud &cloud, bool color) {
+    if(!imgSet.hasDisparity()) {
+        throw SparkError("the ImageSet has no disparity image");
+    }
+
+    const ImageMeta &meta = imgSet.meta().disparity();
+    uint32_t width = meta.width();
+    uint32_t height = meta.height();
+    const ImageSet::Buffer &buff = imgSet.getBuffer(ImageSet::BUFFER_DISPARITY);
+    size_t pixels = size_t(width) * height;
+
+    const uint16_t *disparity = nullptr;
+    if(buff.size() == pixels * 2) {
+        disparity = (const uint16_t *) buff.data();
+    } else if(buff.size() == pixels) {
+        _widened.resize(pixels);
+        runBands(height, [&](uint32_t y0, uint32_t y1) {
+            for(size_t i = size_t(y0) * width; i < size_t(y1) * width; i++) {
+                _widened[i] = buff[i];
+            }
+        });
+        disparity = _widened.data();
+    } else {
+        throw SparkError("size of disparity buffer " + std::to_string(buff.size()) + " does not match image " +
+            std::to_string(width) + "x" + std::to_string(height));
+    }
+
+    std::shared_ptr<const ImageView> colors;
+    if(color) {
+        if(!imgSet.hasLeft()) {
+            throw SparkError("the ImageSet has no left image for the colors of points");
+        }
+        const ImageMeta &left = imgSet.meta().left();
+        // a negative size of the meta is no multiple
+        uint32_t leftWidth = left.width() > 0 ? uint32_t(left.width()) : 0;
+        uint32_t leftHeight = left.height() > 0 ? uint32_t(left.height()) : 0;
+        uint32_t scale = width ? leftWidth / width : 0;
+        if(!scale || leftWidth != width * scale || leftHeight != height * scale) {
+            throw SparkError("size of left image " + std::to_string(left.width()) + "x" + std::to_string(left.height()) +
+                " is not a multiple of the disparity image " + std::to_string(width) + "x" + std::to_string(height));
+        }
+        colors = imgSet.view(ImageSet::BUFFER_LEFT, PIXEL_RGB8, scale);
+    }
+
+    generate(disparity, width, height, colors ? colors->data.data() : nullptr, colors ? colors->stride : 0, cloud);
+}
+
+void PointCloudGeneratorImpl::build(uint32_t width, uint32_t height, const CountFunc &count, const ProjectFunc &project,
+    const uint8_t *rgb, size_t rgbStride, PointCloud &cloud) {
+
+    _offsets.assign(size_t(height) + 1, 0);
+    runBands(height, [&](uint32_t y0, uint32_t y1) {
+        for(uint32_t y = y0; y < y1; y++) {
+            _offsets[y + 1] = count(y);
+        }
+    });
+    for(uint32_t y = 0; y < height; y++) {
+        _offsets[y + 1] += _offsets[y];
+    }
+
+    size_t size = _offsets[height];
+    bool aos = cloud.layout == PointCloud::LAYOUT_AOS;
+    cloud.size = size;
+    cloud.xyz.resize(aos ? 3 * size : 0);
+    cloud.x.resize(aos ? 0 : size);
+    cloud.y.resize(aos ? 0 : size);
+    cloud.z.resize(aos ? 0 : size);
+    cloud.rgb.resize(rgb ? 3 * size : 0);
+    cloud.pixels.resize(size);
+
+    updateColumnScale(width);
+
+    runBands(height, [&](uint32_t y0, uint32_t y1) {
+        // points of a row are compacted to scratch, SIMD kernels store whole vectors past the last point
+        size_t rowSize = size_t(width) + cloud::ROW_PADDING;
+        std::vector<float> coords(3 * rowSize);
+        std::vector<uint32_t> rowPixels(rowSize);
+
+        cloud::RowPoints points;
+        points.x = coords.data();
+        points.y = points.x + rowSize;
+        points.z = points.y + rowSize;
+        points.pixels = rowPixels.data();
+
+        cloud::RowParams params;
+        params.columnScale = _columnScale.data();
+        params.focalBaseline = _focalBaseline;
+        params.minDisparity = _intrinsics.minDisparity;
+
+        for(uint32_t y = y0; y < y1; y++) {
+            params.rowScale = (float(y) - _intrinsics.cy) / _intrinsics.fy;
+            params.rowIndex = y * width;
+
+            size_t offset = _offsets[y];
+            size_t n = project(y, params, points);
+            if(aos) {
+                float *dst = cloud.xyz.data() + 3 * offset;
+                for(size_t i = 0; i < n; i++) {
+                    dst[3 * i] = points.x[i];
+                    dst[3 * i + 1] = points.y[i];
+                    dst[3 * i + 2] = points.z[i];
+                }
+            } else {
+                memcpy(cloud.x.data() + offset, points.x, n * sizeof(float));
+                memcpy(cloud.y.data() + offset, points.y, n * sizeof(float));
+                memcpy(cloud.z.data() + offset, points.z, n * sizeof(float));
+            }
+            memcpy(cloud.pixels.data() + offset, points.pixels, n * sizeof(uint32_t));
+
+            if(rgb) {
+                const uint8_t *src = rgb + y * rgbStride;
+                uint8_t *dst = cloud.rgb.data() + 3 * offset;
+                for(size_t i = 0; i < n; i++) {
+                    memcpy(dst + 3 * i, src + 3 * (points.pixels[i] - params.rowIndex), 3);
+                }
+            }
+        }
+    });
+}
+
+void PointCloudGeneratorImpl::updateColumnScale(uint32_t width) {
+    if(_columnScaleWidth == width) {
+        return;
+    }
+    _columnScale.resize(width);
+    for(uint32_t u = 0; u < width; u++) {
+        _columnScale[u] = (float(u) - _intrinsics.cx) / _intrinsics.fx;
+    }
+    _columnScaleWidth = width;
+}
+
+void PointCloudGeneratorImpl::runBands(uint32_t height, const BandFunc &func) {
+    if(!_pool) {
+        func(0, height);
+        return;
+    }
+    _pool->parallelFor(height, MIN_BAND_ROWS, func);
+}
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,72 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <libsparkproto/pointcloud.h>
+#include <libsparkproto/pointcloudkernels.h>
+#include <libsparkproto/threadpool.h>
+
+namespace libspark {
+
+namespace protocol {
+
+// throw a exception if intrinsics are invalid
+void checkIntrinsics(const StereoIntrinsics &intrinsics);
+
+class PointCloudGeneratorImpl {
+
+public:
+    PointCloudGeneratorImpl(const StereoIntrinsics &intrinsics, uint32_t threads);
+
+    virtual ~PointCloudGeneratorImpl();
+
+    void setIntrinsics(const StereoIntrinsics &intrinsics);
+
+    StereoIntrinsics intrinsics() const;
+
+    void disparityToDepth(const uint16_t *disparity, uint32_t width, uint32_t height, float *depth);
+
+    void generate(const uint16_t *disparity, uint32_t width, uint32_t height,
+        const uint8_t *rgb, size_t rgbStride, PointCloud &cloud);
+
+    void generateFromDepth(const float *depth, uint32_t width, uint32_t height,
+        const uint8_t *rgb, size_t rgbStride, PointCloud &cloud);
+
+    void generate(const ImageSet &imgSet, PointCloud &cloud, bool color);
+
+private:
+    using BandFunc = std::function<void(uint32_t y0, uint32_t y1)>;
+    using CountFunc = std::function<uint32_t(uint32_t y)>;
+    using ProjectFunc = std::function<uint32_t(uint32_t y, const cloud::RowParams &params, const cloud::RowPoints &points)>;
+
+    // count the points of every row, then project the rows of each band to their offset in cloud
+    void build(uint32_t width, uint32_t height, const CountFunc &count, const ProjectFunc &project,
+        const uint8_t *rgb, size_t rgbStride, PointCloud &cloud);
+
+    // (u - cx) / fx of each column
+    void updateColumnScale(uint32_t width);
+
+    // run func over the rows in bands, on the pool when there is one
+    void runBands(uint32_t height, const BandFunc &func);
+
+    StereoIntrinsics _intrinsics;
+    // fx * baseline / disparityScale
+    float _focalBaseline;
+    cpu::Level _level;
+    std::unique_ptr<ThreadPool> _pool;
+
+    // scratch, kept between images
+    std::vector<float> _columnScale;
+    uint32_t _columnScaleWidth;
+    // offset of the first point of each row, and the number of points at [height]
+    std::vector<size_t> _offsets;
+    // disparity of 8-bit images widened to 16 bits
+    std::vector<uint16_t> _widened;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,498 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <float.h>
+#include <math.h>
+
+#include <libsparkproto/pointcloudkernels.h>
+
+#if defined(SPARK_CPU_X86)
+    #include <immintrin.h>
+#endif
+
+namespace libspark {
+
+namespace protocol {
+
+namespace cloud {
+
+//
+// generic, SIMD kernels compute the same float operations so all levels give identical points
+//
+
+static inline bool isValidDepth(float z) {
+    return z > 0.0f && z <= FLT_MAX;
+}
+
+static void disparityToDepthGeneric(const uint16_t *disparity, float *depth, uint32_t x, uint32_t width,
+    float focalBaseline, uint16_t minDisparity) {
+
+    for(; x < width; x++) {
+        depth[x] = disparity[x] >= minDisparity ? focalBaseline / float(disparity[x]) : 0.0f;
+    }
+}
+
+static uint32_t countValidDisparityGeneric(const uint16_t *disparity, uint32_t x, uint32_t width, uint16_t minDisparity) {
+    uint32_t count = 0;
+    for(; x < width; x++) {
+        count += disparity[x] >= minDisparity;
+    }
+    return count;
+}
+
+static uint32_t countValidDepthGeneric(const float *depth, uint32_t x, uint32_t width) {
+    uint32_t count = 0;
+    for(; x < width; x++) {
+        count += isValidDepth(depth[x]);
+    }
+    return count;
+}
+
+static inline void storePoint(const RowParams &params, const RowPoints &points, uint32_t x, float z, uint32_t &count) {
+    points.x[count] = params.columnScale[x] * z;
+    points.y[count] = params.rowScale * z;
+    points.z[count] = z;
+    points.pixels[count] = params.rowIndex + x;
+    count++;
+}
+
+static uint32_t projectDisparityGeneric(const uint16_t *disparity, uint32_t x, uint32_t width,
+    const RowParams &params, const RowPoints &points, uint32_t count) {
+
+    for(; x < width; x++) {
+        if(disparity[x] >= params.minDisparity) {
+            storePoint(params, points, x, params.focalBaseline / float(disparity[x]), count);
+        }
+    }
+    return count;
+}
+
+static uint32_t projectDepthGeneric(const float *depth, uint32_t x, uint32_t width,
+    const RowParams &params, const RowPoints &points, uint32_t count) {
+
+    for(; x < width; x++) {
+        if(isValidDepth(depth[x])) {
+            storePoint(params, points, x, depth[x], count);
+        }
+    }
+    return count;
+}
+
+// voxel of a point, the coordinates are replaced by the offset in the voxel
+static inline uint32_t voxelOf(float &x, float &y, float &z, const GridParams &grid) {
+    float dx = x - grid.originX;
+    float dy = y - grid.originY;
+    float dz = z - grid.originZ;
+    float fx = floorf(dx * grid.inverseSize);
+    float fy = floorf(dy * grid.inverseSize);
+    float fz = floorf(dz * grid.inverseSize);
+    if(!(fx >= 0.0f && fx < float(grid.dimX) && fy >= 0.0f && fy < float(grid.dimY) &&
+        fz >= 0.0f && fz < float(grid.dimZ))) {
+        return INVALID_VOXEL;
+    }
+    x = dx - fx * grid.size;
+    y = dy - fy * grid.size;
+    z = dz - fz * grid.size;
+    return uint32_t(fx) + grid.dimX * (uint32_t(fy) + grid.dimY * uint32_t(fz));
+}
+
+static void voxelizeGeneric(const RowPoints &points, uint32_t i, uint32_t count, const GridParams &grid, uint32_t *voxels) {
+    for(; i < count; i++) {
+        voxels[i] = voxelOf(points.x[i], points.y[i], points.z[i], grid);
+    }
+}
+
+// SIMD kernels process the head of a row and return the number of pixels done, the generic kernel finishes the row.
+// Counting and projecting kernels add their points to count
+struct Kernels {
+    uint32_t (*disparityToDepth)(const uint16_t *disparity, float *depth, uint32_t width, float focalBaseline, uint16_t minDisparity);
+    uint32_t (*countValidDisparity)(const uint16_t *disparity, uint32_t width, uint16_t minDisparity, uint32_t &count);
+    uint32_t (*countValidDepth)(const float *depth, uint32_t width, uint32_t &count);
+    uint32_t (*projectDisparity)(const uint16_t *disparity, uint32_t width, const RowParams &params,
+        const RowPoints &points, uint32_t &count);
+    uint32_t (*projectDepth)(const float *depth, uint32_t width, const RowParams &params,
+        const RowPoints &points, uint32_t &count);
+    uint32_t (*voxelize)(const RowPoints &points, uint32_t count, const GridParams &grid, uint32_t *voxels);
+};
+
+static uint32_t disparityToDepthNone(const uint16_t *, float *, uint32_t, float, uint16_t) { return 0; }
+static uint32_t countValidDisparityNone(const uint16_t *, uint32_t, uint16_t, uint32_t &) { return 0; }
+static uint32_t countValidDepthNone(const float *, uint32_t, uint32_t &) { return 0; }
+static uint32_t projectDisparityNone(const uint16_t *, uint32_t, const RowParams &, const RowPoints &, uint32_t &) { return 0; }
+static uint32_t projectDepthNone(const float *, uint32_t, const RowParams &, const RowPoints &, uint32_t &) { return 0; }
+static uint32_t voxelizeNone(const RowPoints &, uint32_t, const GridParams &, uint32_t *) { return 0; }
+
+static const Kernels GENERIC_KERNELS = {
+    disparityToDepthNone, countValidDisparityNone, countValidDepthNone, projectDisparityNone, projectDepthNone,
+    voxelizeNone
+};
+
+#if defined(SPARK_CPU_X86)
+
+// left-packing of valid lanes: a permutation of 8 x 32-bit lanes for AVX2,
+// a byte shuffle of 4 x 32-bit lanes for SSE4.1, indexed by the movemask of valid lanes
+struct PackTables {
+    uint32_t lanes8[256][8];
+    uint8_t bytes4[16][16];
+};
+
+static constexpr PackTables makePackTables() {
+    PackTables tables{};
+    for(uint32_t mask = 0; mask < 256; mask++) {
+        uint32_t n = 0;
+        for(uint32_t lane = 0; lane < 8; lane++) {
+            if(mask & (1u << lane)) {
+                tables.lanes8[mask][n++] = lane;
+            }
+        }
+        // lanes after the packed ones are don't care
+        for(; n < 8; n++) {
+            tables.lanes8[mask][n] = 0;
+        }
+    }
+    for(uint32_t mask = 0; mask < 16; mask++) {
+        uint32_t n = 0;
+        for(uint32_t lane = 0; lane < 4; lane++) {
+            if(mask & (1u << lane)) {
+                for(uint32_t b = 0; b < 4; b++) {
+                    tables.bytes4[mask][4 * n + b] = uint8_t(4 * lane + b);
+                }
+                n++;
+            }
+        }
+        for(; n < 4; n++) {
+            for(uint32_t b = 0; b < 4; b++) {
+                tables.bytes4[mask][4 * n + b] = 0x80;
+            }
+        }
+    }
+    return tables;
+}
+
+static constexpr PackTables PACK_TABLES = makePackTables();
+
+//
+// SSE4.1
+//
+
+__attribute__((target("sse4.1")))
+static inline __m128i loadDisparitySse41(const uint16_t *disparity) {
+    return _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *) disparity));
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128 validDepthSse41(__m128 z) {
+    return _mm_and_ps(_mm_cmpgt_ps(z, _mm_setzero_ps()), _mm_cmple_ps(z, _mm_set1_ps(FLT_MAX)));
+}
+
+// store the valid lanes of a block of 4 pixels at column x
+__attribute__((target("sse4.1")))
+static inline void packPointsSse41(const RowParams &params, const RowPoints &points, uint32_t x,
+    __m128 z, __m128 valid, uint32_t &count) {
+
+    int mask = _mm_movemask_ps(valid);
+    if(!mask) {
+        return;
+    }
+    __m128i shuffle = _mm_loadu_si128((const __m128i *) PACK_TABLES.bytes4[mask]);
+    __m128 px = _mm_mul_ps(_mm_loadu_ps(params.columnScale + x), z);
+    __m128 py = _mm_mul_ps(_mm_set1_ps(params.rowScale), z);
+    __m128i pixel = _mm_add_epi32(_mm_set1_epi32(int(params.rowIndex + x)), _mm_setr_epi32(0, 1, 2, 3));
+
+    _mm_storeu_si128((__m128i *)(points.x + count), _mm_shuffle_epi8(_mm_castps_si128(px), shuffle));
+    _mm_storeu_si128((__m128i *)(points.y + count), _mm_shuffle_epi8(_mm_castps_si128(py), shuffle));
+    _mm_storeu_si128((__m128i *)(points.z + count), _mm_shuffle_epi8(_mm_castps_si128(z), shuffle));
+    _mm_storeu_si128((__m128i *)(points.pixels + count), _mm_shuffle_epi8(pixel, shuffle));
+    count += __builtin_popcount(mask);
+}
+
+__attribute__((target("sse4.1")))
+static uint32_t disparityToDepthSse41(const uint16_t *disparity, float *depth, uint32_t width,
+    float focalBaseline, uint16_t minDisparity) {
+
+    __m128i below = _mm_set1_epi32(minDisparity - 1);
+    __m128 fb = _mm_set1_ps(focalBaseline);
+    uint32_t x = 0;
+    for(; x + 4 <= width; x += 4) {
+        __m128i d = loadDisparitySse41(disparity + x);
+        __m128 valid = _mm_castsi128_ps(_mm_cmpgt_epi32(d, below));
+        _mm_storeu_ps(depth + x, _mm_and_ps(_mm_div_ps(fb, _mm_cvtepi32_ps(d)), valid));
+    }
+    return x;
+}
+
+__attribute__((target("sse4.1")))
+static uint32_t countValidDisparitySse41(const uint16_t *disparity, uint32_t width, uint16_t minDisparity, uint32_t &count) {
+    // d >= min is max(d, min) == d for unsigned 16-bit
+    __m128i min = _mm_set1_epi16(int16_t(minDisparity));
+    uint32_t x = 0;
+    for(; x + 8 <= width; x += 8) {
+        __m128i d = _mm_loadu_si128((const __m128i *)(disparity + x));
+        __m128i valid = _mm_cmpeq_epi16(_mm_max_epu16(d, min), d);
+        count += __builtin_popcount(_mm_movemask_epi8(valid)) / 2;
+    }
+    return x;
+}
+
+__attribute__((target("sse4.1")))
+static uint32_t countValidDepthSse41(const float *depth, uint32_t width, uint32_t &count) {
+    uint32_t x = 0;
+    for(; x + 4 <= width; x += 4) {
+        count += __builtin_popcount(_mm_movemask_ps(validDepthSse41(_mm_loadu_ps(depth + x))));
+    }
+    return x;
+}
+
+__attribute__((target("sse4.1")))
+static uint32_t projectDisparitySse41(const uint16_t *disparity, uint32_t width, const RowParams &params,
+    const RowPoints &points, uint32_t &count) {
+
+    __m128i below = _mm_set1_epi32(params.minDisparity - 1);
+    __m128 fb = _mm_set1_ps(params.focalBaseline);
+    uint32_t x = 0;
+    for(; x + 4 <= width; x += 4) {
+        __m128i d = loadDisparitySse41(disparity + x);
+        __m128 valid = _mm_castsi128_ps(_mm_cmpgt_epi32(d, below));
+        packPointsSse41(params, points, x, _mm_div_ps(fb, _mm_cvtepi32_ps(d)), valid, count);
+    }
+    return x;
+}
+
+__attribute__((target("sse4.1")))
+static uint32_t projectDepthSse41(const float *depth, uint32_t width, const RowParams &params,
+    const RowPoints &points, uint32_t &count) {
+
+    uint32_t x = 0;
+    for(; x + 4 <= width; x += 4) {
+        __m128 z = _mm_loadu_ps(depth + x);
+        packPointsSse41(params, points, x, z, validDepthSse41(z), count);
+    }
+    return x;
+}
+
+__attribute__((target("sse4.1")))
+static uint32_t voxelizeSse41(const RowPoints &points, uint32_t count, const GridParams &grid, uint32_t *voxels) {
+    __m128 origin[3] = { _mm_set1_ps(grid.originX), _mm_set1_ps(grid.originY), _mm_set1_ps(grid.originZ) };
+    __m128 dims[3] = { _mm_set1_ps(float(grid.dimX)), _mm_set1_ps(float(grid.dimY)), _mm_set1_ps(float(grid.dimZ)) };
+    __m128 inverseSize = _mm_set1_ps(grid.inverseSize);
+    __m128 size = _mm_set1_ps(grid.size);
+    __m128i dimX = _mm_set1_epi32(int(grid.dimX));
+    __m128i dimY = _mm_set1_epi32(int(grid.dimY));
+    float *coords[3] = { points.x, points.y, points.z };
+
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        __m128 valid = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        __m128i cell[3];
+        for(int axis = 0; axis < 3; axis++) {
+            __m128 d = _mm_sub_ps(_mm_loadu_ps(coords[axis] + i), origin[axis]);
+            __m128 f = _mm_floor_ps(_mm_mul_ps(d, inverseSize));
+            valid = _mm_and_ps(valid, _mm_and_ps(_mm_cmpge_ps(f, _mm_setzero_ps()), _mm_cmplt_ps(f, dims[axis])));
+            cell[axis] = _mm_cvttps_epi32(f);
+            _mm_storeu_ps(coords[axis] + i, _mm_sub_ps(d, _mm_mul_ps(f, size)));
+        }
+        __m128i index = _mm_add_epi32(cell[0], _mm_mullo_epi32(dimX, _mm_add_epi32(cell[1], _mm_mullo_epi32(dimY, cell[2]))));
+        index = _mm_or_si128(index, _mm_xor_si128(_mm_castps_si128(valid), _mm_set1_epi32(-1)));
+        _mm_storeu_si128((__m128i *)(voxels + i), index);
+    }
+    return i;
+}
+
+//
+// AVX2
+//
+
+__attribute__((target("avx2")))
+static inline __m256i loadDisparityAvx2(const uint16_t *disparity) {
+    return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) disparity));
+}
+
+__attribute__((target("avx2")))
+static inline __m256 validDepthAvx2(__m256 z) {
+    return _mm256_and_ps(_mm256_cmp_ps(z, _mm256_setzero_ps(), _CMP_GT_OQ),
+        _mm256_cmp_ps(z, _mm256_set1_ps(FLT_MAX), _CMP_LE_OQ));
+}
+
+// store the valid lanes of a block of 8 pixels at column x
+__attribute__((target("avx2")))
+static inline void packPointsAvx2(const RowParams &params, const RowPoints &points, uint32_t x,
+    __m256 z, __m256 valid, uint32_t &count) {
+
+    int mask = _mm256_movemask_ps(valid);
+    if(!mask) {
+        return;
+    }
+    __m256i permutation = _mm256_loadu_si256((const __m256i *) PACK_TABLES.lanes8[mask]);
+    __m256 px = _mm256_mul_ps(_mm256_loadu_ps(params.columnScale + x), z);
+    __m256 py = _mm256_mul_ps(_mm256_set1_ps(params.rowScale), z);
+    __m256i pixel = _mm256_add_epi32(_mm256_set1_epi32(int(params.rowIndex + x)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+    _mm256_storeu_ps(points.x + count, _mm256_permutevar8x32_ps(px, permutation));
+    _mm256_storeu_ps(points.y + count, _mm256_permutevar8x32_ps(py, permutation));
+    _mm256_storeu_ps(points.z + count, _mm256_permutevar8x32_ps(z, permutation));
+    _mm256_storeu_si256((__m256i *)(points.pixels + count), _mm256_permutevar8x32_epi32(pixel, permutation));
+    count += __builtin_popcount(mask);
+}
+
+__attribute__((target("avx2")))
+static uint32_t disparityToDepthAvx2(const uint16_t *disparity, float *depth, uint32_t width,
+    float focalBaseline, uint16_t minDisparity) {
+
+    __m256i below = _mm256_set1_epi32(minDisparity - 1);
+    __m256 fb = _mm256_set1_ps(focalBaseline);
+    uint32_t x = 0;
+    for(; x + 8 <= width; x += 8) {
+        __m256i d = loadDisparityAvx2(disparity + x);
+        __m256 valid = _mm256_castsi256_ps(_mm256_cmpgt_epi32(d, below));
+        _mm256_storeu_ps(depth + x, _mm256_and_ps(_mm256_div_ps(fb, _mm256_cvtepi32_ps(d)), valid));
+    }
+    return x;
+}
+
+__attribute__((target("avx2")))
+static uint32_t countValidDisparityAvx2(const uint16_t *disparity, uint32_t width, uint16_t minDisparity, uint32_t &count) {
+    __m256i min = _mm256_set1_epi16(int16_t(minDisparity));
+    uint32_t x = 0;
+    for(; x + 16 <= width; x += 16) {
+        __m256i d = _mm256_loadu_si256((const __m256i *)(disparity + x));
+        __m256i valid = _mm256_cmpeq_epi16(_mm256_max_epu16(d, min), d);
+        count += __builtin_popcount(_mm256_movemask_epi8(valid)) / 2;
+    }
+    return x;
+}
+
+__attribute__((target("avx2")))
+static uint32_t countValidDepthAvx2(const float *depth, uint32_t width, uint32_t &count) {
+    uint32_t x = 0;
+    for(; x + 8 <= width; x += 8) {
+        count += __builtin_popcount(_mm256_movemask_ps(validDepthAvx2(_mm256_loadu_ps(depth + x))));
+    }
+    return x;
+}
+
+__attribute__((target("avx2")))
+static uint32_t projectDisparityAvx2(const uint16_t *disparity, uint32_t width, const RowParams &params,
+    const RowPoints &points, uint32_t &count) {
+
+    __m256i below = _mm256_set1_epi32(params.minDisparity - 1);
+    __m256 fb = _mm256_set1_ps(params.focalBaseline);
+    uint32_t x = 0;
+    for(; x + 8 <= width; x += 8) {
+        __m256i d = loadDisparityAvx2(disparity + x);
+        __m256 valid = _mm256_castsi256_ps(_mm256_cmpgt_epi32(d, below));
+        packPointsAvx2(params, points, x, _mm256_div_ps(fb, _mm256_cvtepi32_ps(d)), valid, count);
+    }
+    return x;
+}
+
+__attribute__((target("avx2")))
+static uint32_t projectDepthAvx2(const float *depth, uint32_t width, const RowParams &params,
+    const RowPoints &points, uint32_t &count) {
+
+    uint32_t x = 0;
+    for(; x + 8 <= width; x += 8) {
+        __m256 z = _mm256_loadu_ps(depth + x);
+        packPointsAvx2(params, points, x, z, validDepthAvx2(z), count);
+    }
+    return x;
+}
+
+__attribute__((target("avx2")))
+static uint32_t voxelizeAvx2(const RowPoints &points, uint32_t count, const GridParams &grid, uint32_t *voxels) {
+    __m256 origin[3] = { _mm256_set1_ps(grid.originX), _mm256_set1_ps(grid.originY), _mm256_set1_ps(grid.originZ) };
+    __m256 dims[3] = { _mm256_set1_ps(float(grid.dimX)), _mm256_set1_ps(float(grid.dimY)), _mm256_set1_ps(float(grid.dimZ)) };
+    __m256 inverseSize = _mm256_set1_ps(grid.inverseSize);
+    __m256 size = _mm256_set1_ps(grid.size);
+    __m256i dimX = _mm256_set1_epi32(int(grid.dimX));
+    __m256i dimY = _mm256_set1_epi32(int(grid.dimY));
+    float *coords[3] = { points.x, points.y, points.z };
+
+    uint32_t i = 0;
+    for(; i + 8 <= count; i += 8) {
+        __m256 valid = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        __m256i cell[3];
+        for(int axis = 0; axis < 3; axis++) {
+            __m256 d = _mm256_sub_ps(_mm256_loadu_ps(coords[axis] + i), origin[axis]);
+            __m256 f = _mm256_floor_ps(_mm256_mul_ps(d, inverseSize));
+            valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(f, _mm256_setzero_ps(), _CMP_GE_OQ),
+                _mm256_cmp_ps(f, dims[axis], _CMP_LT_OQ)));
+            cell[axis] = _mm256_cvttps_epi32(f);
+            _mm256_storeu_ps(coords[axis] + i, _mm256_sub_ps(d, _mm256_mul_ps(f, size)));
+        }
+        __m256i index = _mm256_add_epi32(cell[0],
+            _mm256_mullo_epi32(dimX, _mm256_add_epi32(cell[1], _mm256_mullo_epi32(dimY, cell[2]))));
+        index = _mm256_or_si256(index, _mm256_xor_si256(_mm256_castps_si256(valid), _mm256_set1_epi32(-1)));
+        _mm256_storeu_si256((__m256i *)(voxels + i), index);
+    }
+    return i;
+}
+
+static const Kernels SSE41_KERNELS = {
+    disparityToDepthSse41, countValidDisparitySse41, countValidDepthSse41, projectDisparitySse41, projectDepthSse41,
+    voxelizeSse41
+};
+
+static const Kernels AVX2_KERNELS = {
+    disparityToDepthAvx2, countValidDisparityAvx2, countValidDepthAvx2, projectDisparityAvx2, projectDepthAvx2,
+    voxelizeAvx2
+};
+
+#endif // SPARK_CPU_X86
+
+static const Kernels& kernelsOf(cpu::Level level) {
+#if defined(SPARK_CPU_X86)
+    if(level == cpu::LEVEL_AVX2) {
+        return AVX2_KERNELS;
+    }
+    if(level == cpu::LEVEL_SSE41) {
+        return SSE41_KERNELS;
+    }
+#endif
+    // NEON is part of the baseline of aarch64, the compiler vectorizes the generic division and counting for it
+    (void) level;
+    return GENERIC_KERNELS;
+}
+
+void disparityToDepthRow(const uint16_t *disparity, float *depth, uint32_t width,
+    float focalBaseline, uint16_t minDisparity, cpu::Level level) {
+
+    uint32_t x = kernelsOf(level).disparityToDepth(disparity, depth, width, focalBaseline, minDisparity);
+    disparityToDepthGeneric(disparity, depth, x, width, focalBaseline, minDisparity);
+}
+
+uint32_t countValidDisparity(const uint16_t *disparity, uint32_t width, uint16_t minDisparity, cpu::Level level) {
+    uint32_t count = 0;
+    uint32_t x = kernelsOf(level).countValidDisparity(disparity, width, minDisparity, count);
+    return count + countValidDisparityGeneric(disparity, x, width, minDisparity);
+}
+
+uint32_t countValidDepth(const float *depth, uint32_t width, cpu::Level level) {
+    uint32_t count = 0;
+    uint32_t x = kernelsOf(level).countValidDepth(depth, width, count);
+    return count + countValidDepthGeneric(depth, x, width);
+}
+
+uint32_t projectDisparityRow(const uint16_t *disparity, uint32_t width, const RowParams &params,
+    const RowPoints &points, cpu::Level level) {
+
+    uint32_t count = 0;
+    uint32_t x = kernelsOf(level).projectDisparity(disparity, width, params, points, count);
+    return projectDisparityGeneric(disparity, x, width, params, points, count);
+}
+
+uint32_t projectDepthRow(const float *depth, uint32_t width, const RowParams &params,
+    const RowPoints &points, cpu::Level level) {
+
+    uint32_t count = 0;
+    uint32_t x = kernelsOf(level).projectDepth(depth, width, params, points, count);
+    return projectDepthGeneric(depth, x, width, params, points, count);
+}
+
+void voxelizeRow(const RowPoints &points, uint32_t count, const GridParams &grid, uint32_t *voxels, cpu::Level level) {
+    uint32_t i = kernelsOf(level).voxelize(points, count, grid, voxels);
+    voxelizeGeneric(points, i, count, grid, voxels);
+}
+
+} // namespace cloud
+} // namespace protocol
+} // namespace libspark
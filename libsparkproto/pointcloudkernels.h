@@ -0,0 +1,142 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <stdint.h>
+
+#include <libsparkproto/cpufeatures.h>
+
+namespace libspark {
+
+namespace protocol {
+
+namespace cloud {
+
+// SIMD kernels store whole vectors of compacted points, a row of RowPoints holds width + ROW_PADDING elements
+static constexpr uint32_t ROW_PADDING = 8;
+
+/**
+ * @brief Projection of a row: depth of a disparity d is focalBaseline / d,
+ * x = columnScale[u] * depth and y = rowScale * depth
+ *
+ */
+struct RowParams {
+    // (u - cx) / fx of each column
+    const float *columnScale = nullptr;
+    // (v - cy) / fy
+    float rowScale = 0.0f;
+    // fx * baseline / disparityScale, depth of a disparity value of 1
+    float focalBaseline = 0.0f;
+    // disparities below are invalid, at least 1
+    uint16_t minDisparity = 1;
+    // index of the pixel of column 0, v * width
+    uint32_t rowIndex = 0;
+};
+
+/**
+ * @brief Valid points of a row, compacted
+ *
+ */
+struct RowPoints {
+    float *x = nullptr;
+    float *y = nullptr;
+    float *z = nullptr;
+    uint32_t *pixels = nullptr;
+};
+
+// voxel of a point outside of the grid
+static constexpr uint32_t INVALID_VOXEL = UINT32_MAX;
+
+/**
+ * @brief Bounded grid of cubic voxels, voxel (i, j, k) covers [origin + (i, j, k) * size, origin + (i + 1, j + 1, k + 1) * size)
+ * and has the index i + dimX * (j + dimY * k)
+ *
+ */
+struct GridParams {
+    float originX = 0.0f;
+    float originY = 0.0f;
+    float originZ = 0.0f;
+    float size = 1.0f;
+    // 1 / size
+    float inverseSize = 1.0f;
+    uint32_t dimX = 0;
+    uint32_t dimY = 0;
+    uint32_t dimZ = 0;
+};
+
+/**
+ * @brief Convert a row of disparity to depth, invalid disparities to 0
+ *
+ * @param disparity
+ * @param depth
+ * @param width
+ * @param focalBaseline
+ * @param minDisparity
+ * @param level
+ */
+void disparityToDepthRow(const uint16_t *disparity, float *depth, uint32_t width,
+    float focalBaseline, uint16_t minDisparity, cpu::Level level);
+
+/**
+ * @brief Number of disparities of a row of at least minDisparity
+ *
+ * @param disparity
+ * @param width
+ * @param minDisparity
+ * @param level
+ * @return uint32_t
+ */
+uint32_t countValidDisparity(const uint16_t *disparity, uint32_t width, uint16_t minDisparity, cpu::Level level);
+
+/**
+ * @brief Number of depths of a row which are positive and finite
+ *
+ * @param depth
+ * @param width
+ * @param level
+ * @return uint32_t
+ */
+uint32_t countValidDepth(const float *depth, uint32_t width, cpu::Level level);
+
+/**
+ * @brief Project the valid disparities of a row to points, see countValidDisparity()
+ *
+ * @param disparity
+ * @param width
+ * @param params
+ * @param points
+ * @param level
+ * @return uint32_t number of points
+ */
+uint32_t projectDisparityRow(const uint16_t *disparity, uint32_t width, const RowParams &params,
+    const RowPoints &points, cpu::Level level);
+
+/**
+ * @brief Project the valid depths of a row to points, see countValidDepth()
+ *
+ * @param depth
+ * @param width
+ * @param params focalBaseline and minDisparity are not used
+ * @param points
+ * @param level
+ * @return uint32_t number of points
+ */
+uint32_t projectDepthRow(const float *depth, uint32_t width, const RowParams &params,
+    const RowPoints &points, cpu::Level level);
+
+/**
+ * @brief Find the voxel of each point of a row, INVALID_VOXEL outside of the grid. The coordinates of points
+ * are replaced by their offset from the lowest corner of their voxel
+ *
+ * @param points count points, rewritten in place
+ * @param count
+ * @param grid
+ * @param voxels count indices of voxels
+ * @param level
+ */
+void voxelizeRow(const RowPoints &points, uint32_t count, const GridParams &grid, uint32_t *voxels, cpu::Level level);
+
+} // namespace cloud
+} // namespace protocol
+} // namespace libspark
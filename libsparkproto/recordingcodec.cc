@@ -0,0 +1,171 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <string.h>
+#include <memory>
+
+#ifdef SPARK_LZ4_ENABLE
+    #include <lz4.h>
+#endif
+
+#ifdef SPARK_ZSTD_ENABLE
+    #include <zstd.h>
+#endif
+
+#include <libsparkproto/recordingcodec.h>
+#include <libsparkproto/exception.h>
+
+namespace libspark {
+
+namespace protocol {
+
+namespace recording {
+
+#ifdef SPARK_ZSTD_ENABLE
+// contexts are reused by each thread, so compressing a plane does not allocate
+struct ZstdContextDeleter {
+    void operator()(ZSTD_CCtx *ctx) const { ZSTD_freeCCtx(ctx); }
+    void operator()(ZSTD_DCtx *ctx) const { ZSTD_freeDCtx(ctx); }
+};
+
+static ZSTD_CCtx* zstdCompressContext() {
+    thread_local std::unique_ptr<ZSTD_CCtx, ZstdContextDeleter> ctx(ZSTD_createCCtx());
+    return ctx.get();
+}
+
+static ZSTD_DCtx* zstdDecompressContext() {
+    thread_local std::unique_ptr<ZSTD_DCtx, ZstdContextDeleter> ctx(ZSTD_createDCtx());
+    return ctx.get();
+}
+#endif
+
+bool isCodecSupported(PlaneCodec codec) {
+    switch (codec)
+    {
+    case CODEC_NONE:
+        return true;
+#ifdef SPARK_LZ4_ENABLE
+    case CODEC_LZ4:
+        return true;
+#endif
+#ifdef SPARK_ZSTD_ENABLE
+    case CODEC_ZSTD:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+size_t compressBound(PlaneCodec codec, size_t size) {
+    switch (codec)
+    {
+#ifdef SPARK_LZ4_ENABLE
+    case CODEC_LZ4:
+        return LZ4_compressBound(size);
+#endif
+#ifdef SPARK_ZSTD_ENABLE
+    case CODEC_ZSTD:
+        return ZSTD_compressBound(size);
+#endif
+    default:
+        return size;
+    }
+}
+
+size_t compressPlane(PlaneCodec codec, int level, const void *src, size_t size, void *dst, size_t dstCapacity) {
+    (void) level;
+
+    switch (codec)
+    {
+    case CODEC_NONE:
+        if(size > dstCapacity) {
+            return 0;
+        }
+        memcpy(dst, src, size);
+        return size;
+#ifdef SPARK_LZ4_ENABLE
+    case CODEC_LZ4: {
+        int ret = LZ4_compress_fast((const char*)src, (char*)dst, size, dstCapacity, level > 0 ? level : 1);
+        return ret > 0 ? ret : 0;
+    }
+#endif
+#ifdef SPARK_ZSTD_ENABLE
+    case CODEC_ZSTD: {
+        size_t ret = ZSTD_compressCCtx(zstdCompressContext(), dst, dstCapacity, src, size, level != 0 ? level : 3);
+        return ZSTD_isError(ret) ? 0 : ret;
+    }
+#endif
+    default:
+        throw SparkError("codec " + std::to_string(codec) + " is not supported by this build");
+    }
+}
+
+void decompressPlane(PlaneCodec codec, const void *src, size_t size, void *dst, size_t rawSize) {
+    switch (codec)
+    {
+    case CODEC_NONE:
+        if(size != rawSize) {
+            throw SparkError("size of plane does not match ImageMeta");
+        }
+        memcpy(dst, src, size);
+        return;
+#ifdef SPARK_LZ4_ENABLE
+    case CODEC_LZ4:
+        if(LZ4_decompress_safe((const char*)src, (char*)dst, size, rawSize) != (int)rawSize) {
+            throw SparkError("failed decompressing LZ4 plane");
+        }
+        return;
+#endif
+#ifdef SPARK_ZSTD_ENABLE
+    case CODEC_ZSTD: {
+        size_t ret = ZSTD_decompressDCtx(zstdDecompressContext(), dst, rawSize, src, size);
+        if(ZSTD_isError(ret) || ret != rawSize) {
+            throw SparkError("failed decompressing zstd plane");
+        }
+        return;
+    }
+#endif
+    default:
+        throw SparkError("codec " + std::to_string(codec) + " is not supported by this build");
+    }
+}
+
+void deltaEncode(const uint8_t *src, const uint8_t *reference, uint8_t *dst, size_t size) {
+    if(size % 2 == 0) {
+        // unaligned 16-bit access through memcpy, the compiler vectorizes the loop
+        for(size_t i = 0; i < size; i += 2) {
+            uint16_t a, b;
+            memcpy(&a, src + i, 2);
+            memcpy(&b, reference + i, 2);
+            uint16_t d = a - b;
+            memcpy(dst + i, &d, 2);
+        }
+    }
+    else {
+        for(size_t i = 0; i < size; i++) {
+            dst[i] = src[i] - reference[i];
+        }
+    }
+}
+
+void deltaDecode(uint8_t *data, const uint8_t *reference, size_t size) {
+    if(size % 2 == 0) {
+        for(size_t i = 0; i < size; i += 2) {
+            uint16_t d, b;
+            memcpy(&d, data + i, 2);
+            memcpy(&b, reference + i, 2);
+            uint16_t a = d + b;
+            memcpy(data + i, &a, 2);
+        }
+    }
+    else {
+        for(size_t i = 0; i < size; i++) {
+            data[i] += reference[i];
+        }
+    }
+}
+
+} // namespace recording
+} // namespace protocol
+} // namespace libspark
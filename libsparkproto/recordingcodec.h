@@ -0,0 +1,87 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <libsparkproto/recordingformat.h>
+
+namespace libspark {
+
+namespace protocol {
+
+namespace recording {
+
+//
+// Compression of planes of a recording. LZ4 and zstd are optional dependencies,
+// they are available when the library is built with ENABLE_LZ4 and ENABLE_ZSTD.
+//
+
+/**
+ * @brief Check if the library is built with support of codec
+ *
+ * @param codec
+ * @return true
+ * @return false
+ */
+bool isCodecSupported(PlaneCodec codec);
+
+/**
+ * @brief Maximum compressed size of a plane of size bytes
+ *
+ * @param codec
+ * @param size
+ * @return size_t
+ */
+size_t compressBound(PlaneCodec codec, size_t size);
+
+/**
+ * @brief Compress a plane to dst. Return the compressed size, 0 if the plane can not be compressed into dstCapacity bytes.
+ * If the codec is not supported, a exception is thrown
+ *
+ * @param codec
+ * @param level compression level of zstd, acceleration of LZ4, 0 for the default of the codec
+ * @param src
+ * @param size
+ * @param dst
+ * @param dstCapacity
+ * @return size_t
+ */
+size_t compressPlane(PlaneCodec codec, int level, const void *src, size_t size, void *dst, size_t dstCapacity);
+
+/**
+ * @brief Decompress a plane of rawSize bytes, a exception is thrown if the data is corrupted
+ *
+ * @param codec
+ * @param src
+ * @param size
+ * @param dst
+ * @param rawSize
+ */
+void decompressPlane(PlaneCodec codec, const void *src, size_t size, void *dst, size_t rawSize);
+
+/**
+ * @brief Store the difference of a plane to a reference plane of the same size.
+ * Planes of even size are processed as 16-bit samples, e.g. disparity
+ *
+ * @param src
+ * @param reference
+ * @param dst
+ * @param size
+ */
+void deltaEncode(const uint8_t *src, const uint8_t *reference, uint8_t *dst, size_t size);
+
+/**
+ * @brief Restore a plane in place from its difference to a reference plane, inverse of deltaEncode
+ *
+ * @param data
+ * @param reference
+ * @param size
+ */
+void deltaDecode(uint8_t *data, const uint8_t *reference, size_t size);
+
+} // namespace recording
+} // namespace protocol
+} // namespace libspark
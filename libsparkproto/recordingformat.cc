@@ -0,0 +1,189 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+
+#include <libsparkproto/recordingformat.h>
+#include <libsparkproto/exception.h>
+#include <libsparkproto/log.h>
+
+namespace libspark {
+
+namespace protocol {
+
+namespace recording {
+
+FileHeader makeFileHeader() {
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+    header.version = FORMAT_VERSION;
+    header.headerSize = sizeof(FileHeader);
+    header.createdTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    return header;
+}
+
+bool isValidFileHeader(const FileHeader &header) {
+    return memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) == 0 &&
+        header.version >= 1 && header.version <= FORMAT_VERSION &&
+        header.headerSize >= sizeof(FileHeader);
+}
+
+RecordHeader makeRecordHeader(const ImageSetMeta &meta, uint32_t metaSize, uint64_t receiveTimestamp) {
+    RecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.sync = RECORD_SYNC;
+    header.metaSize = metaSize;
+    header.receiveTimestamp = receiveTimestamp;
+
+    for(uint32_t i = 0; i < PLANE_COUNT; i++) {
+        const ImageMeta *plane = planeMeta(meta, ImageSet::BufferID(i));
+        header.planeSize[i] = plane ? plane->buffsize() : 0;
+        header.codec[i] = CODEC_NONE;
+    }
+
+    return header;
+}
+
+uint64_t recordSize(const RecordHeader &header) {
+    uint64_t size = sizeof(RecordHeader) + header.metaSize;
+    for(uint32_t i = 0; i < PLANE_COUNT; i++) {
+        size += header.planeSize[i];
+    }
+    return size;
+}
+
+const ImageMeta* planeMeta(const ImageSetMeta &meta, ImageSet::BufferID id) {
+    switch (id)
+    {
+    case ImageSet::BUFFER_LEFT:
+        return meta.has_left() ? &meta.left() : nullptr;
+    case ImageSet::BUFFER_RIGHT:
+        return meta.has_right() ? &meta.right() : nullptr;
+    case ImageSet::BUFFER_DEPTH:
+        return meta.has_depth() ? &meta.depth() : nullptr;
+    case ImageSet::BUFFER_DISPARITY:
+        return meta.has_disparity() ? &meta.disparity() : nullptr;
+    default:
+        return nullptr;
+    }
+}
+
+int64_t metaTimestamp(const ImageSetMeta &meta) {
+    if(meta.has_left()) {
+        return meta.left().timestamp();
+    }
+    if(meta.has_right()) {
+        return meta.right().timestamp();
+    }
+    return 0;
+}
+
+void writeIndex(int fd, uint64_t indexOffset, const Index &index) {
+    uint64_t indexSize = index.size() * sizeof(IndexEntry);
+    if(indexSize > 0) {
+        pwriteFixed(fd, index.data(), indexSize, indexOffset);
+    }
+
+    FileTrailer trailer;
+    memset(&trailer, 0, sizeof(trailer));
+    trailer.indexOffset = indexOffset;
+    trailer.recordCount = index.size();
+    memcpy(trailer.magic, TRAILER_MAGIC, sizeof(trailer.magic));
+    pwriteFixed(fd, &trailer, sizeof(trailer), indexOffset + indexSize);
+}
+
+bool readIndex(int fd, uint64_t fileSize, Index &index) {
+    if(fileSize < sizeof(FileHeader) + sizeof(FileTrailer)) {
+        return false;
+    }
+
+    FileTrailer trailer;
+    preadFixed(fd, &trailer, sizeof(trailer), fileSize - sizeof(FileTrailer));
+    if(memcmp(trailer.magic, TRAILER_MAGIC, sizeof(trailer.magic)) != 0) {
+        return false;
+    }
+
+    uint64_t indexSize = trailer.recordCount * sizeof(IndexEntry);
+    if(trailer.indexOffset < sizeof(FileHeader) ||
+        trailer.indexOffset + indexSize + sizeof(FileTrailer) != fileSize) {
+        return false;
+    }
+
+    index.resize(trailer.recordCount);
+    if(indexSize > 0) {
+        preadFixed(fd, index.data(), indexSize, trailer.indexOffset);
+    }
+    return true;
+}
+
+void scanIndex(int fd, uint64_t fileSize, Index &index) {
+    index.clear();
+
+    uint64_t offset = sizeof(FileHeader);
+    std::string metaBuff;
+    while(offset + sizeof(RecordHeader) <= fileSize) {
+        RecordHeader header;
+        preadFixed(fd, &header, sizeof(header), offset);
+        if(header.sync != RECORD_SYNC || offset + recordSize(header) > fileSize) {
+            break;
+        }
+
+        metaBuff.resize(header.metaSize);
+        preadFixed(fd, &metaBuff[0], header.metaSize, offset + sizeof(RecordHeader));
+        ImageSetMeta meta;
+        if(!meta.ParseFromString(metaBuff)) {
+            break;
+        }
+
+        index.push_back({metaTimestamp(meta), header.receiveTimestamp, offset});
+        offset += recordSize(header);
+    }
+
+    if(offset != fileSize) {
+        LOG_WARNING("recording is truncated, %lu records recovered", index.size());
+    }
+}
+
+void pwriteFixed(int fd, const void *buff, size_t fixedSize, uint64_t offset) {
+    const char *buffer = (const char*) buff;
+
+    for(size_t done = 0; done < fixedSize;) {
+        ssize_t ret = ::pwrite(fd, buffer + done, fixedSize - done, offset + done);
+        if(ret > 0) {
+            done += ret;
+            continue;
+        }
+        if(ret < 0 && errno == EINTR) {
+            continue;
+        }
+        throw SparkError("failed writing recording file: " + std::string(strerror(errno)));
+    }
+}
+
+void preadFixed(int fd, void *buff, size_t fixedSize, uint64_t offset) {
+    char *buffer = (char*) buff;
+
+    for(size_t done = 0; done < fixedSize;) {
+        ssize_t ret = ::pread(fd, buffer + done, fixedSize - done, offset + done);
+        if(ret > 0) {
+            done += ret;
+            continue;
+        }
+        if(ret < 0 && errno == EINTR) {
+            continue;
+        }
+        throw SparkError(ret == 0 ? "unexpected end of recording file" :
+            "failed reading recording file: " + std::string(strerror(errno)));
+    }
+}
+
+} // namespace recording
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,197 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <libsparkproto/imageset.h>
+
+namespace libspark {
+
+namespace protocol {
+
+namespace recording {
+
+//
+// Layout of a recording file (all integers are little endian):
+//
+//   FileHeader
+//   Record[0] ... Record[N-1]
+//   IndexEntry[N]
+//   FileTrailer
+//
+// A record keeps the framing of the image stream: a RecordHeader, the serialized
+// ImageSetMeta (RecordHeader::metaSize bytes) and the plane payloads in BufferID order.
+// Index and trailer are appended when the file is closed. A file without them
+// (e.g. the recorder was killed) can still be opened, the index is rebuilt by scanning.
+//
+
+static constexpr char FILE_MAGIC[8] = {'S', 'P', 'K', 'R', 'E', 'C', '\0', '\0'};
+static constexpr char TRAILER_MAGIC[8] = {'S', 'P', 'K', 'I', 'D', 'X', '\0', '\0'};
+static constexpr uint32_t RECORD_SYNC = 0x524b5053; // "SPKR"
+static constexpr uint32_t FORMAT_VERSION = 1;
+static constexpr uint32_t PLANE_COUNT = (uint32_t)ImageSet::BUFFER_ID_MAX + 1;
+
+static const std::string FILE_EXTENSION = ".sparkrec";
+
+// largest plane accepted from a stream, far above the images of any device
+static constexpr int32_t MAX_PLANE_SIZE = 256 << 20;
+
+enum PlaneCodec : uint8_t {
+    CODEC_NONE = 0,
+    CODEC_LZ4 = 1,
+    CODEC_ZSTD = 2
+};
+
+// RecordHeader::codec holds a PlaneCodec in the lower bits, CODEC_FLAG_DELTA is set when
+// the plane was stored as the difference to the same plane of the previous record
+static constexpr uint8_t CODEC_MASK = 0x7f;
+static constexpr uint8_t CODEC_FLAG_DELTA = 0x80;
+
+// lower bits of RecordHeader::flags, id of the stream of a recording which mixes several streams
+static constexpr uint32_t RECORD_FLAG_STREAM_MASK = 0xff;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    // wall clock time the recording was created, in nanoseconds since epoch
+    uint64_t createdTime;
+};
+
+struct RecordHeader {
+    uint32_t sync;
+    uint32_t metaSize;
+    // host time the ImageSet was received, see ImageSet::receiveTimestamp()
+    uint64_t receiveTimestamp;
+    // stored size of each plane, 0 when the plane is absent. The decoded size is buffsize of ImageMeta
+    uint32_t planeSize[PLANE_COUNT];
+    uint8_t codec[PLANE_COUNT];
+    uint32_t flags;
+};
+
+struct IndexEntry {
+    int64_t timestamp;
+    uint64_t receiveTimestamp;
+    uint64_t offset;
+};
+
+struct FileTrailer {
+    uint64_t indexOffset;
+    uint64_t recordCount;
+    char magic[8];
+};
+
+static_assert(sizeof(FileHeader) == 24, "unexpected FileHeader layout");
+static_assert(sizeof(RecordHeader) == 40, "unexpected RecordHeader layout");
+static_assert(sizeof(IndexEntry) == 24, "unexpected IndexEntry layout");
+static_assert(sizeof(FileTrailer) == 24, "unexpected FileTrailer layout");
+
+using Index = std::vector<IndexEntry>;
+
+/**
+ * @brief Make a header for a new recording file
+ *
+ * @return FileHeader
+ */
+FileHeader makeFileHeader();
+
+/**
+ * @brief Check magic and version of a file header
+ *
+ * @param header
+ * @return true
+ * @return false
+ */
+bool isValidFileHeader(const FileHeader &header);
+
+/**
+ * @brief Fill a RecordHeader from the meta of an ImageSet, the planes are stored uncompressed
+ *
+ * @param meta
+ * @param metaSize size of the serialized meta
+ * @param receiveTimestamp
+ * @return RecordHeader
+ */
+RecordHeader makeRecordHeader(const ImageSetMeta &meta, uint32_t metaSize, uint64_t receiveTimestamp);
+
+/**
+ * @brief Total size of a record on disk, RecordHeader included
+ *
+ * @param header
+ * @return uint64_t
+ */
+uint64_t recordSize(const RecordHeader &header);
+
+/**
+ * @brief Get the ImageMeta of a plane, nullptr when the plane is not in the ImageSetMeta
+ *
+ * @param meta
+ * @param id
+ * @return const ImageMeta*
+ */
+const ImageMeta* planeMeta(const ImageSetMeta &meta, ImageSet::BufferID id);
+
+/**
+ * @brief Get timestamp of an ImageSetMeta, same rule as ImageSet::imageTimestamp()
+ *
+ * @param meta
+ * @return int64_t
+ */
+int64_t metaTimestamp(const ImageSetMeta &meta);
+
+/**
+ * @brief Write index and trailer at the current end of the file
+ *
+ * @param fd
+ * @param indexOffset offset where the index starts
+ * @param index
+ */
+void writeIndex(int fd, uint64_t indexOffset, const Index &index);
+
+/**
+ * @brief Read index from trailer of the file. Returns false if the file has no valid trailer
+ *
+ * @param fd
+ * @param fileSize
+ * @param index
+ * @return true
+ * @return false
+ */
+bool readIndex(int fd, uint64_t fileSize, Index &index);
+
+/**
+ * @brief Rebuild the index by walking through all complete records of the file
+ *
+ * @param fd
+ * @param fileSize
+ * @param index
+ */
+void scanIndex(int fd, uint64_t fileSize, Index &index);
+
+/**
+ * @brief write fixedSize bytes to fd at offset, a exception is thrown on failure
+ *
+ * @param fd
+ * @param buff
+ * @param fixedSize
+ * @param offset
+ */
+void pwriteFixed(int fd, const void *buff, size_t fixedSize, uint64_t offset);
+
+/**
+ * @brief read fixedSize bytes from fd at offset, a exception is thrown on failure
+ *
+ * @param fd
+ * @param buff
+ * @param fixedSize
+ * @param offset
+ */
+void preadFixed(int fd, void *buff, size_t fixedSize, uint64_t offset);
+
+} // namespace recording
+} // namespace protocol
+} // namespace libspark
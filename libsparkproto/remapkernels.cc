@@ -0,0 +1,225 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include <libsparkproto/remapkernels.h>
+
+#if defined(SPARK_CPU_X86)
+    #include <immintrin.h>
+#endif
+
+namespace libspark {
+
+namespace protocol {
+
+namespace remap {
+
+bool setPixel(Map &map, size_t index, double x, double y) {
+    double maxX = map.width - 1;
+    double maxY = map.height - 1;
+    bool inside = x >= 0 && x <= maxX && y >= 0 && y <= maxY;
+
+    // pixels without source are clamped, so pixels of a span are always inside
+    x = std::min(std::max(x, 0.0), maxX);
+    y = std::min(std::max(y, 0.0), maxY);
+    long fixedX = lround(x * FRAC_ONE);
+    long fixedY = lround(y * FRAC_ONE);
+
+    // x of the last column is x = width - 2 with a fraction of 1
+    long ix = std::min<long>(fixedX >> FRAC_BITS, map.width - 2);
+    long iy = std::min<long>(fixedY >> FRAC_BITS, map.height - 2);
+    long fx = fixedX - (ix << FRAC_BITS);
+    long fy = fixedY - (iy << FRAC_BITS);
+
+    map.xy[2 * index] = int16_t(ix);
+    map.xy[2 * index + 1] = int16_t(iy);
+    map.frac[index] = uint16_t((fy << FRAC_Y_SHIFT) | fx);
+    return inside;
+}
+
+// top * (32 - fy) + bottom * fy of the horizontal interpolations fits 18 bits
+static inline uint8_t interpolate(const uint8_t *p, size_t stride, uint32_t channels, uint32_t fx, uint32_t fy) {
+    uint32_t top = p[0] * (FRAC_ONE - fx) + p[channels] * fx;
+    uint32_t bottom = p[stride] * (FRAC_ONE - fx) + p[stride + channels] * fx;
+    return uint8_t((top * (FRAC_ONE - fy) + bottom * fy + (1 << (2 * FRAC_BITS - 1))) >> (2 * FRAC_BITS));
+}
+
+static void remapGeneric(const Map &map, uint32_t v, uint32_t x, uint32_t end,
+    const uint8_t *src, uint32_t channels, uint8_t *dst) {
+
+    size_t stride = size_t(map.width) * channels;
+    size_t row = size_t(v) * map.width;
+    const int16_t *xy = map.xy.data() + 2 * row;
+    const uint16_t *frac = map.frac.data() + row;
+
+    for(; x < end; x++) {
+        const uint8_t *p = src + xy[2 * x + 1] * stride + xy[2 * x] * channels;
+        uint32_t fx = frac[x] & FRAC_MASK;
+        uint32_t fy = frac[x] >> FRAC_Y_SHIFT;
+        for(uint32_t c = 0; c < channels; c++) {
+            dst[x * channels + c] = interpolate(p + c, stride, channels, fx, fy);
+        }
+    }
+}
+
+// SIMD kernels process the head of the columns and return the column reached, the generic kernel finishes them
+struct Kernels {
+    uint32_t (*remapGray)(const Map &map, uint32_t v, uint32_t begin, uint32_t end, const uint8_t *src, uint8_t *dst);
+    uint32_t (*remapRgb)(const Map &map, uint32_t v, uint32_t begin, uint32_t end, const uint8_t *src, uint8_t *dst);
+};
+
+static uint32_t remapNone(const Map &, uint32_t, uint32_t begin, uint32_t, const uint8_t *, uint8_t *) { return begin; }
+
+static const Kernels GENERIC_KERNELS = {
+    remapNone, remapNone
+};
+
+#if defined(SPARK_CPU_X86)
+
+//
+// AVX2: a gather of 32 bits loads 2 neighbouring pixels of a row, the weights are applied with madd
+// to pairs of 16-bit samples, first along rows then between the rows
+//
+
+__attribute__((target("avx2")))
+static inline void loadCoordsAvx2(const int16_t *xy, const uint16_t *frac, __m256i &x, __m256i &y, __m256i &wx, __m256i &wy) {
+    __m256i pairs = _mm256_loadu_si256((const __m256i *) xy);
+    x = _mm256_srai_epi32(_mm256_slli_epi32(pairs, 16), 16);
+    y = _mm256_srai_epi32(pairs, 16);
+
+    __m256i f = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) frac));
+    __m256i one = _mm256_set1_epi32(FRAC_ONE);
+    __m256i fx = _mm256_and_si256(f, _mm256_set1_epi32(FRAC_MASK));
+    __m256i fy = _mm256_srli_epi32(f, FRAC_Y_SHIFT);
+    wx = _mm256_or_si256(_mm256_sub_epi32(one, fx), _mm256_slli_epi32(fx, 16));
+    wy = _mm256_or_si256(_mm256_sub_epi32(one, fy), _mm256_slli_epi32(fy, 16));
+}
+
+// left and right samples in the low and high 16 bits of each lane, to 8-bit output in the low byte of each lane
+__attribute__((target("avx2")))
+static inline __m256i interpolateAvx2(__m256i top, __m256i bottom, __m256i wx, __m256i wy) {
+    __m256i t = _mm256_madd_epi16(top, wx);
+    __m256i b = _mm256_madd_epi16(bottom, wx);
+    __m256i v = _mm256_madd_epi16(_mm256_or_si256(t, _mm256_slli_epi32(b, 16)), wy);
+    return _mm256_srli_epi32(_mm256_add_epi32(v, _mm256_set1_epi32(1 << (2 * FRAC_BITS - 1))), 2 * FRAC_BITS);
+}
+
+// bytes c of left and c + shift / 8 of right to the low and high 16 bits of each lane
+__attribute__((target("avx2")))
+static inline __m256i pairSamplesAvx2(__m256i left, __m256i right, int leftShift, int rightShift) {
+    __m256i mask = _mm256_set1_epi32(0xff);
+    __m256i l = _mm256_and_si256(_mm256_srli_epi32(left, leftShift), mask);
+    __m256i r = _mm256_and_si256(_mm256_srli_epi32(right, rightShift), mask);
+    return _mm256_or_si256(l, _mm256_slli_epi32(r, 16));
+}
+
+__attribute__((target("avx2")))
+static uint32_t remapGrayAvx2(const Map &map, uint32_t v, uint32_t x, uint32_t end, const uint8_t *src, uint8_t *dst) {
+    size_t stride = map.width;
+    size_t row = size_t(v) * map.width;
+    const int16_t *xy = map.xy.data() + 2 * row;
+    const uint16_t *frac = map.frac.data() + row;
+
+    // a gather reads 4 bytes, the last bytes of the image are left to the generic kernel
+    __m256i limit = _mm256_set1_epi32(int(stride * map.height - stride - 4));
+    __m256i strideVec = _mm256_set1_epi32(int(stride));
+    __m256i compact = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+
+    for(; x + 8 <= end; x += 8) {
+        __m256i px, py, wx, wy;
+        loadCoordsAvx2(xy + 2 * x, frac + x, px, py, wx, wy);
+        __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(py, strideVec), px);
+        if(_mm256_movemask_epi8(_mm256_cmpgt_epi32(index, limit))) {
+            break;
+        }
+
+        __m256i top = _mm256_i32gather_epi32((const int *) src, index, 1);
+        __m256i bottom = _mm256_i32gather_epi32((const int *)(src + stride), index, 1);
+        __m256i out = interpolateAvx2(pairSamplesAvx2(top, top, 0, 8), pairSamplesAvx2(bottom, bottom, 0, 8), wx, wy);
+
+        out = _mm256_packus_epi16(_mm256_packus_epi32(out, out), out);
+        out = _mm256_permutevar8x32_epi32(out, compact);
+        _mm_storel_epi64((__m128i *)(dst + x), _mm256_castsi256_si128(out));
+    }
+    return x;
+}
+
+__attribute__((target("avx2")))
+static uint32_t remapRgbAvx2(const Map &map, uint32_t v, uint32_t x, uint32_t end, const uint8_t *src, uint8_t *dst) {
+    size_t stride = size_t(map.width) * 3;
+    size_t row = size_t(v) * map.width;
+    const int16_t *xy = map.xy.data() + 2 * row;
+    const uint16_t *frac = map.frac.data() + row;
+
+    // gathers read r g b r at a pixel and b r g b 2 bytes further
+    __m256i limit = _mm256_set1_epi32(int(stride * map.height - stride - 6));
+    __m256i strideVec = _mm256_set1_epi32(int(stride));
+    __m256i compact = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+    // the second half of 8 pixels is stored as 16 bytes, 2 pixels after the block must belong to the columns
+    for(; x + 10 <= end; x += 8) {
+        __m256i px, py, wx, wy;
+        loadCoordsAvx2(xy + 2 * x, frac + x, px, py, wx, wy);
+        __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(py, strideVec),
+            _mm256_add_epi32(px, _mm256_add_epi32(px, px)));
+        if(_mm256_movemask_epi8(_mm256_cmpgt_epi32(index, limit))) {
+            break;
+        }
+
+        __m256i topLeft = _mm256_i32gather_epi32((const int *) src, index, 1);
+        __m256i topRight = _mm256_i32gather_epi32((const int *)(src + 2), index, 1);
+        __m256i bottomLeft = _mm256_i32gather_epi32((const int *)(src + stride), index, 1);
+        __m256i bottomRight = _mm256_i32gather_epi32((const int *)(src + stride + 2), index, 1);
+
+        __m256i out = _mm256_setzero_si256();
+        for(int c = 0; c < 3; c++) {
+            __m256i top = pairSamplesAvx2(topLeft, topRight, 8 * c, 8 * c + 8);
+            __m256i bottom = pairSamplesAvx2(bottomLeft, bottomRight, 8 * c, 8 * c + 8);
+            out = _mm256_or_si256(out, _mm256_slli_epi32(interpolateAvx2(top, bottom, wx, wy), 8 * c));
+        }
+
+        out = _mm256_shuffle_epi8(out, compact);
+        _mm_storeu_si128((__m128i *)(dst + 3 * x), _mm256_castsi256_si128(out));
+        _mm_storeu_si128((__m128i *)(dst + 3 * x + 12), _mm256_extracti128_si256(out, 1));
+    }
+    return x;
+}
+
+// without gathers, SSE4.1 loads pixels one by one like the generic kernel
+static const Kernels AVX2_KERNELS = {
+    remapGrayAvx2, remapRgbAvx2
+};
+
+#endif // SPARK_CPU_X86
+
+static const Kernels& kernelsOf(cpu::Level level) {
+#if defined(SPARK_CPU_X86)
+    if(level == cpu::LEVEL_AVX2) {
+        return AVX2_KERNELS;
+    }
+#endif
+    (void) level;
+    return GENERIC_KERNELS;
+}
+
+void remapRow(const Map &map, uint32_t v, uint32_t begin, uint32_t end,
+    const uint8_t *src, uint32_t channels, uint8_t *dst, cpu::Level level) {
+
+    uint32_t spanBegin = std::min(std::max(map.spans[2 * v], begin), end);
+    uint32_t spanEnd = std::max(std::min(map.spans[2 * v + 1], end), spanBegin);
+    memset(dst + begin * channels, 0, (spanBegin - begin) * channels);
+    memset(dst + spanEnd * channels, 0, (end - spanEnd) * channels);
+
+    const Kernels &kernels = kernelsOf(level);
+    uint32_t x = channels == 3 ? kernels.remapRgb(map, v, spanBegin, spanEnd, src, dst) :
+        kernels.remapGray(map, v, spanBegin, spanEnd, src, dst);
+    remapGeneric(map, v, x, spanEnd, src, channels, dst);
+}
+
+} // namespace remap
+} // namespace protocol
+} // namespace libspark
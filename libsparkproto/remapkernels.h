@@ -0,0 +1,73 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include <libsparkproto/cpufeatures.h>
+
+namespace libspark {
+
+namespace protocol {
+
+namespace remap {
+
+// fractions of source coordinates are in 1/32 pixel, 0 to 32, bilinear weights sum to 32 * 32
+static constexpr uint32_t FRAC_BITS = 5;
+static constexpr uint32_t FRAC_ONE = 1 << FRAC_BITS;
+
+// packed fraction: x in bits 0-5, y in bits 6-11
+static constexpr uint32_t FRAC_Y_SHIFT = 6;
+static constexpr uint32_t FRAC_MASK = (1 << FRAC_Y_SHIFT) - 1;
+
+/**
+ * @brief Lookup map from pixels of a destination image to source coordinates in fixed point.
+ * The source pixel of (u, v) is at (x + fx / 32, y + fy / 32) with x, y in xy and fx, fy in frac.
+ * Pixels outside of the span of their row have no source and are set to 0. x is at most width - 2,
+ * y at most height - 2, so the 2x2 pixels of the interpolation are inside the source
+ *
+ */
+struct Map {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // x, y of each pixel
+    std::vector<int16_t> xy;
+    // fy << FRAC_Y_SHIFT | fx of each pixel
+    std::vector<uint16_t> frac;
+    // first and end column of the pixels with a source, of each row
+    std::vector<uint32_t> spans;
+};
+
+/**
+ * @brief Set a pixel of the map from a source coordinate, return false if it's outside of the source image
+ *
+ * @param map
+ * @param index
+ * @param x
+ * @param y
+ * @return true
+ * @return false
+ */
+bool setPixel(Map &map, size_t index, double x, double y);
+
+/**
+ * @brief Bilinear remap of the columns [begin, end) of row v of map
+ *
+ * @param map
+ * @param v
+ * @param begin
+ * @param end
+ * @param src source image of map.width x map.height pixels, rows without padding
+ * @param channels 1 or 3 bytes per pixel
+ * @param dst row v of the destination image
+ * @param level
+ */
+void remapRow(const Map &map, uint32_t v, uint32_t begin, uint32_t end,
+    const uint8_t *src, uint32_t channels, uint8_t *dst, cpu::Level level);
+
+} // namespace remap
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,546 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <algorithm>
+
+#include <libsparkproto/sgmkernels.h>
+
+#if defined(SPARK_CPU_X86)
+    #include <immintrin.h>
+#endif
+
+namespace libspark {
+
+namespace protocol {
+
+namespace sgm {
+
+static constexpr int CENSUS_RADIUS_X = CENSUS_WIDTH / 2;
+static constexpr int CENSUS_RADIUS_Y = CENSUS_HEIGHT / 2;
+
+// block of the previous pixel of each vertical path, relative to the block of the pixel
+static constexpr int VERTICAL_OFFSETS[VERTICAL_PATHS] = {0, -1, 1};
+
+//
+// generic kernels, SIMD kernels finish the pixels they leave with them
+//
+
+// bit i of the census is the i-th neighbour in row-major order of the window, the center skipped
+static void censusGeneric(const uint8_t *const rows[CENSUS_HEIGHT], uint32_t x, uint32_t end, uint32_t width,
+    uint64_t *census) {
+
+    for(; x < end; x++) {
+        uint8_t center = rows[CENSUS_RADIUS_Y][x];
+        uint64_t bits = 0;
+        int bit = 0;
+        for(int dy = 0; dy < CENSUS_HEIGHT; dy++) {
+            for(int dx = -CENSUS_RADIUS_X; dx <= CENSUS_RADIUS_X; dx++) {
+                if(dy == CENSUS_RADIUS_Y && dx == 0) {
+                    continue;
+                }
+                int nx = std::min(std::max(int(x) + dx, 0), int(width) - 1);
+                bits |= uint64_t(rows[dy][nx] < center) << bit;
+                bit++;
+            }
+        }
+        census[x] = bits;
+    }
+}
+
+static void censusRowGeneric(const uint8_t *const rows[CENSUS_HEIGHT], uint32_t width, uint64_t *census) {
+    censusGeneric(rows, 0, width, width, census);
+}
+
+static void costGeneric(const uint64_t *left, const uint64_t *right, uint32_t x, uint32_t end,
+    uint32_t disparities, uint16_t *cost) {
+
+    for(; x < end; x++) {
+        uint16_t *block = cost + size_t(x) * disparities;
+        uint32_t valid = std::min(x + 1, disparities);
+        for(uint32_t d = 0; d < valid; d++) {
+            block[d] = uint16_t(__builtin_popcountll(left[x] ^ right[x - d]));
+        }
+        std::fill(block + valid, block + disparities, COST_INVALID);
+    }
+}
+
+static void costRowGeneric(const uint64_t *left, const uint64_t *right, uint32_t width, uint32_t disparities,
+    uint16_t *cost) {
+    costGeneric(left, right, 0, width, disparities, cost);
+}
+
+// path of a pixel from the previous pixel prev of the path, returns the minimum of out
+static uint16_t pathGeneric(const uint16_t *cost, const uint16_t *prev, uint16_t prevMin, uint32_t disparities,
+    uint16_t penalty1, uint16_t penalty2, uint16_t *out, uint16_t *sum) {
+
+    uint32_t jump = prevMin + penalty2;
+    uint16_t outMin = 0xffff;
+    for(uint32_t d = 0; d < disparities; d++) {
+        uint16_t lower = d > 0 ? prev[d - 1] : PATH_GUARD;
+        uint16_t upper = d + 1 < disparities ? prev[d + 1] : PATH_GUARD;
+        uint32_t step = std::min(lower, upper) + penalty1;
+        uint32_t best = std::min(std::min<uint32_t>(prev[d], step), jump);
+        uint16_t value = uint16_t(cost[d] + best - prevMin);
+        out[d] = value;
+        sum[d] = uint16_t(sum[d] + value);
+        outMin = std::min(outMin, value);
+    }
+    return outMin;
+}
+
+static void aggregateHorizontalGeneric(const uint16_t *cost, uint32_t width, uint32_t disparities,
+    uint16_t penalty1, uint16_t penalty2, uint16_t *sum) {
+
+    uint16_t paths[2][MAX_DISPARITIES];
+    for(int direction = 0; direction < 2; direction++) {
+        std::fill(paths[0], paths[0] + disparities, 0);
+        uint16_t prevMin = 0;
+        for(uint32_t i = 0; i < width; i++) {
+            size_t offset = size_t(direction == 0 ? i : width - 1 - i) * disparities;
+            prevMin = pathGeneric(cost + offset, paths[i & 1], prevMin, disparities, penalty1, penalty2,
+                paths[(i + 1) & 1], sum + offset);
+        }
+    }
+}
+
+static void aggregateVerticalGeneric(const uint16_t *cost, uint32_t width, uint32_t disparities,
+    uint16_t penalty1, uint16_t penalty2, const uint16_t *prevPaths, const uint16_t *prevMins,
+    uint16_t *paths, uint16_t *mins, uint16_t *sum) {
+
+    for(uint32_t x = 0; x < width; x++) {
+        size_t offset = size_t(x) * disparities;
+        for(uint32_t r = 0; r < VERTICAL_PATHS; r++) {
+            size_t block = r * size_t(width + 2) + x + 1;
+            size_t prevBlock = block + VERTICAL_OFFSETS[r];
+            mins[block] = pathGeneric(cost + offset, prevPaths + prevBlock * disparities, prevMins[prevBlock],
+                disparities, penalty1, penalty2, paths + block * disparities, sum + offset);
+        }
+    }
+}
+
+static void selectGeneric(const uint16_t *sum, uint32_t x, uint32_t width, uint32_t disparities, uint16_t *best,
+    uint16_t *rightCost, uint16_t *rightDisparity) {
+
+    for(; x < width; x++) {
+        const uint16_t *block = sum + size_t(x) * disparities;
+        uint16_t *cost = rightCost + (width - 1 - x);
+        uint16_t *disparity = rightDisparity + (width - 1 - x);
+        uint32_t lowest = 0;
+        for(uint32_t d = 0; d < disparities; d++) {
+            if(block[d] < block[lowest]) {
+                lowest = d;
+            }
+            if(block[d] < cost[d]) {
+                cost[d] = block[d];
+                disparity[d] = uint16_t(d);
+            }
+        }
+        best[x] = uint16_t(lowest);
+    }
+}
+
+static void selectRowGeneric(const uint16_t *sum, uint32_t width, uint32_t disparities, uint16_t *best,
+    uint16_t *rightCost, uint16_t *rightDisparity) {
+    selectGeneric(sum, 0, width, disparities, best, rightCost, rightDisparity);
+}
+
+static const Kernels GENERIC_KERNELS = {
+    censusRowGeneric, costRowGeneric, aggregateHorizontalGeneric, aggregateVerticalGeneric, selectRowGeneric
+};
+
+#if defined(SPARK_CPU_X86)
+
+//
+// SSE4.1: path costs of 8 disparities per vector. Costs of disparities d -+ 1 are shifted in from the neighbouring
+// vectors, so a path only loads the vectors stored for the previous pixel. minpos finds the minimum of a block
+//
+
+// costs of d - 1 and d + 1 of cur, between the vectors before and after
+__attribute__((target("sse4.1")))
+static inline __m128i pathStepSse41(__m128i cost, __m128i before, __m128i cur, __m128i after,
+    __m128i penalty1, __m128i jump, __m128i base) {
+
+    __m128i lower = _mm_alignr_epi8(cur, before, 14);
+    __m128i upper = _mm_alignr_epi8(after, cur, 2);
+    __m128i step = _mm_adds_epu16(_mm_min_epu16(lower, upper), penalty1);
+    __m128i best = _mm_min_epu16(_mm_min_epu16(cur, step), jump);
+    return _mm_add_epi16(cost, _mm_sub_epi16(best, base));
+}
+
+__attribute__((target("sse4.1")))
+static inline uint16_t minimumSse41(__m128i v) {
+    return uint16_t(_mm_extract_epi16(_mm_minpos_epu16(v), 0));
+}
+
+__attribute__((target("sse4.1")))
+static uint16_t pathSse41(const uint16_t *cost, const uint16_t *prev, uint16_t prevMin, uint32_t disparities,
+    __m128i penalty1, uint16_t penalty2, uint16_t *out, uint16_t *sum) {
+
+    __m128i guard = _mm_set1_epi16(short(PATH_GUARD));
+    __m128i jump = _mm_set1_epi16(short(prevMin + penalty2));
+    __m128i base = _mm_set1_epi16(short(prevMin));
+    __m128i outMin = _mm_set1_epi16(-1);
+    __m128i before = guard;
+    __m128i cur = _mm_loadu_si128((const __m128i *) prev);
+
+    for(uint32_t d = 0; d < disparities; d += 8) {
+        __m128i after = d + 8 < disparities ? _mm_loadu_si128((const __m128i *)(prev + d + 8)) : guard;
+        __m128i value = pathStepSse41(_mm_loadu_si128((const __m128i *)(cost + d)), before, cur, after,
+            penalty1, jump, base);
+        _mm_storeu_si128((__m128i *)(out + d), value);
+        _mm_storeu_si128((__m128i *)(sum + d), _mm_add_epi16(_mm_loadu_si128((const __m128i *)(sum + d)), value));
+        outMin = _mm_min_epu16(outMin, value);
+        before = cur;
+        cur = after;
+    }
+    return minimumSse41(outMin);
+}
+
+__attribute__((target("sse4.1")))
+static void aggregateHorizontalSse41(const uint16_t *cost, uint32_t width, uint32_t disparities,
+    uint16_t penalty1, uint16_t penalty2, uint16_t *sum) {
+
+    // both directions in one loop, their dependency chains overlap
+    __m128i p1 = _mm_set1_epi16(short(penalty1));
+    alignas(16) uint16_t paths[2][2][MAX_DISPARITIES] = {};
+    uint16_t prevMin[2] = {0, 0};
+    for(uint32_t i = 0; i < width; i++) {
+        size_t forward = size_t(i) * disparities;
+        size_t backward = size_t(width - 1 - i) * disparities;
+        prevMin[0] = pathSse41(cost + forward, paths[0][i & 1], prevMin[0], disparities, p1, penalty2,
+            paths[0][(i + 1) & 1], sum + forward);
+        prevMin[1] = pathSse41(cost + backward, paths[1][i & 1], prevMin[1], disparities, p1, penalty2,
+            paths[1][(i + 1) & 1], sum + backward);
+    }
+}
+
+__attribute__((target("sse4.1")))
+static void aggregateVerticalSse41(const uint16_t *cost, uint32_t width, uint32_t disparities,
+    uint16_t penalty1, uint16_t penalty2, const uint16_t *prevPaths, const uint16_t *prevMins,
+    uint16_t *paths, uint16_t *mins, uint16_t *sum) {
+
+    __m128i p1 = _mm_set1_epi16(short(penalty1));
+    for(uint32_t x = 0; x < width; x++) {
+        size_t offset = size_t(x) * disparities;
+        for(uint32_t r = 0; r < VERTICAL_PATHS; r++) {
+            size_t block = r * size_t(width + 2) + x + 1;
+            size_t prevBlock = block + VERTICAL_OFFSETS[r];
+            mins[block] = pathSse41(cost + offset, prevPaths + prevBlock * disparities, prevMins[prevBlock],
+                disparities, p1, penalty2, paths + block * disparities, sum + offset);
+        }
+    }
+}
+
+// aggregated costs are below PATH_GUARD, signed compares of 16 bits are safe
+__attribute__((target("sse4.1")))
+static void selectRowSse41(const uint16_t *sum, uint32_t width, uint32_t disparities, uint16_t *best,
+    uint16_t *rightCost, uint16_t *rightDisparity) {
+
+    __m128i step = _mm_set1_epi16(8);
+    for(uint32_t x = 0; x < width; x++) {
+        const uint16_t *block = sum + size_t(x) * disparities;
+        uint16_t *cost = rightCost + (width - 1 - x);
+        uint16_t *disparity = rightDisparity + (width - 1 - x);
+
+        __m128i lowest = _mm_set1_epi16(short(PATH_GUARD));
+        __m128i lowestIndex = _mm_setzero_si128();
+        __m128i index = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+        for(uint32_t d = 0; d < disparities; d += 8) {
+            __m128i value = _mm_loadu_si128((const __m128i *)(block + d));
+            lowestIndex = _mm_blendv_epi8(lowestIndex, index, _mm_cmpgt_epi16(lowest, value));
+            lowest = _mm_min_epi16(lowest, value);
+
+            __m128i right = _mm_loadu_si128((const __m128i *)(cost + d));
+            __m128i rightIndex = _mm_loadu_si128((const __m128i *)(disparity + d));
+            _mm_storeu_si128((__m128i *)(disparity + d), _mm_blendv_epi8(rightIndex, index, _mm_cmpgt_epi16(right, value)));
+            _mm_storeu_si128((__m128i *)(cost + d), _mm_min_epi16(right, value));
+            index = _mm_add_epi16(index, step);
+        }
+
+        // the first disparity of the lowest cost, of the lanes holding it
+        __m128i minimum = _mm_set1_epi16(short(minimumSse41(lowest)));
+        __m128i candidates = _mm_blendv_epi8(_mm_set1_epi16(-1), lowestIndex, _mm_cmpeq_epi16(lowest, minimum));
+        best[x] = minimumSse41(candidates);
+    }
+}
+
+static const Kernels SSE41_KERNELS = {
+    censusRowGeneric, costRowGeneric, aggregateHorizontalSse41, aggregateVerticalSse41, selectRowSse41
+};
+
+//
+// AVX2: census of 32 pixels per iteration, the bits of 8 neighbours are collected in a byte of each pixel
+// and the 8 bytes transposed to 64-bit words. Hamming distances of 4 disparities per vector by a lookup of
+// the bits of each nibble. Path costs of 16 disparities per vector, shifted like SSE4.1 across the 128-bit lanes
+//
+
+__attribute__((target("avx2")))
+static void censusRowAvx2(const uint8_t *const rows[CENSUS_HEIGHT], uint32_t width, uint64_t *census) {
+    // bytes are compared as signed
+    __m256i bias = _mm256_set1_epi8(char(0x80));
+    uint32_t x = CENSUS_RADIUS_X;
+
+    for(; x + 32 + CENSUS_RADIUS_X <= width; x += 32) {
+        __m256i center = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(rows[CENSUS_RADIUS_Y] + x)), bias);
+        __m256i bytes[8];
+        for(int i = 0; i < 8; i++) {
+            bytes[i] = _mm256_setzero_si256();
+        }
+
+        int bit = 0;
+        for(int dy = 0; dy < CENSUS_HEIGHT; dy++) {
+            for(int dx = -CENSUS_RADIUS_X; dx <= CENSUS_RADIUS_X; dx++) {
+                if(dy == CENSUS_RADIUS_Y && dx == 0) {
+                    continue;
+                }
+                __m256i neighbour = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(rows[dy] + x + dx)), bias);
+                __m256i darker = _mm256_cmpgt_epi8(center, neighbour);
+                bytes[bit >> 3] = _mm256_or_si256(bytes[bit >> 3],
+                    _mm256_and_si256(darker, _mm256_set1_epi8(char(1 << (bit & 7)))));
+                bit++;
+            }
+        }
+
+        // byte pairs of pixels 0-7 | 16-23 and 8-15 | 24-31, then quads of pixels 0-3, 4-7, 8-11, 12-15 | + 16
+        __m256i pairs[8], quads[8], words[8];
+        for(int i = 0; i < 4; i++) {
+            pairs[2 * i] = _mm256_unpacklo_epi8(bytes[2 * i], bytes[2 * i + 1]);
+            pairs[2 * i + 1] = _mm256_unpackhi_epi8(bytes[2 * i], bytes[2 * i + 1]);
+        }
+        for(int i = 0; i < 2; i++) {
+            for(int half = 0; half < 2; half++) {
+                __m256i low = pairs[4 * i + half];
+                __m256i high = pairs[4 * i + 2 + half];
+                quads[4 * i + 2 * half] = _mm256_unpacklo_epi16(low, high);
+                quads[4 * i + 2 * half + 1] = _mm256_unpackhi_epi16(low, high);
+            }
+        }
+        // words of pixels 0, 1 | 16, 17 and 2, 3 | 18, 19 of each quad
+        for(int i = 0; i < 4; i++) {
+            words[2 * i] = _mm256_unpacklo_epi32(quads[i], quads[4 + i]);
+            words[2 * i + 1] = _mm256_unpackhi_epi32(quads[i], quads[4 + i]);
+        }
+        for(int i = 0; i < 4; i++) {
+            _mm256_storeu_si256((__m256i *)(census + x + 4 * i),
+                _mm256_permute2x128_si256(words[2 * i], words[2 * i + 1], 0x20));
+            _mm256_storeu_si256((__m256i *)(census + x + 16 + 4 * i),
+                _mm256_permute2x128_si256(words[2 * i], words[2 * i + 1], 0x31));
+        }
+    }
+
+    censusGeneric(rows, 0, std::min<uint32_t>(CENSUS_RADIUS_X, width), width, census);
+    censusGeneric(rows, std::max<uint32_t>(x, CENSUS_RADIUS_X), width, width, census);
+}
+
+// bits of the 4 words of census, in the low 16 bits of each 64-bit lane
+__attribute__((target("avx2")))
+static inline __m256i popcountAvx2(__m256i v) {
+    __m256i nibbles = _mm256_set1_epi8(0x0f);
+    __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    __m256i low = _mm256_shuffle_epi8(table, _mm256_and_si256(v, nibbles));
+    __m256i high = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibbles));
+    return _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2")))
+static void costRowAvx2(const uint64_t *left, const uint64_t *right, uint32_t width, uint32_t disparities,
+    uint16_t *cost) {
+
+    // pixels left of the last disparity have invalid costs
+    uint32_t x = std::min(disparities - 1, width);
+    costGeneric(left, right, 0, x, disparities, cost);
+
+    // words of disparities 0-1, 4-5, 8-9, 12-13 | 2-3, 6-7, 10-11, 14-15 after packing to 16 bits
+    __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    for(; x < width; x++) {
+        __m256i center = _mm256_set1_epi64x(int64_t(left[x]));
+        uint16_t *block = cost + size_t(x) * disparities;
+        for(uint32_t d = 0; d < disparities; d += 16) {
+            // right pixels x - d - 3 to x - d, reversed to disparities d to d + 3
+            __m256i counts[4];
+            for(int i = 0; i < 4; i++) {
+                __m256i words = _mm256_loadu_si256((const __m256i *)(right + x - d - 4 * i - 3));
+                words = _mm256_permute4x64_epi64(words, 0x1b);
+                counts[i] = popcountAvx2(_mm256_xor_si256(words, center));
+            }
+            __m256i low = _mm256_packus_epi32(counts[0], counts[1]);
+            __m256i high = _mm256_packus_epi32(counts[2], counts[3]);
+            __m256i packed = _mm256_permutevar8x32_epi32(_mm256_packus_epi32(low, high), order);
+            _mm256_storeu_si256((__m256i *)(block + d), packed);
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static inline uint16_t minimumAvx2(__m256i v) {
+    __m128i m = _mm_min_epu16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    return uint16_t(_mm_extract_epi16(_mm_minpos_epu16(m), 0));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i pathStepAvx2(__m256i cost, __m256i before, __m256i cur, __m256i after,
+    __m256i penalty1, __m256i jump, __m256i base) {
+
+    __m256i lower = _mm256_alignr_epi8(cur, _mm256_permute2x128_si256(before, cur, 0x21), 14);
+    __m256i upper = _mm256_alignr_epi8(_mm256_permute2x128_si256(cur, after, 0x21), cur, 2);
+    __m256i step = _mm256_adds_epu16(_mm256_min_epu16(lower, upper), penalty1);
+    __m256i best = _mm256_min_epu16(_mm256_min_epu16(cur, step), jump);
+    return _mm256_add_epi16(cost, _mm256_sub_epi16(best, base));
+}
+
+__attribute__((target("avx2")))
+static uint16_t pathAvx2(const uint16_t *cost, const uint16_t *prev, uint16_t prevMin, uint32_t disparities,
+    __m256i penalty1, uint16_t penalty2, uint16_t *out, uint16_t *sum) {
+
+    __m256i guard = _mm256_set1_epi16(short(PATH_GUARD));
+    __m256i jump = _mm256_set1_epi16(short(prevMin + penalty2));
+    __m256i base = _mm256_set1_epi16(short(prevMin));
+    __m256i outMin = _mm256_set1_epi16(-1);
+    __m256i before = guard;
+    __m256i cur = _mm256_loadu_si256((const __m256i *) prev);
+
+    for(uint32_t d = 0; d < disparities; d += 16) {
+        __m256i after = d + 16 < disparities ? _mm256_loadu_si256((const __m256i *)(prev + d + 16)) : guard;
+        __m256i value = pathStepAvx2(_mm256_loadu_si256((const __m256i *)(cost + d)), before, cur, after,
+            penalty1, jump, base);
+        _mm256_storeu_si256((__m256i *)(out + d), value);
+        _mm256_storeu_si256((__m256i *)(sum + d), _mm256_add_epi16(_mm256_loadu_si256((const __m256i *)(sum + d)), value));
+        outMin = _mm256_min_epu16(outMin, value);
+        before = cur;
+        cur = after;
+    }
+    return minimumAvx2(outMin);
+}
+
+__attribute__((target("avx2")))
+static void aggregateHorizontalAvx2(const uint16_t *cost, uint32_t width, uint32_t disparities,
+    uint16_t penalty1, uint16_t penalty2, uint16_t *sum) {
+
+    __m256i p1 = _mm256_set1_epi16(short(penalty1));
+    alignas(32) uint16_t paths[2][2][MAX_DISPARITIES] = {};
+    uint16_t prevMin[2] = {0, 0};
+    for(uint32_t i = 0; i < width; i++) {
+        size_t forward = size_t(i) * disparities;
+        size_t backward = size_t(width - 1 - i) * disparities;
+        prevMin[0] = pathAvx2(cost + forward, paths[0][i & 1], prevMin[0], disparities, p1, penalty2,
+            paths[0][(i + 1) & 1], sum + forward);
+        prevMin[1] = pathAvx2(cost + backward, paths[1][i & 1], prevMin[1], disparities, p1, penalty2,
+            paths[1][(i + 1) & 1], sum + backward);
+    }
+}
+
+// the 3 paths of a pixel share the loads of its costs and sums
+__attribute__((target("avx2")))
+static void aggregateVerticalAvx2(const uint16_t *cost, uint32_t width, uint32_t disparities,
+    uint16_t penalty1, uint16_t penalty2, const uint16_t *prevPaths, const uint16_t *prevMins,
+    uint16_t *paths, uint16_t *mins, uint16_t *sum) {
+
+    __m256i p1 = _mm256_set1_epi16(short(penalty1));
+    __m256i guard = _mm256_set1_epi16(short(PATH_GUARD));
+    size_t run = size_t(width + 2);
+
+    for(uint32_t x = 0; x < width; x++) {
+        const uint16_t *costs = cost + size_t(x) * disparities;
+        uint16_t *sums = sum + size_t(x) * disparities;
+
+        const uint16_t *prev[VERTICAL_PATHS];
+        uint16_t *out[VERTICAL_PATHS];
+        __m256i jump[VERTICAL_PATHS], base[VERTICAL_PATHS], outMin[VERTICAL_PATHS];
+        for(uint32_t r = 0; r < VERTICAL_PATHS; r++) {
+            size_t block = r * run + x + 1;
+            size_t prevBlock = block + VERTICAL_OFFSETS[r];
+            prev[r] = prevPaths + prevBlock * disparities;
+            out[r] = paths + block * disparities;
+            jump[r] = _mm256_set1_epi16(short(prevMins[prevBlock] + penalty2));
+            base[r] = _mm256_set1_epi16(short(prevMins[prevBlock]));
+            outMin[r] = _mm256_set1_epi16(-1);
+        }
+
+        // the previous row was stored long before, costs of d -+ 1 are loaded instead of shifted inside the block
+        for(uint32_t d = 0; d < disparities; d += 16) {
+            __m256i costVec = _mm256_loadu_si256((const __m256i *)(costs + d));
+            __m256i total = _mm256_loadu_si256((const __m256i *)(sums + d));
+            bool first = d == 0;
+            bool last = d + 16 == disparities;
+            for(uint32_t r = 0; r < VERTICAL_PATHS; r++) {
+                __m256i cur = _mm256_loadu_si256((const __m256i *)(prev[r] + d));
+                __m256i value;
+                if(first || last) {
+                    __m256i before = first ? guard : _mm256_loadu_si256((const __m256i *)(prev[r] + d - 16));
+                    __m256i after = last ? guard : _mm256_loadu_si256((const __m256i *)(prev[r] + d + 16));
+                    value = pathStepAvx2(costVec, before, cur, after, p1, jump[r], base[r]);
+                } else {
+                    __m256i lower = _mm256_loadu_si256((const __m256i *)(prev[r] + d - 1));
+                    __m256i upper = _mm256_loadu_si256((const __m256i *)(prev[r] + d + 1));
+                    __m256i step = _mm256_adds_epu16(_mm256_min_epu16(lower, upper), p1);
+                    __m256i best = _mm256_min_epu16(_mm256_min_epu16(cur, step), jump[r]);
+                    value = _mm256_add_epi16(costVec, _mm256_sub_epi16(best, base[r]));
+                }
+                _mm256_storeu_si256((__m256i *)(out[r] + d), value);
+                total = _mm256_add_epi16(total, value);
+                outMin[r] = _mm256_min_epu16(outMin[r], value);
+            }
+            _mm256_storeu_si256((__m256i *)(sums + d), total);
+        }
+
+        for(uint32_t r = 0; r < VERTICAL_PATHS; r++) {
+            mins[r * run + x + 1] = minimumAvx2(outMin[r]);
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static void selectRowAvx2(const uint16_t *sum, uint32_t width, uint32_t disparities, uint16_t *best,
+    uint16_t *rightCost, uint16_t *rightDisparity) {
+
+    __m256i step = _mm256_set1_epi16(16);
+    for(uint32_t x = 0; x < width; x++) {
+        const uint16_t *block = sum + size_t(x) * disparities;
+        uint16_t *cost = rightCost + (width - 1 - x);
+        uint16_t *disparity = rightDisparity + (width - 1 - x);
+
+        __m256i lowest = _mm256_set1_epi16(short(PATH_GUARD));
+        __m256i lowestIndex = _mm256_setzero_si256();
+        __m256i index = _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        for(uint32_t d = 0; d < disparities; d += 16) {
+            __m256i value = _mm256_loadu_si256((const __m256i *)(block + d));
+            lowestIndex = _mm256_blendv_epi8(lowestIndex, index, _mm256_cmpgt_epi16(lowest, value));
+            lowest = _mm256_min_epi16(lowest, value);
+
+            __m256i right = _mm256_loadu_si256((const __m256i *)(cost + d));
+            __m256i rightIndex = _mm256_loadu_si256((const __m256i *)(disparity + d));
+            _mm256_storeu_si256((__m256i *)(disparity + d),
+                _mm256_blendv_epi8(rightIndex, index, _mm256_cmpgt_epi16(right, value)));
+            _mm256_storeu_si256((__m256i *)(cost + d), _mm256_min_epi16(right, value));
+            index = _mm256_add_epi16(index, step);
+        }
+
+        __m256i minimum = _mm256_set1_epi16(short(minimumAvx2(lowest)));
+        __m256i candidates = _mm256_blendv_epi8(_mm256_set1_epi16(-1), lowestIndex, _mm256_cmpeq_epi16(lowest, minimum));
+        best[x] = minimumAvx2(candidates);
+    }
+}
+
+static const Kernels AVX2_KERNELS = {
+    censusRowAvx2, costRowAvx2, aggregateHorizontalAvx2, aggregateVerticalAvx2, selectRowAvx2
+};
+
+#endif // SPARK_CPU_X86
+
+const Kernels& kernelsOf(cpu::Level level) {
+#if defined(SPARK_CPU_X86)
+    if(level == cpu::LEVEL_AVX2) {
+        return AVX2_KERNELS;
+    }
+    if(level == cpu::LEVEL_SSE41) {
+        return SSE41_KERNELS;
+    }
+#endif
+    (void) level;
+    return GENERIC_KERNELS;
+}
+
+} // namespace sgm
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,122 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <stdint.h>
+
+#include <libsparkproto/cpufeatures.h>
+
+namespace libspark {
+
+namespace protocol {
+
+namespace sgm {
+
+// census window, the bits of the 62 neighbours of the center fit a 64-bit word
+static constexpr int CENSUS_WIDTH = 9;
+static constexpr int CENSUS_HEIGHT = 7;
+static constexpr uint16_t CENSUS_BITS = CENSUS_WIDTH * CENSUS_HEIGHT - 1;
+
+// cost of disparities which point outside of the right image
+static constexpr uint16_t COST_INVALID = CENSUS_BITS;
+
+// path costs beyond the disparities searched, large enough to never be the minimum
+static constexpr uint16_t PATH_GUARD = 0x7fff;
+
+// disparities are searched in blocks of SIMD lanes
+static constexpr uint32_t DISPARITY_STEP = 16;
+static constexpr uint32_t MAX_DISPARITIES = 256;
+
+// directions of the paths from the previous row: top, top left, top right
+static constexpr uint32_t VERTICAL_PATHS = 3;
+
+/**
+ * @brief Kernels of a level of SIMD, see kernelsOf().
+ *
+ * Costs of a pixel are blocks of disparities values, and each path adds to the block of the pixel in sum:
+ * cost[d] + min(prev[d], prev[d -+ 1] + penalty1, min(prev) + penalty2) - min(prev) of the previous pixel prev
+ * along the path. Paths start with a previous pixel of 0 costs.
+ *
+ */
+struct Kernels {
+    /**
+     * @brief Census of the pixels of a row, bits are set where a neighbour is darker than the center
+     *
+     * @param rows the CENSUS_HEIGHT rows of the window around the row, rows outside of the image clamped to the border
+     * @param width
+     * @param census width words
+     */
+    void (*censusRow)(const uint8_t *const rows[CENSUS_HEIGHT], uint32_t width, uint64_t *census);
+
+    /**
+     * @brief Hamming distances of the census of each pixel of the left row to the pixels of the right row
+     * disparities to the left, COST_INVALID for pixels left of the right image
+     *
+     * @param left
+     * @param right
+     * @param width
+     * @param disparities
+     * @param cost width blocks
+     */
+    void (*costRow)(const uint64_t *left, const uint64_t *right, uint32_t width, uint32_t disparities, uint16_t *cost);
+
+    /**
+     * @brief Add the paths left to right and right to left of a row to sum
+     *
+     * @param cost width blocks
+     * @param width
+     * @param disparities
+     * @param penalty1
+     * @param penalty2
+     * @param sum width blocks
+     */
+    void (*aggregateHorizontal)(const uint16_t *cost, uint32_t width, uint32_t disparities,
+        uint16_t penalty1, uint16_t penalty2, uint16_t *sum);
+
+    /**
+     * @brief Add the paths from the previous row to sum. Paths of a row are VERTICAL_PATHS runs of width + 2 blocks,
+     * the block of pixel x at x + 1 and the border blocks of 0 costs
+     *
+     * @param cost width blocks
+     * @param width
+     * @param disparities
+     * @param penalty1
+     * @param penalty2
+     * @param prevPaths paths of the previous row
+     * @param prevMins minimum of each block of prevPaths
+     * @param paths paths of the row, border blocks are not written
+     * @param mins minimum of each block of paths
+     * @param sum width blocks
+     */
+    void (*aggregateVertical)(const uint16_t *cost, uint32_t width, uint32_t disparities,
+        uint16_t penalty1, uint16_t penalty2, const uint16_t *prevPaths, const uint16_t *prevMins,
+        uint16_t *paths, uint16_t *mins, uint16_t *sum);
+
+    /**
+     * @brief Disparity of the lowest aggregated cost of each pixel, the first of equal costs, and the lowest cost
+     * and its disparity of each pixel xr of the right image over the left pixels xr + d, the first of equal costs.
+     * Aggregated costs are below PATH_GUARD
+     *
+     * @param sum width blocks
+     * @param width
+     * @param disparities
+     * @param best width disparities
+     * @param rightCost width + disparities values of PATH_GUARD, the right pixel xr at width - 1 - xr
+     * @param rightDisparity width + disparities values, the right pixel xr at width - 1 - xr
+     */
+    void (*selectRow)(const uint16_t *sum, uint32_t width, uint32_t disparities, uint16_t *best,
+        uint16_t *rightCost, uint16_t *rightDisparity);
+};
+
+/**
+ * @brief Kernels of a level, results are identical for all levels
+ *
+ * @param level
+ * @return const Kernels&
+ */
+const Kernels& kernelsOf(cpu::Level level);
+
+} // namespace sgm
+} // namespace protocol
+} // namespace libspark
@@ -10,6 +10,30 @@
 #include <libsparkproto/deviceinfo.h>
 #include <libsparkproto/deviceenumeration.h>
 #include <libsparkproto/deviceparamconfigure.h>
+#include <libsparkproto/parameterregistry.h>
+#include <libsparkproto/iparametersource.h>
+#include <libsparkproto/parameterbatch.h>
+#include <libsparkproto/parametersimulator.h>
+#include <libsparkproto/parameterprofile.h>
+#include <libsparkproto/parameterwriter.h>
+#include <libsparkproto/parametersession.h>
+#include <libsparkproto/devicegroup.h>
 #include <libsparkproto/imagestream.h>
 #include <libsparkproto/iimageevent.h>
 #include <libsparkproto/asyncimagestream.h>
+#include <libsparkproto/iimagesource.h>
+#include <libsparkproto/imagerecorder.h>
+#include <libsparkproto/imageplayback.h>
+#include <libsparkproto/imageringrecorder.h>
+#include <libsparkproto/imagestreamarchiver.h>
+#include <libsparkproto/bayerprocessor.h>
+#include <libsparkproto/pixelconvert.h>
+#include <libsparkproto/pointcloud.h>
+#include <libsparkproto/calibration.h>
+#include <libsparkproto/stereorectifier.h>
+#include <libsparkproto/stereomatcher.h>
+#include <libsparkproto/disparityfilter.h>
+#include <libsparkproto/voxelgrid.h>
+#include <libsparkproto/tensorexport.h>
+#include <libsparkproto/imagestats.h>
+#include <libsparkproto/exposurecontrol.h>
@@ -0,0 +1,34 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <libsparkproto/stereomatcher.h>
+#include <libsparkproto/stereomatcherimpl.h>
+
+namespace libspark {
+
+namespace protocol {
+
+StereoMatcher::StereoMatcher(const StereoMatcherOptions &options)
+    : _pImpl(new StereoMatcherImpl(options)) {
+
+}
+
+StereoMatcher::~StereoMatcher() {
+
+}
+
+const StereoMatcherOptions& StereoMatcher::options() const {
+    return _pImpl->options();
+}
+
+void StereoMatcher::compute(const uint8_t *left, const uint8_t *right, uint32_t width, uint32_t height,
+    uint16_t *disparity) {
+    _pImpl->compute(left, right, width, height, disparity);
+}
+
+void StereoMatcher::compute(ImageSet &imgSet) {
+    _pImpl->compute(imgSet);
+}
+
+} // namespace protocol
+} // namespace libspark
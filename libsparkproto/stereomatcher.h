@@ -0,0 +1,100 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <libsparkproto/common.h>
+#include <libsparkproto/imageset.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class StereoMatcherImpl;
+
+/**
+ * @brief Options of StereoMatcher
+ *
+ */
+struct SPARK_API StereoMatcherOptions {
+    // number of disparities searched from 0, a multiple of 16 up to 256
+    uint32_t disparities = 64;
+
+    // penalties of a change of disparity between neighbouring pixels by 1 and by more, census costs are 0 to 62
+    uint16_t penalty1 = 8;
+    uint16_t penalty2 = 96;
+
+    // largest difference in pixels of the disparities of the left and right image, negative to skip the check
+    int32_t maxLeftRightDiff = 1;
+
+    // number of threads an image is split across in stripes, 0 for the number of CPU cores, 1 to run in the calling thread
+    uint32_t threads = 0;
+};
+
+/**
+ * @brief StereoMatcher computes disparity of rectified left and right images with semi-global matching on the host.
+ *
+ * Pixels are matched by the hamming distance of their census in a 9x7 window, and the costs aggregated along
+ * 5 paths: left to right, right to left, top to bottom and the 2 diagonals down. The paths are aggregated in a single
+ * pass down the image, so no volume of costs is stored. Disparities are refined to 1/16 pixel with a parabola, and
+ * rejected if the disparity of the right image found from the same costs differs. The image is split into stripes of
+ * rows across threads, each stripe starting a few rows above to settle the paths down the image. Census, costs and
+ * paths use SSE4.1 or AVX2 when the CPU supports them, see libspark::protocol::cpu::dispatchLevel(), with results
+ * identical to the generic code.
+ *
+ * Disparities are 16 bits with 4 fractional bits, 0 where no disparity was found, the layout of disparity images of
+ * the device: set StereoIntrinsics::disparityScale to 1/16 for PointCloudGenerator.
+ *
+ * A StereoMatcher keeps scratch buffers between images, it's not thread-safe. Use one per thread.
+ *
+ */
+class SPARK_API StereoMatcher {
+
+public:
+    /**
+     * @brief Construct a new StereoMatcher object. If the options are invalid, a exception is thrown
+     *
+     * @param options
+     */
+    explicit StereoMatcher(const StereoMatcherOptions &options = StereoMatcherOptions());
+
+    /**
+     * @brief Destroy the StereoMatcher object
+     *
+     */
+    virtual ~StereoMatcher();
+
+    /**
+     * @brief Options of the matcher
+     *
+     * @return const StereoMatcherOptions&
+     */
+    const StereoMatcherOptions& options() const;
+
+    /**
+     * @brief Compute the disparity of gray images
+     *
+     * @param left width * height bytes, rectified
+     * @param right width * height bytes, rectified
+     * @param width
+     * @param height
+     * @param disparity width * height values
+     */
+    void compute(const uint8_t *left, const uint8_t *right, uint32_t width, uint32_t height, uint16_t *disparity);
+
+    /**
+     * @brief Compute the disparity of the left and right images of imgSet and set it as the disparity image.
+     * Images of FORMAT_GRAY are matched directly, others through their gray view, see ImageSet::view().
+     * Images must be rectified and of the same size, otherwise a exception is thrown
+     *
+     * @param imgSet
+     */
+    void compute(ImageSet &imgSet);
+
+private:
+    std::unique_ptr<StereoMatcherImpl> _pImpl;
+};
+
+} // namespace protocol
+} // namespace libspark
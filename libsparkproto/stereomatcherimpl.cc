@@ -0,0 +1,223 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
+
+#include <libsparkproto/stereomatcherimpl.h>
+#include <libsparkproto/exception.h>
+
+namespace libspark {
+
+namespace protocol {
+
+// rows a stripe starts above its first row, for the vertical and diagonal paths to settle
+static constexpr uint32_t STRIPE_OVERLAP = 32;
+
+// stripes are not split below this, the overlap would outweigh the rows matched
+static constexpr uint32_t MIN_STRIPE_ROWS = 64;
+
+// disparities have 4 fractional bits
+static constexpr int SUBPIXEL_BITS = 4;
+
+StereoMatcherImpl::StereoMatcherImpl(const StereoMatcherOptions &options)
+    : _options(options), _kernels(sgm::kernelsOf(cpu::dispatchLevel())) {
+
+    if(!_options.disparities || _options.disparities % sgm::DISPARITY_STEP || _options.disparities > sgm::MAX_DISPARITIES) {
+        throw SparkError("number of disparities must be a multiple of " + std::to_string(sgm::DISPARITY_STEP) +
+            " up to " + std::to_string(sgm::MAX_DISPARITIES) + ", got " + std::to_string(_options.disparities));
+    }
+    // 5 paths of costs up to 62 + penalty2 fit the 15 bits of aggregated costs
+    if(!_options.penalty1 || _options.penalty1 >= _options.penalty2 || _options.penalty2 > 1000) {
+        throw SparkError("penalties must be 0 < penalty1 < penalty2 <= 1000, got " +
+            std::to_string(_options.penalty1) + " and " + std::to_string(_options.penalty2));
+    }
+
+    uint32_t threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+    if(threads > 1) {
+        _pool.reset(new ThreadPool(threads));
+    }
+}
+
+StereoMatcherImpl::~StereoMatcherImpl() {
+
+}
+
+const StereoMatcherOptions& StereoMatcherImpl::options() const {
+    return _options;
+}
+
+void StereoMatcherImpl::compute(const uint8_t *left, const uint8_t *right, uint32_t width, uint32_t height,
+    uint16_t *disparity) {
+
+    if(!width || !height) {
+        throw SparkError("size of images " + std::to_string(width) + "x" + std::to_string(height) + " is invalid");
+    }
+
+    uint32_t stripes = 1;
+    if(_pool) {
+        stripes = std::max(1u, std::min(_pool->threadCount(), height / MIN_STRIPE_ROWS));
+    }
+    if(_scratch.size() < stripes) {
+        _scratch.resize(stripes);
+    }
+
+    auto run = [&](uint32_t begin, uint32_t end) {
+        for(uint32_t i = begin; i < end; i++) {
+            uint32_t y0 = uint32_t(uint64_t(height) * i / stripes);
+            uint32_t y1 = uint32_t(uint64_t(height) * (i + 1) / stripes);
+            matchStripe(left, right, width, height, y0, y1, disparity, _scratch[i]);
+        }
+    };
+
+    if(_pool && stripes > 1) {
+        _pool->parallelFor(stripes, 1, run);
+    } else {
+        run(0, stripes);
+    }
+}
+
+void StereoMatcherImpl::compute(ImageSet &imgSet) {
+    if(!imgSet.hasLeft() || !imgSet.hasRight()) {
+        throw SparkError("the ImageSet has no left and right images to match");
+    }
+    const ImageMeta &leftMeta = imgSet.meta().left();
+    const ImageMeta &rightMeta = imgSet.meta().right();
+    uint32_t width = leftMeta.width();
+    uint32_t height = leftMeta.height();
+    if(rightMeta.width() != leftMeta.width() || rightMeta.height() != leftMeta.height()) {
+        throw SparkError("size of left image " + std::to_string(width) + "x" + std::to_string(height) +
+            " does not match the right image " + std::to_string(rightMeta.width()) + "x" +
+            std::to_string(rightMeta.height()));
+    }
+
+    // gray planes are matched in place, others converted by their view
+    std::shared_ptr<const ImageView> views[2];
+    const uint8_t *planes[2];
+    ImageSet::BufferID ids[2] = {ImageSet::BUFFER_LEFT, ImageSet::BUFFER_RIGHT};
+    const ImageMeta *metas[2] = {&leftMeta, &rightMeta};
+    size_t pixels = size_t(width) * height;
+    for(int i = 0; i < 2; i++) {
+        const ImageSet::Buffer &buff = imgSet.getBuffer(ids[i]);
+        if(metas[i]->format() == FORMAT_GRAY) {
+            if(buff.size() < pixels) {
+                throw SparkError("buffer of the image is smaller than its size in ImageMeta");
+            }
+            planes[i] = buff.data();
+            continue;
+        }
+        views[i] = imgSet.view(ids[i], PIXEL_GRAY8);
+        if(views[i]->stride != width) {
+            throw SparkError("gray view of the image is not contiguous");
+        }
+        planes[i] = views[i]->data.data();
+    }
+
+    _out.resize(pixels * 2);
+    compute(planes[0], planes[1], width, height, (uint16_t *) _out.data());
+    views[0].reset();
+    views[1].reset();
+
+    std::unique_ptr<ImageSetMeta> meta = std::make_unique<ImageSetMeta>(imgSet.meta());
+    ImageMeta *disparityMeta = meta->mutable_disparity();
+    disparityMeta->set_id(leftMeta.id());
+    disparityMeta->set_width(int32_t(width));
+    disparityMeta->set_height(int32_t(height));
+    disparityMeta->set_buffsize(int32_t(_out.size()));
+    disparityMeta->set_timestamp(leftMeta.timestamp());
+    disparityMeta->set_format(FORMAT_UNKNOWN);
+
+    imgSet.getMutableBuffer(ImageSet::BUFFER_DISPARITY).swap(_out);
+    uint64_t receiveTimestamp = imgSet.receiveTimestamp();
+    imgSet.setAllocatedMeta(std::move(meta));
+    imgSet.setReceiveTimestamp(receiveTimestamp);
+}
+
+void StereoMatcherImpl::matchStripe(const uint8_t *left, const uint8_t *right, uint32_t width, uint32_t height,
+    uint32_t y0, uint32_t y1, uint16_t *disparity, Scratch &scratch) {
+
+    uint32_t disparities = _options.disparities;
+    size_t costs = size_t(width) * disparities;
+    size_t blocks = size_t(width + 2) * sgm::VERTICAL_PATHS;
+
+    scratch.census[0].resize(width);
+    scratch.census[1].resize(width);
+    scratch.cost.resize(costs);
+    scratch.sum.resize(costs);
+    // paths start from 0 costs above the stripe and at the borders
+    for(int i = 0; i < 2; i++) {
+        scratch.paths[i].assign(blocks * disparities, 0);
+        scratch.mins[i].assign(blocks, 0);
+    }
+
+    const uint8_t *images[2] = {left, right};
+    const uint8_t *rows[sgm::CENSUS_HEIGHT];
+    uint32_t start = y0 > STRIPE_OVERLAP ? y0 - STRIPE_OVERLAP : 0;
+
+    for(uint32_t y = start; y < y1; y++) {
+        for(int i = 0; i < 2; i++) {
+            for(int dy = 0; dy < sgm::CENSUS_HEIGHT; dy++) {
+                int row = std::min(std::max(int(y) + dy - sgm::CENSUS_HEIGHT / 2, 0), int(height) - 1);
+                rows[dy] = images[i] + size_t(row) * width;
+            }
+            _kernels.censusRow(rows, width, scratch.census[i].data());
+        }
+        _kernels.costRow(scratch.census[0].data(), scratch.census[1].data(), width, disparities, scratch.cost.data());
+
+        std::fill(scratch.sum.begin(), scratch.sum.end(), 0);
+        _kernels.aggregateHorizontal(scratch.cost.data(), width, disparities, _options.penalty1, _options.penalty2,
+            scratch.sum.data());
+        // paths of the previous row alternate with the current row
+        int prev = y & 1;
+        _kernels.aggregateVertical(scratch.cost.data(), width, disparities, _options.penalty1, _options.penalty2,
+            scratch.paths[prev].data(), scratch.mins[prev].data(), scratch.paths[prev ^ 1].data(),
+            scratch.mins[prev ^ 1].data(), scratch.sum.data());
+
+        if(y >= y0) {
+            selectRow(width, disparity + size_t(y) * width, scratch);
+        }
+    }
+}
+
+void StereoMatcherImpl::selectRow(uint32_t width, uint16_t *disparity, Scratch &scratch) {
+    uint32_t disparities = _options.disparities;
+
+    // lowest costs of the right pixels xr at width - 1 - xr, so the pixels x - d of a left pixel are consecutive
+    scratch.rightCost.assign(width + disparities, sgm::PATH_GUARD);
+    scratch.rightDisparity.assign(width + disparities, 0);
+    scratch.best.resize(width);
+    _kernels.selectRow(scratch.sum.data(), width, disparities, scratch.best.data(),
+        scratch.rightCost.data(), scratch.rightDisparity.data());
+
+    for(uint32_t x = 0; x < width; x++) {
+        int32_t d = scratch.best[x];
+        if(d > int32_t(x)) {
+            disparity[x] = 0;
+            continue;
+        }
+        if(_options.maxLeftRightDiff >= 0) {
+            int32_t rightDisparity = scratch.rightDisparity[width - 1 - (x - d)];
+            if(abs(rightDisparity - d) > _options.maxLeftRightDiff) {
+                disparity[x] = 0;
+                continue;
+            }
+        }
+
+        // vertex of the parabola through the costs around d, at most half a pixel away
+        int32_t value = d << SUBPIXEL_BITS;
+        if(d > 0 && d + 1 < int32_t(disparities)) {
+            const uint16_t *sum = scratch.sum.data() + size_t(x) * disparities + d;
+            int32_t curvature = sum[-1] - 2 * sum[0] + sum[1];
+            if(curvature > 0) {
+                int32_t slope = (sum[-1] - sum[1]) << (SUBPIXEL_BITS - 1);
+                value += (slope >= 0 ? slope + curvature / 2 : slope - curvature / 2) / curvature;
+            }
+        }
+        disparity[x] = uint16_t(value);
+    }
+}
+
+} // namespace protocol
+} // namespace libspark
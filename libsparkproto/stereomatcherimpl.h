@@ -0,0 +1,60 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <libsparkproto/stereomatcher.h>
+#include <libsparkproto/sgmkernels.h>
+#include <libsparkproto/threadpool.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class StereoMatcherImpl {
+
+public:
+    StereoMatcherImpl(const StereoMatcherOptions &options);
+
+    virtual ~StereoMatcherImpl();
+
+    const StereoMatcherOptions& options() const;
+
+    void compute(const uint8_t *left, const uint8_t *right, uint32_t width, uint32_t height, uint16_t *disparity);
+
+    void compute(ImageSet &imgSet);
+
+private:
+    // buffers of a stripe, see sgm::Kernels
+    struct Scratch {
+        std::vector<uint64_t> census[2];
+        std::vector<uint16_t> cost;
+        std::vector<uint16_t> sum;
+        // previous and current row of the vertical and diagonal paths
+        std::vector<uint16_t> paths[2];
+        std::vector<uint16_t> mins[2];
+        std::vector<uint16_t> rightCost;
+        std::vector<uint16_t> rightDisparity;
+        std::vector<uint16_t> best;
+    };
+
+    // match the rows [y0, y1), starting the paths above y0
+    void matchStripe(const uint8_t *left, const uint8_t *right, uint32_t width, uint32_t height,
+        uint32_t y0, uint32_t y1, uint16_t *disparity, Scratch &scratch);
+
+    // disparities of a row from the aggregated costs
+    void selectRow(uint32_t width, uint16_t *disparity, Scratch &scratch);
+
+    StereoMatcherOptions _options;
+    const sgm::Kernels &_kernels;
+    std::unique_ptr<ThreadPool> _pool;
+
+    // scratch, kept between images
+    std::vector<Scratch> _scratch;
+    ImageSet::Buffer _out;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,41 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <libsparkproto/stereorectifier.h>
+#include <libsparkproto/stereorectifierimpl.h>
+
+namespace libspark {
+
+namespace protocol {
+
+StereoRectifier::StereoRectifier(const StereoCalibration &calibration, const RectifierOptions &options)
+    : _pImpl(new StereoRectifierImpl(calibration, options)) {
+
+}
+
+StereoRectifier::~StereoRectifier() {
+
+}
+
+bool StereoRectifier::isFromCache() const {
+    return _pImpl->isFromCache();
+}
+
+uint32_t StereoRectifier::width() const {
+    return _pImpl->width();
+}
+
+uint32_t StereoRectifier::height() const {
+    return _pImpl->height();
+}
+
+void StereoRectifier::remap(ImageSet::BufferID id, const uint8_t *src, uint32_t channels, uint8_t *dst) {
+    _pImpl->remap(id, src, channels, dst);
+}
+
+void StereoRectifier::rectify(ImageSet &imgSet) {
+    _pImpl->rectify(imgSet);
+}
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,113 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <libsparkproto/common.h>
+#include <libsparkproto/calibration.h>
+#include <libsparkproto/imageset.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class StereoRectifierImpl;
+
+/**
+ * @brief Options of StereoRectifier
+ *
+ */
+struct SPARK_API RectifierOptions {
+    // directory of the cache of maps, empty for no cache
+    std::string cacheDir;
+
+    // name of the maps in the cache, e.g. DeviceInfoMessage::serialnum()
+    std::string serial;
+
+    // size of the images, 0 for the size of the calibration. Intrinsics are scaled to a different size, e.g. binned images
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    // number of threads an image is split across in tiles, 0 for the number of CPU cores, 1 to run in the calling thread
+    uint32_t threads = 0;
+};
+
+/**
+ * @brief StereoRectifier undistorts and rectifies left and right images with the calibration of the device.
+ *
+ * The maps from rectified pixels to pixels of the camera images are computed once in fixed point, 6 bytes per pixel,
+ * and stored in RectifierOptions::cacheDir as <serial>.sparkmap, so later instances of the same calibration load them
+ * instead. Maps of a different calibration or size in the cache are replaced. Images are remapped bilinearly in tiles
+ * across threads, with AVX2 gathers when the CPU supports them, see libspark::protocol::cpu::dispatchLevel().
+ * Pixels without a source in the camera image are black.
+ *
+ * A StereoRectifier keeps scratch buffers between images, it's not thread-safe. Use one per thread.
+ *
+ */
+class SPARK_API StereoRectifier {
+
+public:
+    /**
+     * @brief Construct a new StereoRectifier object, loading the maps from the cache or computing them.
+     * If the calibration or the size is invalid, a exception is thrown. A cache that can not be read or written
+     * is logged and skipped
+     *
+     * @param calibration
+     * @param options
+     */
+    explicit StereoRectifier(const StereoCalibration &calibration, const RectifierOptions &options = RectifierOptions());
+
+    /**
+     * @brief Destroy the StereoRectifier object
+     *
+     */
+    virtual ~StereoRectifier();
+
+    /**
+     * @brief Check if the maps were loaded from the cache
+     *
+     * @return true
+     * @return false
+     */
+    bool isFromCache() const;
+
+    /**
+     * @brief Width of the images
+     *
+     * @return uint32_t
+     */
+    uint32_t width() const;
+
+    /**
+     * @brief Height of the images
+     *
+     * @return uint32_t
+     */
+    uint32_t height() const;
+
+    /**
+     * @brief Remap an image of the left or right camera, src and dst must not overlap
+     *
+     * @param id left or right image
+     * @param src width * height * channels bytes
+     * @param channels 1 for gray or 3 for RGB
+     * @param dst width * height * channels bytes
+     */
+    void remap(ImageSet::BufferID id, const uint8_t *src, uint32_t channels, uint8_t *dst);
+
+    /**
+     * @brief Rectify the left and right images of imgSet in place. Images must be of FORMAT_GRAY or FORMAT_RGB
+     * with the size of the rectifier, otherwise a exception is thrown
+     *
+     * @param imgSet
+     */
+    void rectify(ImageSet &imgSet);
+
+private:
+    std::unique_ptr<StereoRectifierImpl> _pImpl;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,353 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+#include <libsparkproto/stereorectifierimpl.h>
+#include <libsparkproto/exception.h>
+#include <libsparkproto/log.h>
+
+namespace libspark {
+
+namespace protocol {
+
+// images are remapped in tiles of rows x columns, the source pixels of a tile stay in cache
+static constexpr uint32_t TILE_ROWS = 16;
+static constexpr uint32_t TILE_COLUMNS = 256;
+
+// version of the layout of the maps and of the cache file, older files are replaced
+static constexpr uint32_t MAP_VERSION = 1;
+static constexpr char CACHE_MAGIC[8] = {'S', 'P', 'K', 'R', 'M', 'A', 'P', '\0'};
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t reserved;
+    uint64_t key;
+};
+
+// FNV-1a
+static void hashBytes(uint64_t &hash, const void *data, size_t size) {
+    const uint8_t *p = (const uint8_t *) data;
+    for(size_t i = 0; i < size; i++) {
+        hash = (hash ^ p[i]) * 0x100000001b3ULL;
+    }
+}
+
+static void hashCamera(uint64_t &hash, const CameraCalibration &camera) {
+    hashBytes(hash, camera.K, sizeof(camera.K));
+    hashBytes(hash, camera.distortion.data(), camera.distortion.size() * sizeof(double));
+    hashBytes(hash, camera.R, sizeof(camera.R));
+    hashBytes(hash, camera.P, sizeof(camera.P));
+}
+
+// apply the distortion of a camera to a normalized point, see the OpenCV camera model
+static void distort(const std::vector<double> &k, double &x, double &y) {
+    if(k.empty()) {
+        return;
+    }
+    double r2 = x * x + y * y;
+    double radial = 1 + r2 * (k[0] + r2 * (k[1] + r2 * (k.size() > 4 ? k[4] : 0.0)));
+    if(k.size() == 8) {
+        radial /= 1 + r2 * (k[5] + r2 * (k[6] + r2 * k[7]));
+    }
+    double xd = x * radial + 2 * k[2] * x * y + k[3] * (r2 + 2 * x * x);
+    double yd = y * radial + k[2] * (r2 + 2 * y * y) + 2 * k[3] * x * y;
+    x = xd;
+    y = yd;
+}
+
+StereoRectifierImpl::StereoRectifierImpl(const StereoCalibration &calibration, const RectifierOptions &options)
+    : _options(options), _fromCache(false), _level(cpu::dispatchLevel()) {
+
+    if(!_options.width || !_options.height) {
+        _options.width = calibration.width;
+        _options.height = calibration.height;
+    }
+    if(_options.width < 2 || _options.height < 2 || _options.width > 32767 || _options.height > 32767) {
+        throw SparkError("size of rectified images " + std::to_string(_options.width) + "x" +
+            std::to_string(_options.height) + " is invalid, set it in the calibration or RectifierOptions");
+    }
+    if(!calibration.width || !calibration.height) {
+        throw SparkError("calibration has no image size");
+    }
+
+    uint32_t threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+    if(threads > 1) {
+        _pool.reset(new ThreadPool(threads));
+    }
+
+    uint64_t key = keyOf(calibration);
+    if(loadCache(key)) {
+        _fromCache = true;
+        return;
+    }
+
+    double sx = double(_options.width) / calibration.width;
+    double sy = double(_options.height) / calibration.height;
+    computeMap(calibration.left, sx, sy, _maps[0]);
+    computeMap(calibration.right, sx, sy, _maps[1]);
+    saveCache(key);
+}
+
+StereoRectifierImpl::~StereoRectifierImpl() {
+
+}
+
+bool StereoRectifierImpl::isFromCache() const {
+    return _fromCache;
+}
+
+uint32_t StereoRectifierImpl::width() const {
+    return _options.width;
+}
+
+uint32_t StereoRectifierImpl::height() const {
+    return _options.height;
+}
+
+void StereoRectifierImpl::remap(ImageSet::BufferID id, const uint8_t *src, uint32_t channels, uint8_t *dst) {
+    if(id != ImageSet::BUFFER_LEFT && id != ImageSet::BUFFER_RIGHT) {
+        throw SparkError("only left and right images can be rectified");
+    }
+    if(channels != 1 && channels != 3) {
+        throw SparkError("images of 1 or 3 channels can be rectified, got " + std::to_string(channels));
+    }
+
+    const remap::Map &map = _maps[id == ImageSet::BUFFER_LEFT ? 0 : 1];
+    size_t stride = size_t(map.width) * channels;
+    auto band = [&](uint32_t y0, uint32_t y1) {
+        for(uint32_t x0 = 0; x0 < map.width; x0 += TILE_COLUMNS) {
+            uint32_t x1 = std::min(x0 + TILE_COLUMNS, map.width);
+            for(uint32_t y = y0; y < y1; y++) {
+                remap::remapRow(map, y, x0, x1, src, channels, dst + y * stride, _level);
+            }
+        }
+    };
+
+    if(_pool) {
+        _pool->parallelFor(map.height, TILE_ROWS, band);
+    } else {
+        band(0, map.height);
+    }
+}
+
+void StereoRectifierImpl::rectify(ImageSet &imgSet) {
+    ImageSet::BufferID ids[2] = {ImageSet::BUFFER_LEFT, ImageSet::BUFFER_RIGHT};
+    bool present[2] = {imgSet.hasLeft(), imgSet.hasRight()};
+
+    for(int i = 0; i < 2; i++) {
+        if(!present[i]) {
+            continue;
+        }
+        const ImageMeta &meta = i == 0 ? imgSet.meta().left() : imgSet.meta().right();
+        if(meta.format() != FORMAT_GRAY && meta.format() != FORMAT_RGB) {
+            throw SparkError("images of FORMAT_GRAY or FORMAT_RGB can be rectified");
+        }
+        if(meta.width() < 0 || meta.height() < 0 ||
+            uint32_t(meta.width()) != _options.width || uint32_t(meta.height()) != _options.height) {
+            throw SparkError("size of image " + std::to_string(meta.width()) + "x" + std::to_string(meta.height()) +
+                " does not match the rectifier " + std::to_string(_options.width) + "x" + std::to_string(_options.height));
+        }
+        uint32_t channels = meta.format() == FORMAT_RGB ? 3 : 1;
+        size_t size = size_t(meta.width()) * meta.height() * channels;
+        if(imgSet.getBuffer(ids[i]).size() < size) {
+            throw SparkError("buffer of the image is smaller than its size in ImageMeta");
+        }
+
+        ImageSet::Buffer &buff = imgSet.getMutableBuffer(ids[i]);
+        _out.resize(buff.size());
+        remap(ids[i], buff.data(), channels, _out.data());
+        buff.swap(_out);
+    }
+}
+
+void StereoRectifierImpl::computeMap(const CameraCalibration &camera, double sx, double sy, remap::Map &map) {
+    map.width = _options.width;
+    map.height = _options.height;
+    map.xy.resize(size_t(map.width) * map.height * 2);
+    map.frac.resize(size_t(map.width) * map.height);
+    map.spans.resize(size_t(map.height) * 2);
+
+    // scaling keeps the centers of pixels: (c + 0.5) * s - 0.5
+    double fx = camera.K[0] * sx;
+    double fy = camera.K[4] * sy;
+    double skew = camera.K[1] * sx;
+    double cx = (camera.K[2] + 0.5) * sx - 0.5;
+    double cy = (camera.K[5] + 0.5) * sy - 0.5;
+    double pfx = camera.P[0] * sx;
+    double pfy = camera.P[5] * sy;
+    double pcx = (camera.P[2] + 0.5) * sx - 0.5;
+    double pcy = (camera.P[6] + 0.5) * sy - 0.5;
+    if(fx == 0 || fy == 0 || pfx == 0 || pfy == 0) {
+        throw SparkError("focal length of the calibration is 0");
+    }
+    const double *R = camera.R;
+
+    auto band = [&](uint32_t y0, uint32_t y1) {
+        for(uint32_t v = y0; v < y1; v++) {
+            uint32_t first = map.width;
+            uint32_t last = 0;
+            for(uint32_t u = 0; u < map.width; u++) {
+                // rectified pixel to a ray of the rectified camera, rotated back to the camera by R^T
+                double x = (u - pcx) / pfx;
+                double y = (v - pcy) / pfy;
+                double X = R[0] * x + R[3] * y + R[6];
+                double Y = R[1] * x + R[4] * y + R[7];
+                double W = R[2] * x + R[5] * y + R[8];
+
+                bool inside = false;
+                size_t index = size_t(v) * map.width + u;
+                if(W > 0) {
+                    x = X / W;
+                    y = Y / W;
+                    distort(camera.distortion, x, y);
+                    inside = remap::setPixel(map, index, fx * x + skew * y + cx, fy * y + cy);
+                } else {
+                    remap::setPixel(map, index, 0, 0);
+                }
+                if(inside) {
+                    first = std::min(first, u);
+                    last = u;
+                }
+            }
+            map.spans[2 * v] = first;
+            map.spans[2 * v + 1] = first < map.width ? last + 1 : first;
+        }
+    };
+
+    if(_pool) {
+        _pool->parallelFor(map.height, TILE_ROWS, band);
+    } else {
+        band(0, map.height);
+    }
+}
+
+uint64_t StereoRectifierImpl::keyOf(const StereoCalibration &calibration) const {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    uint32_t sizes[5] = {MAP_VERSION, calibration.width, calibration.height, _options.width, _options.height};
+    hashBytes(hash, sizes, sizeof(sizes));
+    hashCamera(hash, calibration.left);
+    hashCamera(hash, calibration.right);
+    return hash;
+}
+
+std::string StereoRectifierImpl::cachePath() const {
+    if(_options.cacheDir.empty() || _options.serial.empty()) {
+        return std::string();
+    }
+    // the serial is a file name
+    std::string name = _options.serial;
+    for(char &c : name) {
+        if(!isalnum((unsigned char) c) && c != '-' && c != '_') {
+            c = '_';
+        }
+    }
+    return _options.cacheDir + "/" + name + ".sparkmap";
+}
+
+bool StereoRectifierImpl::loadCache(uint64_t key) {
+    std::string path = cachePath();
+    if(path.empty()) {
+        return false;
+    }
+    std::ifstream file(path, std::ios::binary);
+    if(!file.is_open()) {
+        return false;
+    }
+
+    CacheHeader header;
+    file.read((char *) &header, sizeof(header));
+    if(!file || memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) || header.version != MAP_VERSION ||
+        header.key != key || header.width != _options.width || header.height != _options.height) {
+        LOG_INFO("maps in %s are of a different calibration, computing them", path.c_str());
+        return false;
+    }
+
+    for(remap::Map &map : _maps) {
+        map.width = header.width;
+        map.height = header.height;
+        map.xy.resize(size_t(map.width) * map.height * 2);
+        map.frac.resize(size_t(map.width) * map.height);
+        map.spans.resize(size_t(map.height) * 2);
+        file.read((char *) map.xy.data(), map.xy.size() * sizeof(int16_t));
+        file.read((char *) map.frac.data(), map.frac.size() * sizeof(uint16_t));
+        file.read((char *) map.spans.data(), map.spans.size() * sizeof(uint32_t));
+    }
+    if(!file) {
+        LOG_WARNING("maps in %s are truncated, computing them", path.c_str());
+        return false;
+    }
+
+    // a damaged file must not make the remap read outside of the images
+    for(const remap::Map &map : _maps) {
+        for(size_t i = 0; i < map.frac.size(); i++) {
+            if(map.xy[2 * i] < 0 || uint32_t(map.xy[2 * i]) > map.width - 2 ||
+                map.xy[2 * i + 1] < 0 || uint32_t(map.xy[2 * i + 1]) > map.height - 2 ||
+                (map.frac[i] & remap::FRAC_MASK) > remap::FRAC_ONE || (map.frac[i] >> remap::FRAC_Y_SHIFT) > remap::FRAC_ONE) {
+                LOG_WARNING("maps in %s are damaged, computing them", path.c_str());
+                return false;
+            }
+        }
+        for(uint32_t v = 0; v < map.height; v++) {
+            if(map.spans[2 * v] > map.spans[2 * v + 1] || map.spans[2 * v + 1] > map.width) {
+                LOG_WARNING("maps in %s are damaged, computing them", path.c_str());
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void StereoRectifierImpl::saveCache(uint64_t key) const {
+    std::string path = cachePath();
+    if(path.empty()) {
+        return;
+    }
+
+    CacheHeader header = {};
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = MAP_VERSION;
+    header.width = _options.width;
+    header.height = _options.height;
+    header.key = key;
+
+    // written to a temporary file and renamed, so other processes never read a partial file
+    std::string tmpPath = path + ".tmp" +
+        std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if(!file.is_open()) {
+            LOG_WARNING("can not write maps to %s", tmpPath.c_str());
+            return;
+        }
+        file.write((const char *) &header, sizeof(header));
+        for(const remap::Map &map : _maps) {
+            file.write((const char *) map.xy.data(), map.xy.size() * sizeof(int16_t));
+            file.write((const char *) map.frac.data(), map.frac.size() * sizeof(uint16_t));
+            file.write((const char *) map.spans.data(), map.spans.size() * sizeof(uint32_t));
+        }
+        file.flush();
+        if(!file) {
+            LOG_WARNING("can not write maps to %s", tmpPath.c_str());
+            file.close();
+            remove(tmpPath.c_str());
+            return;
+        }
+    }
+    if(rename(tmpPath.c_str(), path.c_str())) {
+        LOG_WARNING("can not rename maps to %s", path.c_str());
+        remove(tmpPath.c_str());
+    }
+}
+
+} // namespace protocol
+} // namespace libspark
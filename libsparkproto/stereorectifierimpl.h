@@ -0,0 +1,59 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <libsparkproto/stereorectifier.h>
+#include <libsparkproto/remapkernels.h>
+#include <libsparkproto/threadpool.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class StereoRectifierImpl {
+
+public:
+    StereoRectifierImpl(const StereoCalibration &calibration, const RectifierOptions &options);
+
+    virtual ~StereoRectifierImpl();
+
+    bool isFromCache() const;
+
+    uint32_t width() const;
+
+    uint32_t height() const;
+
+    void remap(ImageSet::BufferID id, const uint8_t *src, uint32_t channels, uint8_t *dst);
+
+    void rectify(ImageSet &imgSet);
+
+private:
+    // map of the pixels of a camera from its calibration, with intrinsics scaled by sx, sy
+    void computeMap(const CameraCalibration &camera, double sx, double sy, remap::Map &map);
+
+    // hash of the calibration and size the maps are computed for
+    uint64_t keyOf(const StereoCalibration &calibration) const;
+
+    std::string cachePath() const;
+
+    bool loadCache(uint64_t key);
+
+    void saveCache(uint64_t key) const;
+
+    RectifierOptions _options;
+    bool _fromCache;
+    cpu::Level _level;
+    std::unique_ptr<ThreadPool> _pool;
+
+    // left, right
+    remap::Map _maps[2];
+
+    // scratch of rectify(), kept between images
+    ImageSet::Buffer _out;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,48 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <libsparkproto/tensorexport.h>
+#include <libsparkproto/tensorexportimpl.h>
+
+namespace libspark {
+
+namespace protocol {
+
+TensorExporter::TensorExporter(const TensorOptions &options)
+    : _pImpl(new TensorExporterImpl(options)) {
+
+}
+
+TensorExporter::~TensorExporter() {
+
+}
+
+const TensorOptions& TensorExporter::options() const {
+    return _pImpl->options();
+}
+
+TensorShape TensorExporter::shapeOf(const ImageSet &imgSet, ImageSet::BufferID id, uint32_t batch) const {
+    return _pImpl->shapeOf(imgSet, id, batch);
+}
+
+TensorTransform TensorExporter::exportImage(const uint8_t *src, size_t srcStride, PixelFormat srcFormat,
+    uint32_t width, uint32_t height, void *dst, size_t capacity) {
+
+    return _pImpl->exportImage(src, srcStride, srcFormat, width, height, dst, capacity);
+}
+
+TensorTransform TensorExporter::exportImage(const ImageSet &imgSet, ImageSet::BufferID id, void *dst, size_t capacity) {
+    TensorTransform transform;
+    const ImageSet *imgSets[1] = {&imgSet};
+    _pImpl->exportBatch(imgSets, 1, id, dst, capacity, &transform);
+    return transform;
+}
+
+void TensorExporter::exportBatch(const ImageSet *const *imgSets, uint32_t count, ImageSet::BufferID id,
+    void *dst, size_t capacity, TensorTransform *transforms) {
+
+    _pImpl->exportBatch(imgSets, count, id, dst, capacity, transforms);
+}
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,177 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <libsparkproto/common.h>
+#include <libsparkproto/imageset.h>
+#include <libsparkproto/pixelformat.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class TensorExporterImpl;
+
+/**
+ * @brief Type of the elements of a tensor
+ *
+ */
+enum TensorType {
+    TENSOR_FLOAT32 = 0,
+    // normalized values divided by quantScale, rounded, plus zeroPoint, saturated to [-128, 127]
+    TENSOR_INT8 = 1
+};
+
+/**
+ * @brief Options of TensorExporter. Each element is (value * inputScale - mean[c]) / std[c] of the bilinearly
+ * resized pixel value, c the channel of the tensor
+ *
+ */
+struct SPARK_API TensorOptions {
+    // size of the tensor, 0 for the size of the images
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    // keep the aspect ratio of the images when resizing, centered and padded with padValue.
+    // false stretches the images to the tensor
+    bool letterbox = true;
+    // 8-bit pixel value of the padding
+    uint8_t padValue = 0;
+
+    // order of the channels of color images in the tensor, RGB or BGR
+    bool bgr = false;
+
+    float inputScale = 1.0f / 255.0f;
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    float std[3] = {1.0f, 1.0f, 1.0f};
+
+    TensorType type = TENSOR_FLOAT32;
+    // TENSOR_INT8 only
+    float quantScale = 1.0f / 128.0f;
+    int32_t zeroPoint = 0;
+
+    // number of threads a batch is split across in bands of rows, 0 for the number of CPU cores,
+    // 1 to run in the calling thread
+    uint32_t threads = 0;
+};
+
+/**
+ * @brief Shape of a tensor in NCHW order
+ *
+ */
+struct SPARK_API TensorShape {
+    uint32_t batch = 0;
+    // 3 for color images, 1 for gray images
+    uint32_t channels = 0;
+    uint32_t height = 0;
+    uint32_t width = 0;
+    // size of the tensor in bytes
+    size_t bytes = 0;
+};
+
+/**
+ * @brief Placement of an image in the tensor, a point (x, y) of the image in pixels is at
+ * (x * scaleX + offsetX, y * scaleY + offsetY) in the tensor, e.g. to map detections back to the image
+ *
+ */
+struct SPARK_API TensorTransform {
+    float scaleX = 1.0f;
+    float scaleY = 1.0f;
+    float offsetX = 0.0f;
+    float offsetY = 0.0f;
+};
+
+/**
+ * @brief TensorExporter writes images to NCHW tensors for inference, resized, normalized and quantized
+ * in a single pass over each image. Rows of the tensor are resampled from the rows of the image they need,
+ * then blended, normalized and stored to each plane by SIMD kernels when the CPU supports them,
+ * see libspark::protocol::cpu::dispatchLevel(). A batch, e.g. the images of several cameras,
+ * is split across threads in bands of rows.
+ *
+ * Images are 8-bit RGB, BGR or gray of at least 2x2 pixels, the images of a batch are all color or all gray.
+ * Bayer images must be converted with BayerProcessor first. The sampling tables and scratch buffers
+ * are kept between batches of the same size, it's not thread-safe. Use one per thread.
+ *
+ */
+class SPARK_API TensorExporter {
+
+public:
+    /**
+     * @brief Construct a new TensorExporter object. If options are invalid, a exception is thrown
+     *
+     * @param options
+     */
+    explicit TensorExporter(const TensorOptions &options = TensorOptions());
+
+    /**
+     * @brief Destroy the TensorExporter object
+     *
+     */
+    virtual ~TensorExporter();
+
+    /**
+     * @brief Options of the exporter
+     *
+     * @return const TensorOptions&
+     */
+    const TensorOptions& options() const;
+
+    /**
+     * @brief Shape of the tensor of a batch of images like the image id of imgSet.
+     * If imgSet has no such image, a exception is thrown
+     *
+     * @param imgSet
+     * @param id left or right image
+     * @param batch
+     * @return TensorShape
+     */
+    TensorShape shapeOf(const ImageSet &imgSet, ImageSet::BufferID id, uint32_t batch = 1) const;
+
+    /**
+     * @brief Write an image to a tensor of batch 1
+     *
+     * @param src
+     * @param srcStride bytes between rows of src, 0 for no padding
+     * @param srcFormat PIXEL_RGB8, PIXEL_BGR8 or PIXEL_GRAY8
+     * @param width
+     * @param height
+     * @param dst
+     * @param capacity size of dst in bytes, at least the size of the tensor
+     * @return TensorTransform
+     */
+    TensorTransform exportImage(const uint8_t *src, size_t srcStride, PixelFormat srcFormat,
+        uint32_t width, uint32_t height, void *dst, size_t capacity);
+
+    /**
+     * @brief Write the image id of imgSet to a tensor of batch 1
+     *
+     * @param imgSet
+     * @param id left or right image
+     * @param dst
+     * @param capacity size of dst in bytes, at least shapeOf(imgSet, id).bytes
+     * @return TensorTransform
+     */
+    TensorTransform exportImage(const ImageSet &imgSet, ImageSet::BufferID id, void *dst, size_t capacity);
+
+    /**
+     * @brief Write the image id of each ImageSet to a tensor of batch count, in order.
+     * Without a size in the options, the images must have the same size
+     *
+     * @param imgSets
+     * @param count
+     * @param id left or right image
+     * @param dst
+     * @param capacity size of dst in bytes, at least shapeOf(*imgSets[0], id, count).bytes
+     * @param transforms count transforms of the images, or nullptr
+     */
+    void exportBatch(const ImageSet *const *imgSets, uint32_t count, ImageSet::BufferID id,
+        void *dst, size_t capacity, TensorTransform *transforms = nullptr);
+
+private:
+    std::unique_ptr<TensorExporterImpl> _pImpl;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,327 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <math.h>
+#include <algorithm>
+#include <thread>
+
+#include <libsparkproto/tensorexportimpl.h>
+#include <libsparkproto/pixelconvert.h>
+#include <libsparkproto/exception.h>
+
+namespace libspark {
+
+namespace protocol {
+
+// rows of the smallest band, a row of a tensor is a few kB
+static constexpr uint32_t MIN_BAND_ROWS = 8;
+// sampling tables of this many image sizes are kept
+static constexpr size_t MAX_GEOMETRIES = 8;
+
+TensorExporterImpl::TensorExporterImpl(const TensorOptions &options)
+    : _options(options), _level(cpu::dispatchLevel()) {
+
+    if(!options.width != !options.height) {
+        throw SparkError("width and height of the tensor must be both set or both 0");
+    }
+    if(!(options.inputScale != 0.0f) || !isfinite(options.inputScale)) {
+        throw SparkError("input scale must be finite and not 0");
+    }
+    if(options.type != TENSOR_FLOAT32 && options.type != TENSOR_INT8) {
+        throw SparkError("tensor type " + std::to_string(options.type) + " is not supported");
+    }
+    if(options.type == TENSOR_INT8) {
+        if(!(options.quantScale > 0.0f) || !isfinite(options.quantScale)) {
+            throw SparkError("quantization scale must be positive");
+        }
+        if(options.zeroPoint < -128 || options.zeroPoint > 127) {
+            throw SparkError("zero point " + std::to_string(options.zeroPoint) + " is out of int8");
+        }
+    }
+
+    for(int c = 0; c < 3; c++) {
+        if(!(options.std[c] != 0.0f) || !isfinite(options.std[c]) || !isfinite(options.mean[c])) {
+            throw SparkError("mean and std of channel " + std::to_string(c) + " must be finite, std not 0");
+        }
+        _scale[c] = options.inputScale / options.std[c];
+        _offset[c] = -options.mean[c] / options.std[c];
+        if(options.type == TENSOR_INT8) {
+            _scale[c] /= options.quantScale;
+            _offset[c] = _offset[c] / options.quantScale + float(options.zeroPoint);
+        }
+    }
+
+    uint32_t threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+    if(threads > 1) {
+        _pool.reset(new ThreadPool(threads));
+    }
+}
+
+TensorExporterImpl::~TensorExporterImpl() {
+
+}
+
+const TensorOptions& TensorExporterImpl::options() const {
+    return _options;
+}
+
+TensorShape TensorExporterImpl::shapeOf(const ImageSet &imgSet, ImageSet::BufferID id, uint32_t batch) const {
+    return shapeOf(sourceOf(imgSet, id), batch);
+}
+
+TensorTransform TensorExporterImpl::exportImage(const uint8_t *src, size_t srcStride, PixelFormat srcFormat,
+    uint32_t width, uint32_t height, void *dst, size_t capacity) {
+
+    Source source;
+    source.data = src;
+    source.stride = srcStride ? srcStride : size_t(width) * pixelSize(srcFormat);
+    source.format = srcFormat;
+    source.width = width;
+    source.height = height;
+
+    TensorTransform transform;
+    exportSources(&source, 1, dst, capacity, &transform);
+    return transform;
+}
+
+void TensorExporterImpl::exportBatch(const ImageSet *const *imgSets, uint32_t count, ImageSet::BufferID id,
+    void *dst, size_t capacity, TensorTransform *transforms) {
+
+    _sources.clear();
+    for(uint32_t n = 0; n < count; n++) {
+        _sources.push_back(sourceOf(*imgSets[n], id));
+    }
+    exportSources(_sources.data(), count, dst, capacity, transforms);
+}
+
+TensorExporterImpl::Source TensorExporterImpl::sourceOf(const ImageSet &imgSet, ImageSet::BufferID id) {
+    if(id != ImageSet::BUFFER_LEFT && id != ImageSet::BUFFER_RIGHT) {
+        throw SparkError("only left and right images can be exported");
+    }
+    if((id == ImageSet::BUFFER_LEFT && !imgSet.hasLeft()) || (id == ImageSet::BUFFER_RIGHT && !imgSet.hasRight())) {
+        throw SparkError("the image to export is not in the ImageSet");
+    }
+
+    const ImageMeta &meta = id == ImageSet::BUFFER_LEFT ? imgSet.meta().left() : imgSet.meta().right();
+    const ImageSet::Buffer &buff = imgSet.getBuffer(id);
+
+    Source source;
+    source.format = pixelFormatOf(meta.format());
+    source.width = meta.width();
+    source.height = meta.height();
+    source.stride = size_t(source.width) * pixelSize(source.format);
+    source.data = buff.data();
+    if(buff.size() < imageSize(source.format, source.width, source.height)) {
+        throw SparkError("buffer of the image is smaller than its size in ImageMeta");
+    }
+    return source;
+}
+
+void TensorExporterImpl::checkSource(const Source &source) const {
+    if(source.format != PIXEL_RGB8 && source.format != PIXEL_BGR8 && source.format != PIXEL_GRAY8) {
+        throw SparkError("images of pixel format " + std::to_string(source.format) + " can't be exported");
+    }
+    if(source.width < 2 || source.height < 2) {
+        throw SparkError("image of " + std::to_string(source.width) + "x" + std::to_string(source.height) +
+            " pixels is too small to export");
+    }
+}
+
+TensorShape TensorExporterImpl::shapeOf(const Source &source, uint32_t batch) const {
+    checkSource(source);
+
+    TensorShape shape;
+    shape.batch = batch;
+    shape.channels = source.format == PIXEL_GRAY8 ? 1 : 3;
+    shape.width = _options.width ? _options.width : source.width;
+    shape.height = _options.height ? _options.height : source.height;
+    shape.bytes = size_t(batch) * shape.channels * shape.height * shape.width *
+        (_options.type == TENSOR_INT8 ? sizeof(int8_t) : sizeof(float));
+    return shape;
+}
+
+void TensorExporterImpl::exportSources(const Source *sources, uint32_t count, void *dst, size_t capacity,
+    TensorTransform *transforms) {
+
+    if(!count) {
+        return;
+    }
+
+    TensorShape shape = shapeOf(sources[0], count);
+    // geometries are dropped between batches only, the batch refers to them by index
+    if(_geometries.size() >= MAX_GEOMETRIES) {
+        _geometries.clear();
+    }
+    _sourceGeometries.resize(count);
+    for(uint32_t n = 0; n < count; n++) {
+        TensorShape imageShape = shapeOf(sources[n], count);
+        if(imageShape.channels != shape.channels || imageShape.width != shape.width || imageShape.height != shape.height) {
+            throw SparkError("image " + std::to_string(n) + " of the batch does not match the tensor of the first image");
+        }
+        _sourceGeometries[n] = geometryOf(sources[n].width, sources[n].height, shape);
+        if(transforms) {
+            transforms[n] = _geometries[_sourceGeometries[n]].transform;
+        }
+    }
+    if(capacity < shape.bytes) {
+        throw SparkError("tensor of " + std::to_string(shape.bytes) + " bytes does not fit to " +
+            std::to_string(capacity) + " bytes");
+    }
+
+    uint32_t rows = count * shape.height;
+    uint32_t bands = 1;
+    if(_pool) {
+        bands = std::max(1u, std::min(_pool->threadCount(), rows / MIN_BAND_ROWS));
+    }
+    if(_scratch.size() < bands) {
+        _scratch.resize(bands);
+    }
+
+    auto run = [&](uint32_t begin, uint32_t end) {
+        for(uint32_t i = begin; i < end; i++) {
+            Scratch &scratch = _scratch[i];
+            for(int slot = 0; slot < 2; slot++) {
+                scratch.rows[slot].resize(size_t(3) * shape.width);
+                scratch.sampled[slot] = -1;
+            }
+            uint32_t r0 = uint32_t(uint64_t(rows) * i / bands);
+            uint32_t r1 = uint32_t(uint64_t(rows) * (i + 1) / bands);
+            for(uint32_t r = r0; r < r1; r++) {
+                uint32_t n = r / shape.height;
+                exportRow(sources[n], _geometries[_sourceGeometries[n]], shape, n, r % shape.height, scratch, dst);
+            }
+        }
+    };
+    if(_pool && bands > 1) {
+        _pool->parallelFor(bands, 1, run);
+    } else {
+        run(0, bands);
+    }
+}
+
+uint32_t TensorExporterImpl::geometryOf(uint32_t srcWidth, uint32_t srcHeight, const TensorShape &shape) {
+    for(uint32_t i = 0; i < _geometries.size(); i++) {
+        const Geometry &geometry = _geometries[i];
+        // the size of the tensor follows from the size of the images and the options
+        if(geometry.srcWidth == srcWidth && geometry.srcHeight == srcHeight) {
+            return i;
+        }
+    }
+
+    Geometry geometry;
+    geometry.srcWidth = srcWidth;
+    geometry.srcHeight = srcHeight;
+    if(_options.letterbox) {
+        double scale = std::min(double(shape.width) / srcWidth, double(shape.height) / srcHeight);
+        geometry.width = std::max(1u, std::min(shape.width, uint32_t(lround(srcWidth * scale))));
+        geometry.height = std::max(1u, std::min(shape.height, uint32_t(lround(srcHeight * scale))));
+    } else {
+        geometry.width = shape.width;
+        geometry.height = shape.height;
+    }
+    geometry.x0 = (shape.width - geometry.width) / 2;
+    geometry.y0 = (shape.height - geometry.height) / 2;
+    geometry.transform.scaleX = float(geometry.width) / srcWidth;
+    geometry.transform.scaleY = float(geometry.height) / srcHeight;
+    geometry.transform.offsetX = float(geometry.x0);
+    geometry.transform.offsetY = float(geometry.y0);
+
+    // pixel centers are aligned, the last pixel samples its left neighbour with weight 1
+    auto mapAxis = [](uint32_t dstSize, uint32_t srcSize, std::vector<uint32_t> &index, std::vector<float> &weight) {
+        index.resize(dstSize);
+        weight.resize(dstSize);
+        double ratio = double(srcSize) / dstSize;
+        for(uint32_t i = 0; i < dstSize; i++) {
+            double s = std::min(std::max((i + 0.5) * ratio - 0.5, 0.0), double(srcSize - 1));
+            uint32_t left = std::min(uint32_t(s), srcSize - 2);
+            index[i] = left;
+            weight[i] = float(s - left);
+        }
+    };
+    mapAxis(geometry.width, srcWidth, geometry.columnIndex, geometry.columnWeight);
+    mapAxis(geometry.height, srcHeight, geometry.rowIndex, geometry.rowWeight);
+
+    // a gather reads 4 bytes at the right neighbour of 3 bytes per pixel
+    geometry.gatherCount = 0;
+    while(geometry.gatherCount < geometry.width && geometry.columnIndex[geometry.gatherCount] + 3 <= srcWidth) {
+        geometry.gatherCount++;
+    }
+
+    _geometries.push_back(std::move(geometry));
+    return uint32_t(_geometries.size() - 1);
+}
+
+void TensorExporterImpl::sample(const Source &source, const Geometry &geometry, uint32_t n, uint32_t y,
+    Scratch &scratch, int slot) {
+
+    int64_t key = (int64_t(n) << 32) | y;
+    if(scratch.sampled[slot] == key) {
+        return;
+    }
+    // consecutive rows of the tensor share their source rows when upscaling
+    if(scratch.sampled[1 - slot] == key) {
+        std::swap(scratch.rows[0], scratch.rows[1]);
+        std::swap(scratch.sampled[0], scratch.sampled[1]);
+        return;
+    }
+
+    size_t width = geometry.width;
+    float *planes[3] = {scratch.rows[slot].data(), scratch.rows[slot].data() + width,
+        scratch.rows[slot].data() + 2 * width};
+
+    tensor::ColumnMap columns;
+    columns.index = geometry.columnIndex.data();
+    columns.weight = geometry.columnWeight.data();
+    columns.count = geometry.width;
+    columns.gatherCount = geometry.gatherCount;
+    uint32_t channels = source.format == PIXEL_GRAY8 ? 1 : 3;
+    tensor::sampleRow(source.data + y * source.stride, channels, columns, planes, _level);
+    scratch.sampled[slot] = key;
+}
+
+void TensorExporterImpl::exportRow(const Source &source, const Geometry &geometry, const TensorShape &shape,
+    uint32_t n, uint32_t y, Scratch &scratch, void *dst) {
+
+    size_t planeSize = size_t(shape.height) * shape.width;
+    size_t rowOffset = size_t(n) * shape.channels * planeSize + size_t(y) * shape.width;
+    bool image = y >= geometry.y0 && y < geometry.y0 + geometry.height;
+    float weight = 0.0f;
+    if(image) {
+        uint32_t r = y - geometry.y0;
+        uint32_t top = geometry.rowIndex[r];
+        weight = geometry.rowWeight[r];
+        sample(source, geometry, n, top, scratch, 0);
+        sample(source, geometry, n, top + 1, scratch, 1);
+    }
+
+    for(uint32_t c = 0; c < shape.channels; c++) {
+        // channel c of the source is plane c of the scratch, it's reversed in the tensor if the orders differ
+        bool reversed = shape.channels == 3 && (source.format == PIXEL_BGR8) != _options.bgr;
+        uint32_t plane = reversed ? 2 - c : c;
+        size_t offset = rowOffset + plane * planeSize;
+        uint32_t padLeft = image ? geometry.x0 : shape.width;
+        uint32_t padRight = image ? shape.width - geometry.x0 - geometry.width : 0;
+        float pad = float(_options.padValue) * _scale[plane] + _offset[plane];
+        const float *top = scratch.rows[0].data() + size_t(c) * geometry.width;
+        const float *bottom = scratch.rows[1].data() + size_t(c) * geometry.width;
+
+        if(_options.type == TENSOR_INT8) {
+            int8_t *out = (int8_t *) dst + offset;
+            std::fill(out, out + padLeft, tensor::quantize(pad));
+            std::fill(out + shape.width - padRight, out + shape.width, tensor::quantize(pad));
+            if(image) {
+                tensor::blendRowInt8(top, bottom, weight, _scale[plane], _offset[plane], geometry.width, out + padLeft, _level);
+            }
+        } else {
+            float *out = (float *) dst + offset;
+            std::fill(out, out + padLeft, pad);
+            std::fill(out + shape.width - padRight, out + shape.width, pad);
+            if(image) {
+                tensor::blendRow(top, bottom, weight, _scale[plane], _offset[plane], geometry.width, out + padLeft, _level);
+            }
+        }
+    }
+}
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,101 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <libsparkproto/tensorexport.h>
+#include <libsparkproto/tensorkernels.h>
+#include <libsparkproto/threadpool.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class TensorExporterImpl {
+
+public:
+    TensorExporterImpl(const TensorOptions &options);
+
+    virtual ~TensorExporterImpl();
+
+    const TensorOptions& options() const;
+
+    TensorShape shapeOf(const ImageSet &imgSet, ImageSet::BufferID id, uint32_t batch) const;
+
+    TensorTransform exportImage(const uint8_t *src, size_t srcStride, PixelFormat srcFormat,
+        uint32_t width, uint32_t height, void *dst, size_t capacity);
+
+    void exportBatch(const ImageSet *const *imgSets, uint32_t count, ImageSet::BufferID id,
+        void *dst, size_t capacity, TensorTransform *transforms);
+
+private:
+    // an image of the batch
+    struct Source {
+        const uint8_t *data;
+        size_t stride;
+        PixelFormat format;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    // placement of images of a size in the tensor and their sampling tables
+    struct Geometry {
+        uint32_t srcWidth;
+        uint32_t srcHeight;
+        // region of the image in the tensor, the rest is padding
+        uint32_t x0;
+        uint32_t y0;
+        uint32_t width;
+        uint32_t height;
+        TensorTransform transform;
+        std::vector<uint32_t> columnIndex;
+        std::vector<float> columnWeight;
+        uint32_t gatherCount;
+        // top source row and weight of the bottom row of each row of the region
+        std::vector<uint32_t> rowIndex;
+        std::vector<float> rowWeight;
+    };
+
+    // sampled source rows of a band, top and bottom of a tensor row
+    struct Scratch {
+        std::vector<float> rows[2];
+        // source of the sampled rows, row index and image
+        int64_t sampled[2];
+    };
+
+    static Source sourceOf(const ImageSet &imgSet, ImageSet::BufferID id);
+
+    void checkSource(const Source &source) const;
+
+    TensorShape shapeOf(const Source &source, uint32_t batch) const;
+
+    void exportSources(const Source *sources, uint32_t count, void *dst, size_t capacity, TensorTransform *transforms);
+
+    // index of the geometry of images of a size in _geometries
+    uint32_t geometryOf(uint32_t srcWidth, uint32_t srcHeight, const TensorShape &shape);
+
+    // write row y of the tensor of image n
+    void exportRow(const Source &source, const Geometry &geometry, const TensorShape &shape,
+        uint32_t n, uint32_t y, Scratch &scratch, void *dst);
+
+    // point the sampled row of slot to row y of image n
+    void sample(const Source &source, const Geometry &geometry, uint32_t n, uint32_t y, Scratch &scratch, int slot);
+
+    TensorOptions _options;
+    cpu::Level _level;
+    std::unique_ptr<ThreadPool> _pool;
+    // per channel of the tensor, element = value * scale + offset before quantization
+    float _scale[3];
+    float _offset[3];
+
+    // kept between batches
+    std::vector<Geometry> _geometries;
+    std::vector<Scratch> _scratch;
+    std::vector<Source> _sources;
+    std::vector<uint32_t> _sourceGeometries;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,237 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <math.h>
+#include <algorithm>
+
+#include <libsparkproto/tensorkernels.h>
+
+#if defined(SPARK_CPU_X86)
+    #include <immintrin.h>
+#endif
+
+namespace libspark {
+
+namespace protocol {
+
+namespace tensor {
+
+//
+// generic, SIMD kernels compute the same float operations so all levels give identical tensors
+//
+
+static void sampleGeneric(const uint8_t *src, uint32_t channels, const ColumnMap &columns, float *const dst[3], uint32_t x) {
+    for(; x < columns.count; x++) {
+        const uint8_t *left = src + columns.index[x] * channels;
+        float weight = columns.weight[x];
+        for(uint32_t c = 0; c < channels; c++) {
+            float p0 = float(left[c]);
+            float p1 = float(left[channels + c]);
+            dst[c][x] = p0 + weight * (p1 - p0);
+        }
+    }
+}
+
+static void blendGeneric(const float *top, const float *bottom, float weight, float scale, float offset,
+    uint32_t x, uint32_t count, float *dst) {
+
+    for(; x < count; x++) {
+        dst[x] = (top[x] + weight * (bottom[x] - top[x])) * scale + offset;
+    }
+}
+
+int8_t quantize(float value) {
+    // clamped first, conversion of a float out of range is undefined
+    return int8_t(lrintf(std::min(std::max(value, -128.0f), 127.0f)));
+}
+
+static void blendInt8Generic(const float *top, const float *bottom, float weight, float scale, float offset,
+    uint32_t x, uint32_t count, int8_t *dst) {
+
+    for(; x < count; x++) {
+        dst[x] = quantize((top[x] + weight * (bottom[x] - top[x])) * scale + offset);
+    }
+}
+
+// SIMD kernels process the head of a row and return the number of columns done, the generic kernel finishes the row
+struct Kernels {
+    uint32_t (*sampleRgb)(const uint8_t *src, const ColumnMap &columns, float *const dst[3]);
+    uint32_t (*blend)(const float *top, const float *bottom, float weight, float scale, float offset,
+        uint32_t count, float *dst);
+    uint32_t (*blendInt8)(const float *top, const float *bottom, float weight, float scale, float offset,
+        uint32_t count, int8_t *dst);
+};
+
+static uint32_t sampleRgbNone(const uint8_t *, const ColumnMap &, float *const [3]) { return 0; }
+static uint32_t blendNone(const float *, const float *, float, float, float, uint32_t, float *) { return 0; }
+static uint32_t blendInt8None(const float *, const float *, float, float, float, uint32_t, int8_t *) { return 0; }
+
+static const Kernels GENERIC_KERNELS = {
+    sampleRgbNone, blendNone, blendInt8None
+};
+
+#if defined(SPARK_CPU_X86)
+
+//
+// SSE4.1, without gathers the sampling stays generic
+//
+
+__attribute__((target("sse4.1")))
+static inline __m128 blendSse41(const float *top, const float *bottom, __m128 weight, __m128 scale, __m128 offset) {
+    __m128 t = _mm_loadu_ps(top);
+    __m128 v = _mm_add_ps(t, _mm_mul_ps(weight, _mm_sub_ps(_mm_loadu_ps(bottom), t)));
+    return _mm_add_ps(_mm_mul_ps(v, scale), offset);
+}
+
+__attribute__((target("sse4.1")))
+static uint32_t blendRowSse41(const float *top, const float *bottom, float weight, float scale, float offset,
+    uint32_t count, float *dst) {
+
+    __m128 w = _mm_set1_ps(weight);
+    __m128 s = _mm_set1_ps(scale);
+    __m128 o = _mm_set1_ps(offset);
+    uint32_t x = 0;
+    for(; x + 4 <= count; x += 4) {
+        _mm_storeu_ps(dst + x, blendSse41(top + x, bottom + x, w, s, o));
+    }
+    return x;
+}
+
+__attribute__((target("sse4.1")))
+static uint32_t blendRowInt8Sse41(const float *top, const float *bottom, float weight, float scale, float offset,
+    uint32_t count, int8_t *dst) {
+
+    __m128 w = _mm_set1_ps(weight);
+    __m128 s = _mm_set1_ps(scale);
+    __m128 o = _mm_set1_ps(offset);
+    __m128 low = _mm_set1_ps(-128.0f);
+    __m128 high = _mm_set1_ps(127.0f);
+    uint32_t x = 0;
+    for(; x + 16 <= count; x += 16) {
+        __m128i q[4];
+        for(int i = 0; i < 4; i++) {
+            __m128 v = blendSse41(top + x + 4 * i, bottom + x + 4 * i, w, s, o);
+            q[i] = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(v, low), high));
+        }
+        __m128i packed = _mm_packs_epi16(_mm_packs_epi32(q[0], q[1]), _mm_packs_epi32(q[2], q[3]));
+        _mm_storeu_si128((__m128i *)(dst + x), packed);
+    }
+    return x;
+}
+
+//
+// AVX2
+//
+
+// pixels of 3 channels are gathered as 32-bit words, the channels of the left and right pixel
+// are the low 3 bytes of two gathers
+__attribute__((target("avx2")))
+static uint32_t sampleRgbAvx2(const uint8_t *src, const ColumnMap &columns, float *const dst[3]) {
+    __m256i three = _mm256_set1_epi32(3);
+    __m256i byte = _mm256_set1_epi32(0xff);
+    uint32_t x = 0;
+    for(; x + 8 <= columns.gatherCount; x += 8) {
+        __m256i offsets = _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i *)(columns.index + x)), three);
+        __m256i left = _mm256_i32gather_epi32((const int *) src, offsets, 1);
+        __m256i right = _mm256_i32gather_epi32((const int *)(src + 3), offsets, 1);
+        __m256 weight = _mm256_loadu_ps(columns.weight + x);
+        for(int c = 0; c < 3; c++) {
+            __m256 p0 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(left, 8 * c), byte));
+            __m256 p1 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(right, 8 * c), byte));
+            _mm256_storeu_ps(dst[c] + x, _mm256_add_ps(p0, _mm256_mul_ps(weight, _mm256_sub_ps(p1, p0))));
+        }
+    }
+    return x;
+}
+
+__attribute__((target("avx2")))
+static inline __m256 blendAvx2(const float *top, const float *bottom, __m256 weight, __m256 scale, __m256 offset) {
+    __m256 t = _mm256_loadu_ps(top);
+    __m256 v = _mm256_add_ps(t, _mm256_mul_ps(weight, _mm256_sub_ps(_mm256_loadu_ps(bottom), t)));
+    return _mm256_add_ps(_mm256_mul_ps(v, scale), offset);
+}
+
+__attribute__((target("avx2")))
+static uint32_t blendRowAvx2(const float *top, const float *bottom, float weight, float scale, float offset,
+    uint32_t count, float *dst) {
+
+    __m256 w = _mm256_set1_ps(weight);
+    __m256 s = _mm256_set1_ps(scale);
+    __m256 o = _mm256_set1_ps(offset);
+    uint32_t x = 0;
+    for(; x + 8 <= count; x += 8) {
+        _mm256_storeu_ps(dst + x, blendAvx2(top + x, bottom + x, w, s, o));
+    }
+    return x;
+}
+
+__attribute__((target("avx2")))
+static uint32_t blendRowInt8Avx2(const float *top, const float *bottom, float weight, float scale, float offset,
+    uint32_t count, int8_t *dst) {
+
+    __m256 w = _mm256_set1_ps(weight);
+    __m256 s = _mm256_set1_ps(scale);
+    __m256 o = _mm256_set1_ps(offset);
+    __m256 low = _mm256_set1_ps(-128.0f);
+    __m256 high = _mm256_set1_ps(127.0f);
+    // packs interleave the 128-bit lanes, the permutation restores the order of the 32-bit groups
+    __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    uint32_t x = 0;
+    for(; x + 32 <= count; x += 32) {
+        __m256i q[4];
+        for(int i = 0; i < 4; i++) {
+            __m256 v = blendAvx2(top + x + 8 * i, bottom + x + 8 * i, w, s, o);
+            q[i] = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(v, low), high));
+        }
+        __m256i packed = _mm256_packs_epi16(_mm256_packs_epi32(q[0], q[1]), _mm256_packs_epi32(q[2], q[3]));
+        _mm256_storeu_si256((__m256i *)(dst + x), _mm256_permutevar8x32_epi32(packed, order));
+    }
+    return x;
+}
+
+static const Kernels SSE41_KERNELS = {
+    sampleRgbNone, blendRowSse41, blendRowInt8Sse41
+};
+
+static const Kernels AVX2_KERNELS = {
+    sampleRgbAvx2, blendRowAvx2, blendRowInt8Avx2
+};
+
+#endif // SPARK_CPU_X86
+
+static const Kernels& kernelsOf(cpu::Level level) {
+#if defined(SPARK_CPU_X86)
+    if(level == cpu::LEVEL_AVX2) {
+        return AVX2_KERNELS;
+    }
+    if(level == cpu::LEVEL_SSE41) {
+        return SSE41_KERNELS;
+    }
+#endif
+    // NEON is part of the baseline of aarch64, the compiler vectorizes the generic blending for it
+    (void) level;
+    return GENERIC_KERNELS;
+}
+
+void sampleRow(const uint8_t *src, uint32_t channels, const ColumnMap &columns, float *const dst[3], cpu::Level level) {
+    uint32_t x = channels == 3 ? kernelsOf(level).sampleRgb(src, columns, dst) : 0;
+    sampleGeneric(src, channels, columns, dst, x);
+}
+
+void blendRow(const float *top, const float *bottom, float weight, float scale, float offset,
+    uint32_t count, float *dst, cpu::Level level) {
+
+    uint32_t x = kernelsOf(level).blend(top, bottom, weight, scale, offset, count, dst);
+    blendGeneric(top, bottom, weight, scale, offset, x, count, dst);
+}
+
+void blendRowInt8(const float *top, const float *bottom, float weight, float scale, float offset,
+    uint32_t count, int8_t *dst, cpu::Level level) {
+
+    uint32_t x = kernelsOf(level).blendInt8(top, bottom, weight, scale, offset, count, dst);
+    blendInt8Generic(top, bottom, weight, scale, offset, x, count, dst);
+}
+
+} // namespace tensor
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,81 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <stdint.h>
+
+#include <libsparkproto/cpufeatures.h>
+
+namespace libspark {
+
+namespace protocol {
+
+namespace tensor {
+
+/**
+ * @brief Bilinear sampling of the columns of a row: column x of dst is
+ * src[index[x]] + weight[x] * (src[index[x] + 1] - src[index[x]]) for each channel
+ *
+ */
+struct ColumnMap {
+    // left source pixel of each column, its right neighbour is in the row
+    const uint32_t *index = nullptr;
+    const float *weight = nullptr;
+    uint32_t count = 0;
+    // leading columns of which 4 bytes can be read from the right neighbour within the row
+    uint32_t gatherCount = 0;
+};
+
+/**
+ * @brief Sample a row of 8-bit pixels of 1 or 3 interleaved channels to a float plane per channel
+ *
+ * @param src
+ * @param channels
+ * @param columns
+ * @param dst channels planes of columns.count floats
+ * @param level
+ */
+void sampleRow(const uint8_t *src, uint32_t channels, const ColumnMap &columns, float *const dst[3], cpu::Level level);
+
+/**
+ * @brief Blend two sampled rows and normalize, dst[x] = (top[x] + weight * (bottom[x] - top[x])) * scale + offset
+ *
+ * @param top
+ * @param bottom
+ * @param weight
+ * @param scale
+ * @param offset
+ * @param count
+ * @param dst
+ * @param level
+ */
+void blendRow(const float *top, const float *bottom, float weight, float scale, float offset,
+    uint32_t count, float *dst, cpu::Level level);
+
+/**
+ * @brief Blend two sampled rows and quantize, as blendRow() rounded to the nearest even and saturated to int8
+ *
+ * @param top
+ * @param bottom
+ * @param weight
+ * @param scale
+ * @param offset
+ * @param count
+ * @param dst
+ * @param level
+ */
+void blendRowInt8(const float *top, const float *bottom, float weight, float scale, float offset,
+    uint32_t count, int8_t *dst, cpu::Level level);
+
+/**
+ * @brief Quantize a normalized value as blendRowInt8() does
+ *
+ * @param value
+ * @return int8_t
+ */
+int8_t quantize(float value);
+
+} // namespace tensor
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,104 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <algorithm>
+
+#include <libsparkproto/threadpool.h>
+#include <libsparkproto/exception.h>
+#include <libsparkproto/log.h>
+
+namespace libspark {
+
+namespace protocol {
+
+// ranges per worker of parallelFor, more ranges than workers even out ranges of different cost
+static constexpr uint32_t RANGES_PER_THREAD = 4;
+
+ThreadPool::ThreadPool(uint32_t threadCount) : _running(0), _stop(false) {
+    if(threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for(uint32_t i = 0; i < threadCount; i++) {
+        _workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _stop = true;
+        _taskCond.notify_all();
+    }
+
+    for(auto &worker : _workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(Task task) {
+    std::lock_guard<std::mutex> lock(_lock);
+    _tasks.push_back(std::move(task));
+    _taskCond.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(_lock);
+    _idleCond.wait(lock, [&]() { return _tasks.empty() && _running == 0; });
+}
+
+void ThreadPool::parallelFor(uint32_t count, uint32_t minRange, const RangeTask &task) {
+    minRange = std::max(1u, minRange);
+    uint32_t ranges = std::min<uint32_t>(threadCount() * RANGES_PER_THREAD, count / minRange);
+    if(ranges <= 1) {
+        task(0, count);
+        return;
+    }
+
+    uint32_t rangeSize = (count + ranges - 1) / ranges;
+    rangeSize = (rangeSize + minRange - 1) / minRange * minRange;
+    for(uint32_t begin = 0; begin < count; begin += rangeSize) {
+        uint32_t end = std::min(begin + rangeSize, count);
+        submit([&task, begin, end]() {
+            task(begin, end);
+        });
+    }
+    wait();
+}
+
+uint32_t ThreadPool::threadCount() const {
+    return _workers.size();
+}
+
+void ThreadPool::workerLoop() {
+    std::unique_lock<std::mutex> lock(_lock);
+
+    while(true) {
+        _taskCond.wait(lock, [&]() { return _stop || !_tasks.empty(); });
+        if(_tasks.empty()) {
+            break;
+        }
+
+        Task task = std::move(_tasks.front());
+        _tasks.pop_front();
+        _running++;
+
+        lock.unlock();
+        try {
+            task();
+        } catch (std::exception &e) {
+            LOG_ERROR("task of thread pool failed: %s", e.what());
+        } catch (...) {
+            LOG_ERROR("task of thread pool failed with an unknown exception");
+        }
+        lock.lock();
+
+        _running--;
+        if(_tasks.empty() && _running == 0) {
+            _idleCond.notify_all();
+        }
+    }
+}
+
+} // namespace protocol
+} // namespace libspark
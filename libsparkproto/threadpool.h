@@ -0,0 +1,83 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace libspark {
+
+namespace protocol {
+
+/**
+ * @brief A fixed set of worker threads running tasks in the order they are submitted
+ *
+ */
+class ThreadPool {
+
+public:
+    using Task = std::function<void()>;
+    using RangeTask = std::function<void(uint32_t begin, uint32_t end)>;
+
+    /**
+     * @brief Construct a new ThreadPool object
+     *
+     * @param threadCount number of workers, 0 for the number of CPU cores
+     */
+    ThreadPool(uint32_t threadCount);
+
+    /**
+     * @brief Destroy the ThreadPool object, queued tasks are finished first
+     *
+     */
+    virtual ~ThreadPool();
+
+    /**
+     * @brief Queue a task to be run by a worker
+     *
+     * @param task
+     */
+    void submit(Task task);
+
+    /**
+     * @brief Wait until all submitted tasks are finished
+     *
+     */
+    void wait();
+
+    /**
+     * @brief Split [0, count) in ranges of a multiple of minRange, a few per worker, run task on each range
+     * and wait until all tasks of the pool are finished. A single range is run in the calling thread
+     *
+     * @param count
+     * @param minRange
+     * @param task
+     */
+    void parallelFor(uint32_t count, uint32_t minRange, const RangeTask &task);
+
+    /**
+     * @brief Get number of workers
+     *
+     * @return uint32_t
+     */
+    uint32_t threadCount() const;
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> _workers;
+    std::deque<Task> _tasks;
+    uint32_t _running;
+    bool _stop;
+    std::mutex _lock;
+    std::condition_variable _taskCond;
+    std::condition_variable _idleCond;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,45 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <libsparkproto/voxelgrid.h>
+#include <libsparkproto/voxelgridimpl.h>
+
+namespace libspark {
+
+namespace protocol {
+
+VoxelGrid::VoxelGrid(const StereoIntrinsics &intrinsics, const VoxelGridOptions &options)
+    : _pImpl(new VoxelGridImpl(intrinsics, options)) {
+
+}
+
+VoxelGrid::~VoxelGrid() {
+
+}
+
+void VoxelGrid::setIntrinsics(const StereoIntrinsics &intrinsics) {
+    _pImpl->setIntrinsics(intrinsics);
+}
+
+StereoIntrinsics VoxelGrid::intrinsics() const {
+    return _pImpl->intrinsics();
+}
+
+const VoxelGridOptions& VoxelGrid::options() const {
+    return _pImpl->options();
+}
+
+void VoxelGrid::reduce(const uint16_t *disparity, uint32_t width, uint32_t height, VoxelCloud &voxels) {
+    _pImpl->reduce(disparity, width, height, voxels);
+}
+
+void VoxelGrid::reduceDepth(const float *depth, uint32_t width, uint32_t height, VoxelCloud &voxels) {
+    _pImpl->reduceDepth(depth, width, height, voxels);
+}
+
+void VoxelGrid::reduce(const ImageSet &imgSet, VoxelCloud &voxels) {
+    _pImpl->reduce(imgSet, voxels);
+}
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,151 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <libsparkproto/common.h>
+#include <libsparkproto/pointcloud.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class ImageSet;
+class VoxelGridImpl;
+
+/**
+ * @brief Options of VoxelGrid. The grid is a fixed box of dimX * dimY * dimZ cubic voxels in the camera frame,
+ * lengths are in the unit of the baseline, see StereoIntrinsics
+ *
+ */
+struct SPARK_API VoxelGridOptions {
+    // edge of a voxel
+    float voxelSize = 0.1f;
+
+    // lowest corner of the grid
+    float originX = -6.4f;
+    float originY = -3.2f;
+    float originZ = 0.0f;
+
+    // voxels along each axis, the grid has less than 2^32 voxels
+    uint32_t dimX = 128;
+    uint32_t dimY = 64;
+    uint32_t dimZ = 128;
+
+    // voxels of less points are left out
+    uint32_t minPoints = 1;
+
+    // compute the centroid of the points of each voxel, false for counts only
+    bool centroids = true;
+
+    // number of threads an image is split across in bands of rows, 0 for the number of CPU cores,
+    // 1 to run in the calling thread. Each thread bins to a grid of 16 bytes per voxel
+    uint32_t threads = 0;
+};
+
+/**
+ * @brief Occupied voxels of a VoxelGrid, in the order of their index i + dimX * (j + dimY * k).
+ * Vectors are resized to the voxels of the last image, their capacity is kept between images
+ *
+ */
+struct SPARK_API VoxelCloud {
+    // number of voxels
+    size_t size = 0;
+
+    // index of each voxel
+    std::vector<uint32_t> voxels;
+
+    // number of points of each voxel
+    std::vector<uint32_t> counts;
+
+    // x, y, z of the centroid of each voxel interleaved, empty without VoxelGridOptions::centroids
+    std::vector<float> xyz;
+};
+
+/**
+ * @brief VoxelGrid downsamples disparity or depth images to a grid of voxels without building the point cloud.
+ *
+ * Each row of pixels is projected to points as PointCloudGenerator does, the points are binned to their voxel
+ * and accumulated to the grid of the thread right away. Bands of rows run across threads, each to a grid of its own,
+ * and the grids are merged by their occupied voxels. Projection and binning use AVX2 or SSE4.1 when the CPU supports
+ * them, see libspark::protocol::cpu::dispatchLevel(). Points outside of the grid are left out.
+ *
+ * The grids are allocated once and cleared by their occupied voxels, images are reduced without allocations.
+ * A VoxelGrid is not thread-safe, use one per thread.
+ *
+ */
+class SPARK_API VoxelGrid {
+
+public:
+    /**
+     * @brief Construct a new VoxelGrid object. If intrinsics or options are invalid, a exception is thrown
+     *
+     * @param intrinsics
+     * @param options
+     */
+    explicit VoxelGrid(const StereoIntrinsics &intrinsics, const VoxelGridOptions &options = VoxelGridOptions());
+
+    /**
+     * @brief Destroy the VoxelGrid object
+     *
+     */
+    virtual ~VoxelGrid();
+
+    /**
+     * @brief Set intrinsics. If intrinsics are invalid, a exception is thrown
+     *
+     * @param intrinsics
+     */
+    void setIntrinsics(const StereoIntrinsics &intrinsics);
+
+    /**
+     * @brief Get intrinsics
+     *
+     * @return StereoIntrinsics
+     */
+    StereoIntrinsics intrinsics() const;
+
+    /**
+     * @brief Options of the grid
+     *
+     * @return const VoxelGridOptions&
+     */
+    const VoxelGridOptions& options() const;
+
+    /**
+     * @brief Reduce a disparity image to voxels
+     *
+     * @param disparity width * height values
+     * @param width
+     * @param height
+     * @param voxels
+     */
+    void reduce(const uint16_t *disparity, uint32_t width, uint32_t height, VoxelCloud &voxels);
+
+    /**
+     * @brief Reduce a depth image to voxels, pixels of depth 0, negative or not finite are invalid
+     *
+     * @param depth width * height floats
+     * @param width
+     * @param height
+     * @param voxels
+     */
+    void reduceDepth(const float *depth, uint32_t width, uint32_t height, VoxelCloud &voxels);
+
+    /**
+     * @brief Reduce the disparity image of imgSet to voxels, of 8 or 16 bits per pixel.
+     * If imgSet has no disparity image, a exception is thrown
+     *
+     * @param imgSet
+     * @param voxels
+     */
+    void reduce(const ImageSet &imgSet, VoxelCloud &voxels);
+
+private:
+    std::unique_ptr<VoxelGridImpl> _pImpl;
+};
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,292 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#include <math.h>
+#include <algorithm>
+#include <thread>
+
+#include <libsparkproto/voxelgridimpl.h>
+#include <libsparkproto/pointcloudimpl.h>
+#include <libsparkproto/exception.h>
+#include <libsparkproto/imageset.h>
+
+namespace libspark {
+
+namespace protocol {
+
+// a band bins to a grid of its own, it's worth the merge only for enough rows
+static constexpr uint32_t MIN_BAND_ROWS = 32;
+// words of occupied voxels merged by a thread
+static constexpr uint32_t MIN_MERGE_WORDS = 256;
+// float keeps the index of a voxel along an axis exact
+static constexpr uint32_t MAX_DIMENSION = 1u << 24;
+
+VoxelGridImpl::VoxelGridImpl(const StereoIntrinsics &intrinsics, const VoxelGridOptions &options)
+    : _options(options), _focalBaseline(0.0f), _cellCount(0), _level(cpu::dispatchLevel()), _columnScaleWidth(0) {
+
+    setIntrinsics(intrinsics);
+
+    if(!(options.voxelSize > 0.0f) || !isfinite(options.voxelSize)) {
+        throw SparkError("voxel size must be positive");
+    }
+    if(!isfinite(options.originX) || !isfinite(options.originY) || !isfinite(options.originZ)) {
+        throw SparkError("origin of the grid must be finite");
+    }
+    uint64_t cells = uint64_t(options.dimX) * options.dimY * options.dimZ;
+    if(!cells || options.dimX > MAX_DIMENSION || options.dimY > MAX_DIMENSION || options.dimZ > MAX_DIMENSION ||
+        cells >= cloud::INVALID_VOXEL) {
+        throw SparkError("grid of " + std::to_string(options.dimX) + "x" + std::to_string(options.dimY) + "x" +
+            std::to_string(options.dimZ) + " voxels is invalid");
+    }
+
+    _grid.originX = options.originX;
+    _grid.originY = options.originY;
+    _grid.originZ = options.originZ;
+    _grid.size = options.voxelSize;
+    _grid.inverseSize = 1.0f / options.voxelSize;
+    _grid.dimX = options.dimX;
+    _grid.dimY = options.dimY;
+    _grid.dimZ = options.dimZ;
+    _cellCount = size_t(cells);
+
+    uint32_t threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+    if(threads > 1) {
+        _pool.reset(new ThreadPool(threads));
+    }
+}
+
+VoxelGridImpl::~VoxelGridImpl() {
+
+}
+
+void VoxelGridImpl::setIntrinsics(const StereoIntrinsics &intrinsics) {
+    checkIntrinsics(intrinsics);
+
+    _intrinsics = intrinsics;
+    _focalBaseline = intrinsics.fx * intrinsics.baseline / intrinsics.disparityScale;
+    _columnScaleWidth = 0;
+}
+
+StereoIntrinsics VoxelGridImpl::intrinsics() const {
+    return _intrinsics;
+}
+
+const VoxelGridOptions& VoxelGridImpl::options() const {
+    return _options;
+}
+
+void VoxelGridImpl::reduce(const uint16_t *disparity, uint32_t width, uint32_t height, VoxelCloud &voxels) {
+    bin(width, height, [&](uint32_t y, const cloud::RowParams &params, const cloud::RowPoints &points) {
+        return cloud::projectDisparityRow(disparity + size_t(y) * width, width, params, points, _level);
+    }, voxels);
+}
+
+void VoxelGridImpl::reduceDepth(const float *depth, uint32_t width, uint32_t height, VoxelCloud &voxels) {
+    bin(width, height, [&](uint32_t y, const cloud::RowParams &params, const cloud::RowPoints &points) {
+        return cloud::projectDepthRow(depth + size_t(y) * width, width, params, points, _level);
+    }, voxels);
+}
+
+void VoxelGridImpl::reduce(const ImageSet &imgSet, VoxelCloud &voxels) {
+    if(!imgSet.hasDisparity()) {
+        throw SparkError("the ImageSet has no disparity image");
+    }
+
+    const ImageMeta &meta = imgSet.meta().disparity();
+    uint32_t width = meta.width();
+    uint32_t height = meta.height();
+    const ImageSet::Buffer &buff = imgSet.getBuffer(ImageSet::BUFFER_DISPARITY);
+    size_t pixels = size_t(width) * height;
+
+    if(buff.size() == pixels * 2) {
+        reduce((const uint16_t *) buff.data(), width, height, voxels);
+    } else if(buff.size() == pixels) {
+        _widened.resize(pixels);
+        runRanges(height, MIN_BAND_ROWS, [&](uint32_t y0, uint32_t y1) {
+            for(size_t i = size_t(y0) * width; i < size_t(y1) * width; i++) {
+                _widened[i] = buff[i];
+            }
+        });
+        reduce(_widened.data(), width, height, voxels);
+    } else {
+        throw SparkError("size of disparity buffer " + std::to_string(buff.size()) + " does not match image " +
+            std::to_string(width) + "x" + std::to_string(height));
+    }
+}
+
+void VoxelGridImpl::bin(uint32_t width, uint32_t height, const ProjectFunc &project, VoxelCloud &voxels) {
+    updateColumnScale(width);
+
+    uint32_t bands = 1;
+    if(_pool) {
+        bands = std::max(1u, std::min(_pool->threadCount(), height / MIN_BAND_ROWS));
+    }
+    if(_bands.size() < bands) {
+        _bands.resize(bands);
+    }
+
+    auto run = [&](uint32_t begin, uint32_t end) {
+        for(uint32_t i = begin; i < end; i++) {
+            uint32_t y0 = uint32_t(uint64_t(height) * i / bands);
+            uint32_t y1 = uint32_t(uint64_t(height) * (i + 1) / bands);
+            binBand(_bands[i], y0, y1, width, project);
+        }
+    };
+    if(_pool && bands > 1) {
+        _pool->parallelFor(bands, 1, run);
+    } else {
+        run(0, bands);
+    }
+
+    merge(bands);
+    emit(voxels);
+}
+
+void VoxelGridImpl::binBand(Band &band, uint32_t y0, uint32_t y1, uint32_t width, const ProjectFunc &project) {
+    // the grids are allocated zeroed on first use, then cleared by their occupied voxels
+    if(band.cells.size() != _cellCount) {
+        band.cells.assign(_cellCount, Cell());
+        band.occupied.assign((_cellCount + 63) / 64, 0);
+    }
+    // SIMD kernels store whole vectors past the last point of a row
+    size_t rowSize = size_t(width) + cloud::ROW_PADDING;
+    if(band.pixels.size() < rowSize) {
+        band.coords.resize(3 * rowSize);
+        band.pixels.resize(rowSize);
+        band.voxels.resize(rowSize);
+    }
+
+    cloud::RowPoints points;
+    points.x = band.coords.data();
+    points.y = points.x + rowSize;
+    points.z = points.y + rowSize;
+    points.pixels = band.pixels.data();
+
+    cloud::RowParams params;
+    params.columnScale = _columnScale.data();
+    params.focalBaseline = _focalBaseline;
+    params.minDisparity = _intrinsics.minDisparity;
+
+    Cell *cells = band.cells.data();
+    uint64_t *occupied = band.occupied.data();
+    const uint32_t *voxels = band.voxels.data();
+    bool centroids = _options.centroids;
+
+    for(uint32_t y = y0; y < y1; y++) {
+        params.rowScale = (float(y) - _intrinsics.cy) / _intrinsics.fy;
+        params.rowIndex = y * width;
+
+        uint32_t n = project(y, params, points);
+        cloud::voxelizeRow(points, n, _grid, band.voxels.data(), _level);
+
+        for(uint32_t i = 0; i < n; i++) {
+            uint32_t voxel = voxels[i];
+            if(voxel == cloud::INVALID_VOXEL) {
+                continue;
+            }
+            Cell &cell = cells[voxel];
+            if(!cell.count) {
+                occupied[voxel / 64] |= uint64_t(1) << (voxel % 64);
+            }
+            cell.count++;
+            if(centroids) {
+                cell.x += points.x[i];
+                cell.y += points.y[i];
+                cell.z += points.z[i];
+            }
+        }
+    }
+}
+
+void VoxelGridImpl::merge(uint32_t bands) {
+    if(bands < 2) {
+        return;
+    }
+
+    Band &target = _bands[0];
+    runRanges(uint32_t(target.occupied.size()), MIN_MERGE_WORDS, [&](uint32_t w0, uint32_t w1) {
+        for(uint32_t b = 1; b < bands; b++) {
+            Band &band = _bands[b];
+            for(uint32_t w = w0; w < w1; w++) {
+                uint64_t bits = band.occupied[w];
+                if(!bits) {
+                    continue;
+                }
+                target.occupied[w] |= bits;
+                band.occupied[w] = 0;
+                do {
+                    size_t voxel = size_t(w) * 64 + __builtin_ctzll(bits);
+                    Cell &src = band.cells[voxel];
+                    Cell &dst = target.cells[voxel];
+                    dst.x += src.x;
+                    dst.y += src.y;
+                    dst.z += src.z;
+                    dst.count += src.count;
+                    src = Cell();
+                    bits &= bits - 1;
+                } while(bits);
+            }
+        }
+    });
+}
+
+void VoxelGridImpl::emit(VoxelCloud &voxels) {
+    Band &band = _bands[0];
+    bool centroids = _options.centroids;
+    uint32_t minPoints = std::max(1u, _options.minPoints);
+
+    voxels.voxels.clear();
+    voxels.counts.clear();
+    voxels.xyz.clear();
+
+    uint32_t words = uint32_t(band.occupied.size());
+    for(uint32_t w = 0; w < words; w++) {
+        uint64_t bits = band.occupied[w];
+        if(!bits) {
+            continue;
+        }
+        band.occupied[w] = 0;
+        do {
+            uint32_t voxel = w * 64 + __builtin_ctzll(bits);
+            Cell &cell = band.cells[voxel];
+            if(cell.count >= minPoints) {
+                voxels.voxels.push_back(voxel);
+                voxels.counts.push_back(cell.count);
+                if(centroids) {
+                    uint32_t i = voxel % _grid.dimX;
+                    uint32_t j = (voxel / _grid.dimX) % _grid.dimY;
+                    uint32_t k = voxel / _grid.dimX / _grid.dimY;
+                    float scale = 1.0f / float(cell.count);
+                    voxels.xyz.push_back(_grid.originX + float(i) * _grid.size + cell.x * scale);
+                    voxels.xyz.push_back(_grid.originY + float(j) * _grid.size + cell.y * scale);
+                    voxels.xyz.push_back(_grid.originZ + float(k) * _grid.size + cell.z * scale);
+                }
+            }
+            cell = Cell();
+            bits &= bits - 1;
+        } while(bits);
+    }
+    voxels.size = voxels.voxels.size();
+}
+
+void VoxelGridImpl::updateColumnScale(uint32_t width) {
+    if(_columnScaleWidth == width) {
+        return;
+    }
+    _columnScale.resize(width);
+    for(uint32_t u = 0; u < width; u++) {
+        _columnScale[u] = (float(u) - _intrinsics.cx) / _intrinsics.fx;
+    }
+    _columnScaleWidth = width;
+}
+
+void VoxelGridImpl::runRanges(uint32_t count, uint32_t minRange, const RangeFunc &func) {
+    if(_pool) {
+        _pool->parallelFor(count, minRange, func);
+    } else {
+        func(0, count);
+    }
+}
+
+} // namespace protocol
+} // namespace libspark
@@ -0,0 +1,92 @@
+// Copyright 2021 Dynim Oy.
+// SPDX-License-Identifier: BSD 3-Clause
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <libsparkproto/voxelgrid.h>
+#include <libsparkproto/pointcloudkernels.h>
+#include <libsparkproto/threadpool.h>
+
+namespace libspark {
+
+namespace protocol {
+
+class VoxelGridImpl {
+
+public:
+    VoxelGridImpl(const StereoIntrinsics &intrinsics, const VoxelGridOptions &options);
+
+    virtual ~VoxelGridImpl();
+
+    void setIntrinsics(const StereoIntrinsics &intrinsics);
+
+    StereoIntrinsics intrinsics() const;
+
+    const VoxelGridOptions& options() const;
+
+    void reduce(const uint16_t *disparity, uint32_t width, uint32_t height, VoxelCloud &voxels);
+
+    void reduceDepth(const float *depth, uint32_t width, uint32_t height, VoxelCloud &voxels);
+
+    void reduce(const ImageSet &imgSet, VoxelCloud &voxels);
+
+private:
+    using RangeFunc = std::function<void(uint32_t begin, uint32_t end)>;
+    using ProjectFunc = std::function<uint32_t(uint32_t y, const cloud::RowParams &params, const cloud::RowPoints &points)>;
+
+    // sums of the offsets of the points in a voxel and their number
+    struct Cell {
+        float x;
+        float y;
+        float z;
+        uint32_t count;
+    };
+
+    // grid and row scratch of a band of rows, cells are zero where occupied is clear
+    struct Band {
+        std::vector<Cell> cells;
+        std::vector<uint64_t> occupied;
+        std::vector<float> coords;
+        std::vector<uint32_t> pixels;
+        std::vector<uint32_t> voxels;
+    };
+
+    // project the rows of each band and bin them to the grid of the band, merge the grids to voxels
+    void bin(uint32_t width, uint32_t height, const ProjectFunc &project, VoxelCloud &voxels);
+
+    void binBand(Band &band, uint32_t y0, uint32_t y1, uint32_t width, const ProjectFunc &project);
+
+    // add the grids of bands [1, bands) to the grid of band 0 and clear them
+    void merge(uint32_t bands);
+
+    // write the occupied voxels of band 0 and clear it
+    void emit(VoxelCloud &voxels);
+
+    // (u - cx) / fx of each column
+    void updateColumnScale(uint32_t width);
+
+    // run func over [0, count) in ranges of at least minRange, on the pool when there is one
+    void runRanges(uint32_t count, uint32_t minRange, const RangeFunc &func);
+
+    StereoIntrinsics _intrinsics;
+    VoxelGridOptions _options;
+    // fx * baseline / disparityScale
+    float _focalBaseline;
+    cloud::GridParams _grid;
+    size_t _cellCount;
+    cpu::Level _level;
+    std::unique_ptr<ThreadPool> _pool;
+
+    // scratch, kept between images
+    std::vector<Band> _bands;
+    std::vector<float> _columnScale;
+    uint32_t _columnScaleWidth;
+    // disparity of 8-bit images widened to 16 bits
+    std::vector<uint16_t> _widened;
+};
+
+} // namespace protocol
+} // namespace libspark